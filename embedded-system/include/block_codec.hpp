@@ -0,0 +1,62 @@
+#pragma once
+
+// Column-oriented block codec for journey records. Plain C++ with no Arduino
+// dependencies, so the same code runs on the device and in the host tools
+// (tools/jblock.cpp).
+//
+// A block holds up to BLOCK_RECORDS records stored column by column:
+//   0xB1 varint(payload length) payload
+//   payload = varint(count) column...
+// Integer columns are zigzag varints of the delta from the previous record
+// (delta-of-delta for position); float columns are varints of the XOR with
+// the previous value's bits. The first record is coded against zero.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOCK_RECORDS   64
+#define BLOCK_MARKER    0xB1
+#define BLOCK_COLUMNS   11
+// Worst case: every value a 5-byte varint, plus the block header
+#define BLOCK_MAX_BYTES (BLOCK_COLUMNS * BLOCK_RECORDS * 5 + 16)
+
+// Scale of the fixed-point position columns (1e-7 degree, about 1 cm)
+#define BLOCK_DEGREE_SCALE 10000000.0
+
+struct BlockRecord {
+    int32_t time;           // Seconds since midnight
+    int32_t latitude;       // Degrees * BLOCK_DEGREE_SCALE
+    int32_t longitude;
+    int32_t rpm;
+    int32_t speed;
+    int32_t throttle;
+    int32_t accelX;
+    int32_t accelY;
+    float maf;
+    float instantMPG;
+    float avgMPG;
+};
+
+class BlockEncoder {
+public:
+    void reset() { m_count = 0; }
+    // Returns false if the block is already full
+    bool add(const BlockRecord& record);
+    size_t count() const { return m_count; }
+    bool full() const { return m_count == BLOCK_RECORDS; }
+
+    // Writes the block to `out`; returns its size, or 0 if `size` is too small
+    size_t encode(uint8_t* out, size_t size) const;
+
+private:
+    BlockRecord m_records[BLOCK_RECORDS];
+    size_t m_count = 0;
+};
+
+// Decodes the block at the start of `in` into `out` (room for BLOCK_RECORDS).
+// Returns the bytes consumed, or 0 if the block is truncated or malformed.
+size_t blockDecode(const uint8_t* in, size_t length, BlockRecord* out, size_t& count);
+
+// Size and record count of the block at the start of `in`, from its header
+// alone. Returns 0 if the block is truncated or the header is malformed.
+size_t blockLength(const uint8_t* in, size_t length, size_t& count);
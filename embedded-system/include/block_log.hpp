@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include "journey.hpp"
+#include "block_codec.hpp"
+
+// Compact column-block copy of each journey (see block_codec.hpp), appended
+// one block at a time next to the NDJSON records
+#define BLOCK_LOG_EXT ".blk"
+
+// Journey lifecycle (caller must hold sdMutex)
+void blockLogBegin(const char* journeyPath);
+void blockLogAdd(const TelemetrySample& sample);
+void blockLogFinish();
+
+// Brings the block log of a recovered journey up to date with its records:
+// blocks still buffered in RAM at a power loss are rebuilt from the journey
+// and a torn last block is dropped. Caller must hold sdMutex.
+bool blockLogRebuild(const char* journeyPath);
+
+// Converts a logged sample to the codec's fixed-point record
+void blockRecordFromSample(const TelemetrySample& sample, BlockRecord& record);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// Append-only log of closed/changed journeys, one {"gen":N,"path":"..."} per line
+#define CATALOG_PATH "/.catalog"
+// Last generation acknowledged by the client
+#define SYNCED_PATH  "/.synced"
+
+// Loads the current and acknowledged generations (call once after SD init)
+void catalogBegin();
+
+// Records a new or changed journey and returns its generation.
+// Caller must hold sdMutex.
+uint32_t catalogAdd(const char* journeyPath);
+
+uint32_t catalogGeneration();
+uint32_t catalogSyncedGeneration();
+
+// Persists the generation the client has received. Caller must hold sdMutex.
+bool catalogAck(uint32_t gen);
+
+// Calls fn(gen, path) for every entry newer than `since`, in generation order.
+// Stops early when fn returns false. Caller must hold sdMutex.
+void catalogForEach(uint32_t since, bool (*fn)(uint32_t gen, const char* path, void* ctx), void* ctx);
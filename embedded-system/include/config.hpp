@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "record_codec.hpp"
+
+// Logger settings kept on the card, e.g. {"encoding":"msgpack","ubx_capture":true}
+#define CONFIG_PATH "/config.json"
+
+struct LoggerConfig {
+    RecordEncoding encoding;    // Encoding of new journeys; existing ones keep theirs
+    bool ubxCapture;            // Raw GNSS frames next to each journey (from the next GNSS start)
+};
+
+extern LoggerConfig loggerConfig;
+
+// Reads CONFIG_PATH; missing or unknown values keep their defaults.
+// Caller must hold sdMutex (or run before the tasks start).
+void configLoad();
+// Writes the current settings back to CONFIG_PATH. Caller must hold sdMutex.
+bool configSave();
+void configToJson(JsonObject out);
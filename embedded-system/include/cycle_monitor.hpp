@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Fixed-rate schedule and deadline check for dataTask. Cycles start on a
+// grid of CYCLE_PERIOD_MS (vTaskDelayUntil), so the time spent doing the
+// work no longer adds to the sample period. A cycle whose work takes longer
+// than CYCLE_DEADLINE_MS is an overrun, blamed on the phase that took the
+// most time; the next cycle then starts late, straight away, and slots
+// that passed entirely are skipped rather than run back to back.
+//
+// Phases are marked with CYCLE_PHASE() scopes, which may nest: time in an
+// inner phase is not counted in the outer one. Only dataTask records; the
+// counters are also exported on GET /metrics.
+
+#define CYCLE_PERIOD_MS   1000
+#define CYCLE_DEADLINE_MS 1000  // At most the period; lower it to keep slack
+// A cycle starting more than this after its slot counts as late
+#define CYCLE_LATE_MS     10
+
+enum CyclePhase : uint8_t {
+    CYCLE_OBD,
+    CYCLE_GNSS_PVT,
+    CYCLE_GNSS_ESF,
+    CYCLE_SD_MUTEX,
+    CYCLE_SD_RECORD,
+    CYCLE_SIDECARS,
+    CYCLE_SD_FLUSH,
+    CYCLE_OTHER,            // Outside any phase
+    CYCLE_PHASES
+};
+
+struct CycleStats {
+    uint32_t cycles;
+    uint32_t overruns;
+    uint32_t late;
+    uint32_t skipped;                   // Slots that passed with no cycle
+    uint32_t overrunsBy[CYCLE_PHASES];  // By the phase blamed
+    uint32_t worstUs;                   // Longest cycle
+};
+
+const char* cyclePhaseName(CyclePhase phase);     // "obd", "gnss_pvt", ...
+
+// Starts the schedule: the first slot is now
+void cycleMonitorBegin();
+// Marks the start of a cycle. Returns how late it is (ms) if by more than
+// CYCLE_LATE_MS, else 0
+uint32_t cycleBegin();
+// Marks the end of the work; true if it missed the deadline
+bool cycleEnd();
+// Sleeps until the next slot, or returns at once when it has passed
+void cycleWait();
+
+const CycleStats& cycleStats();
+
+// Charges the time from construction to destruction to a phase
+class CyclePhaseScope {
+public:
+    CyclePhaseScope(CyclePhase phase);
+    ~CyclePhaseScope();
+
+private:
+    CyclePhase m_outer;
+};
+
+#define CYCLE_PHASE_CONCAT_(a, b) a##b
+#define CYCLE_PHASE_CONCAT(a, b) CYCLE_PHASE_CONCAT_(a, b)
+#define CYCLE_PHASE(phase) CyclePhaseScope CYCLE_PHASE_CONCAT(cyclePhase, __LINE__)(phase)
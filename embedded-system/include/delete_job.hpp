@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// Pending delete roots, one path per line; rewritten as jobs are queued/finished
+#define DELETE_JOB_PATH     "/.deljob"
+#define DELETE_QUEUE_MAX    8
+#define DELETE_PATH_MAX     64
+// Entries removed per sdMutex hold
+#define DELETE_BATCH        8
+// Minimum time between delete steps (ms)
+#define DELETE_INTERVAL     10
+// Directory levels whose read position is kept between steps
+#define DELETE_DEPTH_MAX    4
+
+struct DeleteJobStatus {
+    bool running;
+    char path[DELETE_PATH_MAX];     // Root of the job in progress
+    uint8_t queued;                 // Jobs waiting, including the running one
+    uint32_t removed;               // Entries removed by the current/last job
+    uint32_t steps;
+    uint32_t maxHoldUs;             // Longest sdMutex hold by a single step
+    uint32_t completed;
+    uint32_t failed;
+    char lastError[48];
+};
+
+// Reloads queued jobs left by a previous boot (call once after SD init)
+void deleteJobBegin();
+
+// Queues a file or directory for background removal and persists the queue.
+// Caller must hold sdMutex.
+bool deleteJobQueue(const char* path);
+
+// Removes a journey ("/YYYY-MM-DD/HH-MM-SS.json") and its sidecars. A legacy
+// single file goes at once; a segment directory is queued. Caller must hold sdMutex.
+bool deleteJourney(const char* journeyPath);
+
+// True if `path` is queued or being deleted
+bool deleteJobPending(const char* path);
+
+// Removes up to DELETE_BATCH entries of the current job. Called from loop()
+// through storageService(); takes sdMutex itself without waiting.
+void deleteJobService();
+
+const DeleteJobStatus& deleteJobStatus();
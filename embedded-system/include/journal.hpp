@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// Fixed-size record naming the journey being written, its current segment and
+// the committed length of that segment
+#define JOURNAL_PATH    "/.journal"
+// One {"path":...,"committed":N,"size":N,"action":...} line per repaired journey
+#define RECOVERED_PATH  "/.recovered"
+#define JOURNAL_MAGIC   0x4A524E32UL   // "JRN2"
+
+struct JournalRecord {
+    uint32_t magic;
+    uint32_t seq;               // Incremented on every write
+    char path[40];              // Journey path; empty when no journey is open
+    uint16_t segment;           // Segment being written
+    uint16_t reserved;
+    uint32_t committed;         // Bytes of complete records in that segment
+    uint32_t check;             // Checksum of the fields above
+};
+
+// Result of the recovery pass at boot, reported by /sdinfo
+struct RecoveryReport {
+    uint32_t elapsedMs;
+    bool repaired;
+    char path[40];
+    uint32_t truncatedBytes;
+};
+
+// Checks the journal and repairs the journey that was open when power was
+// lost (call once after SD init and catalogBegin). Only that one file is
+// touched, so boot time does not grow with the number of journeys.
+void journalRecover();
+
+// Journey lifecycle; caller must hold sdMutex
+void journalOpen(const char* journeyPath);
+void journalCommit(uint16_t segment, uint32_t length);
+void journalClose();
+
+const RecoveryReport& journalRecovery();
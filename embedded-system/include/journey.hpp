@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include <ArduinoJson.h>
+#include "record_codec.hpp"
+
+// Thresholds (milli-g) above which an IMU sample counts as a harsh event
+#define HARSH_ACCEL_MG    300
+#define HARSH_BRAKE_MG    300
+#define HARSH_CORNER_MG   400
+
+// Sidecar extension for the per-journey summary (replaces ".json")
+#define SUMMARY_EXT ".sum"
+// Empty marker sidecar: a starred journey is never evicted by retention
+#define STAR_EXT    ".star"
+
+// One logged sample, as produced by dataTask every cycle
+struct TelemetrySample {
+    const char* time;       // "HH:MM:SS"
+    double latitude;
+    double longitude;
+    int rpm;
+    int speed;              // km/h
+    float maf;              // g/s
+    float instantMPG;
+    int throttle;           // %
+    float avgMPG;
+    int accelX;             // mg, longitudinal
+    int accelY;             // mg, lateral
+};
+
+// Running min/max/sum for a single channel
+struct ChannelStats {
+    float min;
+    float max;
+    double sum;
+    uint32_t count;
+
+    void reset();
+    void add(float value);
+    float mean() const;
+};
+
+// Aggregates for the journey currently being logged
+struct JourneyStats {
+    bool active;
+    char path[40];          // "YYYY-MM-DD/HH-MM-SS.json"
+    uint32_t gen;           // Catalog generation, set when the journey closes
+    char startTime[10];
+    char endTime[10];
+    double startLat, startLon;
+    double lastLat, lastLon;
+    bool hasFix;
+
+    uint32_t samples;
+    float durationSec;
+    float movingSec;
+    float idleSec;
+    double distanceKm;      // Haversine over GPS fixes
+    double obdMiles;        // Integrated OBD speed
+    double fuelGallons;     // Integrated MAF fuel flow
+
+    uint16_t harshAccel;
+    uint16_t harshBrake;
+    uint16_t harshCorner;
+    bool inAccel, inBrake, inCorner;
+
+    ChannelStats rpm, speed, maf, throttle, instantMPG, accelX, accelY;
+};
+
+extern JourneyStats journeyStats;
+
+// Great-circle distance between two coordinates in kilometres
+double haversineKm(double lat1, double lon1, double lat2, double lon2);
+
+// Journey lifecycle
+void journeyStatsBegin(JourneyStats& stats, const char* path);
+void journeyStatsUpdate(JourneyStats& stats, const TelemetrySample& sample, float deltaTime);
+float journeyStatsAverageMPG(const JourneyStats& stats);
+void journeyStatsToJson(const JourneyStats& stats, JsonObject out);
+bool journeyStatsWrite(JourneyStats& stats);
+
+// Parses one logged record into a sample; `time` receives the "HH:MM:SS" string
+bool journeyParseRecord(const char* line, size_t length, TelemetrySample& sample, char* time, size_t timeSize,
+                        RecordEncoding encoding = ENCODING_NDJSON);
+// Seconds between two "HH:MM:SS" times, allowing for a midnight rollover
+float journeyTimeDelta(const char* from, const char* to);
+// Recomputes the stats of a journey file from its records. Caller must hold sdMutex.
+bool journeyStatsRebuild(JourneyStats& stats, const char* journeyPath);
+
+// Sidecar helpers ("YYYY-MM-DD/HH-MM-SS.json" -> "YYYY-MM-DD/HH-MM-SS<ext>")
+bool journeySidecarPath(const char* journeyPath, const char* ext, char* out, size_t size);
+void journeyRemoveSidecars(const char* journeyPath);
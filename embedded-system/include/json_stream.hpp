@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <ArduinoJson.h>
+
+#define JSON_STREAM_BUF_SIZE  512
+#define JSON_STREAM_MAX_DEPTH 8
+
+// Writes a JSON response straight to the client using chunked transfer
+// encoding, through a fixed buffer instead of building a String in memory.
+class JsonStreamWriter {
+public:
+    explicit JsonStreamWriter(WebServer& server);
+
+    // Sends the status line and headers; the body follows as chunks
+    void begin(int code = 200, const char* contentType = "application/json");
+    // Flushes the buffer and sends the terminating chunk
+    void end();
+
+    void beginArray();
+    void endArray();
+    void beginObject();
+    void endObject();
+    void key(const char* name);
+
+    void value(const char* str);
+    void value(int32_t number);
+    void value(uint32_t number);
+    void value(uint64_t number);
+    void value(double number, uint8_t decimals = 2);
+    void value(bool flag);
+    // An ArduinoJson value, serialized straight into the stream
+    void value(JsonVariantConst json);
+    // Already serialized JSON (e.g. the contents of a sidecar file);
+    // append() continues a value started with raw()
+    void raw(const char* json, size_t length);
+    void append(const char* json, size_t length);
+
+    size_t bytesWritten() const { return m_total; }
+
+private:
+    struct Sink;
+
+    void separator();
+    void write(char c);
+    void write(const char* data, size_t length);
+    void flush();
+
+    WebServer& m_server;
+    char m_buf[JSON_STREAM_BUF_SIZE];
+    size_t m_len = 0;
+    size_t m_total = 0;
+    uint8_t m_depth = 0;
+    bool m_first[JSON_STREAM_MAX_DEPTH + 1];
+    bool m_afterKey = false;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Registry of latency histograms and counters, exported on GET /metrics as
+// one line per metric:
+//
+//   cycle_us count=120 sum=7234000 p50=58720 p90=61440 p99=90112 max=91234
+//   obd_pid_us{pid="010C"} count=480 sum=...
+//   http_bytes_total 1048576
+//   heap_free_bytes 182340
+//
+// Histograms are HDR-style: fixed log-linear buckets, exact below 4 and four
+// per power of two above (values within 19 %), so recording is a few atomic
+// increments with no allocation and no lock. Values are microseconds unless
+// the name says otherwise. Heap and PSRAM gauges are read at export time.
+//
+// Metrics are created on first lookup and live for the life of the program;
+// call sites keep the pointer in a static. Names and label values are stored
+// as pointers, so they must be string literals or live as long (task names,
+// route paths).
+
+#define METRICS_MAX          48
+#define METRIC_SUB_BITS      2
+#define METRIC_BUCKETS       ((32 - METRIC_SUB_BITS + 1) << METRIC_SUB_BITS)
+
+class MetricHistogram {
+public:
+    void record(uint32_t value);
+    uint32_t count() const { return m_count; }
+    uint64_t sum() const { return m_sum; }
+    uint32_t max() const { return m_max; }
+    // Middle of the bucket holding the p-th percentile (p in 0..100)
+    uint32_t percentile(float p) const;
+
+private:
+    uint32_t m_buckets[METRIC_BUCKETS] = {};
+    uint32_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint32_t m_max = 0;
+};
+
+class MetricCounter {
+public:
+    void add(uint32_t n = 1) { __atomic_fetch_add(&m_value, n, __ATOMIC_RELAXED); }
+    uint32_t value() const { return m_value; }
+
+private:
+    uint32_t m_value = 0;
+};
+
+// Found or created. Never null: once the registry is full, extra metrics
+// share one that is not exported.
+MetricHistogram* metricsHistogram(const char* name, const char* labelKey = nullptr,
+                                  const char* labelValue = nullptr);
+MetricCounter* metricsCounter(const char* name, const char* labelKey = nullptr,
+                              const char* labelValue = nullptr);
+
+// Receives the text export a piece at a time
+typedef void (*MetricsSink)(const char* data, size_t length, void* context);
+void metricsWrite(MetricsSink sink, void* context);
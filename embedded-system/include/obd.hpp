@@ -18,6 +18,8 @@ public:
     float calculateAverageMPG(float totalSpeedTimeProduct, float totalFuelTimeProduct);
 
 private:
+    friend struct ObdBench;     // tools/hotpath_bench.cpp
+
     // Helper Functions
     bool sendPIDCommand(const char* pid, char* response, int bufsize);
     int parseHexValue(const char* response, int startIndex, int length);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include "journey.hpp"
+
+// Overview levels kept per journey (bucket width in seconds and sidecar extension)
+#define OVERVIEW_LEVELS 2
+#define OVERVIEW_FINE_SEC    10
+#define OVERVIEW_COARSE_SEC  60
+#define OVERVIEW_FINE_EXT    ".l10"
+#define OVERVIEW_COARSE_EXT  ".l60"
+
+// Aggregate of all samples that fall into one time bucket
+struct OverviewBucket {
+    uint32_t index;             // Bucket number since journey start
+    uint16_t count;
+    char time[10];              // Time of the first sample
+    double firstLat, firstLon;
+    double lastLat, lastLon;
+    ChannelStats speed, rpm, throttle, maf, instantMPG, accelX, accelY;
+};
+
+struct OverviewLevel {
+    uint16_t widthSec;
+    const char* ext;
+    OverviewBucket bucket;
+    FsFile file;                // Sidecar, open for the whole journey
+};
+
+// Journey lifecycle (caller must hold sdMutex)
+void overviewBegin(const char* journeyPath);
+void overviewUpdate(const TelemetrySample& sample, float elapsedSec);
+void overviewFinish();
+
+// Sidecar extension for a bucket width, or nullptr if there is no such level
+const char* overviewLevelExt(int widthSec);
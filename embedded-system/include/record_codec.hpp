@@ -0,0 +1,38 @@
+#pragma once
+
+// Encodings for journey records: NDJSON (one JSON object per line), or
+// MessagePack / CBOR items written back to back. Depends only on ArduinoJson,
+// so the host tools (tools/record_bench.cpp) use the same code.
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest record accepted, in any encoding; longer records are skipped
+#define RECORD_MAX_LEN 384
+
+enum RecordEncoding : uint8_t {
+    ENCODING_NDJSON,
+    ENCODING_MSGPACK,
+    ENCODING_CBOR,
+    ENCODING_COUNT
+};
+
+const char* recordEncodingName(RecordEncoding encoding);         // "ndjson", "msgpack", "cbor"
+const char* recordEncodingExt(RecordEncoding encoding);          // ".json", ".mpk", ".cbor"
+const char* recordEncodingContentType(RecordEncoding encoding);
+bool recordEncodingParse(const char* name, RecordEncoding& encoding);
+
+// Serializes one record into `out` (NDJSON includes the newline).
+// Returns the bytes written, or 0 if they do not fit.
+size_t recordSerialize(JsonVariantConst record, RecordEncoding encoding, uint8_t* out, size_t size);
+
+// Size of the MessagePack/CBOR item at `in`, or 0 if it is incomplete or malformed
+size_t recordItemLength(const uint8_t* in, size_t length, RecordEncoding encoding);
+
+// Parses one record (an NDJSON line without its newline, or one binary item),
+// keeping only the fields allowed by `filter`
+DeserializationError recordDeserialize(JsonDocument& doc, const char* in, size_t length,
+                                       RecordEncoding encoding, JsonVariantConst filter);
+DeserializationError recordDeserialize(JsonDocument& doc, const char* in, size_t length,
+                                       RecordEncoding encoding);
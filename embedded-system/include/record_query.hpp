@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Builds an ArduinoJson filter from a comma separated list of "group.channel"
+// (or whole "group") names. gps.time is always kept as the time axis; an
+// empty list keeps everything. Returns false if a field name is malformed.
+bool recordFieldFilter(const String& fields, JsonDocument& filter);
+
+// from/to time window over the records of a journey, in file order. Times
+// are "HH:MM:SS" and a drive may cross midnight, so records are placed by
+// their elapsed time since the first record checked, and the bounds
+// relative to that record: a bound more than 12 h after it is taken as
+// lying before it.
+class RecordWindow {
+public:
+    // Empty bounds are open. False if a bound is not "HH:MM:SS".
+    bool begin(const char* from, const char* to);
+
+    // -1 before the window, 0 inside it, 1 past its end (and so are all
+    // later records). Records without a time keep the last one's place.
+    int check(const char* time);
+
+private:
+    char m_from[9];
+    char m_to[9];
+    char m_last[9];
+    long m_elapsed;
+    long m_fromElapsed;
+    long m_toElapsed;
+};
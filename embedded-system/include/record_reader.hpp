@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include "record_codec.hpp"
+
+class JourneyFile;
+
+// Buffered record reader over an open file or journey: newline-delimited
+// JSON, or back-to-back MessagePack/CBOR items for segments in those encodings
+class RecordReader {
+public:
+    explicit RecordReader(FsFile& file);
+    explicit RecordReader(JourneyFile& journey);
+
+    // Returns the next non-empty record (without the newline), or nullptr at EOF
+    const char* next(size_t& length);
+
+    // Encoding of the records returned by next() (see recordDeserialize())
+    RecordEncoding encoding() const { return m_encoding; }
+
+    // Byte offset of the start of the record last returned by next()
+    uint64_t recordOffset() const { return m_recordOffset; }
+
+private:
+    bool fill();
+    const char* nextItem(size_t& length);
+
+    FsFile* m_file = nullptr;
+    JourneyFile* m_journey = nullptr;
+    RecordEncoding m_encoding = ENCODING_NDJSON;
+    uint8_t m_buf[512];
+    size_t m_pos = 0;
+    size_t m_len = 0;
+    uint64_t m_bufOffset = 0;       // File offset of m_buf[0]
+    uint64_t m_recordOffset = 0;
+    char m_line[RECORD_MAX_LEN + 1];
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// --- Retention policy ---
+// Start evicting when free space drops below RETAIN_LOW_FREE_MB and keep going
+// until RETAIN_TARGET_FREE_MB is free again
+#define RETAIN_LOW_FREE_MB      256
+#define RETAIN_TARGET_FREE_MB   512
+// Evict while more than this is used (0 = no cap)
+#define RETAIN_MAX_USED_MB      0
+// Evict journeys from days more than this many days before the newest day (0 = keep)
+#define RETAIN_MAX_AGE_DAYS     0
+// Starred journeys (STAR_EXT sidecar) are never evicted
+#define RETAIN_KEEP_STARRED     1
+
+// Time between eviction steps while evicting, and between checks otherwise (ms)
+#define RETAIN_STEP_INTERVAL    200
+#define RETAIN_IDLE_INTERVAL    5000
+// Pause after a pass has been through every day folder (ms)
+#define RETAIN_BLOCKED_INTERVAL 60000
+
+struct RetentionStatus {
+    bool evicting;              // Below the free-space / size thresholds
+    bool blocked;               // Space wanted but nothing can be evicted
+    uint32_t evicted;           // Journeys removed since boot
+    uint64_t evictedBytes;
+    char lastEvicted[40];       // "YYYY-MM-DD/HH-MM-SS.json"
+};
+
+// Evicts at most one journey per call: the oldest journey that has been
+// synced (summary gen <= acknowledged generation) and is not starred.
+// Called from loop() through storageService(); takes sdMutex without waiting,
+// and never runs in the logging path.
+void retentionService();
+
+const RetentionStatus& retentionStatus();
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Every SD access holds sdMutex (created in setup()). Taking and giving it
+// through these records, per task, the wait in sd_mutex_wait_us, the hold
+// in sd_mutex_hold_us and timeouts in sd_mutex_timeouts_total (/metrics).
+extern SemaphoreHandle_t sdMutex;
+
+// As xSemaphoreTake(sdMutex, timeout)
+BaseType_t sdMutexTake(TickType_t timeout);
+void sdMutexGive();
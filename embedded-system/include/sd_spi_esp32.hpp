@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+#if SPI_DRIVER_SELECT == 3
+#include <driver/spi_master.h>
+
+#define SD_SPI_HOST        SPI2_HOST
+#define SD_SPI_CHUNK       4096    // Largest single DMA transaction (bytes)
+#define SD_SPI_QUEUE       4       // Transactions in flight for long transfers
+#define SD_SPI_DMA_MIN     32      // Shorter transfers use polling instead of DMA
+
+// SdFat SPI driver on the IDF SPI master. Sector payloads go out as DMA
+// transactions (queued when longer than one chunk) and the bus stays
+// acquired between activate() and deactivate(), so SdFat's dedicated-SPI
+// multi-block transfers never re-arbitrate the bus.
+class SdSpiEsp32 : public SdSpiBaseClass {
+public:
+    void begin(SdSpiConfig config) override;
+    void end() override;
+    void activate() override;
+    void deactivate() override;
+
+    uint8_t receive() override;
+    uint8_t receive(uint8_t* buf, size_t count) override;
+    void send(uint8_t data) override;
+    void send(const uint8_t* buf, size_t count) override;
+
+    // Applied on the next activate(); the device is re-added at the new clock
+    void setSckSpeed(uint32_t maxSck) override { m_clockHz = maxSck; }
+
+private:
+    bool attach();
+    uint8_t transfer(const uint8_t* tx, uint8_t* rx, size_t count);
+
+    spi_device_handle_t m_device = nullptr;
+    uint32_t m_clockHz = 400000;
+    uint32_t m_deviceHz = 0;        // Clock m_device was added with
+    bool m_busReady = false;
+    uint8_t* m_ones = nullptr;      // DMA-capable 0xFF block clocked out while reading
+};
+
+extern SdSpiEsp32 sdSpi;
+#endif  // SPI_DRIVER_SELECT == 3
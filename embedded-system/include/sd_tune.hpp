@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// Hidden, preallocated scratch file whose sectors the probe overwrites
+#define SD_PROBE_PATH     "/.sdprobe"
+#define SD_PROBE_SECTORS  64        // 32 KB
+#define SD_PROBE_ROUNDS   3         // Clean passes required per clock step
+// Clock used to mount the card before probing (the previous fixed rate)
+#define SD_SAFE_SCK       SD_SCK_MHZ(1)
+
+// Result of the start-up probe, reported by /sdinfo
+struct SdTuneResult {
+    bool mounted;
+    uint32_t clockHz;       // Clock the card runs at
+    uint32_t maxPassHz;     // Fastest clock that passed every round
+    float readMBps;         // Measured at clockHz
+    float writeMBps;
+};
+
+extern SdTuneResult sdTune;
+
+// Mounts the card at the fastest reliable SPI clock (with one step of margin
+// below the fastest step that passed) and measures throughput. Returns false
+// if the card cannot be mounted at all.
+bool sdAutoTune(SdCsPin_t csPin);
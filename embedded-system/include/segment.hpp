@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include "record_codec.hpp"
+
+// A journey "YYYY-MM-DD/HH-MM-SS.json" is stored as fixed-size segments
+// "YYYY-MM-DD/HH-MM-SS/000.json", "001.json", ... Each one holds whole records
+// and is closed (and never written again) once it reaches SEGMENT_BYTES.
+// The segment extension gives the record encoding (.json, .mpk or .cbor).
+#define SEGMENT_BYTES         65536
+#define SEGMENT_MAX           999
+// Flat sidecar listing the closed segments, one {"seg":N,"bytes":B} per line
+#define SEGMENT_MANIFEST_EXT  ".seg"
+
+// "YYYY-MM-DD/HH-MM-SS.json" -> "YYYY-MM-DD/HH-MM-SS" / ".../NNN<ext>"
+bool segmentDirPath(const char* journeyPath, char* out, size_t size);
+bool segmentPath(const char* journeyPath, uint16_t index, RecordEncoding encoding, char* out, size_t size);
+
+// True if the journey is stored as segments. Caller must hold sdMutex.
+bool segmentIsSegmented(const char* journeyPath);
+// True if the journey is on the card, as a single file or as segments.
+// Caller must hold sdMutex.
+bool segmentJourneyExists(const char* journeyPath);
+// Encoding of a segmented journey's records (NDJSON if it has no segments).
+// Caller must hold sdMutex.
+RecordEncoding segmentEncoding(const char* journeyPath);
+
+// Writer side, used by dataTask; caller must hold sdMutex
+bool segmentOpen(const char* journeyPath, uint16_t index, RecordEncoding encoding, FsFile& file);
+bool segmentClose(const char* journeyPath, uint16_t index, FsFile& file);
+// Rewrites the manifest from the segment files on the card (used by recovery)
+bool segmentManifestRebuild(const char* journeyPath);
+
+// Read-only view of a journey: a single legacy file or its segments stitched
+// together in order, with offsets continuous across segment boundaries.
+class JourneyFile {
+public:
+    // Caller must hold sdMutex for open(), close() and each read or seek
+    bool open(const char* journeyPath);
+    void close();
+
+    int read(void* buf, size_t count);
+    bool seekSet(uint64_t position);
+    uint64_t curPosition() const { return m_segmentStart + m_file.curPosition(); }
+    uint64_t size() const { return m_size; }
+    bool available() { return curPosition() < m_size; }
+
+    bool segmented() const { return m_segmented; }
+    uint16_t segmentCount() const { return m_segments; }
+    RecordEncoding encoding() const { return m_encoding; }
+
+    explicit operator bool() const { return m_isOpen; }
+
+private:
+    bool openSegment(uint16_t index);
+
+    char m_journey[48];
+    FsFile m_file;
+    bool m_isOpen = false;
+    bool m_segmented = false;
+    RecordEncoding m_encoding = ENCODING_NDJSON;
+    uint16_t m_segments = 0;
+    uint16_t m_segment = 0;
+    uint64_t m_segmentStart = 0;    // Journey offset of the current segment
+    uint64_t m_size = 0;
+};
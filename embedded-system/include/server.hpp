@@ -9,7 +9,16 @@ void handleRoot();
 void handleDays();
 void handleDrives();
 void handleDrive();
+void handleSummary();
+void handleOverview();
 void handleLiveData();
+void handleSegments();
+void handleSegment();
+void handleSync();
+void handleSyncAck();
+void handleStar();
+void handleConfig();
+void handleConfigUpdate();
 void handleSDInfo();
 
 
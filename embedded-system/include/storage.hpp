@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// FAT/bitmap sectors counted per sdMutex hold by the background scan
+#define FREE_SCAN_SECTORS   8
+// Minimum time between background scan steps (ms)
+#define FREE_SCAN_INTERVAL  20
+
+// Advances background storage work (free-space count, queued deletes,
+// retention) a small slice at a time. Called from loop(); never waits for sdMutex, so it
+// cannot delay logging or requests.
+void storageService();
+
+// True once the free-cluster count is known and maintained incrementally.
+// Caller must hold sdMutex.
+bool storageFreeKnown();
+
+// Card capacity and free bytes from the maintained count; false while the
+// count is still being computed. Caller must hold sdMutex.
+bool storageSpace(uint64_t& totalBytes, uint64_t& freeBytes);
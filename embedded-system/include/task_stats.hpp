@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Time between samples (ms) and samples kept: 5 minutes of history
+#define TASK_STATS_INTERVAL 5000
+#define TASK_STATS_HISTORY  60
+// Tasks reported per sample (the rest are counted but not listed)
+#define TASK_STATS_MAX      16
+// Names of the idle tasks (one per core) start with this
+#define TASK_STATS_IDLE     "IDLE"
+
+// CPU time per task and core load need the trace facility and run time
+// stats (CONFIG_FREERTOS_USE_TRACE_FACILITY and
+// CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS in sdkconfig). Without them the
+// runtime_ms, cpu_pct and load_pct fields are left out of the JSON.
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+#define TASK_STATS_RUN_TIME 1
+#else
+#define TASK_STATS_RUN_TIME 0
+#endif
+
+struct TaskInfo {
+    char name[configMAX_TASK_NAME_LEN];
+    int8_t core;                // -1 when not pinned
+    uint8_t priority;
+    uint32_t stackFree;         // Bytes of stack never used (high-water mark)
+    uint64_t runtimeMs;         // CPU time since first seen; 0 without run time stats
+    float cpuPercent;           // Share of one core over the last interval
+};
+
+struct SystemSample {
+    uint32_t uptimeSec;
+    uint32_t heapFree;
+    uint32_t heapMinFree;       // Lowest free heap since boot
+    uint32_t heapLargest;       // Largest free block: fragmentation shows here first
+    uint32_t psramFree;
+    uint32_t psramLargest;
+    int8_t load[2];             // Busy % per core over the interval; -1 unknown
+};
+
+// Tasks to report when FreeRTOS is built without the trace facility, which
+// lists every task (the Arduino core's ESP32 build has it)
+void taskStatsWatch(TaskHandle_t task);
+
+// Samples every TASK_STATS_INTERVAL. Called from loop(); the results below
+// are only read from the loop task (the web server), so no lock is needed.
+void taskStatsService();
+
+#if configUSE_TRACE_FACILITY
+// Folds one uxTaskGetSystemState() snapshot into the task list and the
+// sample's core load (taskStatsService() does this every interval). Run
+// time counters are 32 bits and wrap, so each task's CPU time is summed
+// from the advance between snapshots into 64 bits.
+void taskStatsSample(const TaskStatus_t* status, UBaseType_t count, uint32_t totalRunTime, SystemSample& sample);
+#endif
+
+// Tasks at the last sample; count is the number listed, total all tasks
+const TaskInfo* taskStatsTasks(size_t& count, size_t& total);
+// Samples, oldest first; i in 0..taskStatsHistorySize()-1
+size_t taskStatsHistorySize();
+const SystemSample& taskStatsHistory(size_t i);
+
+// task_count and tasks[] of the last sample
+void taskStatsToJson(JsonObject out);
+// A sample's heap and PSRAM fields and load_pct
+void systemSampleToJson(const SystemSample& sample, JsonObject out);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+class JourneyFile;
+
+// Sparse seek index written next to each journey: a header followed by one
+// entry every TIME_INDEX_EVERY records
+#define TIME_INDEX_EXT    ".idx"
+#define TIME_INDEX_EVERY  30
+#define TIME_INDEX_MAGIC  0x31584954    // "TIX1"
+
+struct TimeIndexHeader {
+    uint32_t magic;
+    char startTime[12];     // "HH:MM:SS" of the first record
+};
+
+struct TimeIndexEntry {
+    uint32_t elapsed;       // Seconds since the first record (monotonic across midnight)
+    uint32_t offset;        // Journey byte offset of the record
+};
+
+// Writer side, called by dataTask for every logged record; caller must hold sdMutex
+void timeIndexBegin(const char* journeyPath);
+void timeIndexUpdate(const char* time, uint64_t offset);
+
+// Offset of the last indexed record at or before `time` ("HH:MM:SS"), by
+// binary search of the sidecar. Entries at or past `size` (cut off by a
+// recovery) are ignored. False if the journey has no index.
+// Caller must hold sdMutex.
+bool timeIndexSeek(const char* journeyPath, const char* time, uint64_t size, uint64_t& offset);
+
+// Linear fallback for journeys without an index: offset of the first record
+// at or after `time`, reading from the start of `file`. Caller must hold sdMutex.
+bool timeIndexScan(JourneyFile& file, const char* time, uint64_t& offset);
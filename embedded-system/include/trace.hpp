@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Low-overhead timeline of where the data cycle and the web server spend
+// their time. Trace points record into a fixed ring per core: a slot is
+// claimed with an atomic increment, so recording never blocks and never
+// allocates, and the oldest events are overwritten. Timestamps come from the
+// CPU cycle counter, extended to 64 bits against esp_timer.
+//
+// The rings are exported as Chrome Trace Event JSON (GET /trace, or to the
+// card with /trace?save=1) for ui.perfetto.dev or chrome://tracing.
+//
+// Build with -DTRACE_ENABLED=0 to compile every trace point out.
+//
+// Names and args are stored as pointers, so they must be string literals
+// (or otherwise live for the life of the program).
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS 512   // Per core, 24-32 bytes each
+#endif
+#define TRACE_CORES 2
+#define TRACE_SD_PATH "/trace.json"
+
+// Receives the JSON export a piece at a time
+typedef void (*TraceSink)(const char* data, size_t length, void* context);
+
+#if TRACE_ENABLED
+
+// A slice from construction to destruction (Chrome phase "X")
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* arg = nullptr);
+    ~TraceScope();
+
+private:
+    const char* m_name;
+    const char* m_arg;
+    uint64_t m_start;
+};
+
+void traceInstant(const char* name, const char* arg = nullptr);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, arg)
+#define TRACE_INSTANT(name) traceInstant(name)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_SCOPE_ARG(name, arg) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+
+#endif
+
+// Writes the events recorded since the last traceClear(); returns how many
+// (an empty trace when compiled out). Recording carries on meanwhile; an
+// event overwritten while it is being copied is left out.
+size_t traceWrite(TraceSink sink, void* context);
+// Same, into TRACE_SD_PATH; caller must hold sdMutex
+size_t traceSave();
+void traceClear();
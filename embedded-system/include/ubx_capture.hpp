@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+class SFE_UBLOX_GNSS;
+
+// Raw receiver output kept next to a journey when "ubx_capture" is set in
+// the config: every NAV-PVT, ESF-INS and ESF-STATUS frame the GNSS library
+// processes, byte for byte as it came off the bus. The file is a plain UBX
+// stream (as u-center logs), so it replays into the library on the host
+// (SimUblox::replay) for regression tests and benchmarks.
+#define UBX_CAPTURE_EXT     ".ubx"
+#define UBX_CAPTURE_BUFFER  4096    // Library file buffer: about 20 s of 1 Hz frames
+
+// Before gnss.begin(): sizes the library's file buffer if capture is on
+void ubxCaptureSetup(SFE_UBLOX_GNSS& gnss);
+// After gnss.begin(): selects the messages that go into the file buffer
+void ubxCaptureEnable(SFE_UBLOX_GNSS& gnss);
+
+// Writer side, called by dataTask for every logged record; caller must hold sdMutex
+void ubxCaptureBegin(const char* journeyPath);
+void ubxCaptureDrain(SFE_UBLOX_GNSS& gnss);
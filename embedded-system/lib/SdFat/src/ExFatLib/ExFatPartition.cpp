@@ -79,6 +79,7 @@ bool ExFatPartition::bitmapModify(uint32_t cluster, uint32_t count,
                                   bool value) {
   uint32_t sector;
   uint32_t start = cluster - 2;
+  uint32_t total = count;
   size_t i;
   uint8_t* cache;
   uint8_t mask;
@@ -113,6 +114,8 @@ bool ExFatPartition::bitmapModify(uint32_t cluster, uint32_t count,
         }
         cache[i] ^= mask;
         if (--count == 0) {
+          updateFreeClusterCount(value ? -(int32_t)total : (int32_t)total,
+                                 start);
           return true;
         }
       }
@@ -237,6 +240,11 @@ fail:
 }
 //------------------------------------------------------------------------------
 int32_t ExFatPartition::freeClusterCount() {
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeClusterCount >= 0) {
+    return m_freeClusterCount;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   uint32_t nc = 0;
   uint32_t sector = m_clusterHeapStartSector;
   uint32_t usedCount = 0;
@@ -259,12 +267,42 @@ int32_t ExFatPartition::freeClusterCount() {
       }
       nc += 8;
       if (nc >= m_clusterCount) {
+        setFreeClusterCount(m_clusterCount - usedCount);
         return m_clusterCount - usedCount;
       }
     }
   }
 }
 //------------------------------------------------------------------------------
+#if MAINTAIN_FREE_CLUSTER_COUNT
+int8_t ExFatPartition::freeClusterCountStep(uint32_t maxSectors) {
+  const uint32_t bitsPerSector = 8UL * m_bytesPerSector;
+  while (m_freeClusterCount < 0 && maxSectors--) {
+    // Read through the bitmap cache so unsynced allocations are seen.
+    uint32_t sector = m_clusterHeapStartSector + m_freeScanBit / bitsPerSector;
+    const uint8_t* cache = bitmapCachePrepare(sector, FsCache::CACHE_FOR_READ);
+    if (!cache) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    uint32_t n = m_clusterCount - m_freeScanBit;
+    if (n > bitsPerSector) {
+      n = bitsPerSector;
+    }
+    for (uint32_t b = 0; b < n; b++) {
+      if (!(cache[b >> 3] & (1 << (b & 7)))) {
+        m_freeScanCount++;
+      }
+    }
+    m_freeScanBit += n;
+    if (m_freeScanBit >= m_clusterCount) {
+      m_freeClusterCount = m_freeScanCount;
+    }
+  }
+  return m_freeClusterCount >= 0 ? 1 : 0;
+}
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+//------------------------------------------------------------------------------
 bool ExFatPartition::init(FsBlockDevice* dev, uint8_t part, uint32_t volStart) {
   pbs_t* pbs;
   const BpbExFat_t* bpb;
@@ -315,6 +353,8 @@ bool ExFatPartition::init(FsBlockDevice* dev, uint8_t part, uint32_t volStart) {
   m_sectorsPerClusterShift = bpb->sectorsPerClusterShift;
   m_bytesPerCluster = 1UL << (m_bytesPerSectorShift + m_sectorsPerClusterShift);
   m_clusterMask = m_bytesPerCluster - 1;
+  // Indicate unknown number of free clusters.
+  setFreeClusterCount(-1);
   // Set m_bitmapStart to first free cluster.
   m_bitmapStart = 0;
   bitmapFind(0, 1);
@@ -94,6 +94,21 @@ class ExFatPartition {
   uint8_t fatType() const { return m_fatType; }
   /** \return free cluster count or -1 if an error occurs. */
   int32_t freeClusterCount();
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  /** \return true if freeClusterCount() will return without a bitmap scan. */
+  bool freeClusterCountKnown() const { return m_freeClusterCount >= 0; }
+  /** Continue an incremental count of free clusters.
+   *
+   * Allocations and frees made between calls are accounted for, so the
+   * scan may be spread over many calls while the volume is in use.
+   *
+   * \param[in] maxSectors Maximum number of bitmap sectors to read.
+   *
+   * \return 1 when the count is known, 0 if more sectors remain or
+   *         -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t maxSectors);
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   /** Initialize a exFAT partition.
    * \param[in] dev The blockDevice for the partition.
    * \param[in] part The partition to be used.  Legal values for \a part are
@@ -141,6 +156,32 @@ class ExFatPartition {
   friend class ExFatFile;
   uint32_t bitmapFind(uint32_t cluster, uint32_t count);
   bool bitmapModify(uint32_t cluster, uint32_t count, bool value);
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  void setFreeClusterCount(int32_t value) {
+    m_freeClusterCount = value;
+    m_freeScanBit = 0;
+    m_freeScanCount = 0;
+  }
+  // change is +/- the number of clusters freed/allocated from bitmap bit.
+  void updateFreeClusterCount(int32_t change, uint32_t bit) {
+    if (m_freeClusterCount >= 0) {
+      m_freeClusterCount += change;
+    } else if (bit < m_freeScanBit) {
+      // Only bits the incremental scan has already passed.
+      uint32_t n = change < 0 ? -change : change;
+      if (n > m_freeScanBit - bit) {
+        n = m_freeScanBit - bit;
+      }
+      m_freeScanCount += change < 0 ? -(int32_t)n : (int32_t)n;
+    }
+  }
+#else   // MAINTAIN_FREE_CLUSTER_COUNT
+  void setFreeClusterCount(int32_t value) { (void)value; }
+  void updateFreeClusterCount(int32_t change, uint32_t bit) {
+    (void)change;
+    (void)bit;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   //----------------------------------------------------------------------------
   // Cache functions.
   uint8_t* bitmapCachePrepare(uint32_t sector, uint8_t option) {
@@ -222,4 +263,9 @@ class ExFatPartition {
   FsBlockDevice* m_blockDev;
   uint8_t m_fatType = 0;
   uint8_t m_sectorsPerClusterShift;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  int32_t m_freeClusterCount = -1;  // Count of free clusters in volume.
+  uint32_t m_freeScanBit = 0;       // First bitmap bit not yet counted.
+  int32_t m_freeScanCount = 0;      // Free clusters below m_freeScanBit.
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
 };
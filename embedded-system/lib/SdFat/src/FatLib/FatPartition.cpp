@@ -80,7 +80,7 @@ bool FatPartition::allocateCluster(uint32_t current, uint32_t* next) {
       goto fail;
     }
   }
-  updateFreeClusterCount(-1);
+  updateFreeClusterCount(-1, find);
   *next = find;
   return true;
 
@@ -143,7 +143,7 @@ bool FatPartition::allocContiguous(uint32_t count, uint32_t* firstCluster) {
     endCluster--;
   }
   // Maintain count of free clusters.
-  updateFreeClusterCount(-count);
+  updateFreeClusterCount(-count, bgnCluster);
 
   // return first cluster number to caller
   *firstCluster = bgnCluster;
@@ -313,7 +313,7 @@ bool FatPartition::freeChain(uint32_t cluster) {
       goto fail;
     }
     // Add one to count of free clusters.
-    updateFreeClusterCount(1);
+    updateFreeClusterCount(1, cluster);
     if (cluster < m_allocSearchStart) {
       m_allocSearchStart = cluster - 1;
     }
@@ -390,6 +390,54 @@ fail:
   return -1;
 }
 //------------------------------------------------------------------------------
+#if MAINTAIN_FREE_CLUSTER_COUNT
+int8_t FatPartition::freeClusterCountStep(uint32_t maxSectors) {
+  if (m_freeClusterCount >= 0) {
+    return 1;
+  }
+  if (fatType() != 16 && fatType() != 32) {
+    // FAT12 volumes are small enough to count in one call.
+    return freeClusterCount() < 0 ? -1 : 1;
+  }
+  uint16_t perSector =
+      fatType() == 16 ? m_bytesPerSector / 2 : m_bytesPerSector / 4;
+  uint32_t todo = m_lastCluster + 1;
+  while (maxSectors-- && m_freeScanCluster < todo) {
+    uint32_t sector = m_fatStartSector + m_freeScanCluster / perSector;
+    const uint8_t* pc = fatCachePrepare(sector, FsCache::CACHE_FOR_READ);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    uint32_t n = todo - m_freeScanCluster;
+    if (n > perSector) {
+      n = perSector;
+    }
+    if (fatType() == 16) {
+      const uint16_t* p16 = reinterpret_cast<const uint16_t*>(pc);
+      for (uint32_t i = 0; i < n; i++) {
+        if (p16[i] == 0) {
+          m_freeScanCount++;
+        }
+      }
+    } else {
+      const uint32_t* p32 = reinterpret_cast<const uint32_t*>(pc);
+      for (uint32_t i = 0; i < n; i++) {
+        if (p32[i] == 0) {
+          m_freeScanCount++;
+        }
+      }
+    }
+    m_freeScanCluster += n;
+  }
+  if (m_freeScanCluster < todo) {
+    return 0;
+  }
+  m_freeClusterCount = m_freeScanCount;
+  return 1;
+}
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+//------------------------------------------------------------------------------
 bool FatPartition::init(FsBlockDevice* dev, uint8_t part, uint32_t volStart) {
   uint32_t countOfClusters;
   uint32_t totalSectors;
@@ -104,6 +104,21 @@ class FatPartition {
   uint8_t fatType() const { return m_fatType; }
   /** \return free cluster count or -1 if an error occurs. */
   int32_t freeClusterCount();
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  /** \return true if freeClusterCount() will return without a FAT scan. */
+  bool freeClusterCountKnown() const { return m_freeClusterCount >= 0; }
+  /** Continue an incremental count of free clusters.
+   *
+   * Allocations and frees made between calls are accounted for, so the
+   * scan may be spread over many calls while the volume is in use.
+   *
+   * \param[in] maxSectors Maximum number of FAT sectors to read.
+   *
+   * \return 1 when the count is known, 0 if more sectors remain or
+   *         -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t maxSectors);
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   /** Initialize a FAT partition.
    *
    * \param[in] dev FsBlockDevice for this partition.
@@ -183,15 +198,32 @@ class FatPartition {
   bool syncDevice() { return m_blockDev->syncDevice(); }
 #if MAINTAIN_FREE_CLUSTER_COUNT
   int32_t m_freeClusterCount;  // Count of free clusters in volume.
-  void setFreeClusterCount(int32_t value) { m_freeClusterCount = value; }
-  void updateFreeClusterCount(int32_t change) {
+  uint32_t m_freeScanCluster;  // First FAT entry not yet counted by a step.
+  int32_t m_freeScanCount;     // Free clusters below m_freeScanCluster.
+  void setFreeClusterCount(int32_t value) {
+    m_freeClusterCount = value;
+    m_freeScanCluster = 0;
+    m_freeScanCount = 0;
+  }
+  // change is +/- the number of clusters freed/allocated starting at cluster.
+  void updateFreeClusterCount(int32_t change, uint32_t cluster) {
     if (m_freeClusterCount >= 0) {
       m_freeClusterCount += change;
+    } else if (cluster < m_freeScanCluster) {
+      // Only clusters the incremental scan has already passed.
+      uint32_t n = change < 0 ? -change : change;
+      if (n > m_freeScanCluster - cluster) {
+        n = m_freeScanCluster - cluster;
+      }
+      m_freeScanCount += change < 0 ? -(int32_t)n : (int32_t)n;
     }
   }
 #else   // MAINTAIN_FREE_CLUSTER_COUNT
   void setFreeClusterCount(int32_t value) { (void)value; }
-  void updateFreeClusterCount(int32_t change) { (void)change; }
+  void updateFreeClusterCount(int32_t change, uint32_t cluster) {
+    (void)change;
+    (void)cluster;
+  }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
         // sector caches
   FsCache m_cache;
@@ -146,6 +146,26 @@ class FsVolume {
            : m_xVol ? m_xVol->freeClusterCount()
                     : -1;
   }
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  /** \return true if freeClusterCount() will return without a scan. */
+  bool freeClusterCountKnown() const {
+    return m_fVol   ? m_fVol->freeClusterCountKnown()
+           : m_xVol ? m_xVol->freeClusterCountKnown()
+                    : false;
+  }
+  /** Continue an incremental count of free clusters.
+   *
+   * \param[in] maxSectors Maximum number of FAT or bitmap sectors to read.
+   *
+   * \return 1 when the count is known, 0 if more sectors remain or
+   *         -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t maxSectors) const {
+    return m_fVol   ? m_fVol->freeClusterCountStep(maxSectors)
+           : m_xVol ? m_xVol->freeClusterCountStep(maxSectors)
+                    : -1;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
   /**
    * Check for device busy.
    *
@@ -7725,7 +7725,7 @@ bool SFE_UBLOX_GNSS::getProtocolVersion(uint16_t maxWait)
   // }
 
   // We will step through the payload looking at each extension field of 30 bytes
-  char *ptr;
+  const char *ptr;
   for (uint8_t extensionNumber = 0; extensionNumber < ((packetCfg.len - 40) / 30); extensionNumber++)
   {
     ptr = strstr((const char *)&payloadCfg[(30 * extensionNumber)], "PROTVER="); // Check for PROTVER (should be in extension 2)
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+// Far end of a fake UART (e.g. the ELM327 on Serial1). Bytes the firmware
+// writes go to receive(); available()/read() are what it has sent back.
+class SimUartDevice {
+public:
+    virtual ~SimUartDevice() {}
+    virtual void begin(unsigned long baud) { (void)baud; }
+    virtual void receive(uint8_t c) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// A port with no device attached writes to stdout (Serial) or drops its
+// output, and never has anything to read
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int port) : m_port(port) {}
+
+    void attach(SimUartDevice* device) { m_device = device; }
+    void setMuted(bool muted) { m_muted = muted; }
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int availableForWrite() override { return 128; }
+
+    operator bool() const { return true; }
+
+private:
+    int m_port;
+    SimUartDevice* m_device = nullptr;
+    bool m_muted = false;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
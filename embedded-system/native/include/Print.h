@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return printNumber(v, base); }
+    size_t print(int v, int base = DEC) { return printSigned(v, base); }
+    size_t print(unsigned int v, int base = DEC) { return printNumber(v, base); }
+    size_t print(long v, int base = DEC) { return printSigned(v, base); }
+    size_t print(unsigned long v, int base = DEC) { return printNumber(v, base); }
+    size_t print(long long v, int base = DEC) { return printSigned(v, base); }
+    size_t print(unsigned long long v, int base = DEC) { return printNumber(v, base); }
+    size_t print(double v, int digits = 2) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", digits, v);
+        return write(buf);
+    }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(const T& v, int format) { size_t n = print(v, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (len < 0) return 0;
+        if ((size_t)len < sizeof(buf)) return write((const uint8_t*)buf, len);
+
+        // Longer than the stack buffer: format again into the heap
+        char* big = (char*)malloc(len + 1);
+        if (!big) return 0;
+        va_start(args, format);
+        vsnprintf(big, len + 1, format, args);
+        va_end(args);
+        size_t n = write((const uint8_t*)big, len);
+        free(big);
+        return n;
+    }
+
+private:
+    size_t printNumber(unsigned long long v, int base) {
+        if (base < 2) base = DEC;
+        char buf[72];
+        char* p = buf + sizeof(buf) - 1;
+        *p = '\0';
+        do {
+            int d = v % base;
+            *--p = d < 10 ? '0' + d : 'A' + d - 10;
+            v /= base;
+        } while (v);
+        return write(p);
+    }
+    size_t printSigned(long long v, int base) {
+        if (base != DEC || v >= 0) return printNumber(base == DEC ? v : (unsigned long)v, base);
+        return print('-') + printNumber(-(unsigned long long)v, base);
+    }
+};
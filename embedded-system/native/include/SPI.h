@@ -0,0 +1,40 @@
+#pragma once
+
+// Arduino SPI class for the native build. Nothing is wired to it: the SD card
+// sits on the IDF SPI master (driver/spi_master.h), as in the firmware.
+
+#include <Arduino.h>
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+
+class SPISettings {
+public:
+    SPISettings() {}
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+        (void)clock;
+        (void)bitOrder;
+        (void)dataMode;
+    }
+};
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+        (void)sck;
+        (void)miso;
+        (void)mosi;
+        (void)ss;
+    }
+    void end() {}
+    void beginTransaction(SPISettings settings) { (void)settings; }
+    void endTransaction() {}
+    uint8_t transfer(uint8_t data) { (void)data; return 0xFF; }
+    void transfer(void* buf, size_t count) { memset(buf, 0xFF, count); }
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Print.h"
+
+unsigned long millis();
+void yield();
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+    unsigned long getTimeout() const { return m_timeout; }
+
+    size_t readBytes(char* buf, size_t length) {
+        size_t n = 0;
+        while (n < length) {
+            int c = timedRead();
+            if (c < 0) break;
+            buf[n++] = (char)c;
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t* buf, size_t length) { return readBytes((char*)buf, length); }
+
+    size_t readBytesUntil(char terminator, char* buf, size_t length) {
+        size_t n = 0;
+        while (n < length) {
+            int c = timedRead();
+            if (c < 0 || c == terminator) break;
+            buf[n++] = (char)c;
+        }
+        return n;
+    }
+
+    String readStringUntil(char terminator) {
+        String s;
+        int c;
+        while ((c = timedRead()) >= 0 && c != terminator) s += (char)c;
+        return s;
+    }
+    String readString() { return readStringUntil('\0'); }
+
+protected:
+    int timedRead() {
+        unsigned long start = millis();
+        do {
+            int c = read();
+            if (c >= 0) return c;
+            yield();
+        } while (millis() - start < m_timeout);
+        return -1;
+    }
+
+    unsigned long m_timeout = 1000;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+// Arduino String for the native build, backed by std::string
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+public:
+    String() {}
+    String(const char* s) : m_s(s ? s : "") {}
+    String(const char* s, size_t n) : m_s(s, n) {}
+    String(const std::string& s) : m_s(s) {}
+    String(const __FlashStringHelper* s) : String((const char*)s) {}
+    explicit String(char c) : m_s(1, c) {}
+    explicit String(unsigned char v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(int v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(unsigned int v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(long v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(unsigned long v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(long long v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(unsigned long long v, unsigned char base = 10) { setNumber(v, base); }
+    explicit String(double v, unsigned int decimals = 2) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        m_s = buf;
+    }
+    explicit String(float v, unsigned int decimals = 2) : String((double)v, decimals) {}
+
+    const char* c_str() const { return m_s.c_str(); }
+    unsigned int length() const { return m_s.size(); }
+    bool isEmpty() const { return m_s.empty(); }
+    bool reserve(unsigned int size) { m_s.reserve(size); return true; }
+
+    bool concat(const String& s) { m_s += s.m_s; return true; }
+    bool concat(const char* s) { if (s) m_s += s; return s != nullptr; }
+    bool concat(const char* s, unsigned int n) { m_s.append(s, n); return true; }
+    bool concat(char c) { m_s += c; return true; }
+    template <typename T> bool concat(T v) { return concat(String(v)); }
+
+    template <typename T> String& operator+=(const T& v) { concat(v); return *this; }
+    String& operator=(const char* s) { m_s = s ? s : ""; return *this; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.m_s + b.m_s); }
+    friend String operator+(const String& a, const char* b) { return String(a.m_s + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String(std::string(a ? a : "") + b.m_s); }
+    friend String operator+(const String& a, char b) { return String(a.m_s + b); }
+
+    bool equals(const String& s) const { return m_s == s.m_s; }
+    bool equalsIgnoreCase(const String& s) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+    bool operator==(const String& s) const { return m_s == s.m_s; }
+    bool operator==(const char* s) const { return m_s == (s ? s : ""); }
+    bool operator!=(const String& s) const { return m_s != s.m_s; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    bool operator<(const String& s) const { return m_s < s.m_s; }
+    bool operator>(const String& s) const { return m_s > s.m_s; }
+    bool operator<=(const String& s) const { return m_s <= s.m_s; }
+    bool operator>=(const String& s) const { return m_s >= s.m_s; }
+    int compareTo(const String& s) const { return m_s.compare(s.m_s); }
+
+    bool startsWith(const String& p, unsigned int from = 0) const {
+        return from <= m_s.size() && m_s.compare(from, p.m_s.size(), p.m_s) == 0;
+    }
+    bool endsWith(const String& p) const {
+        return m_s.size() >= p.m_s.size() && m_s.compare(m_s.size() - p.m_s.size(), p.m_s.size(), p.m_s) == 0;
+    }
+
+    char charAt(unsigned int i) const { return i < m_s.size() ? m_s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return m_s[i]; }
+
+    int indexOf(char c, unsigned int from = 0) const { return found(m_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return found(m_s.find(s.m_s, from)); }
+    int lastIndexOf(char c) const { return found(m_s.rfind(c)); }
+    int lastIndexOf(const String& s) const { return found(m_s.rfind(s.m_s)); }
+
+    String substring(unsigned int from) const { return from < m_s.size() ? String(m_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < m_s.size() ? String(m_s.substr(from, to - from)) : String();
+    }
+
+    void remove(unsigned int index) { if (index < m_s.size()) m_s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < m_s.size()) m_s.erase(index, count); }
+    void replace(const String& from, const String& to) {
+        if (from.m_s.empty()) return;
+        for (size_t i = 0; (i = m_s.find(from.m_s, i)) != std::string::npos; i += to.m_s.size()) {
+            m_s.replace(i, from.m_s.size(), to.m_s);
+        }
+    }
+    void trim() {
+        size_t a = m_s.find_first_not_of(" \t\r\n");
+        size_t b = m_s.find_last_not_of(" \t\r\n");
+        m_s = a == std::string::npos ? "" : m_s.substr(a, b - a + 1);
+    }
+    void toLowerCase() { for (char& c : m_s) c = tolower(c); }
+    void toUpperCase() { for (char& c : m_s) c = toupper(c); }
+
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return atof(c_str()); }
+    double toDouble() const { return atof(c_str()); }
+
+    void toCharArray(char* buf, unsigned int size, unsigned int from = 0) const {
+        if (!size) return;
+        strncpy(buf, from < m_s.size() ? c_str() + from : "", size - 1);
+        buf[size - 1] = '\0';
+    }
+    void getBytes(unsigned char* buf, unsigned int size) const { toCharArray((char*)buf, size); }
+
+    // Used by ArduinoJson to serialize into a String
+    size_t write(uint8_t c) { m_s += (char)c; return 1; }
+    size_t write(const uint8_t* s, size_t n) { m_s.append((const char*)s, n); return n; }
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    template <typename T> void setNumber(T v, unsigned char base) {
+        if (base == 10) {
+            m_s = std::to_string(v);
+            return;
+        }
+        unsigned long long u = (unsigned long long)v;
+        char buf[72];
+        char* p = buf + sizeof(buf) - 1;
+        *p = '\0';
+        do {
+            int d = u % base;
+            *--p = d < 10 ? '0' + d : 'a' + d - 10;
+            u /= base;
+        } while (u);
+        m_s = p;
+    }
+
+    std::string m_s;
+};
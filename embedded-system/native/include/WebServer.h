@@ -0,0 +1,83 @@
+#pragma once
+
+// WebServer for the native build: the ESP32 core's API over a POSIX socket.
+// Like the firmware's server it handles one request per handleClient() call
+// and closes the connection after each response. The port given to the
+// constructor is replaced by simWebServerSetPort() (port 80 needs root).
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS } HTTPMethod;
+
+void simWebServerSetPort(uint16_t port);
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80) : m_port(port) {}
+    ~WebServer();
+
+    void begin();
+    void begin(uint16_t port);
+    void handleClient();
+    void close();
+    void stop() { close(); }
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { m_notFound = handler; }
+
+    String uri() const { return m_uri; }
+    HTTPMethod method() const { return m_method; }
+    String arg(const String& name) const;
+    String arg(int i) const;
+    String argName(int i) const;
+    int args() const { return (int)m_args.size(); }
+    bool hasArg(const String& name) const;
+    String header(const String& name) const;
+
+    void send(int code, const char* contentType = nullptr, const String& content = String());
+    void send(int code, const String& contentType, const String& content) {
+        send(code, contentType.c_str(), content);
+    }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void setContentLength(size_t length) { m_contentLength = length; }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    bool readRequest();
+    void parseArgs(const std::string& query);
+    bool writeAll(const char* data, size_t length);
+
+    int m_port;
+    int m_listen = -1;
+    int m_client = -1;
+    std::vector<Route> m_routes;
+    THandlerFunction m_notFound;
+
+    // Current request
+    HTTPMethod m_method = HTTP_GET;
+    String m_uri;
+    std::vector<std::pair<String, String>> m_args;
+    std::vector<std::pair<String, String>> m_requestHeaders;
+
+    // Current response
+    std::vector<std::pair<String, String>> m_headers;
+    size_t m_contentLength = CONTENT_LENGTH_NOT_SET;
+    bool m_chunked = false;
+};
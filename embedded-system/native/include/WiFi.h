@@ -0,0 +1,56 @@
+#pragma once
+
+// WiFi for the native build: the soft AP is the host's loopback interface,
+// where WebServer listens.
+
+#include <Arduino.h>
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+typedef enum {
+    WIFI_POWER_19_5dBm = 78,
+    WIFI_POWER_15dBm = 60,
+    WIFI_POWER_11dBm = 44,
+    WIFI_POWER_8_5dBm = 34,
+    WIFI_POWER_2dBm = 8,
+} wifi_power_t;
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : m_bytes{ a, b, c, d } {}
+    uint8_t operator[](int i) const { return m_bytes[i]; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", m_bytes[0], m_bytes[1], m_bytes[2], m_bytes[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t m_bytes[4];
+};
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t mode) { m_mode = mode; return true; }
+    wifi_mode_t getMode() const { return m_mode; }
+    bool softAP(const char* ssid, const char* password = nullptr, int channel = 1, int hidden = 0, int maxConnections = 4) {
+        (void)ssid;
+        (void)password;
+        (void)channel;
+        (void)hidden;
+        (void)maxConnections;
+        m_mode = WIFI_AP;
+        return true;
+    }
+    bool softAPdisconnect(bool wifiOff = false) { m_mode = wifiOff ? WIFI_OFF : m_mode; return true; }
+    IPAddress softAPIP() const { return IPAddress(127, 0, 0, 1); }
+    uint8_t softAPgetStationNum() const { return 0; }
+    bool setTxPower(wifi_power_t power) { m_power = power; return true; }
+    wifi_power_t getTxPower() const { return m_power; }
+
+private:
+    wifi_mode_t m_mode = WIFI_OFF;
+    wifi_power_t m_power = WIFI_POWER_19_5dBm;
+};
+
+extern WiFiClass WiFi;
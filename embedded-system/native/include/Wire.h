@@ -0,0 +1,60 @@
+#pragma once
+
+// I2C for the native build. Each transaction is handed whole to the fake
+// device attached at the target address; an address with no device NACKs.
+
+#include <Arduino.h>
+
+#define I2C_BUFFER_LENGTH 128
+
+class SimI2cDevice {
+public:
+    virtual ~SimI2cDevice() {}
+    // One write transaction (the bytes between start and stop/restart)
+    virtual void i2cWrite(const uint8_t* data, size_t length) = 0;
+    // One read transaction; returns the bytes supplied (at most `length`)
+    virtual size_t i2cRead(uint8_t* data, size_t length) = 0;
+};
+
+class TwoWire : public Stream {
+public:
+    explicit TwoWire(uint8_t bus) : m_bus(bus) {}
+
+    void attach(uint8_t address, SimI2cDevice* device);
+
+    bool setPins(int sda, int scl) { (void)sda; (void)scl; return true; }
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frequency = 0) { (void)sda; (void)scl; (void)frequency; return true; }
+    bool end() { return true; }
+    bool setClock(uint32_t frequency) { (void)frequency; return true; }
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = true);
+    uint8_t requestFrom(int address, int quantity, int sendStop = true) {
+        return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+    }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override { return m_rxLength - m_rxIndex; }
+    int read() override { return m_rxIndex < m_rxLength ? m_rx[m_rxIndex++] : -1; }
+    int peek() override { return m_rxIndex < m_rxLength ? m_rx[m_rxIndex] : -1; }
+
+private:
+    SimI2cDevice* device(uint8_t address) const;
+
+    uint8_t m_bus;
+    SimI2cDevice* m_devices[128] = {};
+    uint8_t m_address = 0;
+    uint8_t m_tx[I2C_BUFFER_LENGTH];
+    size_t m_txLength = 0;
+    uint8_t m_rx[I2C_BUFFER_LENGTH];
+    size_t m_rxLength = 0;
+    size_t m_rxIndex = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
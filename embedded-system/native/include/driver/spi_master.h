@@ -0,0 +1,76 @@
+#pragma once
+
+// IDF SPI master for the native build. Transactions complete as soon as they
+// are queued: each is passed whole, full duplex, to the fake device attached
+// to the bus (the SD card), and the clock's bus time is charged to the
+// virtual clock.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { SPI1_HOST = 0, SPI2_HOST = 1, SPI3_HOST = 2 } spi_host_device_t;
+
+#define SPI_DMA_DISABLED 0
+#define SPI_DMA_CH_AUTO  3
+
+#define SPI_TRANS_USE_RXDATA (1 << 2)
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+    uint32_t flags;
+} spi_bus_config_t;
+
+typedef struct {
+    uint8_t command_bits;
+    uint8_t address_bits;
+    uint8_t dummy_bits;
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    uint32_t flags;
+    int queue_size;
+} spi_device_interface_config_t;
+
+typedef struct {
+    uint32_t flags;
+    size_t length;          // Bits
+    size_t rxlength;
+    void* user;
+    union {
+        const void* tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void* rx_buffer;
+        uint8_t rx_data[4];
+    };
+} spi_transaction_t;
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* config, int dmaChannel);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* config,
+                             spi_device_handle_t* handle);
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle);
+esp_err_t spi_device_acquire_bus(spi_device_handle_t handle, uint32_t wait);
+void spi_device_release_bus(spi_device_handle_t handle);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* trans);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans, uint32_t wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans, uint32_t wait);
+
+// Native only: the peripheral on a bus. `rx` may be null; `tx` never is.
+class SimSpiDevice {
+public:
+    virtual ~SimSpiDevice() {}
+    virtual void spiTransfer(const uint8_t* tx, uint8_t* rx, size_t length) = 0;
+};
+
+void simSpiAttach(spi_host_device_t host, SimSpiDevice* device);
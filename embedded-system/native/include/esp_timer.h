@@ -0,0 +1,10 @@
+#pragma once
+
+// Microseconds since boot, on the virtual clock
+
+#include <stdint.h>
+#include "sim_clock.hpp"
+
+inline int64_t esp_timer_get_time() {
+    return (int64_t)simClockMicros();
+}
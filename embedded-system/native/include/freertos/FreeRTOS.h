@@ -0,0 +1,36 @@
+#pragma once
+
+// FreeRTOS types for the native build. Ticks are 1 ms of virtual time.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY      ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define tskNO_AFFINITY     0x7FFFFFFF
+
+// uxTaskGetSystemState() with run time and core, as in ESP-IDF builds that
+// enable them
+#define configUSE_TRACE_FACILITY      1
+#define configGENERATE_RUN_TIME_STATS 1
+#define configTASKLIST_INCLUDE_COREID 1
+#define configMAX_TASK_NAME_LEN       16
+
+// The dual-core port's spinlock, as a host mutex
+#include <mutex>
+typedef struct {
+    std::mutex lock;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) ((mux)->lock.lock())
+#define portEXIT_CRITICAL(mux)  ((mux)->lock.unlock())
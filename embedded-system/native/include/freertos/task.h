@@ -0,0 +1,54 @@
+#pragma once
+
+// Tasks of the native build are host threads; priorities and core affinity
+// are recorded but not enforced. Each task's stack is SIM_STACK_FACTOR times
+// the depth asked for (host code is 64-bit and glibc's stdio is deep),
+// painted as FreeRTOS does, with a guard page below it; the high-water mark
+// is reported divided by the factor. Run time is the thread's host CPU time
+// scaled to virtual time.
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct SimTask* TaskHandle_t;
+
+#define SIM_STACK_FACTOR 4
+
+typedef enum { eRunning, eReady, eBlocked, eSuspended, eDeleted, eInvalid } eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char* pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;          // Microseconds
+    uint8_t* pxStackBase;
+    uint32_t usStackHighWaterMark;      // Bytes, as in ESP-IDF
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority,
+                                   TaskHandle_t* created, BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                       void* parameters, UBaseType_t priority, TaskHandle_t* created);
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+BaseType_t xTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char* pcTaskGetName(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+
+UBaseType_t uxTaskGetNumberOfTasks();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t size, uint32_t* totalRunTime);
+
+// Runs body as the Arduino loop task, on a painted stack of the ESP32 core's
+// loop task size, and returns when it does
+void simRunLoopTask(void (*body)());
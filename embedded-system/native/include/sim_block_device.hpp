@@ -0,0 +1,99 @@
+#pragma once
+
+// Sector store of the native build, in RAM or in a raw disk image, with a
+// latency model of SD flash. It backs SimSdCard, which turns the latency
+// into busy time on the SPI bus, and can also be mounted directly by SdFat
+// (the native env sets USE_BLOCK_DEVICE_INTERFACE), in which case each
+// transfer sleeps its latency on the virtual clock. Images can be mapped
+// (fastest) or accessed with pread/pwrite, and mounted on the host with
+// standard tools (`losetup -P`, `mount`, `fsck.vfat`).
+//
+// Write latency is a fixed programming time per sector, an extra cost when
+// a write opens a different allocation unit than the last one, and stalls
+// drawn from up to three tiers (e.g. wear levelling, garbage collection)
+// with a seeded generator, so a run is repeatable.
+
+#include <common/FsBlockDeviceInterface.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+#define SIM_SD_SECTOR 512
+#define SIM_BLOCK_STALL_TIERS 3
+
+struct SimBlockStall {
+    uint32_t perMillion;        // Sector writes that meet this stall
+    uint32_t minUs;
+    uint32_t maxUs;             // Uniform between min and max
+};
+
+struct SimBlockLatency {
+    uint32_t readUs;            // Access time per read
+    uint32_t writeUs;           // Programming time per sector
+    uint32_t auSectors;         // Allocation unit; 0 disables the AU cost
+    uint32_t auOpenUs;          // Writing into a different AU than the last write
+    SimBlockStall stalls[SIM_BLOCK_STALL_TIERS];
+};
+
+struct SimBlockStats {
+    uint64_t sectorsRead;
+    uint64_t sectorsWritten;
+    uint32_t stalls;
+    uint32_t auOpens;
+    uint64_t latencyUs;         // Sum of the latencies handed out
+    uint32_t maxLatencyUs;
+};
+
+enum SimBlockAccess {
+    SIM_BLOCK_MMAP,             // Image mapped shared; the kernel writes it back
+    SIM_BLOCK_PREAD,            // pread/pwrite per transfer
+};
+
+class SimBlockDevice : public FsBlockDeviceInterface {
+public:
+    ~SimBlockDevice();
+
+    // Blank device of `sectors` sectors (rounded down to a multiple of 1024)
+    // in RAM; host memory is only committed for the sectors written
+    bool beginRam(uint32_t sectors);
+    // Device stored in an image file; a missing file is created sparse at `sectors`
+    bool beginFile(const char* path, uint32_t sectors, SimBlockAccess access = SIM_BLOCK_PREAD);
+
+    // Named latency model: none, class10, worn (false if unknown)
+    static bool latencyProfile(const char* name, SimBlockLatency& latency);
+    void setLatency(const SimBlockLatency& latency);
+    void setSeed(uint32_t seed);
+    // Whether the FsBlockDeviceInterface calls sleep their latency (default on)
+    void setSleep(bool sleep) { m_sleep = sleep; }
+    SimBlockStats stats();
+
+    // Storage without latency, for tools and the card's own bookkeeping
+    bool read(uint32_t sector, uint8_t* dst, size_t ns = 1);
+    bool write(uint32_t sector, const uint8_t* src, size_t ns = 1);
+    // Latency of a transfer starting at `sector`, drawn from the model
+    uint32_t readLatency(uint32_t sector, size_t ns);
+    uint32_t writeLatency(uint32_t sector, size_t ns);
+
+    // FsBlockDeviceInterface
+    bool isBusy() override { return false; }
+    bool readSector(uint32_t sector, uint8_t* dst) override { return readSectors(sector, dst, 1); }
+    bool readSectors(uint32_t sector, uint8_t* dst, size_t ns) override;
+    uint32_t sectorCount() override { return m_sectors; }
+    bool syncDevice() override;
+    bool writeSector(uint32_t sector, const uint8_t* src) override { return writeSectors(sector, src, 1); }
+    bool writeSectors(uint32_t sector, const uint8_t* src, size_t ns) override;
+
+private:
+    uint32_t random();
+
+    std::mutex m_mutex;
+    uint8_t* m_map = nullptr;   // RAM or the mapped image
+    int m_fd = -1;
+    uint32_t m_sectors = 0;
+
+    SimBlockLatency m_latency = {};
+    uint32_t m_seed = 1;
+    uint32_t m_lastAu = UINT32_MAX;
+    bool m_sleep = true;
+    SimBlockStats m_stats = {};
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Virtual clock of the native build. millis()/micros(), delay(), vTaskDelay()
+// and every timeout in the fakes run on it. It advances `scale` times faster
+// than the host's monotonic clock, so a 1 s dataTask cycle takes 1/scale s of
+// real time. Host CPU time is stretched by the same factor, so timings of
+// CPU-bound work should be taken at a modest scale.
+
+#include <stdint.h>
+
+void simClockBegin(double scale);
+double simClockScale();
+
+// Virtual time since simClockBegin()
+uint64_t simClockMicros();
+
+// Blocks the calling thread for a virtual duration
+void simClockSleepMicros(uint64_t us);
+
+// Host duration (microseconds) that covers a virtual one
+uint64_t simClockHostMicros(uint64_t virtualUs);
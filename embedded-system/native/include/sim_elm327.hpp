@@ -0,0 +1,125 @@
+#pragma once
+
+// ELM327/STN11xx OBD-II adapter on Serial1 for the native build. It speaks
+// the AT commands COBD uses (Z, E0, H0, SP, I, RV, DP, ...) and answers
+// mode 01 from SimVehicle or a loaded SimObdTrace, plus the VIN (0902) as a
+// multi-frame reply.
+//
+// Timing follows the real link: bytes move at the baud rate the firmware
+// opened the port with, and each request is answered after the adapter's
+// processing time plus ECU latency, uniform jitter and occasional bus
+// stalls drawn from a seeded generator. After ATZ the first request runs a
+// protocol search ("SEARCHING..."), and a request that arrives while a
+// reply is pending is answered "STOPPED", as the ELM does. A script can
+// change all of this at set times:
+//
+//   # seconds  directive
+//   0     latency 45          ECU answer time, ms
+//   0     jitter 20           uniform extra delay, 0..ms
+//   0     stall 10 250        10 requests in 1000 see a 250 ms bus stall
+//   30    nodata 0D 5         PID 0D (or "all") answers NO DATA for 5 s
+//   60    ignition off        silent ECU: NO DATA / UNABLE TO CONNECT
+//   90    ignition on
+//   90    search              forget the protocol, as after a bus reset
+//   120   ecus 2              the transmission ECU answers as well
+//   150   profile stn1110
+
+#include <HardwareSerial.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "sim_obd_trace.hpp"
+
+enum SimElmProfile {
+    SIM_ELM327,                 // v1.5 clone: slow command processing
+    SIM_STN1110,                // OBDLink-class: fast processing and search
+};
+
+struct SimElmTiming {
+    uint32_t atUs;              // AT command processing
+    uint32_t adapterUs;         // Adapter overhead on each OBD request
+    uint32_t ecuUs;             // ECU answer time
+    uint32_t jitterUs;          // Uniform extra delay, 0..jitterUs
+    uint32_t stallPermille;     // Requests that meet a bus stall
+    uint32_t stallUs;
+    uint32_t searchUs;          // Protocol search after ATZ or ATSP0
+    uint32_t resetUs;           // ATZ
+};
+
+struct SimElmStats {
+    uint32_t requests;          // OBD requests (AT commands excluded)
+    uint32_t noData;
+    uint32_t stopped;           // Requests interrupted by the next one
+    uint32_t stalls;
+    uint32_t searches;
+    uint64_t serviceUs;         // Sum of request-to-prompt times
+};
+
+class SimElm327 : public SimUartDevice {
+public:
+    SimElm327();
+
+    void setProfile(SimElmProfile profile);
+    void setTiming(const SimElmTiming& timing);
+    SimElmTiming timing();
+    void setSeed(uint32_t seed);
+    bool loadTrace(const char* path);
+    bool loadScript(const char* path);
+    SimElmStats stats();
+
+    void begin(unsigned long baud) override;
+    void receive(uint8_t c) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+
+private:
+    struct OutByte {
+        uint64_t at;            // Virtual time the byte has fully arrived
+        char c;
+    };
+    struct ScriptEvent {
+        uint64_t at;
+        std::string directive;
+    };
+
+    void runScript(uint64_t now);
+    void apply(const std::string& directive);
+    void execute(const std::string& command, uint64_t start);
+    std::string at(const std::string& command, uint32_t& delayUs);
+    void obd(const std::string& command, uint64_t start);
+    void finishRequest(uint64_t now);
+    std::string mode01(uint8_t pid, int ecu);
+    std::vector<std::string> vin();
+    void queue(const std::string& text, uint64_t at);
+    uint32_t requestDelay();
+    uint32_t random();
+
+    std::mutex m_mutex;
+    SimElmProfile m_profile = SIM_ELM327;
+    SimElmTiming m_timing;
+    uint32_t m_byteUs = 1042;   // 10 bits at 9600 baud
+    uint32_t m_seed = 1;
+    uint64_t m_rxDoneAt = 0;    // When the last received byte finished arriving
+    std::string m_line;
+    std::string m_lastCommand;  // Repeated by an empty line
+    uint64_t m_txFreeAt = 0;    // When the adapter's transmitter is next idle
+    std::deque<OutByte> m_out;
+
+    bool m_echo = true;
+    bool m_headers = false;
+    bool m_protocolKnown = false;
+    int m_ecus = 1;
+    uint64_t m_noDataUntil[256] = {};   // Per PID, virtual us
+
+    SimObdTrace m_trace;
+    std::vector<ScriptEvent> m_script;
+    size_t m_scriptPos = 0;
+    SimElmStats m_stats = {};
+    bool m_pending = false;     // An OBD request is being answered
+    uint64_t m_requestAt = 0;   // ... since this time
+    uint64_t m_promptAt = 0;    // ... until its prompt has been sent
+};
+
+extern SimElm327 simElm327;
@@ -0,0 +1,9 @@
+#pragma once
+
+// Drives input pins of the native build from outside the firmware, e.g.
+// holding the logging button down. An undriven INPUT_PULLUP pin reads HIGH.
+
+#include <stdint.h>
+
+void simGpioSet(uint8_t pin, int level);
+void simGpioRelease(uint8_t pin);
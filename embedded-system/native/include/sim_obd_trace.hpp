@@ -0,0 +1,38 @@
+#pragma once
+
+// Vehicle trace the fake ELM327 can answer from instead of SimVehicle's
+// drive cycle. Two formats are read:
+//   - CSV with a header naming the columns: t (seconds), rpm, speed (km/h),
+//     maf (g/s), throttle (%), coolant (C); missing columns read as 0
+//   - a journey recorded by the logger (NDJSON records), one record per
+//     second or timed by gps.time
+// Values are interpolated between samples and the trace repeats.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+struct SimObdSample {
+    double t;
+    double rpm;
+    double speedKph;
+    double mafGps;
+    double throttlePct;
+    double coolantC;
+};
+
+class SimObdTrace {
+public:
+    bool load(const char* path);
+    bool loaded() const { return m_samples.size() >= 2; }
+    double duration() const { return loaded() ? m_samples.back().t - m_samples.front().t : 0; }
+    size_t size() const { return m_samples.size(); }
+
+    SimObdSample at(double seconds) const;
+
+private:
+    bool loadCsv(FILE* f);
+    bool loadRecords(FILE* f);
+
+    std::vector<SimObdSample> m_samples;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Measurement points in the fakes, in virtual time. Nothing listens unless
+// a collector (e.g. the soak benchmark) sets simProbe; until then each
+// point costs a null check.
+
+#include <stdint.h>
+
+class SimProbe {
+public:
+    virtual ~SimProbe() {}
+    // A mutex was taken after waiting `us`, or given back after holding it `us`
+    virtual void mutexWait(const char* task, uint64_t us) { (void)task; (void)us; }
+    virtual void mutexHold(const char* task, uint64_t us) { (void)task; (void)us; }
+    // An SD write command, from CMD24/25 to the card being ready again
+    virtual void sdWrite(uint64_t us) { (void)us; }
+    // An OBD request reached the adapter
+    virtual void obdRequest(const char* command, uint64_t at) { (void)command; (void)at; }
+};
+
+extern SimProbe* simProbe;
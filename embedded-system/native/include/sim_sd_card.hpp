@@ -0,0 +1,75 @@
+#pragma once
+
+// SD card in SPI mode for the native build. It sits on SD_SPI_HOST behind the
+// firmware's own DMA driver (sd_spi_esp32.cpp), so SdFat, sd_tune.cpp and
+// everything above them run unchanged. It answers the commands SdSpiCard
+// issues (CMD0/8/55/41/58/59, CSD/CID/SCR/status, single and multi-sector
+// read/write, erase) with SDHC addressing, and checks CRCs once CMD59 turns
+// them on. Sectors live in a SimBlockDevice (RAM or a raw image file), whose
+// latency model sets how long the card holds MISO low (busy) after each
+// written sector and how long it sends 0xFF before each read data token.
+
+#include <driver/spi_master.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "sim_block_device.hpp"
+
+class SimSdCard : public SimSpiDevice {
+public:
+    bool beginRam(uint32_t sectors) { return m_device.beginRam(sectors); }
+    bool beginFile(const char* path, uint32_t sectors, SimBlockAccess access = SIM_BLOCK_PREAD) {
+        return m_device.beginFile(path, sectors, access);
+    }
+    SimBlockDevice& device() { return m_device; }
+
+    uint32_t sectorCount() { return m_device.sectorCount(); }
+    // Direct access, without latency
+    bool readSector(uint32_t sector, uint8_t* dst) { return m_device.read(sector, dst); }
+    bool writeSector(uint32_t sector, const uint8_t* src) { return m_device.write(sector, src); }
+
+    // Sectors transferred through the SPI interface
+    uint64_t sectorsRead() const { return m_sectorsRead; }
+    uint64_t sectorsWritten() const { return m_sectorsWritten; }
+
+    void spiTransfer(const uint8_t* tx, uint8_t* rx, size_t length) override;
+
+private:
+    enum State { COMMAND, READ_MULTI, WRITE_TOKEN, WRITE_DATA };
+
+    uint8_t nextOut();
+    void feed(uint8_t b);
+    void command();
+    void respond(uint8_t r1);
+    void queueBlock(const uint8_t* data, size_t length);
+    void queueSector(uint32_t sector);
+    void blockReceived();
+    void writeDone();
+
+    SimBlockDevice m_device;
+
+    State m_state = COMMAND;
+    bool m_idle = true;         // Until ACMD41 completes initialisation
+    bool m_appCmd = false;      // Previous command was CMD55
+    bool m_crc = false;         // CRC checking enabled by CMD59
+    bool m_multi = false;       // Writing with CMD25
+    uint8_t m_cmd[6];
+    size_t m_cmdLength = 0;
+    uint32_t m_sector = 0;      // Next sector of a multi-sector transfer
+    uint32_t m_eraseStart = 0;
+    uint32_t m_eraseEnd = 0;
+    uint8_t m_block[SIM_SD_SECTOR + 2];
+    size_t m_blockLength = 0;
+
+    std::vector<uint8_t> m_out; // MISO bytes waiting to be clocked out
+    size_t m_outPos = 0;
+    size_t m_holdPos = SIZE_MAX;    // m_out is held at this index (read access time)...
+    uint64_t m_holdUntil = 0;       // ... until this virtual time
+    uint64_t m_busyUntil = 0;       // Programming a written sector
+    uint64_t m_writeStart = 0;      // CMD24/25 of the write in progress
+
+    uint64_t m_sectorsRead = 0;
+    uint64_t m_sectorsWritten = 0;
+};
+
+extern SimSdCard simSdCard;
@@ -0,0 +1,37 @@
+#pragma once
+
+// End-to-end soak benchmark of the native build. While the firmware runs a
+// drive (SimVehicle, or a recorded one through --obd-trace/--ubx-replay) in
+// accelerated time, client threads poll /live, /sdinfo and /drive like the
+// app does. Measurements come from simProbe and the clients, all in
+// virtual time:
+//   - data cycles (one per 010C request) against records logged: drop rate
+//   - cycle period and jitter against the nominal 1 s
+//   - sdMutex wait and hold times per task
+//   - SD write latency, CMD24/25 to card ready
+//   - heap low-water mark of the whole host process, the clients included
+//     (see ESP.getMinFreeHeap()), so a lower bound on the firmware's
+//   - HTTP latency per endpoint
+// The report ends with a pass/fail line per SLO; limits can be overridden
+// with "name=value" (see simSoakSetSlo).
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct SimSoakOptions {
+    uint16_t port;
+    int clients;
+    uint32_t intervalMs;        // Virtual pause between a client's requests
+};
+
+// Sets an SLO limit, e.g. "jitter_p99_ms=50"; false for an unknown name
+bool simSoakSetSlo(const char* assignment);
+
+// After setup(): attaches the probe and starts the clients
+void simSoakBegin(const SimSoakOptions& options);
+// Stops the clients and counts the records logged, over HTTP, so loop()
+// must keep running until simSoakDone()
+void simSoakStop();
+bool simSoakDone();
+// Prints the report; returns the number of SLOs missed
+int simSoakReport(FILE* out);
@@ -0,0 +1,95 @@
+#pragma once
+
+// u-blox NEO-M8U on Wire1 (0x42) for the native build. It models the DDC
+// (I2C) interface the SparkFun library drives: a 1-byte write sets the
+// register address, longer writes are UBX input, and reads return the
+// output length at 0xFD/0xFE followed by the output stream at 0xFF. Polls
+// are answered from SimVehicle after a fixed latency: CFG-PRT/RATE,
+// NAV-PVT, ESF-INS and ESF-STATUS, whose fusion mode goes from
+// initialisation to fusion once the IMU calibration time has passed.
+// Other CFG messages are acknowledged.
+//
+// Instead of SimVehicle, the output can come from a capture of a real
+// receiver: replay() streams the frames at their original pace (by the
+// capture's timestamps, or the iTOW of its NAV/HNR frames) or all at once,
+// and NAV/ESF polls are then left to the stream. Two capture formats:
+//   - raw UBX, as the logger's .ubx sidecar, the library's file buffer or
+//     a u-center log
+//   - text, one "<seconds> <hex bytes>" line per read of register 0xFF, as
+//     capture() writes it and a logic analyser's I2C export converts to
+// At the end of the capture the receiver stays silent until stopReplay().
+
+#include <Wire.h>
+#include <stdio.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#define SIM_UBLOX_ADDRESS 0x42
+
+class SimUblox : public SimI2cDevice {
+public:
+    void setLatency(uint32_t us);
+    void setCalibrationTime(uint32_t ms);
+
+    void i2cWrite(const uint8_t* data, size_t length) override;
+    size_t i2cRead(uint8_t* data, size_t length) override;
+
+    uint32_t polls() const { return m_polls; }
+
+    bool replay(const char* path, bool realTime);
+    void stopReplay();
+    bool replaying();
+    uint64_t replayedBytes();
+    // Records every byte the library reads from the stream
+    bool capture(const char* path);
+
+private:
+    struct Pending {
+        uint64_t readyAt;
+        std::vector<uint8_t> bytes;
+    };
+    struct ReplayChunk {
+        uint64_t at;            // Offset from the start of the capture, us
+        std::vector<uint8_t> bytes;
+    };
+
+    static bool loadRaw(FILE* f, std::vector<ReplayChunk>& chunks);
+    static bool loadText(FILE* f, std::vector<ReplayChunk>& chunks);
+
+    void parse(uint8_t b);
+    void message(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length);
+    void send(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length);
+    void acknowledge(uint8_t cls, uint8_t id, bool ack);
+    void navPvt();
+    void esfIns();
+    void esfStatus();
+    void release();
+
+    std::mutex m_mutex;
+    uint8_t m_register = 0xFF;
+    uint16_t m_length = 0;      // Length latched by the last 0xFD read
+
+    // UBX input parser
+    std::vector<uint8_t> m_in;
+
+    // Output: replies wait in m_pending until their latency has passed
+    std::deque<Pending> m_pending;
+    std::deque<uint8_t> m_out;
+    std::vector<uint8_t> m_reply;   // Reply being built by send()
+
+    uint16_t m_outProtoMask = 0x0003;   // UBX + NMEA until setI2COutput()
+    uint32_t m_latencyUs = 10000;
+    uint32_t m_calibrationMs = 5000;
+    uint32_t m_polls = 0;
+
+    std::vector<ReplayChunk> m_replay;
+    size_t m_replayPos = 0;
+    uint64_t m_replayedBytes = 0;
+    uint64_t m_replayStart = 0;
+    bool m_replayRealTime = true;
+    bool m_replaying = false;
+    FILE* m_capture = nullptr;
+};
+
+extern SimUblox simUblox;
@@ -0,0 +1,51 @@
+#pragma once
+
+// The car behind the fakes: a repeating urban drive cycle (idle, pull away,
+// cruise, brake) driven around a loop, as a deterministic function of
+// virtual time. The ELM327 and the u-blox both read it, so OBD and GNSS
+// values in a record agree with each other.
+
+#include <stdint.h>
+
+struct SimVehicleState {
+    bool ignition;
+    int speedKph;
+    int rpm;
+    float mafGps;               // Mass air flow, g/s
+    int throttlePct;            // Accelerator pedal position
+    int coolantC;
+    float accelX;               // Longitudinal acceleration, m/s^2
+    float accelY;               // Lateral acceleration, m/s^2
+    double latitude;
+    double longitude;
+    float headingDeg;
+    uint8_t satellites;
+    // UTC date and time
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint16_t millisecond;
+};
+
+struct SimVehicleStart {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint32_t secondOfDay;       // UTC
+    double latitude;
+    double longitude;
+};
+
+// Default start: 2025-03-04 08:00:00 UTC in Bath, UK
+void simVehicleBegin(const SimVehicleStart& start);
+const SimVehicleStart& simVehicleStart();
+
+// State at a virtual time (microseconds since simClockBegin)
+SimVehicleState simVehicleAt(uint64_t us);
+SimVehicleState simVehicleNow();
+
+// Ignition off: the ECU stops answering and the car stays put
+void simVehicleSetIgnition(bool on);
@@ -0,0 +1,5 @@
+# Linker flags for the native environment. build_flags also reach every
+# compile, so the thread library is added here instead.
+Import("env")
+
+env.Append(LINKFLAGS=["-pthread"])
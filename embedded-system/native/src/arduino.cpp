@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include <malloc.h>
+#include <mutex>
+#include "sim_clock.hpp"
+#include "sim_gpio.hpp"
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+EspClass ESP;
+
+// Nominal free heap of an ESP32 after the Arduino core and WiFi have started
+#define SIM_HEAP_SIZE 327680
+
+// Idle time spent in each empty UART poll, about one byte at 115200 baud
+#define SIM_UART_POLL_US 100
+
+
+unsigned long millis() {
+    return (unsigned long)(simClockMicros() / 1000);
+}
+
+
+unsigned long micros() {
+    return (unsigned long)simClockMicros();
+}
+
+
+void delay(uint32_t ms) {
+    simClockSleepMicros((uint64_t)ms * 1000);
+}
+
+
+void delayMicroseconds(uint32_t us) {
+    simClockSleepMicros(us);
+}
+
+
+void yield() {
+    simClockSleepMicros(0);
+}
+
+
+//-------------------------------------------------------------------------------
+// GPIO: outputs read back what was written; inputs read the level driven by
+// the harness, or their pull
+//-------------------------------------------------------------------------------
+struct SimPin {
+    uint8_t mode;
+    int8_t driven;      // -1 when not driven from outside
+    uint8_t level;
+};
+
+static std::mutex pinLock;
+static SimPin pins[64];
+static bool pinsReady = false;
+
+
+static SimPin& pin(uint8_t n) {
+    if (!pinsReady) {
+        for (SimPin& p : pins) p = { INPUT, -1, LOW };
+        pinsReady = true;
+    }
+    return pins[n & 63];
+}
+
+
+void pinMode(uint8_t n, uint8_t mode) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pin(n).mode = mode;
+}
+
+
+void digitalWrite(uint8_t n, uint8_t level) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pin(n).level = level ? HIGH : LOW;
+}
+
+
+int digitalRead(uint8_t n) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    SimPin& p = pin(n);
+    if (p.mode == OUTPUT) return p.level;
+    if (p.driven >= 0) return p.driven;
+    return p.mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+
+void simGpioSet(uint8_t n, int level) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pin(n).driven = level ? HIGH : LOW;
+}
+
+
+void simGpioRelease(uint8_t n) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pin(n).driven = -1;
+}
+
+
+long random(long max) {
+    return max > 0 ? rand() % max : 0;
+}
+
+
+long random(long min, long max) {
+    return min >= max ? min : min + random(max - min);
+}
+
+
+void randomSeed(unsigned long seed) {
+    srand(seed);
+}
+
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+
+//-------------------------------------------------------------------------------
+// Serial ports
+//-------------------------------------------------------------------------------
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+    if (m_device) m_device->begin(baud);
+}
+
+
+int HardwareSerial::available() {
+    int n = m_device ? m_device->available() : 0;
+    if (n == 0) simClockSleepMicros(SIM_UART_POLL_US);
+    return n;
+}
+
+
+int HardwareSerial::read() {
+    return m_device ? m_device->read() : -1;
+}
+
+
+int HardwareSerial::peek() {
+    return m_device ? m_device->peek() : -1;
+}
+
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+    if (m_device) {
+        for (size_t i = 0; i < size; i++) m_device->receive(buf[i]);
+    } else if (m_port == 0 && !m_muted) {
+        fwrite(buf, 1, size, stdout);
+    }
+    return size;
+}
+
+
+//-------------------------------------------------------------------------------
+// Heap: the nominal ESP32 heap less what the process has allocated since the
+// first call
+//-------------------------------------------------------------------------------
+static std::mutex heapLock;
+static size_t heapBaseline = 0;
+static bool heapBaselineSet = false;
+static uint32_t heapMinFree = SIM_HEAP_SIZE;
+
+
+static uint32_t heapFree() {
+    struct mallinfo2 info = mallinfo2();
+    std::lock_guard<std::mutex> guard(heapLock);
+    if (!heapBaselineSet) {
+        heapBaseline = info.uordblks;
+        heapBaselineSet = true;
+    }
+    size_t used = info.uordblks > heapBaseline ? info.uordblks - heapBaseline : 0;
+    uint32_t free = used < SIM_HEAP_SIZE ? SIM_HEAP_SIZE - used : 0;
+    if (free < heapMinFree) heapMinFree = free;
+    return free;
+}
+
+
+uint32_t EspClass::getHeapSize() {
+    return SIM_HEAP_SIZE;
+}
+
+
+uint32_t EspClass::getFreeHeap() {
+    return heapFree();
+}
+
+
+uint32_t EspClass::getMinFreeHeap() {
+    heapFree();
+    std::lock_guard<std::mutex> guard(heapLock);
+    return heapMinFree;
+}
+
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return heapFree();
+}
+
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(simClockMicros() * getCpuFreqMHz());
+}
+
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
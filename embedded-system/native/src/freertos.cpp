@@ -0,0 +1,288 @@
+#include <Arduino.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sim_clock.hpp"
+#include "sim_probe.hpp"
+
+#define SIM_LOOP_TASK_STACK 8192     // getArduinoLoopTaskStackSize()
+#define SIM_STACK_PAINT 0xA5
+
+struct SimTask {
+    std::string name;
+    UBaseType_t priority;
+    BaseType_t core;
+    TaskFunction_t code;
+    void* parameters;
+    pthread_t thread;
+    uint8_t* stack;             // Lowest usable byte; null when the stack is not ours
+    size_t stackSize;
+    UBaseType_t number;
+};
+
+// The thread running setup()/loop() is the Arduino loop task
+static SimTask loopTask = { "loopTask", 1, 1, nullptr, nullptr, pthread_self(), nullptr, 0, 1 };
+static thread_local SimTask* currentTask = &loopTask;
+
+static std::mutex tasksLock;
+static std::vector<SimTask*> tasks = { &loopTask };
+
+
+static void* taskMain(void* arg) {
+    SimTask* task = (SimTask*)arg;
+    currentTask = task;
+    task->code(task->parameters);
+    // FreeRTOS tasks must not return; treat it like vTaskDelete(NULL)
+    return nullptr;
+}
+
+
+//-------------------------------------------------------------------------------
+// Starts a task's thread on a painted stack with a guard page below it, so
+// an overflow faults instead of corrupting memory
+//-------------------------------------------------------------------------------
+static bool startTask(SimTask* task, uint32_t stackDepth) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = ((size_t)stackDepth * SIM_STACK_FACTOR + page - 1) / page * page;
+    uint8_t* map = (uint8_t*)mmap(nullptr, size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return false;
+    mprotect(map, page, PROT_NONE);
+    task->stack = map + page;
+    task->stackSize = size;
+    memset(task->stack, SIM_STACK_PAINT, size);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, size);
+    int err = pthread_create(&task->thread, &attr, taskMain, task);
+    pthread_attr_destroy(&attr);
+    return err == 0;
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority,
+                                   TaskHandle_t* created, BaseType_t coreId) {
+    SimTask* task = new SimTask{ name ? name : "", priority, coreId, code, parameters, {}, nullptr, 0, 0 };
+    {
+        std::lock_guard<std::mutex> guard(tasksLock);
+        task->number = tasks.size() + 1;
+        tasks.push_back(task);
+    }
+    if (!startTask(task, stackDepth)) return pdFAIL;
+    pthread_detach(task->thread);
+    if (created) *created = task;
+    return pdPASS;
+}
+
+
+static void loopTaskMain(void* body) {
+    ((void (*)())body)();
+}
+
+
+void simRunLoopTask(void (*body)()) {
+    loopTask.code = loopTaskMain;
+    loopTask.parameters = (void*)body;
+    if (!startTask(&loopTask, SIM_LOOP_TASK_STACK)) {
+        body();
+        return;
+    }
+    pthread_join(loopTask.thread, nullptr);
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth,
+                       void* parameters, UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, created, tskNO_AFFINITY);
+}
+
+
+void vTaskDelete(TaskHandle_t task) {
+    // Only a task deleting itself is supported; host threads cannot be killed
+    if (task == nullptr || task == currentTask) {
+        {
+            std::lock_guard<std::mutex> guard(tasksLock);
+            for (size_t i = 0; i < tasks.size(); i++) {
+                if (tasks[i] == currentTask) tasks.erase(tasks.begin() + i);
+            }
+        }
+        pthread_exit(nullptr);
+    }
+}
+
+
+void vTaskDelay(TickType_t ticks) {
+    simClockSleepMicros((uint64_t)ticks * 1000);
+}
+
+
+BaseType_t xTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    TickType_t wake = *previousWakeTime + increment;
+    int32_t remaining = (int32_t)(wake - xTaskGetTickCount());
+    *previousWakeTime = wake;
+    if (remaining <= 0) return pdFALSE;
+    vTaskDelay(remaining);
+    return pdTRUE;
+}
+
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    xTaskDelayUntil(previousWakeTime, increment);
+}
+
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(simClockMicros() / 1000);
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return currentTask;
+}
+
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : currentTask)->name.c_str();
+}
+
+
+BaseType_t xPortGetCoreID() {
+    return currentTask->core == tskNO_AFFINITY ? 0 : currentTask->core;
+}
+
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+    std::lock_guard<std::mutex> guard(tasksLock);
+    return tasks.size();
+}
+
+
+// Bytes at the bottom of the stack still holding the paint, in target bytes
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    task = task ? task : currentTask;
+    if (!task->stack) return 0;
+    size_t untouched = 0;
+    while (untouched < task->stackSize && task->stack[untouched] == SIM_STACK_PAINT) untouched++;
+    return untouched / SIM_STACK_FACTOR;
+}
+
+
+static uint32_t runTime(SimTask* task) {
+    clockid_t clock;
+    timespec ts;
+    if (pthread_getcpuclockid(task->thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+    double hostUs = ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+    return (uint32_t)(uint64_t)(hostUs * simClockScale());
+}
+
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t size, uint32_t* totalRunTime) {
+    std::lock_guard<std::mutex> guard(tasksLock);
+    UBaseType_t n = 0;
+    for (SimTask* task : tasks) {
+        if (n == size) break;
+        TaskStatus_t& s = status[n++];
+        s.xHandle = task;
+        s.pcTaskName = task->name.c_str();
+        s.xTaskNumber = task->number;
+        s.eCurrentState = task == currentTask ? eRunning : eBlocked;
+        s.uxCurrentPriority = task->priority;
+        s.uxBasePriority = task->priority;
+        s.ulRunTimeCounter = runTime(task);
+        s.pxStackBase = task->stack;
+        s.usStackHighWaterMark = uxTaskGetStackHighWaterMark(task);
+        s.xCoreID = task->core;
+    }
+    if (totalRunTime) *totalRunTime = (uint32_t)simClockMicros();
+    return n;
+}
+
+
+//-------------------------------------------------------------------------------
+// Semaphores: a count guarded by a host mutex. A FreeRTOS mutex is a binary
+// semaphore that starts full (priority inheritance is not modelled); its
+// wait and hold times go to simProbe.
+//-------------------------------------------------------------------------------
+struct SimSemaphore {
+    std::mutex lock;
+    std::condition_variable ready;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    bool mutex;
+    const char* owner;
+    uint64_t takenAt;
+};
+
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    SimSemaphore* s = new SimSemaphore();
+    s->count = initialCount;
+    s->maxCount = maxCount;
+    return s;
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SemaphoreHandle_t s = xSemaphoreCreateCounting(1, 1);
+    s->mutex = true;
+    return s;
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    uint64_t start = semaphore->mutex && simProbe ? simClockMicros() : 0;
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    auto available = [semaphore] { return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->ready.wait(guard, available);
+    } else {
+        auto wait = std::chrono::microseconds(simClockHostMicros((uint64_t)ticks * 1000));
+        if (!semaphore->ready.wait_for(guard, wait, available)) return pdFALSE;
+    }
+    semaphore->count--;
+    if (start) {
+        semaphore->owner = currentTask->name.c_str();
+        semaphore->takenAt = simClockMicros();
+        simProbe->mutexWait(semaphore->owner, semaphore->takenAt - start);
+    }
+    return pdTRUE;
+}
+
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount) return pdFALSE;
+        semaphore->count++;
+        if (semaphore->mutex && simProbe && semaphore->takenAt) {
+            simProbe->mutexHold(semaphore->owner, simClockMicros() - semaphore->takenAt);
+            semaphore->takenAt = 0;
+        }
+    }
+    semaphore->ready.notify_one();
+    return pdTRUE;
+}
+
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> guard(semaphore->lock);
+    return semaphore->count;
+}
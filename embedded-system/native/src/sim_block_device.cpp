@@ -0,0 +1,186 @@
+#include "sim_block_device.hpp"
+#include "sim_clock.hpp"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const struct {
+    const char* name;
+    SimBlockLatency latency;
+} profiles[] = {
+    { "none", {} },
+    // Class 10 SDHC: short programming time, a stall in a hundred writes,
+    // rare garbage collection pauses of a few hundred ms
+    { "class10", { 100, 250, 8192, 3000, { { 10000, 2000, 10000 }, { 1000, 20000, 80000 }, { 50, 150000, 300000 } } } },
+    // A worn or cheap card: slower programming, stalls ten times as often
+    { "worn", { 200, 600, 8192, 8000, { { 30000, 5000, 25000 }, { 5000, 50000, 150000 }, { 500, 250000, 600000 } } } },
+};
+
+
+SimBlockDevice::~SimBlockDevice() {
+    if (m_map) munmap(m_map, (size_t)m_sectors * SIM_SD_SECTOR);
+    if (m_fd >= 0) close(m_fd);
+}
+
+
+bool SimBlockDevice::beginRam(uint32_t sectors) {
+    m_sectors = sectors & ~1023u;
+    void* ram = mmap(nullptr, (size_t)m_sectors * SIM_SD_SECTOR, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ram == MAP_FAILED) return false;
+    m_map = (uint8_t*)ram;
+    return m_sectors > 0;
+}
+
+
+bool SimBlockDevice::beginFile(const char* path, uint32_t sectors, SimBlockAccess access) {
+    m_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) return false;
+    off_t size = lseek(m_fd, 0, SEEK_END);
+    if (size == 0) {
+        size = (off_t)(sectors & ~1023u) * SIM_SD_SECTOR;
+        if (ftruncate(m_fd, size) != 0) return false;
+    }
+    m_sectors = (uint32_t)(size / SIM_SD_SECTOR) & ~1023u;
+    if (access == SIM_BLOCK_MMAP && m_sectors) {
+        void* map = mmap(nullptr, (size_t)m_sectors * SIM_SD_SECTOR, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED) return false;
+        m_map = (uint8_t*)map;
+    }
+    return m_sectors > 0;
+}
+
+
+bool SimBlockDevice::latencyProfile(const char* name, SimBlockLatency& latency) {
+    for (const auto& p : profiles) {
+        if (strcmp(p.name, name) == 0) {
+            latency = p.latency;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void SimBlockDevice::setLatency(const SimBlockLatency& latency) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latency = latency;
+}
+
+
+void SimBlockDevice::setSeed(uint32_t seed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_seed = seed ? seed : 1;
+}
+
+
+SimBlockStats SimBlockDevice::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+
+bool SimBlockDevice::read(uint32_t sector, uint8_t* dst, size_t ns) {
+    if (sector >= m_sectors || ns > m_sectors - sector) return false;
+    off_t offset = (off_t)sector * SIM_SD_SECTOR;
+    size_t length = ns * SIM_SD_SECTOR;
+    if (m_map) {
+        memcpy(dst, &m_map[offset], length);
+        return true;
+    }
+    return pread(m_fd, dst, length, offset) == (ssize_t)length;
+}
+
+
+bool SimBlockDevice::write(uint32_t sector, const uint8_t* src, size_t ns) {
+    if (sector >= m_sectors || ns > m_sectors - sector) return false;
+    off_t offset = (off_t)sector * SIM_SD_SECTOR;
+    size_t length = ns * SIM_SD_SECTOR;
+    if (m_map) {
+        memcpy(&m_map[offset], src, length);
+        return true;
+    }
+    return pwrite(m_fd, src, length, offset) == (ssize_t)length;
+}
+
+
+// xorshift32: stalls repeat exactly for a given seed
+uint32_t SimBlockDevice::random() {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+
+uint32_t SimBlockDevice::readLatency(uint32_t sector, size_t ns) {
+    (void)sector;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.sectorsRead += ns;
+    uint32_t us = m_latency.readUs;
+    m_stats.latencyUs += us;
+    if (us > m_stats.maxLatencyUs) m_stats.maxLatencyUs = us;
+    return us;
+}
+
+
+//-------------------------------------------------------------------------------
+// Programming time for each sector, the AU cost each time the write moves to
+// another allocation unit, and for each sector one draw against the stall
+// tiers (the first tier that hits wins)
+//-------------------------------------------------------------------------------
+uint32_t SimBlockDevice::writeLatency(uint32_t sector, size_t ns) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.sectorsWritten += ns;
+    uint64_t us = 0;
+    for (size_t i = 0; i < ns; i++) {
+        us += m_latency.writeUs;
+        if (m_latency.auSectors) {
+            uint32_t au = (sector + (uint32_t)i) / m_latency.auSectors;
+            if (au != m_lastAu) {
+                if (m_lastAu != UINT32_MAX) {
+                    us += m_latency.auOpenUs;
+                    m_stats.auOpens++;
+                }
+                m_lastAu = au;
+            }
+        }
+        uint32_t draw = random() % 1000000;
+        for (const SimBlockStall& stall : m_latency.stalls) {
+            if (draw < stall.perMillion) {
+                us += stall.minUs + (stall.maxUs > stall.minUs ? random() % (stall.maxUs - stall.minUs + 1) : 0);
+                m_stats.stalls++;
+                break;
+            }
+            draw -= stall.perMillion;
+        }
+    }
+    uint32_t latency = (uint32_t)(us < UINT32_MAX ? us : UINT32_MAX);
+    m_stats.latencyUs += latency;
+    if (latency > m_stats.maxLatencyUs) m_stats.maxLatencyUs = latency;
+    return latency;
+}
+
+
+bool SimBlockDevice::readSectors(uint32_t sector, uint8_t* dst, size_t ns) {
+    if (!read(sector, dst, ns)) return false;
+    uint32_t us = readLatency(sector, ns);
+    if (m_sleep && us) simClockSleepMicros(us);
+    return true;
+}
+
+
+bool SimBlockDevice::writeSectors(uint32_t sector, const uint8_t* src, size_t ns) {
+    if (!write(sector, src, ns)) return false;
+    uint32_t us = writeLatency(sector, ns);
+    if (m_sleep && us) simClockSleepMicros(us);
+    return true;
+}
+
+
+bool SimBlockDevice::syncDevice() {
+    if (m_fd < 0) return true;
+    if (m_map) return msync(m_map, (size_t)m_sectors * SIM_SD_SECTOR, MS_ASYNC) == 0;
+    return true;
+}
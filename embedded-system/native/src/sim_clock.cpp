@@ -0,0 +1,40 @@
+#include "sim_clock.hpp"
+#include <chrono>
+#include <thread>
+
+typedef std::chrono::steady_clock HostClock;
+
+static HostClock::time_point start = HostClock::now();
+static double clockScale = 1.0;
+
+
+void simClockBegin(double scale) {
+    clockScale = scale > 0 ? scale : 1.0;
+    start = HostClock::now();
+}
+
+
+double simClockScale() {
+    return clockScale;
+}
+
+
+uint64_t simClockMicros() {
+    auto host = std::chrono::duration_cast<std::chrono::nanoseconds>(HostClock::now() - start);
+    return (uint64_t)(host.count() * clockScale / 1000.0);
+}
+
+
+uint64_t simClockHostMicros(uint64_t virtualUs) {
+    return (uint64_t)(virtualUs / clockScale);
+}
+
+
+void simClockSleepMicros(uint64_t us) {
+    uint64_t host = simClockHostMicros(us);
+    if (host == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(host));
+}
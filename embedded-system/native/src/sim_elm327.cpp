@@ -0,0 +1,469 @@
+#include "sim_elm327.hpp"
+#include "sim_clock.hpp"
+#include "sim_probe.hpp"
+#include "sim_vehicle.hpp"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+SimElm327 simElm327;
+
+#define SIM_ELM_NO_DATA_US 200000   // AT ST default: how long the ELM waits for an ECU
+#define SIM_ELM_VIN "WVWZZZ1JZXW000001"
+
+static const SimElmTiming profiles[] = {
+    // AT     adapter  ECU    jitter  stall‰  stall    search    reset
+    { 20000,  15000,   30000, 10000,  5,      200000,  4000000,  800000 },    // SIM_ELM327
+    { 1000,   1500,    30000, 5000,   5,      200000,  600000,   250000 },    // SIM_STN1110
+};
+
+// PIDs each ECU answers in mode 01: engine (7E8) and transmission (7E9)
+static const uint8_t enginePids[] = { 0x04, 0x05, 0x0C, 0x0D, 0x10, 0x11, 0x4A };
+static const uint8_t transmissionPids[] = { 0x0D };
+
+
+SimElm327::SimElm327() : m_timing(profiles[SIM_ELM327]) {
+}
+
+
+void SimElm327::setProfile(SimElmProfile profile) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_profile = profile;
+    m_timing = profiles[profile];
+}
+
+
+void SimElm327::setTiming(const SimElmTiming& timing) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timing = timing;
+}
+
+
+SimElmTiming SimElm327::timing() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_timing;
+}
+
+
+void SimElm327::setSeed(uint32_t seed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_seed = seed ? seed : 1;
+}
+
+
+bool SimElm327::loadTrace(const char* path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_trace.load(path);
+}
+
+
+//-------------------------------------------------------------------------------
+// Script: "<seconds> <directive>" per line, '#' comments. Events run in
+// time order as virtual time passes them.
+//-------------------------------------------------------------------------------
+bool SimElm327::loadScript(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    std::vector<ScriptEvent> script;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#' || *p == 0) continue;
+        char* end;
+        double seconds = strtod(p, &end);
+        if (end == p) continue;
+        while (isspace((unsigned char)*end)) end++;
+        std::string directive(end);
+        directive.erase(directive.find_last_not_of(" \t\r\n") + 1);
+        script.push_back({ (uint64_t)(seconds * 1e6), directive });
+    }
+    fclose(f);
+    std::stable_sort(script.begin(), script.end(),
+                     [](const ScriptEvent& a, const ScriptEvent& b) { return a.at < b.at; });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_script = script;
+    m_scriptPos = 0;
+    return true;
+}
+
+
+SimElmStats SimElm327::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    finishRequest(simClockMicros());
+    return m_stats;
+}
+
+
+void SimElm327::begin(unsigned long baud) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (baud) m_byteUs = (uint32_t)(10000000 / baud);
+}
+
+
+void SimElm327::runScript(uint64_t now) {
+    while (m_scriptPos < m_script.size() && m_script[m_scriptPos].at <= now) {
+        apply(m_script[m_scriptPos++].directive);
+    }
+}
+
+
+void SimElm327::apply(const std::string& directive) {
+    char word[16] = "", arg[16] = "";
+    unsigned a = 0, b = 0;
+    sscanf(directive.c_str(), "%15s", word);
+    std::string w(word);
+    if (w == "latency" && sscanf(directive.c_str(), "%*s %u", &a) == 1) {
+        m_timing.ecuUs = a * 1000;
+    } else if (w == "jitter" && sscanf(directive.c_str(), "%*s %u", &a) == 1) {
+        m_timing.jitterUs = a * 1000;
+    } else if (w == "stall" && sscanf(directive.c_str(), "%*s %u %u", &a, &b) == 2) {
+        m_timing.stallPermille = a;
+        m_timing.stallUs = b * 1000;
+    } else if (w == "nodata" && sscanf(directive.c_str(), "%*s %15s %u", arg, &b) == 2) {
+        uint64_t until = simClockMicros() + (uint64_t)b * 1000000;
+        if (strcmp(arg, "all") == 0) {
+            std::fill(m_noDataUntil, m_noDataUntil + 256, until);
+        } else {
+            m_noDataUntil[strtoul(arg, nullptr, 16) & 0xFF] = until;
+        }
+    } else if (w == "ignition" && sscanf(directive.c_str(), "%*s %15s", arg) == 1) {
+        simVehicleSetIgnition(strcmp(arg, "off") != 0);
+    } else if (w == "search") {
+        m_protocolKnown = false;
+    } else if (w == "ecus" && sscanf(directive.c_str(), "%*s %u", &a) == 1) {
+        m_ecus = a >= 2 ? 2 : 1;
+    } else if (w == "profile" && sscanf(directive.c_str(), "%*s %15s", arg) == 1) {
+        m_profile = strcmp(arg, "stn1110") == 0 ? SIM_STN1110 : SIM_ELM327;
+        m_timing = profiles[m_profile];
+    } else {
+        fprintf(stderr, "ELM327 script: unknown directive '%s'\n", directive.c_str());
+    }
+}
+
+
+// xorshift32: jitter and stalls repeat exactly for a given seed
+uint32_t SimElm327::random() {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+
+uint32_t SimElm327::requestDelay() {
+    uint32_t us = m_timing.adapterUs + m_timing.ecuUs;
+    if (m_timing.jitterUs) us += random() % (m_timing.jitterUs + 1);
+    if (m_timing.stallPermille && random() % 1000 < m_timing.stallPermille) {
+        us += m_timing.stallUs;
+        m_stats.stalls++;
+    }
+    return us;
+}
+
+
+//-------------------------------------------------------------------------------
+// Sends text from `at` (or when the transmitter frees up), one byte time each
+//-------------------------------------------------------------------------------
+void SimElm327::queue(const std::string& text, uint64_t at) {
+    uint64_t t = std::max(at, m_txFreeAt);
+    for (char c : text) {
+        t += m_byteUs;
+        m_out.push_back({ t, c });
+    }
+    m_txFreeAt = t;
+}
+
+
+void SimElm327::finishRequest(uint64_t now) {
+    if (m_pending && now >= m_promptAt) {
+        m_stats.serviceUs += m_promptAt - m_requestAt;
+        m_pending = false;
+    }
+}
+
+
+int SimElm327::available() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t now = simClockMicros();
+    runScript(now);
+    int n = 0;
+    for (const OutByte& b : m_out) {
+        if (b.at > now) break;
+        n++;
+    }
+    return n;
+}
+
+
+int SimElm327::read() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_out.empty() || m_out.front().at > simClockMicros()) return -1;
+    char c = m_out.front().c;
+    m_out.pop_front();
+    return (uint8_t)c;
+}
+
+
+int SimElm327::peek() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_out.empty() || m_out.front().at > simClockMicros()) return -1;
+    return (uint8_t)m_out.front().c;
+}
+
+
+//-------------------------------------------------------------------------------
+// Bytes arrive one byte time apart from when the firmware wrote them. A byte
+// that arrives while an OBD reply is still pending stops it. Requests end
+// with CR; LF is ignored, as the ELM does.
+//-------------------------------------------------------------------------------
+void SimElm327::receive(uint8_t c) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t now = simClockMicros();
+    runScript(now);
+    m_rxDoneAt = std::max(now, m_rxDoneAt) + m_byteUs;
+    finishRequest(m_rxDoneAt);
+    if (c == '\n') return;     // println's LF lands while the ELM is still parsing
+
+    if (m_pending) {
+        while (!m_out.empty() && m_out.back().at > m_rxDoneAt) m_out.pop_back();
+        m_txFreeAt = m_out.empty() ? 0 : m_out.back().at;
+        queue("STOPPED\r\r>", m_rxDoneAt);
+        m_stats.stopped++;
+        m_stats.serviceUs += m_txFreeAt - m_requestAt;
+        m_pending = false;
+    }
+
+    if (m_echo) queue(std::string(1, (char)c), m_rxDoneAt);
+    if (c != '\r') {
+        m_line += (char)c;
+        return;
+    }
+
+    std::string command;
+    for (char ch : m_line) {
+        if (ch != ' ') command += (char)toupper((unsigned char)ch);
+    }
+    m_line.clear();
+    if (command.empty()) command = m_lastCommand;
+    m_lastCommand = command;
+    execute(command, m_rxDoneAt);
+}
+
+
+void SimElm327::execute(const std::string& command, uint64_t start) {
+    if (command.empty()) {
+        queue(">", start);
+        return;
+    }
+    if (command.compare(0, 2, "AT") == 0 || command.compare(0, 2, "ST") == 0) {
+        uint32_t delayUs = m_timing.atUs;
+        std::string reply = at(command, delayUs);
+        queue(reply + "\r\r>", start + delayUs);
+        return;
+    }
+    obd(command, start);
+}
+
+
+std::string SimElm327::at(const std::string& command, uint32_t& delayUs) {
+    bool stn = m_profile == SIM_STN1110;
+    if (command == "STI") return stn ? "STN1110 v4.2.0" : "?";
+    if (command.compare(0, 2, "ST") == 0) return stn ? "OK" : "?";
+
+    std::string at = command.substr(2);
+    if (at == "Z" || at == "WS") {
+        m_echo = true;
+        m_headers = false;
+        m_protocolKnown = false;
+        delayUs = m_timing.resetUs;
+        return stn ? "ELM327 v1.4b" : "ELM327 v1.5";
+    }
+    if (at == "I") return stn ? "ELM327 v1.4b" : "ELM327 v1.5";
+    if (at == "E0" || at == "E1") m_echo = at == "E1";
+    if (at == "H0" || at == "H1") m_headers = at == "H1";
+    if (at.compare(0, 2, "SP") == 0) {
+        // SP 0 and SP Ax search; a fixed protocol is taken as found
+        std::string p = at.substr(2);
+        m_protocolKnown = !(p == "0" || p[0] == 'A');
+    }
+    if (at == "RV") {
+        char volts[16];
+        snprintf(volts, sizeof(volts), "%.1fV", simVehicleNow().ignition ? 14.2 : 12.6);
+        return volts;
+    }
+    if (at == "DP") return m_protocolKnown ? "AUTO, ISO 15765-4 (CAN 11/500)" : "AUTO";
+    if (at == "DPN") return m_protocolKnown ? "A6" : "A0";
+    return "OK";
+}
+
+
+//-------------------------------------------------------------------------------
+// An OBD request: protocol search first if needed, then the ECU replies after
+// the request delay. Without ignition the ECU is silent: the search fails
+// with UNABLE TO CONNECT, later requests time out with NO DATA.
+//-------------------------------------------------------------------------------
+void SimElm327::obd(const std::string& command, uint64_t start) {
+    for (char ch : command) {
+        if (!isxdigit((unsigned char)ch)) {
+            queue("?\r\r>", start + m_timing.atUs);
+            return;
+        }
+    }
+    m_stats.requests++;
+    if (simProbe) simProbe->obdRequest(command.c_str(), start);
+    m_pending = true;
+    m_requestAt = start;
+
+    bool ignition = simVehicleNow().ignition;
+    uint64_t at = start + m_timing.adapterUs;
+    if (!m_protocolKnown) {
+        queue("SEARCHING...\r", at);
+        m_stats.searches++;
+        at = start + m_timing.searchUs;
+        if (!ignition) {
+            queue("UNABLE TO CONNECT\r\r>", at);
+            m_stats.noData++;
+            m_promptAt = m_txFreeAt;
+            return;
+        }
+        m_protocolKnown = true;
+        at -= m_timing.adapterUs;
+    }
+
+    std::vector<std::string> lines;
+    uint8_t mode = (uint8_t)strtoul(command.substr(0, 2).c_str(), nullptr, 16);
+    uint8_t pid = command.size() >= 4 ? (uint8_t)strtoul(command.substr(2, 2).c_str(), nullptr, 16) : 0;
+    if (ignition && mode == 0x01 && command.size() == 4 && simClockMicros() >= m_noDataUntil[pid]) {
+        for (int ecu = 0; ecu < m_ecus; ecu++) {
+            std::string line = mode01(pid, ecu);
+            if (!line.empty()) lines.push_back(line);
+        }
+    } else if (ignition && mode == 0x09 && pid == 0x02) {
+        lines = vin();
+    }
+
+    if (lines.empty()) {
+        queue("NO DATA\r\r>", at + m_timing.adapterUs + SIM_ELM_NO_DATA_US);
+        m_stats.noData++;
+    } else {
+        std::string reply;
+        for (const std::string& line : lines) reply += line + "\r";
+        queue(reply + "\r>", at + requestDelay());
+    }
+    m_promptAt = m_txFreeAt;
+}
+
+
+//-------------------------------------------------------------------------------
+// Mode 01 reply of one ECU as "41 PP AA BB ..." (with "7E8 NN " in front when
+// headers are on), or "" when that ECU does not support the PID. The
+// supported-PID maps (00/20/40/60) chain to the next map while there are
+// PIDs above it.
+//-------------------------------------------------------------------------------
+std::string SimElm327::mode01(uint8_t pid, int ecu) {
+    const uint8_t* pids = ecu ? transmissionPids : enginePids;
+    size_t count = ecu ? sizeof(transmissionPids) : sizeof(enginePids);
+
+    uint8_t data[4];
+    size_t length = 0;
+    if (pid % 0x20 == 0 && pid <= 0x60) {
+        uint32_t map = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t p = pids[i];
+            if (p > pid && p <= pid + 0x20) map |= 1u << (32 - (p - pid));
+            if (p > pid + 0x20) map |= 1;
+        }
+        if (pid != 0 && !map) return "";
+        for (int i = 0; i < 4; i++) data[i] = map >> (24 - 8 * i);
+        length = 4;
+    } else {
+        if (std::find(pids, pids + count, pid) == pids + count) return "";
+
+        SimVehicleState v = simVehicleNow();
+        double rpm = v.rpm, speed = v.speedKph, maf = v.mafGps, throttle = v.throttlePct, coolant = v.coolantC;
+        if (m_trace.loaded() && v.ignition) {
+            SimObdSample s = m_trace.at(simClockMicros() / 1e6);
+            rpm = s.rpm;
+            speed = s.speedKph;
+            maf = s.mafGps;
+            throttle = s.throttlePct;
+            coolant = s.coolantC;
+        }
+        switch (pid) {
+        case 0x04:  // Calculated load
+        case 0x11:  // Throttle position
+        case 0x4A:  // Accelerator pedal position D
+            data[0] = (uint8_t)std::min(255.0, throttle * 255 / 100);
+            length = 1;
+            break;
+        case 0x05:  // Coolant, +40 offset
+            data[0] = (uint8_t)std::max(0.0, std::min(255.0, coolant + 40));
+            length = 1;
+            break;
+        case 0x0C: {
+            uint16_t quarterRpm = (uint16_t)std::min(65535.0, rpm * 4);
+            data[0] = quarterRpm >> 8;
+            data[1] = quarterRpm & 0xFF;
+            length = 2;
+            break;
+        }
+        case 0x0D:
+            data[0] = (uint8_t)std::min(255.0, speed + 0.5);
+            length = 1;
+            break;
+        case 0x10: {
+            uint16_t rate = (uint16_t)std::min(65535.0, maf * 100);
+            data[0] = rate >> 8;
+            data[1] = rate & 0xFF;
+            length = 2;
+            break;
+        }
+        }
+    }
+
+    char reply[48];
+    int n = 0;
+    if (m_headers) n = snprintf(reply, sizeof(reply), "%s %02X ", ecu ? "7E9" : "7E8", (unsigned)length + 2);
+    n += snprintf(reply + n, sizeof(reply) - n, "41 %02X", pid);
+    for (size_t i = 0; i < length; i++) n += snprintf(reply + n, sizeof(reply) - n, " %02X", data[i]);
+    return std::string(reply) + " ";
+}
+
+
+//-------------------------------------------------------------------------------
+// VIN as an ISO-TP multi-frame reply: first frame plus consecutive frames,
+// numbered "0:", "1:", ... when headers are off, as the ELM formats them
+//-------------------------------------------------------------------------------
+std::vector<std::string> SimElm327::vin() {
+    std::vector<uint8_t> payload = { 0x49, 0x02, 0x01 };
+    for (const char* p = SIM_ELM_VIN; *p; p++) payload.push_back((uint8_t)*p);
+
+    std::vector<std::string> lines;
+    char buf[64];
+    if (!m_headers) {
+        snprintf(buf, sizeof(buf), "%03zX", payload.size());
+        lines.push_back(buf);
+    }
+    size_t pos = 0;
+    for (int frame = 0; pos < payload.size(); frame++) {
+        size_t n = std::min(payload.size() - pos, (size_t)(frame == 0 ? 6 : 7));
+        int len = 0;
+        if (m_headers) {
+            len = frame == 0 ? snprintf(buf, sizeof(buf), "7E8 10 %02zX", payload.size())
+                             : snprintf(buf, sizeof(buf), "7E8 %02X", 0x20 | (frame & 0x0F));
+        } else {
+            len = snprintf(buf, sizeof(buf), "%X:", frame & 0x0F);
+        }
+        for (size_t i = 0; i < n; i++) len += snprintf(buf + len, sizeof(buf) - len, " %02X", payload[pos + i]);
+        if (m_headers) {
+            for (size_t i = n; i < (size_t)(frame == 0 ? 6 : 7); i++) len += snprintf(buf + len, sizeof(buf) - len, " 00");
+        }
+        lines.push_back(std::string(buf) + " ");
+        pos += n;
+    }
+    return lines;
+}
@@ -0,0 +1,265 @@
+//-------------------------------------------------------------------------------
+// Entry point of the native build. Wires the fakes to the ports the firmware
+// uses (ELM327 on Serial1, u-blox on Wire1, SD card on the SPI host), formats
+// a blank card, then runs setup() and loop() as the Arduino core's loop task.
+//
+//   logger [--speed X] [--port N] [--image FILE] [--card-mb N]
+//          [--seconds N] [--idle] [--ignition-off] [--quiet]
+//          [--elm-profile elm327|stn1110] [--elm-script FILE]
+//          [--obd-trace FILE] [--seed N]
+//          [--ubx-replay FILE [--ubx-fast]] [--ubx-capture FILE]
+//          [--sd-latency none|class10|worn] [--mmap]
+//          [--soak [--clients N] [--slo NAME=VALUE]...]
+//
+// --soak measures the run against service level objectives (see
+// sim_soak.hpp) and exits 1 if any is missed, e.g. a 4 hour drive in
+// 6 minutes on a worn card:
+//
+//   logger --soak --seconds 14400 --speed 40 --sd-latency worn --quiet
+//-------------------------------------------------------------------------------
+#include <Arduino.h>
+#include <SdFat.h>
+#include <WebServer.h>
+#include <Wire.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "sd_spi_esp32.hpp"
+#include "sim_clock.hpp"
+#include "sim_elm327.hpp"
+#include "sim_gpio.hpp"
+#include "sim_sd_card.hpp"
+#include "sim_soak.hpp"
+#include "sim_ublox.hpp"
+#include "sim_vehicle.hpp"
+
+#define SIM_BUTTON_PIN A2       // BUTTON_PIN in main.cpp
+#define SIM_SD_CS_PIN A0        // SD_CS_PIN in main.cpp
+
+void setup();
+void loop();
+
+struct SimOptions {
+    double speed = 1.0;
+    uint16_t port = 8080;
+    const char* image = nullptr;
+    uint32_t cardMb = 8192;     // FAT32, as the SDHC cards the logger uses
+    uint32_t seconds = 0;       // Virtual run time; 0 runs until killed
+    bool idle = false;          // Leave the logging button released
+    bool ignitionOff = false;
+    bool quiet = false;
+    SimElmProfile elmProfile = SIM_ELM327;
+    const char* elmScript = nullptr;
+    const char* obdTrace = nullptr;
+    uint32_t seed = 1;
+    const char* ubxReplay = nullptr;
+    bool ubxFast = false;       // Replay the capture as fast as it is read
+    const char* ubxCapture = nullptr;
+    const char* sdLatency = "none";
+    bool mmap = false;          // Map the image instead of pread/pwrite
+    bool soak = false;
+    int clients = 2;            // HTTP clients of the soak
+};
+
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --speed X        virtual time runs X times faster than real time (1)\n"
+            "  --port N         HTTP port of the web server (8080)\n"
+            "  --image FILE     keep the SD card in a raw image file (default: RAM)\n"
+            "  --card-mb N      size of a new card (8192)\n"
+            "  --seconds N      stop after N seconds of virtual time\n"
+            "  --idle           do not press the logging button\n"
+            "  --ignition-off   the ECU does not answer\n"
+            "  --quiet          do not print the firmware's Serial output\n"
+            "  --elm-profile P  OBD adapter timing: elm327 or stn1110 (elm327)\n"
+            "  --elm-script F   timed latency, NO DATA and ignition events\n"
+            "  --obd-trace F    answer OBD requests from a CSV or recorded journey\n"
+            "  --seed N         seed of the adapter's and the card's random delays (1)\n"
+            "  --ubx-replay F   GNSS output from a UBX capture instead of the drive model\n"
+            "  --ubx-fast       replay the capture as fast as the firmware reads it\n"
+            "  --ubx-capture F  record the GNSS bytes the firmware reads\n"
+            "  --sd-latency P   card write/read latency model: none, class10, worn (none)\n"
+            "  --mmap           map the card image into memory\n"
+            "  --soak           report against the SLOs at the end (needs --seconds)\n"
+            "  --clients N      HTTP clients polling /live, /sdinfo and /drive in a soak (2)\n"
+            "  --slo NAME=V     SLO limit: drop_pct, jitter_p99_ms, mutex_wait_p99_ms,\n"
+            "                   sd_write_p99_ms, process_heap_min_free, http_p99_ms\n",
+            name);
+}
+
+
+static bool parseOptions(int argc, char** argv, SimOptions& o) {
+    static const option longOptions[] = {
+        { "speed", required_argument, nullptr, 's' },
+        { "port", required_argument, nullptr, 'p' },
+        { "image", required_argument, nullptr, 'i' },
+        { "card-mb", required_argument, nullptr, 'c' },
+        { "seconds", required_argument, nullptr, 't' },
+        { "idle", no_argument, nullptr, 'l' },
+        { "ignition-off", no_argument, nullptr, 'g' },
+        { "quiet", no_argument, nullptr, 'q' },
+        { "elm-profile", required_argument, nullptr, 'e' },
+        { "elm-script", required_argument, nullptr, 'x' },
+        { "obd-trace", required_argument, nullptr, 'o' },
+        { "seed", required_argument, nullptr, 'r' },
+        { "ubx-replay", required_argument, nullptr, 'u' },
+        { "ubx-fast", no_argument, nullptr, 'f' },
+        { "ubx-capture", required_argument, nullptr, 'a' },
+        { "sd-latency", required_argument, nullptr, 'd' },
+        { "mmap", no_argument, nullptr, 'm' },
+        { "soak", no_argument, nullptr, 'k' },
+        { "clients", required_argument, nullptr, 'n' },
+        { "slo", required_argument, nullptr, 'v' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        switch (c) {
+        case 's': o.speed = atof(optarg); break;
+        case 'p': o.port = (uint16_t)atoi(optarg); break;
+        case 'i': o.image = optarg; break;
+        case 'c': o.cardMb = (uint32_t)atoi(optarg); break;
+        case 't': o.seconds = (uint32_t)atoi(optarg); break;
+        case 'l': o.idle = true; break;
+        case 'g': o.ignitionOff = true; break;
+        case 'q': o.quiet = true; break;
+        case 'e':
+            if (strcmp(optarg, "stn1110") == 0) o.elmProfile = SIM_STN1110;
+            else if (strcmp(optarg, "elm327") != 0) return false;
+            break;
+        case 'x': o.elmScript = optarg; break;
+        case 'o': o.obdTrace = optarg; break;
+        case 'r': o.seed = (uint32_t)strtoul(optarg, nullptr, 0); break;
+        case 'u': o.ubxReplay = optarg; break;
+        case 'f': o.ubxFast = true; break;
+        case 'a': o.ubxCapture = optarg; break;
+        case 'd': o.sdLatency = optarg; break;
+        case 'm': o.mmap = true; break;
+        case 'k': o.soak = true; break;
+        case 'n': o.clients = atoi(optarg); break;
+        case 'v':
+            if (!simSoakSetSlo(optarg)) return false;
+            break;
+        default: return false;
+        }
+    }
+    return o.speed > 0 && o.cardMb >= 64 && (!o.soak || (o.seconds && o.clients >= 0));
+}
+
+
+static SimOptions options;
+
+
+//-------------------------------------------------------------------------------
+// The Arduino loop task: setup(), then loop() for the run time (and, in a
+// soak, until the records have been counted)
+//-------------------------------------------------------------------------------
+static void loopTask() {
+    setup();
+    if (options.soak) simSoakBegin({ options.port, options.clients, 1000 });
+    uint64_t end = (uint64_t)options.seconds * 1000000;
+    while (!end || simClockMicros() < end) loop();
+    if (options.soak) {
+        // The records are counted over HTTP, so the server keeps running
+        simSoakStop();
+        while (!simSoakDone()) loop();
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// A card whose boot sector is blank gets a file system, as a new card from
+// the shop would have one. format() leaves its last multi-sector write open;
+// syncDevice() ends it before the firmware's own mount.
+//-------------------------------------------------------------------------------
+static bool formatIfBlank() {
+    uint8_t sector[SIM_SD_SECTOR];
+    if (!simSdCard.readSector(0, sector)) return false;
+    for (uint8_t b : sector) {
+        if (b) return true;
+    }
+    SdFat sd;
+    if (!sd.cardBegin(SdSpiConfig(SIM_SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(10), &sdSpi))) return false;
+    return sd.format() && sd.card()->syncDevice();
+}
+
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    simClockBegin(options.speed);
+    uint32_t sectors = options.cardMb * (1024 * 1024 / SIM_SD_SECTOR);
+    bool card = options.image ? simSdCard.beginFile(options.image, sectors, options.mmap ? SIM_BLOCK_MMAP : SIM_BLOCK_PREAD)
+                              : simSdCard.beginRam(sectors);
+    if (!card) {
+        fprintf(stderr, "Cannot create the SD card%s%s\n", options.image ? " image " : "",
+                options.image ? options.image : "");
+        return 1;
+    }
+    SimBlockLatency latency;
+    if (!SimBlockDevice::latencyProfile(options.sdLatency, latency)) {
+        fprintf(stderr, "Unknown SD latency model %s\n", options.sdLatency);
+        return 2;
+    }
+    simSpiAttach(SD_SPI_HOST, &simSdCard);
+    if (!formatIfBlank()) {
+        fprintf(stderr, "Cannot format the SD card\n");
+        return 1;
+    }
+    // After formatting, so the new card's file system costs no virtual time
+    simSdCard.device().setLatency(latency);
+    simSdCard.device().setSeed(options.seed);
+
+    simElm327.setProfile(options.elmProfile);
+    simElm327.setSeed(options.seed);
+    if (options.elmScript && !simElm327.loadScript(options.elmScript)) {
+        fprintf(stderr, "Cannot read the ELM327 script %s\n", options.elmScript);
+        return 1;
+    }
+    if (options.obdTrace && !simElm327.loadTrace(options.obdTrace)) {
+        fprintf(stderr, "Cannot read the OBD trace %s\n", options.obdTrace);
+        return 1;
+    }
+    Serial1.attach(&simElm327);
+    if (options.ubxReplay && !simUblox.replay(options.ubxReplay, !options.ubxFast)) {
+        fprintf(stderr, "Cannot read the UBX capture %s\n", options.ubxReplay);
+        return 1;
+    }
+    if (options.ubxCapture && !simUblox.capture(options.ubxCapture)) {
+        fprintf(stderr, "Cannot create the UBX capture %s\n", options.ubxCapture);
+        return 1;
+    }
+    Wire1.attach(SIM_UBLOX_ADDRESS, &simUblox);
+    simVehicleSetIgnition(!options.ignitionOff);
+    simWebServerSetPort(options.port);
+    Serial.setMuted(options.quiet);
+    if (!options.idle) simGpioSet(SIM_BUTTON_PIN, LOW);
+
+    fprintf(stderr, "Logger running at %gx, http://127.0.0.1:%u/\n", options.speed, options.port);
+    simRunLoopTask(loopTask);
+
+    SimElmStats elm = simElm327.stats();
+    fprintf(stderr, "OBD: %u requests, %u no data, %u stopped, %u stalls, %u searches, %.1f ms mean service\n",
+            elm.requests, elm.noData, elm.stopped, elm.stalls, elm.searches,
+            elm.requests ? elm.serviceUs / 1000.0 / elm.requests : 0.0);
+    SimBlockStats sd = simSdCard.device().stats();
+    fprintf(stderr, "SD: %llu sectors read, %llu written, %u stalls, %u AU opens, %.1f ms max latency\n",
+            (unsigned long long)sd.sectorsRead, (unsigned long long)sd.sectorsWritten, sd.stalls, sd.auOpens,
+            sd.maxLatencyUs / 1000.0);
+    if (options.ubxReplay) {
+        fprintf(stderr, "UBX: %llu bytes replayed%s\n", (unsigned long long)simUblox.replayedBytes(),
+                simUblox.replaying() ? "" : ", capture finished");
+    }
+
+    int missed = options.soak ? simSoakReport(stderr) : 0;
+
+    // Stop like a power cut: the data task is not joined, and the journal
+    // repairs the open journey at the next boot from the same image
+    fflush(stdout);
+    _exit(missed ? 1 : 0);
+}
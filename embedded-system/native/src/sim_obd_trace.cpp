@@ -0,0 +1,108 @@
+#include "sim_obd_trace.hpp"
+#include <ArduinoJson.h>
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define TRACE_LINE_MAX 1024
+
+
+bool SimObdTrace::load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    m_samples.clear();
+    int c;
+    while ((c = fgetc(f)) != EOF && isspace(c)) {}
+    ungetc(c, f);
+    bool ok = c == '{' ? loadRecords(f) : loadCsv(f);
+    fclose(f);
+    return ok && loaded();
+}
+
+
+//-------------------------------------------------------------------------------
+// CSV: the header picks the columns, so traces exported from other tools
+// only need renaming, not reordering
+//-------------------------------------------------------------------------------
+bool SimObdTrace::loadCsv(FILE* f) {
+    static const char* const names[] = { "t", "rpm", "speed", "maf", "throttle", "coolant" };
+    char line[TRACE_LINE_MAX];
+    if (!fgets(line, sizeof(line), f)) return false;
+
+    // Columns match by prefix (time, speed_kph); the longest name wins, so
+    // "throttle" is not taken for "t"
+    int column[8];              // Field of each column in SimObdSample, or -1
+    int columns = 0;
+    for (char* tok = strtok(line, ",\r\n"); tok && columns < 8; tok = strtok(nullptr, ",\r\n")) {
+        while (*tok == ' ') tok++;
+        column[columns] = -1;
+        for (int i = 0; i < 6; i++) {
+            if (strncasecmp(tok, names[i], strlen(names[i])) == 0) column[columns] = i;
+        }
+        columns++;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        double v[6] = {};
+        char* p = line;
+        for (int i = 0; i < columns && *p; i++) {
+            char* end;
+            double x = strtod(p, &end);
+            if (column[i] >= 0) v[column[i]] = x;
+            p = strchr(end, ',');
+            if (!p) break;
+            p++;
+        }
+        m_samples.push_back({ v[0], v[1], v[2], v[3], v[4], v[5] });
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Logger records: obd.* as logged; gps.time gives the spacing, crossing
+// midnight, and records without it are taken as one second apart
+//-------------------------------------------------------------------------------
+bool SimObdTrace::loadRecords(FILE* f) {
+    char line[TRACE_LINE_MAX];
+    double last = -1;
+    while (fgets(line, sizeof(line), f)) {
+        JsonDocument doc;
+        if (deserializeJson(doc, line)) continue;
+
+        double t = last + 1;
+        int h, m, s;
+        const char* time = doc["gps"]["time"] | "";
+        if (sscanf(time, "%d:%d:%d", &h, &m, &s) == 3) {
+            t = h * 3600 + m * 60 + s;
+            while (last >= 0 && t <= last - 43200) t += 86400;
+            if (last >= 0 && t <= last) t = last + 1;  // Repeated second
+        }
+        last = t;
+
+        JsonObject obd = doc["obd"];
+        m_samples.push_back({ t, obd["rpm"] | 0.0, obd["speed"] | 0.0, obd["maf"] | 0.0,
+                              obd["throttle"] | 0.0, obd["coolant"] | 90.0 });
+    }
+    return true;
+}
+
+
+SimObdSample SimObdTrace::at(double seconds) const {
+    if (!loaded()) return SimObdSample{};
+    double t = m_samples.front().t + fmod(seconds, duration());
+    size_t hi = 1;
+    while (hi + 1 < m_samples.size() && m_samples[hi].t < t) hi++;
+    const SimObdSample& a = m_samples[hi - 1];
+    const SimObdSample& b = m_samples[hi];
+    double x = b.t > a.t ? fmin(1, fmax(0, (t - a.t) / (b.t - a.t))) : 0;
+    return { t,
+             a.rpm + (b.rpm - a.rpm) * x,
+             a.speedKph + (b.speedKph - a.speedKph) * x,
+             a.mafGps + (b.mafGps - a.mafGps) * x,
+             a.throttlePct + (b.throttlePct - a.throttlePct) * x,
+             a.coolantC + (b.coolantC - a.coolantC) * x };
+}
@@ -0,0 +1,343 @@
+#include "sim_sd_card.hpp"
+#include "sim_clock.hpp"
+#include "sim_probe.hpp"
+#include <Arduino.h>
+
+SimSdCard simSdCard;
+
+// SPI-mode tokens and responses
+#define R1_READY          0x00
+#define R1_IDLE           0x01
+#define R1_ILLEGAL        0x04
+#define R1_CRC_ERROR      0x08
+#define TOKEN_START       0xFE      // Single-sector data, and every read block
+#define TOKEN_MULTI       0xFC      // One sector of CMD25
+#define TOKEN_STOP        0xFD      // End of CMD25
+#define DATA_ACCEPTED     0x05
+#define DATA_CRC_ERROR    0x0B
+#define DATA_WRITE_ERROR  0x0D
+
+
+static uint8_t crc7(const uint8_t* data, size_t n) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t d = data[i];
+        for (int j = 0; j < 8; j++) {
+            crc <<= 1;
+            if ((d & 0x80) ^ (crc & 0x80)) crc ^= 0x09;
+            d <<= 1;
+        }
+    }
+    return (crc << 1) | 1;
+}
+
+
+static uint16_t crc16(const uint8_t* data, size_t n) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int j = 0; j < 8; j++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+
+//-------------------------------------------------------------------------------
+// Full duplex: each MOSI byte goes to the protocol, each MISO byte is the next
+// queued response byte, or 0xFF (ready) when nothing is queued. A read block
+// waits behind 0xFF for its access time; after a write the card is busy
+// (0x00) for the sector's programming time.
+//-------------------------------------------------------------------------------
+void SimSdCard::spiTransfer(const uint8_t* tx, uint8_t* rx, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t out = nextOut();
+        if (rx) rx[i] = out;
+        feed(tx[i]);
+    }
+}
+
+
+uint8_t SimSdCard::nextOut() {
+    if (m_outPos == m_out.size() && m_state == READ_MULTI) queueSector(m_sector++);
+    if (m_outPos == m_holdPos) {
+        if (simClockMicros() < m_holdUntil) return 0xFF;
+        m_holdPos = SIZE_MAX;
+    }
+    if (m_outPos == m_out.size()) return m_busyUntil && simClockMicros() < m_busyUntil ? 0x00 : 0xFF;
+    uint8_t b = m_out[m_outPos++];
+    if (m_outPos == m_out.size()) {
+        m_out.clear();
+        m_outPos = 0;
+    }
+    return b;
+}
+
+
+void SimSdCard::feed(uint8_t b) {
+    switch (m_state) {
+    case COMMAND:
+    case READ_MULTI:
+        // Commands start with 01xxxxxx; the 0xFF clocked while reading is ignored
+        if (m_cmdLength == 0 && (b & 0xC0) != 0x40) return;
+        m_cmd[m_cmdLength++] = b;
+        if (m_cmdLength == sizeof(m_cmd)) {
+            m_cmdLength = 0;
+            command();
+        }
+        return;
+
+    case WRITE_TOKEN:
+        if (b == TOKEN_START || b == TOKEN_MULTI) {
+            m_blockLength = 0;
+            m_state = WRITE_DATA;
+        } else if (b == TOKEN_STOP && m_multi) {
+            m_multi = false;
+            m_state = COMMAND;
+            writeDone();
+        } else if ((b & 0xC0) == 0x40) {
+            // A command between blocks abandons the write, as when the host
+            // resets mid-transfer and starts again with CMD0
+            m_multi = false;
+            m_state = COMMAND;
+            m_cmd[0] = b;
+            m_cmdLength = 1;
+        }
+        return;
+
+    case WRITE_DATA:
+        m_block[m_blockLength++] = b;
+        if (m_blockLength == sizeof(m_block)) blockReceived();
+        return;
+    }
+}
+
+
+void SimSdCard::respond(uint8_t r1) {
+    // One stuff byte before the response, as SdSpiCard expects
+    m_out.clear();
+    m_outPos = 0;
+    m_holdPos = SIZE_MAX;
+    m_out.push_back(0xFF);
+    m_out.push_back(r1);
+}
+
+
+void SimSdCard::queueBlock(const uint8_t* data, size_t length) {
+    uint16_t crc = crc16(data, length);
+    m_out.push_back(TOKEN_START);
+    m_out.insert(m_out.end(), data, data + length);
+    m_out.push_back(crc >> 8);
+    m_out.push_back(crc & 0xFF);
+}
+
+
+void SimSdCard::queueSector(uint32_t sector) {
+    uint8_t data[SIM_SD_SECTOR];
+    if (!m_device.read(sector, data)) {
+        m_out.push_back(0x08);      // Data error token: out of range
+        m_state = COMMAND;
+        return;
+    }
+    uint32_t us = m_device.readLatency(sector, 1);
+    if (us) {
+        m_holdPos = m_out.size();
+        m_holdUntil = simClockMicros() + us;
+    }
+    queueBlock(data, sizeof(data));
+    m_sectorsRead++;
+}
+
+
+void SimSdCard::blockReceived() {
+    uint16_t crc = (uint16_t)m_block[SIM_SD_SECTOR] << 8 | m_block[SIM_SD_SECTOR + 1];
+    uint8_t response;
+    if (m_crc && crc != crc16(m_block, SIM_SD_SECTOR)) {
+        response = DATA_CRC_ERROR;
+    } else if (!m_device.write(m_sector, m_block)) {
+        response = DATA_WRITE_ERROR;
+    } else {
+        response = DATA_ACCEPTED;
+        uint32_t us = m_device.writeLatency(m_sector, 1);
+        if (us) m_busyUntil = simClockMicros() + us;
+        m_sector++;
+        m_sectorsWritten++;
+    }
+    m_out.push_back(response);
+    if (!m_multi && response == DATA_ACCEPTED) writeDone();
+    m_state = (m_multi && response == DATA_ACCEPTED) ? WRITE_TOKEN : COMMAND;
+    if (m_state == COMMAND) m_multi = false;
+}
+
+
+void SimSdCard::writeDone() {
+    if (!simProbe) return;
+    uint64_t now = simClockMicros();
+    simProbe->sdWrite((m_busyUntil > now ? m_busyUntil : now) - m_writeStart);
+}
+
+
+void SimSdCard::command() {
+    uint8_t index = m_cmd[0] & 0x3F;
+    uint32_t arg = (uint32_t)m_cmd[1] << 24 | (uint32_t)m_cmd[2] << 16 | (uint32_t)m_cmd[3] << 8 | m_cmd[4];
+    bool app = m_appCmd;
+    m_appCmd = false;
+
+    // CMD0 and CMD8 carry valid CRCs even before CMD59
+    bool crcChecked = m_crc || index == 0 || index == 8;
+    if (crcChecked && crc7(m_cmd, 5) != m_cmd[5]) {
+        respond((m_idle ? R1_IDLE : R1_READY) | R1_CRC_ERROR);
+        return;
+    }
+
+    // Any command ends a multi-sector read
+    if (m_state == READ_MULTI) m_state = COMMAND;
+    uint8_t r1 = m_idle ? R1_IDLE : R1_READY;
+
+    if (app) {
+        switch (index) {
+        case 41:    // SD_SEND_OP_COND
+            m_idle = false;
+            respond(R1_READY);
+            return;
+        case 13: {  // SD_STATUS: R2, then 64 bytes
+            uint8_t status[64] = {};
+            respond(r1);
+            m_out.push_back(0x00);
+            queueBlock(status, sizeof(status));
+            return;
+        }
+        case 51: {  // SCR: SD 3.0, 1/4-bit bus
+            static const uint8_t scr[8] = { 0x02, 0x35, 0x80, 0x00, 0, 0, 0, 0 };
+            respond(r1);
+            queueBlock(scr, sizeof(scr));
+            return;
+        }
+        case 23:    // SET_WR_BLK_ERASE_COUNT
+            respond(r1);
+            return;
+        }
+        // Not an application command: handled as a plain one below
+    }
+
+    switch (index) {
+    case 0:     // GO_IDLE_STATE
+        m_idle = true;
+        m_crc = false;
+        m_multi = false;
+        m_state = COMMAND;
+        respond(R1_IDLE);
+        return;
+
+    case 8:     // SEND_IF_COND: echo the check pattern
+        respond(r1);
+        m_out.push_back(0x00);
+        m_out.push_back(0x00);
+        m_out.push_back(arg >> 8 & 0x0F);
+        m_out.push_back(arg & 0xFF);
+        return;
+
+    case 55:    // APP_CMD
+        m_appCmd = true;
+        respond(r1);
+        return;
+
+    case 58:    // READ_OCR: powered up, high capacity, 3.2-3.4 V
+        respond(r1);
+        m_out.push_back(0xC0);
+        m_out.push_back(0xFF);
+        m_out.push_back(0x80);
+        m_out.push_back(0x00);
+        return;
+
+    case 59:    // CRC_ON_OFF
+        m_crc = arg & 1;
+        respond(r1);
+        return;
+
+    case 9: {   // SEND_CSD (version 2.0)
+        uint32_t cSize = m_device.sectorCount() / 1024 - 1;
+        uint8_t csd[16] = { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00,
+                            (uint8_t)(cSize >> 16 & 0x3F), (uint8_t)(cSize >> 8), (uint8_t)cSize,
+                            0x7F, 0x80, 0x0A, 0x40, 0x00, 0x00 };
+        csd[15] = crc7(csd, 15);
+        respond(r1);
+        queueBlock(csd, sizeof(csd));
+        return;
+    }
+
+    case 10: {  // SEND_CID
+        uint8_t cid[16] = { 0x03, 'S', 'D', 'N', 'A', 'T', 'I', 'V', 0x10,
+                            0x00, 0x00, 0x00, 0x01, 0x01, 0x9A, 0x00 };
+        cid[15] = crc7(cid, 15);
+        respond(r1);
+        queueBlock(cid, sizeof(cid));
+        return;
+    }
+
+    case 13:    // SEND_STATUS: R2
+        respond(r1);
+        m_out.push_back(0x00);
+        return;
+
+    case 6: {   // SWITCH_FUNC: no functions switched
+        uint8_t status[64] = {};
+        respond(r1);
+        queueBlock(status, sizeof(status));
+        return;
+    }
+
+    case 12:    // STOP_TRANSMISSION
+        respond(r1);
+        return;
+
+    case 16:    // SET_BLOCKLEN (always 512 on SDHC)
+        respond(r1);
+        return;
+
+    case 17:    // READ_SINGLE_BLOCK
+    case 18:    // READ_MULTIPLE_BLOCK
+        if (m_idle || arg >= m_device.sectorCount()) {
+            respond(r1 | R1_ILLEGAL);
+            return;
+        }
+        respond(r1);
+        if (index == 17) {
+            queueSector(arg);
+        } else {
+            m_sector = arg;
+            m_state = READ_MULTI;
+        }
+        return;
+
+    case 24:    // WRITE_BLOCK
+    case 25:    // WRITE_MULTIPLE_BLOCK
+        if (m_idle || arg >= m_device.sectorCount()) {
+            respond(r1 | R1_ILLEGAL);
+            return;
+        }
+        respond(r1);
+        m_sector = arg;
+        m_multi = index == 25;
+        m_writeStart = simClockMicros();
+        m_state = WRITE_TOKEN;
+        return;
+
+    case 32:    // ERASE_WR_BLK_START
+        m_eraseStart = arg;
+        respond(r1);
+        return;
+
+    case 33:    // ERASE_WR_BLK_END
+        m_eraseEnd = arg;
+        respond(r1);
+        return;
+
+    case 38: {  // ERASE: erased sectors read as zeros
+        uint8_t zero[SIM_SD_SECTOR] = {};
+        for (uint32_t s = m_eraseStart; s <= m_eraseEnd && s < m_device.sectorCount(); s++) m_device.write(s, zero);
+        respond(r1);
+        return;
+    }
+    }
+    respond(r1 | R1_ILLEGAL);
+}
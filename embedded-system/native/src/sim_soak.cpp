@@ -0,0 +1,391 @@
+#include "sim_soak.hpp"
+#include "sim_clock.hpp"
+#include "sim_probe.hpp"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+SimProbe* simProbe = nullptr;
+
+#define SOAK_NOMINAL_CYCLE_US 1000000
+#define SOAK_HTTP_TIMEOUT_S 30      // Host time; a request that takes longer counts as an error
+#define SOAK_REFRESH_REQUESTS 30    // Requests between looking up the latest drive again
+
+
+//-------------------------------------------------------------------------------
+// A distribution in microseconds as a log-linear histogram: exact below 16 us,
+// then 16 buckets per power of two (within 6 %). It never allocates after
+// construction, so a long soak does not show up in the heap figures.
+//-------------------------------------------------------------------------------
+#define SAMPLES_SUB_BITS 4
+#define SAMPLES_BUCKETS ((64 - SAMPLES_SUB_BITS + 1) << SAMPLES_SUB_BITS)
+
+class Samples {
+public:
+    void add(uint64_t us) {
+        m_buckets[bucket(us)]++;
+        m_count++;
+        uint64_t max = m_max;
+        while (us > max && !m_max.compare_exchange_weak(max, us)) {}
+    }
+    size_t count() { return m_count; }
+    // p in 0..100, as the middle of the bucket it falls in; 0 when empty
+    double percentileMs(double p) {
+        uint64_t count = m_count;
+        if (count == 0) return 0;
+        if (p >= 100) return m_max / 1000.0;
+        uint64_t rank = (uint64_t)(p / 100 * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < SAMPLES_BUCKETS; i++) {
+            seen += m_buckets[i];
+            if (seen >= rank) return std::min((double)m_max, (lowest(i) + lowest(i + 1) - 1) / 2.0) / 1000.0;
+        }
+        return m_max / 1000.0;
+    }
+    void print(FILE* out, const char* name) {
+        fprintf(out, "  %-22s %8zu  p50 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f ms\n", name, count(),
+                percentileMs(50), percentileMs(99), percentileMs(99.9), percentileMs(100));
+    }
+
+private:
+    static int bucket(uint64_t us) {
+        if (us < (1 << SAMPLES_SUB_BITS)) return (int)us;
+        int exponent = 63 - __builtin_clzll(us);
+        int shift = exponent - SAMPLES_SUB_BITS;
+        return ((shift + 1) << SAMPLES_SUB_BITS) + (int)((us >> shift) & ((1 << SAMPLES_SUB_BITS) - 1));
+    }
+    // Smallest value of bucket i
+    static double lowest(int i) {
+        if (i < (1 << SAMPLES_SUB_BITS)) return i;
+        int shift = (i >> SAMPLES_SUB_BITS) - 1;
+        int sub = i & ((1 << SAMPLES_SUB_BITS) - 1);
+        return (double)(((uint64_t)(1 << SAMPLES_SUB_BITS) + sub) << shift);
+    }
+
+    std::atomic<uint32_t> m_buckets[SAMPLES_BUCKETS] = {};
+    std::atomic<uint64_t> m_count{ 0 };
+    std::atomic<uint64_t> m_max{ 0 };
+};
+
+
+// Samples per name (task or endpoint), created on first use
+class SampleMap {
+public:
+    Samples& operator[](const std::string& name) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_map[name];
+    }
+    std::vector<std::string> names() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::string> names;
+        for (const auto& entry : m_map) names.push_back(entry.first);
+        return names;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::map<std::string, Samples> m_map;
+};
+
+
+class SoakProbe : public SimProbe {
+public:
+    void mutexWait(const char* task, uint64_t us) override {
+        waits[task].add(us);
+    }
+    void mutexHold(const char* task, uint64_t us) override { holds[task].add(us); }
+    void sdWrite(uint64_t us) override { sdWrites.add(us); }
+    void obdRequest(const char* command, uint64_t at) override {
+        // Every data cycle starts with the RPM request
+        if (strcmp(command, "010C") != 0) return;
+        uint64_t last = lastCycle.exchange(at);
+        cycles++;
+        if (last) {
+            periods.add(at - last);
+            int64_t jitter = (int64_t)(at - last) - SOAK_NOMINAL_CYCLE_US;
+            jitters.add(jitter < 0 ? -jitter : jitter);
+        }
+    }
+
+    SampleMap waits, holds;
+    Samples sdWrites, periods, jitters;
+    std::atomic<uint64_t> lastCycle{ 0 };
+    std::atomic<uint32_t> cycles{ 0 };
+};
+
+
+struct Slo {
+    const char* name;
+    double limit;
+    bool atLeast;               // The measured value must be >= the limit
+};
+
+static Slo slos[] = {
+    { "drop_pct", 0.1, false },
+    { "jitter_p99_ms", 50, false },
+    { "mutex_wait_p99_ms", 100, false },       // Worst task
+    { "sd_write_p99_ms", 250, false },
+    { "process_heap_min_free", 100000, true },
+    { "http_p99_ms", 500, false },
+};
+
+static SoakProbe probe;
+static SimSoakOptions soak;
+static std::vector<std::thread> clients;
+static std::thread finisher;
+static std::atomic<bool> running{ false };
+static std::atomic<bool> done{ false };
+static SampleMap http;
+static std::atomic<uint32_t> httpErrors{ 0 };
+static std::atomic<uint64_t> httpBytes{ 0 };
+static uint64_t startUs = 0;
+static uint64_t stopUs = 0;
+static uint32_t records = 0;
+static uint32_t cyclesAtCount = 0;
+
+
+bool simSoakSetSlo(const char* assignment) {
+    const char* eq = strchr(assignment, '=');
+    if (!eq) return false;
+    for (Slo& slo : slos) {
+        if (strlen(slo.name) == (size_t)(eq - assignment) && strncmp(slo.name, assignment, eq - assignment) == 0) {
+            slo.limit = atof(eq + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Body of a chunked response without the chunk framing
+static std::string dechunk(const std::string& chunked) {
+    std::string body;
+    size_t pos = 0;
+    while (pos < chunked.size()) {
+        size_t eol = chunked.find("\r\n", pos);
+        if (eol == std::string::npos) break;
+        size_t size = strtoul(chunked.c_str() + pos, nullptr, 16);
+        if (size == 0) break;
+        body.append(chunked, eol + 2, size);
+        pos = eol + 2 + size + 2;
+    }
+    return body;
+}
+
+
+//-------------------------------------------------------------------------------
+// One GET over a fresh connection, as the app makes them. Returns the status
+// code, or -1 if the request failed or timed out.
+//-------------------------------------------------------------------------------
+static int httpGet(const std::string& path, std::string* body, uint64_t& us, size_t& bytes) {
+    uint64_t start = simClockMicros();
+    bytes = 0;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    timeval timeout = { SOAK_HTTP_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(soak.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    if (send(fd, request.data(), request.size(), 0) != (ssize_t)request.size()) {
+        close(fd);
+        return -1;
+    }
+
+    std::string head;
+    char buf[4096];
+    ssize_t n;
+    bool inBody = false;
+    bool failed = false;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) != 0) {
+        if (n < 0) {
+            failed = true;
+            break;
+        }
+        bytes += n;
+        if (inBody) {
+            if (body) body->append(buf, n);
+            continue;
+        }
+        head.append(buf, n);
+        size_t end = head.find("\r\n\r\n");
+        if (end != std::string::npos) {
+            inBody = true;
+            if (body) body->assign(head, end + 4, std::string::npos);
+        }
+    }
+    close(fd);
+    us = simClockMicros() - start;
+    if (failed || head.compare(0, 9, "HTTP/1.1 ") != 0) return -1;
+    if (body && head.find("Transfer-Encoding: chunked") != std::string::npos) *body = dechunk(*body);
+    return atoi(head.c_str() + 9);
+}
+
+
+// Last string of a JSON array such as ["2025-03-04","2025-03-05"], or ""
+static std::string lastName(const std::string& json) {
+    JsonDocument doc;
+    if (deserializeJson(doc, json)) return "";
+    JsonArray names = doc.as<JsonArray>();
+    return names.size() ? names[names.size() - 1].as<const char*>() : "";
+}
+
+
+static void clientMain(int id) {
+    const char* endpoints[] = { "/live", "/sdinfo", "/drive" };
+    std::string drive;
+    for (uint32_t n = id; running; n++) {
+        uint64_t us;
+        size_t bytes;
+        if (n % SOAK_REFRESH_REQUESTS == (uint32_t)id || drive.empty()) {
+            std::string days, drives;
+            if (httpGet("/days", &days, us, bytes) == 200) {
+                std::string day = lastName(days);
+                if (!day.empty() && httpGet("/drives?day=" + day, &drives, us, bytes) == 200) {
+                    std::string name = lastName(drives);
+                    if (!name.empty()) drive = "/drive?day=" + day + "&drive=" + name;
+                }
+            }
+        }
+
+        const char* endpoint = endpoints[n % 3];
+        std::string path = endpoint;
+        if (path == "/drive") {
+            if (drive.empty()) continue;
+            path = drive;
+        }
+        int status = httpGet(path, nullptr, us, bytes);
+        if (status == 200) {
+            http[endpoint].add(us);
+            httpBytes += bytes;
+        } else if (status != 404) {
+            // 404 is /live before the first record
+            httpErrors++;
+        }
+        simClockSleepMicros((uint64_t)soak.intervalMs * 1000);
+    }
+}
+
+
+void simSoakBegin(const SimSoakOptions& options) {
+    soak = options;
+    simProbe = &probe;
+    startUs = simClockMicros();
+    running = true;
+    for (int i = 0; i < options.clients; i++) clients.emplace_back(clientMain, i);
+}
+
+
+//-------------------------------------------------------------------------------
+// Records logged, from the summaries of every drive on the card (the active
+// one included), with the cycle count taken at the same moment
+//-------------------------------------------------------------------------------
+static void countRecords() {
+    uint64_t us;
+    size_t bytes;
+    std::string days;
+    if (httpGet("/days", &days, us, bytes) != 200) return;
+    cyclesAtCount = probe.cycles;
+    JsonDocument dayDoc;
+    if (deserializeJson(dayDoc, days)) return;
+    for (JsonVariant day : dayDoc.as<JsonArray>()) {
+        std::string drives;
+        std::string d = day.as<const char*>();
+        if (httpGet("/drives?day=" + d, &drives, us, bytes) != 200) continue;
+        JsonDocument driveDoc;
+        if (deserializeJson(driveDoc, drives)) continue;
+        for (JsonVariant drive : driveDoc.as<JsonArray>()) {
+            std::string summary;
+            if (httpGet("/summary?day=" + d + "&drive=" + drive.as<const char*>(), &summary, us, bytes) != 200) {
+                continue;
+            }
+            JsonDocument doc;
+            if (!deserializeJson(doc, summary)) records += doc["samples"] | 0;
+        }
+    }
+}
+
+
+void simSoakStop() {
+    stopUs = simClockMicros();
+    running = false;
+    finisher = std::thread([] {
+        for (std::thread& client : clients) client.join();
+        countRecords();
+        simProbe = nullptr;
+        done = true;
+    });
+}
+
+
+bool simSoakDone() {
+    return done;
+}
+
+
+int simSoakReport(FILE* out) {
+    finisher.join();
+
+    // The first cycle runs before logging is switched on
+    uint32_t expected = cyclesAtCount > 1 ? cyclesAtCount - 1 : 0;
+    double dropPct = expected && records < expected ? 100.0 * (expected - records) / expected : 0;
+    double httpP99 = 0;
+    for (const std::string& name : http.names()) httpP99 = std::max(httpP99, http[name].percentileMs(99));
+    // Per task, so a busy web server cannot hide a Data Task that waits
+    double waitP99 = 0;
+    for (const std::string& task : probe.waits.names()) waitP99 = std::max(waitP99, probe.waits[task].percentileMs(99));
+    // The whole host process: the soak's own clients allocate from the same
+    // heap, so this is a lower bound on what the firmware alone leaves free
+    uint32_t heapMin = ESP.getMinFreeHeap();
+
+    fprintf(out, "\nSoak: %.0f s virtual at %gx, %d clients\n", (stopUs - startUs) / 1e6, simClockScale(),
+            soak.clients);
+    fprintf(out, "  data cycles %u, records %u, drop %.2f %%\n", cyclesAtCount, records, dropPct);
+    probe.periods.print(out, "cycle period");
+    probe.jitters.print(out, "cycle jitter (vs 1 s)");
+    for (const std::string& task : probe.waits.names()) probe.waits[task].print(out, ("sdMutex wait " + task).c_str());
+    for (const std::string& task : probe.holds.names()) probe.holds[task].print(out, ("sdMutex hold " + task).c_str());
+    probe.sdWrites.print(out, "SD write");
+    for (const std::string& name : http.names()) http[name].print(out, ("HTTP " + name).c_str());
+    fprintf(out, "  HTTP errors %u, %.1f MB served; process heap min free %u bytes\n", (unsigned)httpErrors,
+            httpBytes / 1e6, (unsigned)heapMin);
+
+    double measured[] = {
+        dropPct,
+        probe.jitters.percentileMs(99),
+        waitP99,
+        probe.sdWrites.percentileMs(99),
+        (double)heapMin,
+        httpP99,
+    };
+    int missed = 0;
+    fprintf(out, "SLO\n");
+    for (size_t i = 0; i < sizeof(slos) / sizeof(slos[0]); i++) {
+        bool pass = slos[i].atLeast ? measured[i] >= slos[i].limit : measured[i] <= slos[i].limit;
+        if (!pass) missed++;
+        fprintf(out, "  %-22s %s %-10g %12.2f  %s\n", slos[i].name, slos[i].atLeast ? ">=" : "<=", slos[i].limit,
+                measured[i], pass ? "PASS" : "FAIL");
+    }
+    if (httpErrors) {
+        missed++;
+        fprintf(out, "  %-22s %s %-10g %12u  FAIL\n", "http_errors", "<=", 0.0, (unsigned)httpErrors);
+    }
+    return missed;
+}
@@ -0,0 +1,398 @@
+#include "sim_ublox.hpp"
+#include "sim_clock.hpp"
+#include "sim_vehicle.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+SimUblox simUblox;
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_NAV 0x01
+#define UBX_ACK 0x05
+#define UBX_CFG 0x06
+#define UBX_ESF 0x10
+#define UBX_HNR 0x28
+#define UBX_WEEK_MS 604800000u
+
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = v >> (8 * i);
+}
+
+
+void SimUblox::setLatency(uint32_t us) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latencyUs = us;
+}
+
+
+void SimUblox::setCalibrationTime(uint32_t ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_calibrationMs = ms;
+}
+
+
+//-------------------------------------------------------------------------------
+// Raw UBX: one chunk per frame with a valid checksum; anything between
+// frames (NMEA, line noise) is skipped. NAV and HNR frames start with iTOW,
+// which times them and the frames after them.
+//-------------------------------------------------------------------------------
+bool SimUblox::loadRaw(FILE* f, std::vector<ReplayChunk>& chunks) {
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+
+    bool timed = false;
+    uint32_t firstTow = 0;
+    uint64_t at = 0;
+    size_t i = 0;
+    while (i + 8 <= data.size()) {
+        if (data[i] != UBX_SYNC_1 || data[i + 1] != UBX_SYNC_2) {
+            i++;
+            continue;
+        }
+        uint16_t length = data[i + 4] | data[i + 5] << 8;
+        if (i + 8 + length > data.size()) break;
+        uint8_t a = 0, c = 0;
+        for (size_t j = i + 2; j < i + 6 + length; j++) {
+            a += data[j];
+            c += a;
+        }
+        if (a != data[i + 6 + length] || c != data[i + 7 + length]) {
+            i++;
+            continue;
+        }
+        uint8_t cls = data[i + 2];
+        if ((cls == UBX_NAV || cls == UBX_HNR) && length >= 4) {
+            uint32_t tow = data[i + 6] | data[i + 7] << 8 | data[i + 8] << 16 | (uint32_t)data[i + 9] << 24;
+            if (!timed) firstTow = tow;
+            timed = true;
+            at = (uint64_t)((tow - firstTow + UBX_WEEK_MS) % UBX_WEEK_MS) * 1000;
+        }
+        chunks.push_back({ at, std::vector<uint8_t>(data.begin() + i, data.begin() + i + 8 + length) });
+        i += 8 + length;
+    }
+    return !chunks.empty();
+}
+
+
+bool SimUblox::loadText(FILE* f, std::vector<ReplayChunk>& chunks) {
+    char line[4096];
+    bool first = true;
+    double start = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) continue;
+        char* end;
+        double seconds = strtod(p, &end);
+        if (end == p) return false;
+        if (first) start = seconds;
+        first = false;
+
+        ReplayChunk chunk = { (uint64_t)((seconds - start) * 1e6), {} };
+        for (p = end;;) {
+            unsigned long b = strtoul(p, &end, 16);
+            if (end == p) break;
+            chunk.bytes.push_back((uint8_t)b);
+            p = end;
+        }
+        if (!chunk.bytes.empty()) chunks.push_back(chunk);
+    }
+    return !chunks.empty();
+}
+
+
+bool SimUblox::replay(const char* path, bool realTime) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    int first = fgetc(f);
+    rewind(f);
+    std::vector<ReplayChunk> chunks;
+    bool ok = first == UBX_SYNC_1 ? loadRaw(f, chunks) : loadText(f, chunks);
+    fclose(f);
+    if (!ok) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_replay = std::move(chunks);
+    m_replayPos = 0;
+    m_replayedBytes = 0;
+    m_replayStart = simClockMicros();
+    m_replayRealTime = realTime;
+    m_replaying = true;
+    m_pending.clear();
+    m_out.clear();
+    return true;
+}
+
+
+void SimUblox::stopReplay() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_replaying = false;
+    m_replay.clear();
+    m_replayPos = 0;
+    m_out.clear();
+}
+
+
+bool SimUblox::replaying() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_replaying && m_replayPos < m_replay.size();
+}
+
+
+uint64_t SimUblox::replayedBytes() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_replayedBytes;
+}
+
+
+bool SimUblox::capture(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_capture) fclose(m_capture);
+    m_capture = f;
+    fprintf(f, "# seconds  bytes read from register 0xFF\n");
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Moves replies whose latency has passed, and captured output whose time
+// has come, into the readable stream
+//-------------------------------------------------------------------------------
+void SimUblox::release() {
+    uint64_t now = simClockMicros();
+    while (!m_pending.empty() && m_pending.front().readyAt <= now) {
+        m_out.insert(m_out.end(), m_pending.front().bytes.begin(), m_pending.front().bytes.end());
+        m_pending.pop_front();
+    }
+    while (m_replaying && m_replayPos < m_replay.size() &&
+           (!m_replayRealTime || m_replayStart + m_replay[m_replayPos].at <= now)) {
+        const std::vector<uint8_t>& bytes = m_replay[m_replayPos++].bytes;
+        m_out.insert(m_out.end(), bytes.begin(), bytes.end());
+        m_replayedBytes += bytes.size();
+    }
+}
+
+
+void SimUblox::i2cWrite(const uint8_t* data, size_t length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (length == 1) {
+        m_register = data[0];
+        return;
+    }
+    for (size_t i = 0; i < length; i++) parse(data[i]);
+}
+
+
+size_t SimUblox::i2cRead(uint8_t* data, size_t length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    release();
+    std::vector<uint8_t> streamed;
+    for (size_t i = 0; i < length; i++) {
+        if (m_register == 0xFD) {
+            m_length = (uint16_t)std::min<size_t>(m_out.size(), 0x7FFF);
+            data[i] = m_length >> 8;
+        } else if (m_register == 0xFE) {
+            data[i] = m_length & 0xFF;
+        } else if (m_register == 0xFF) {
+            if (m_out.empty()) {
+                data[i] = 0xFF;
+            } else {
+                data[i] = m_out.front();
+                m_out.pop_front();
+                streamed.push_back(data[i]);
+            }
+            continue;   // The stream register does not advance
+        } else {
+            data[i] = 0;
+        }
+        m_register++;
+    }
+
+    if (m_capture && !streamed.empty()) {
+        fprintf(m_capture, "%.6f", simClockMicros() / 1e6);
+        for (uint8_t b : streamed) fprintf(m_capture, " %02X", b);
+        fputc('\n', m_capture);
+        fflush(m_capture);
+    }
+    return length;
+}
+
+
+//-------------------------------------------------------------------------------
+// UBX framing: sync, class, id, length, payload, Fletcher checksum. Bytes
+// that do not start a frame are dropped, as the receiver does.
+//-------------------------------------------------------------------------------
+void SimUblox::parse(uint8_t b) {
+    if ((m_in.empty() && b != UBX_SYNC_1) || (m_in.size() == 1 && b != UBX_SYNC_2)) {
+        m_in.clear();
+        return;
+    }
+    m_in.push_back(b);
+    if (m_in.size() < 6) return;
+
+    uint16_t length = m_in[4] | m_in[5] << 8;
+    if (m_in.size() < (size_t)length + 8) return;
+
+    uint8_t a = 0, c = 0;
+    for (size_t i = 2; i < (size_t)length + 6; i++) {
+        a += m_in[i];
+        c += a;
+    }
+    if (a == m_in[length + 6] && c == m_in[length + 7]) message(m_in[2], m_in[3], &m_in[6], length);
+    m_in.clear();
+}
+
+
+void SimUblox::send(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length) {
+    size_t start = m_reply.size();
+    m_reply.push_back(UBX_SYNC_1);
+    m_reply.push_back(UBX_SYNC_2);
+    m_reply.push_back(cls);
+    m_reply.push_back(id);
+    m_reply.push_back(length & 0xFF);
+    m_reply.push_back(length >> 8);
+    m_reply.insert(m_reply.end(), payload, payload + length);
+    uint8_t a = 0, c = 0;
+    for (size_t i = start + 2; i < m_reply.size(); i++) {
+        a += m_reply[i];
+        c += a;
+    }
+    m_reply.push_back(a);
+    m_reply.push_back(c);
+}
+
+
+void SimUblox::acknowledge(uint8_t cls, uint8_t id, bool ack) {
+    uint8_t payload[2] = { cls, id };
+    send(UBX_ACK, ack ? 0x01 : 0x00, payload, sizeof(payload));
+}
+
+
+void SimUblox::message(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length) {
+    m_reply.clear();
+    bool poll = length == 0;
+
+    if (cls == UBX_CFG) {
+        if (id == 0x00 && length == 1) {
+            // CFG-PRT poll of the DDC port
+            uint8_t prt[20] = {};
+            prt[0] = payload[0];
+            put32(&prt[4], SIM_UBLOX_ADDRESS << 1);
+            put16(&prt[12], 0x0007);
+            put16(&prt[14], m_outProtoMask);
+            send(UBX_CFG, 0x00, prt, sizeof(prt));
+            acknowledge(cls, id, true);
+        } else if (id == 0x00 && length == 20) {
+            if (payload[0] == 0) m_outProtoMask = payload[14] | payload[15] << 8;
+            acknowledge(cls, id, true);
+        } else if (id == 0x08 && poll) {
+            // CFG-RATE: 1 Hz, GPS time
+            uint8_t rate[6] = { 0xE8, 0x03, 0x01, 0x00, 0x01, 0x00 };
+            send(UBX_CFG, 0x08, rate, sizeof(rate));
+            acknowledge(cls, id, true);
+        } else {
+            acknowledge(cls, id, !poll);
+        }
+    } else if (m_replaying) {
+        // Navigation output comes from the capture
+    } else if (cls == UBX_NAV && id == 0x07 && poll) {
+        navPvt();
+    } else if (cls == UBX_ESF && id == 0x15 && poll) {
+        esfIns();
+    } else if (cls == UBX_ESF && id == 0x10 && poll) {
+        esfStatus();
+    }
+
+    if (m_reply.empty()) return;
+    m_polls++;
+    m_pending.push_back({ simClockMicros() + m_latencyUs, m_reply });
+}
+
+
+// GPS time of week, ms
+static uint32_t timeOfWeek(const SimVehicleState& v) {
+    // Sakamoto's day of week, 0 = Sunday as in GPS weeks
+    static const int t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    int y = v.year - (v.month < 3);
+    int dow = (y + y / 4 - y / 100 + y / 400 + t[v.month - 1] + v.day) % 7;
+    return ((dow * 86400u + v.hour * 3600u + v.minute * 60u + v.second) * 1000u) + v.millisecond;
+}
+
+
+//-------------------------------------------------------------------------------
+// NAV-PVT of the last 1 Hz epoch: 3D fix, valid and fully resolved time
+//-------------------------------------------------------------------------------
+void SimUblox::navPvt() {
+    uint64_t now = simClockMicros();
+    SimVehicleState v = simVehicleAt(now - now % 1000000);
+    double speed = v.speedKph / 3.6;
+    double heading = v.headingDeg * M_PI / 180;
+
+    uint8_t pvt[92] = {};
+    put32(&pvt[0], timeOfWeek(v));
+    put16(&pvt[4], v.year);
+    pvt[6] = v.month;
+    pvt[7] = v.day;
+    pvt[8] = v.hour;
+    pvt[9] = v.minute;
+    pvt[10] = v.second;
+    pvt[11] = 0x07;                     // validDate, validTime, fullyResolved
+    put32(&pvt[12], 30);                // tAcc, ns
+    pvt[20] = 3;                        // 3D fix
+    pvt[21] = 0x01;                     // gnssFixOK
+    pvt[23] = v.satellites;
+    put32(&pvt[24], (uint32_t)(int32_t)lround(v.longitude * 1e7));
+    put32(&pvt[28], (uint32_t)(int32_t)lround(v.latitude * 1e7));
+    put32(&pvt[32], 75000);             // Height above ellipsoid, mm
+    put32(&pvt[36], 27000);             // Height above sea level, mm
+    put32(&pvt[40], 1800);              // hAcc, mm
+    put32(&pvt[44], 2600);              // vAcc, mm
+    put32(&pvt[48], (uint32_t)(int32_t)lround(speed * cos(heading) * 1000));
+    put32(&pvt[52], (uint32_t)(int32_t)lround(speed * sin(heading) * 1000));
+    put32(&pvt[60], (uint32_t)lround(speed * 1000));
+    put32(&pvt[64], (uint32_t)lround(v.headingDeg * 1e5));
+    put32(&pvt[68], 250);               // sAcc, mm/s
+    put32(&pvt[72], 1500000);           // headAcc, 1e-5 deg
+    put16(&pvt[76], 120);               // pDOP 1.20
+    send(UBX_NAV, 0x07, pvt, sizeof(pvt));
+}
+
+
+//-------------------------------------------------------------------------------
+// ESF-INS: gravity-free acceleration in the vehicle frame (x forward,
+// y right), 1e-2 m/s^2
+//-------------------------------------------------------------------------------
+void SimUblox::esfIns() {
+    SimVehicleState v = simVehicleNow();
+    uint8_t ins[36] = {};
+    put32(&ins[0], 0x3F00);             // Angular rates and accelerations valid
+    put32(&ins[8], timeOfWeek(v));
+    put32(&ins[24], (uint32_t)(int32_t)lround(v.accelX * 100));
+    put32(&ins[28], (uint32_t)(int32_t)lround(v.accelY * 100));
+    send(UBX_ESF, 0x15, ins, sizeof(ins));
+}
+
+
+void SimUblox::esfStatus() {
+    SimVehicleState v = simVehicleNow();
+    bool calibrated = simClockMicros() >= (uint64_t)m_calibrationMs * 1000;
+    uint8_t status[16] = {};
+    put32(&status[0], timeOfWeek(v));
+    status[4] = 2;                      // Message version
+    status[5] = calibrated ? 0x4A : 0x05;   // Wheel-tick, mounting and INS init status
+    status[12] = calibrated ? 1 : 0;    // Fusion mode: 0 initialising, 1 fusion
+    send(UBX_ESF, 0x10, status, sizeof(status));
+}
@@ -0,0 +1,154 @@
+#include "sim_vehicle.hpp"
+#include "sim_clock.hpp"
+#include <math.h>
+#include <mutex>
+
+#define CYCLE_SECONDS 120.0
+#define STEP_US 100000          // Integration step of the position
+#define EARTH_RADIUS_M 6371000.0
+
+static SimVehicleStart start = { 2025, 3, 4, 8 * 3600, 51.3781, -2.3597 };
+
+static std::mutex mutex;
+static bool ignition = true;
+static uint64_t integratedUs = 0;   // Virtual time the position is integrated to
+static double driveSeconds = 0;     // Time spent with the ignition on
+static double latitude = start.latitude;
+static double longitude = start.longitude;
+static double headingDeg = 0;
+
+
+void simVehicleBegin(const SimVehicleStart& s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    start = s;
+    latitude = s.latitude;
+    longitude = s.longitude;
+    headingDeg = 0;
+    integratedUs = 0;
+    driveSeconds = 0;
+}
+
+
+const SimVehicleStart& simVehicleStart() {
+    return start;
+}
+
+
+void simVehicleSetIgnition(bool on) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ignition = on;
+}
+
+
+static double smoothstep(double from, double to, double t0, double t1, double t) {
+    double x = (t - t0) / (t1 - t0);
+    return from + (to - from) * x * x * (3 - 2 * x);
+}
+
+
+//-------------------------------------------------------------------------------
+// Drive cycle: idle, pull away to ~50 km/h and cruise with some traffic,
+// brake to a stop, a short hop at 30 km/h, stop
+//-------------------------------------------------------------------------------
+static double cycleSpeedKph(double seconds) {
+    double c = fmod(seconds, CYCLE_SECONDS);
+    if (c < 8) return 0;
+    if (c < 23) return smoothstep(0, 48, 8, 23, c);
+    if (c < 68) return 48 + 6 * sin(2 * M_PI * (c - 23) / 30);
+    if (c < 80) return smoothstep(48, 0, 68, 80, c);
+    if (c < 88) return 0;
+    if (c < 100) return smoothstep(0, 30, 88, 100, c);
+    if (c < 112) return smoothstep(30, 0, 100, 112, c);
+    return 0;
+}
+
+
+// Gentle bends left and right while moving, deg/s
+static double cycleYawRate(double seconds, double speedKph) {
+    return speedKph > 0 ? 6 * sin(2 * M_PI * seconds / 40) : 0;
+}
+
+
+static void integrateTo(uint64_t us) {
+    while (integratedUs + STEP_US <= us) {
+        integratedUs += STEP_US;
+        if (!ignition) continue;
+        double dt = STEP_US / 1e6;
+        driveSeconds += dt;
+        double speed = cycleSpeedKph(driveSeconds) / 3.6;
+        headingDeg = fmod(headingDeg + cycleYawRate(driveSeconds, speed) * dt + 360, 360);
+        double distance = speed * dt;
+        double heading = headingDeg * M_PI / 180;
+        latitude += distance * cos(heading) / EARTH_RADIUS_M * 180 / M_PI;
+        longitude += distance * sin(heading) / (EARTH_RADIUS_M * cos(latitude * M_PI / 180)) * 180 / M_PI;
+    }
+}
+
+
+// Proleptic Gregorian date from days since 1970-01-01
+static void civilFromDays(int64_t days, uint16_t& year, uint8_t& month, uint8_t& day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    year = (uint16_t)(yoe + era * 400 + (month <= 2));
+}
+
+
+static int64_t daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = (unsigned)(year - era * 400);
+    unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+
+SimVehicleState simVehicleAt(uint64_t us) {
+    std::lock_guard<std::mutex> lock(mutex);
+    integrateTo(us);
+
+    SimVehicleState s = {};
+    s.ignition = ignition;
+    s.latitude = latitude;
+    s.longitude = longitude;
+    s.headingDeg = (float)headingDeg;
+
+    double t = driveSeconds;
+    double speed = ignition ? cycleSpeedKph(t) : 0;
+    double accel = ignition ? (cycleSpeedKph(t + 0.5) - cycleSpeedKph(t - 0.5)) / 3.6 : 0;
+    s.speedKph = (int)lround(speed);
+    s.accelX = (float)accel;
+    s.accelY = (float)(speed / 3.6 * cycleYawRate(t, speed) * M_PI / 180);
+
+    if (ignition) {
+        // Five-speed box, km/h per 1000 rpm in each gear
+        static const double kphPer1000[] = { 8, 15, 23, 31, 40 };
+        int gear = speed < 15 ? 0 : speed < 30 ? 1 : speed < 45 ? 2 : speed < 60 ? 3 : 4;
+        s.rpm = (int)fmax(800, speed * 1000 / kphPer1000[gear]);
+        s.throttlePct = accel > 0.05 ? (int)fmin(60, 15 + accel * 20) : speed > 0 && accel > -0.05 ? 12 : 0;
+        s.mafGps = (float)(s.rpm / 1000.0 * (1.2 + s.throttlePct * 0.12));
+    }
+    s.coolantC = (int)(20 + 70 * fmin(1, t / 600));
+    s.satellites = (uint8_t)(9 + (us / 17000000) % 4);
+
+    uint64_t ms = us / 1000;
+    uint64_t seconds = start.secondOfDay + ms / 1000;
+    civilFromDays(daysFromCivil(start.year, start.month, start.day) + (int64_t)(seconds / 86400),
+                  s.year, s.month, s.day);
+    s.hour = (uint8_t)(seconds % 86400 / 3600);
+    s.minute = (uint8_t)(seconds % 3600 / 60);
+    s.second = (uint8_t)(seconds % 60);
+    s.millisecond = (uint16_t)(ms % 1000);
+    return s;
+}
+
+
+SimVehicleState simVehicleNow() {
+    return simVehicleAt(simClockMicros());
+}
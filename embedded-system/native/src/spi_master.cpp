@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include <driver/spi_master.h>
+#include <deque>
+
+SPIClass SPI;
+
+// Bus time owed to the virtual clock is paid in steps of this size, so
+// single-byte transfers do not each cost a host sleep
+#define SIM_SPI_SETTLE_US 500
+
+struct SimSpiBus {
+    bool ready;
+    SimSpiDevice* device;
+};
+
+struct spi_device_t {
+    spi_host_device_t host;
+    int clockHz;
+    double owedUs;
+    std::deque<spi_transaction_t*> done;
+};
+
+static SimSpiBus buses[3];
+
+
+void simSpiAttach(spi_host_device_t host, SimSpiDevice* device) {
+    buses[host].device = device;
+}
+
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* config, int dmaChannel) {
+    (void)config;
+    (void)dmaChannel;
+    if (buses[host].ready) return ESP_ERR_INVALID_STATE;
+    buses[host].ready = true;
+    return ESP_OK;
+}
+
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* config,
+                             spi_device_handle_t* handle) {
+    if (!buses[host].ready || config->clock_speed_hz <= 0) return ESP_ERR_INVALID_STATE;
+    *handle = new spi_device_t{ host, config->clock_speed_hz, 0, {} };
+    return ESP_OK;
+}
+
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    delete handle;
+    return ESP_OK;
+}
+
+
+esp_err_t spi_device_acquire_bus(spi_device_handle_t handle, uint32_t wait) {
+    (void)handle;
+    (void)wait;
+    return ESP_OK;
+}
+
+
+void spi_device_release_bus(spi_device_handle_t handle) {
+    (void)handle;
+}
+
+
+//-------------------------------------------------------------------------------
+// Runs one transaction against the attached device. Without a device MISO
+// floats high, as on a bus with no card inserted.
+//-------------------------------------------------------------------------------
+static void transact(spi_device_handle_t handle, spi_transaction_t* t) {
+    size_t bytes = (t->length + 7) / 8;
+    const uint8_t* tx = (t->flags & SPI_TRANS_USE_TXDATA) ? t->tx_data : (const uint8_t*)t->tx_buffer;
+    uint8_t* rx = (t->flags & SPI_TRANS_USE_RXDATA) ? t->rx_data : (uint8_t*)t->rx_buffer;
+
+    SimSpiDevice* device = buses[handle->host].device;
+    if (device) {
+        device->spiTransfer(tx, rx, bytes);
+    } else if (rx) {
+        memset(rx, 0xFF, bytes);
+    }
+
+    handle->owedUs += t->length * 1e6 / handle->clockHz;
+    if (handle->owedUs >= SIM_SPI_SETTLE_US) {
+        uint32_t us = (uint32_t)handle->owedUs;
+        delayMicroseconds(us);
+        handle->owedUs -= us;
+    }
+}
+
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* trans) {
+    transact(handle, trans);
+    return ESP_OK;
+}
+
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans) {
+    return spi_device_polling_transmit(handle, trans);
+}
+
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans, uint32_t wait) {
+    (void)wait;
+    transact(handle, trans);
+    handle->done.push_back(trans);
+    return ESP_OK;
+}
+
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans, uint32_t wait) {
+    (void)wait;
+    if (handle->done.empty()) return ESP_ERR_TIMEOUT;
+    *trans = handle->done.front();
+    handle->done.pop_front();
+    return ESP_OK;
+}
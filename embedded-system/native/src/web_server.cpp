@@ -0,0 +1,314 @@
+#include <WebServer.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+#define SIM_HTTP_TIMEOUT_S 5        // Host time allowed to read a request
+#define SIM_HTTP_MAX_HEADER 8192
+
+static uint16_t portOverride = 0;
+
+
+void simWebServerSetPort(uint16_t port) {
+    portOverride = port;
+}
+
+
+WebServer::~WebServer() {
+    close();
+}
+
+
+void WebServer::begin() {
+    begin((uint16_t)m_port);
+}
+
+
+void WebServer::begin(uint16_t port) {
+    if (portOverride) port = portOverride;
+    m_listen = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listen < 0) return;
+    int on = 1;
+    setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(m_listen, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listen, 8) != 0) {
+        fprintf(stderr, "WebServer: cannot listen on port %u: %s\n", port, strerror(errno));
+        ::close(m_listen);
+        m_listen = -1;
+        return;
+    }
+    fcntl(m_listen, F_SETFL, O_NONBLOCK);
+}
+
+
+void WebServer::close() {
+    if (m_listen >= 0) ::close(m_listen);
+    m_listen = -1;
+}
+
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    m_routes.push_back({ uri, method, handler });
+}
+
+
+static String urlDecode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return String(out);
+}
+
+
+void WebServer::parseArgs(const std::string& query) {
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(pos, end - pos);
+        size_t eq = pair.find('=');
+        if (!pair.empty()) {
+            m_args.push_back({ urlDecode(pair.substr(0, eq)),
+                               eq == std::string::npos ? String() : urlDecode(pair.substr(eq + 1)) });
+        }
+        pos = end + 1;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// Reads the request line, headers and a Content-Length body. A form body
+// adds to the query arguments; any other body is the "plain" argument.
+//-------------------------------------------------------------------------------
+bool WebServer::readRequest() {
+    std::string data;
+    size_t headerEnd;
+    char buf[1024];
+    while ((headerEnd = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(m_client, buf, sizeof(buf), 0);
+        if (n <= 0 || data.size() > SIM_HTTP_MAX_HEADER) return false;
+        data.append(buf, n);
+    }
+
+    size_t lineEnd = data.find("\r\n");
+    std::string line = data.substr(0, lineEnd);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+    std::string method = line.substr(0, sp1);
+    std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    static const struct { const char* name; HTTPMethod method; } methods[] = {
+        { "GET", HTTP_GET }, { "HEAD", HTTP_HEAD }, { "POST", HTTP_POST }, { "PUT", HTTP_PUT },
+        { "PATCH", HTTP_PATCH }, { "DELETE", HTTP_DELETE }, { "OPTIONS", HTTP_OPTIONS },
+    };
+    m_method = HTTP_ANY;
+    for (const auto& m : methods) {
+        if (method == m.name) m_method = m.method;
+    }
+
+    m_args.clear();
+    m_requestHeaders.clear();
+    size_t q = target.find('?');
+    m_uri = urlDecode(target.substr(0, q));
+    if (q != std::string::npos) parseArgs(target.substr(q + 1));
+
+    size_t contentLength = 0;
+    bool form = false;
+    for (size_t pos = lineEnd + 2; pos < headerEnd;) {
+        size_t end = data.find("\r\n", pos);
+        std::string header = data.substr(pos, end - pos);
+        size_t colon = header.find(':');
+        if (colon != std::string::npos) {
+            std::string name = header.substr(0, colon);
+            std::string value = header.substr(header.find_first_not_of(' ', colon + 1));
+            m_requestHeaders.push_back({ String(name), String(value) });
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) contentLength = strtoul(value.c_str(), nullptr, 10);
+            if (strcasecmp(name.c_str(), "Content-Type") == 0) form = value.find("x-www-form-urlencoded") != std::string::npos;
+        }
+        pos = end + 2;
+    }
+
+    std::string body = data.substr(headerEnd + 4);
+    while (body.size() < contentLength) {
+        ssize_t n = recv(m_client, buf, std::min(sizeof(buf), contentLength - body.size()), 0);
+        if (n <= 0) return false;
+        body.append(buf, n);
+    }
+    if (form) {
+        parseArgs(body);
+    } else if (!body.empty()) {
+        m_args.push_back({ String("plain"), String(body) });
+    }
+    return true;
+}
+
+
+void WebServer::handleClient() {
+    if (m_listen < 0) return;
+    m_client = accept(m_listen, nullptr, nullptr);
+    if (m_client < 0) {
+        delay(1);   // As the ESP32 core does when no client is waiting
+        return;
+    }
+
+    timeval timeout = { SIM_HTTP_TIMEOUT_S, 0 };
+    setsockopt(m_client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(m_client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (readRequest()) {
+        m_headers.clear();
+        m_contentLength = CONTENT_LENGTH_NOT_SET;
+        m_chunked = false;
+
+        const Route* route = nullptr;
+        for (const Route& r : m_routes) {
+            if (r.uri == m_uri && (r.method == HTTP_ANY || r.method == m_method)) {
+                route = &r;
+                break;
+            }
+        }
+        if (route) {
+            route->handler();
+        } else if (m_notFound) {
+            m_notFound();
+        } else {
+            send(404, "text/plain", String("Not found: ") + m_uri);
+        }
+    }
+    ::close(m_client);
+    m_client = -1;
+}
+
+
+String WebServer::arg(const String& name) const {
+    for (const auto& a : m_args) {
+        if (a.first == name) return a.second;
+    }
+    return String();
+}
+
+
+String WebServer::arg(int i) const {
+    return i >= 0 && i < (int)m_args.size() ? m_args[i].second : String();
+}
+
+
+String WebServer::argName(int i) const {
+    return i >= 0 && i < (int)m_args.size() ? m_args[i].first : String();
+}
+
+
+bool WebServer::hasArg(const String& name) const {
+    for (const auto& a : m_args) {
+        if (a.first == name) return true;
+    }
+    return false;
+}
+
+
+String WebServer::header(const String& name) const {
+    for (const auto& h : m_requestHeaders) {
+        if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return h.second;
+    }
+    return String();
+}
+
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    if (first) {
+        m_headers.insert(m_headers.begin(), { name, value });
+    } else {
+        m_headers.push_back({ name, value });
+    }
+}
+
+
+bool WebServer::writeAll(const char* data, size_t length) {
+    while (length) {
+        ssize_t n = ::send(m_client, data, length, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+
+static const char* reason(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    }
+    return "";
+}
+
+
+//-------------------------------------------------------------------------------
+// Status line and headers, then `content`. With setContentLength() the body
+// follows in sendContent() calls, chunked when the length is unknown.
+//-------------------------------------------------------------------------------
+void WebServer::send(int code, const char* contentType, const String& content) {
+    if (m_client < 0) return;
+    std::string head = "HTTP/1.1 " + std::to_string(code) + " " + reason(code) + "\r\n";
+
+    bool typed = false;
+    for (const auto& h : m_headers) typed |= strcasecmp(h.first.c_str(), "Content-Type") == 0;
+    if (contentType && *contentType && !typed) head += std::string("Content-Type: ") + contentType + "\r\n";
+
+    if (m_contentLength == CONTENT_LENGTH_UNKNOWN) {
+        head += "Transfer-Encoding: chunked\r\n";
+        m_chunked = true;
+    } else {
+        size_t length = m_contentLength == CONTENT_LENGTH_NOT_SET ? content.length() : m_contentLength;
+        head += "Content-Length: " + std::to_string(length) + "\r\n";
+    }
+    for (const auto& h : m_headers) head += std::string(h.first.c_str()) + ": " + h.second.c_str() + "\r\n";
+    head += "Connection: close\r\n\r\n";
+    m_headers.clear();
+
+    if (!writeAll(head.data(), head.size())) return;
+    if (content.length()) sendContent(content);
+}
+
+
+void WebServer::sendContent(const char* content, size_t length) {
+    if (m_client < 0) return;
+    if (!m_chunked) {
+        writeAll(content, length);
+        return;
+    }
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+    writeAll(size, n);
+    writeAll(content, length);
+    writeAll("\r\n", 2);
+    if (length == 0) m_chunked = false;     // Terminating chunk
+}
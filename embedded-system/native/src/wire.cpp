@@ -0,0 +1,64 @@
+#include <Wire.h>
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+// Bus time of one byte (9 clocks) at 400 kHz
+#define SIM_I2C_BYTE_US 23
+
+
+void TwoWire::attach(uint8_t address, SimI2cDevice* device) {
+    m_devices[address & 0x7F] = device;
+}
+
+
+SimI2cDevice* TwoWire::device(uint8_t address) const {
+    return m_devices[address & 0x7F];
+}
+
+
+void TwoWire::beginTransmission(uint8_t address) {
+    m_address = address;
+    m_txLength = 0;
+}
+
+
+size_t TwoWire::write(uint8_t c) {
+    if (m_txLength >= sizeof(m_tx)) return 0;
+    m_tx[m_txLength++] = c;
+    return 1;
+}
+
+
+size_t TwoWire::write(const uint8_t* buf, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buf[n])) n++;
+    return n;
+}
+
+
+//-------------------------------------------------------------------------------
+// Returns the Arduino status: 0 success, 2 address NACK
+//-------------------------------------------------------------------------------
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    SimI2cDevice* dev = device(m_address);
+    if (!dev) return 2;
+    if (m_txLength) dev->i2cWrite(m_tx, m_txLength);
+    delayMicroseconds((m_txLength + 1) * SIM_I2C_BYTE_US);
+    m_txLength = 0;
+    return 0;
+}
+
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+    (void)sendStop;
+    m_rxIndex = 0;
+    m_rxLength = 0;
+    SimI2cDevice* dev = device(address);
+    if (!dev) return 0;
+    size_t n = quantity < sizeof(m_rx) ? quantity : sizeof(m_rx);
+    m_rxLength = dev->i2cRead(m_rx, n);
+    delayMicroseconds((m_rxLength + 1) * SIM_I2C_BYTE_US);
+    return m_rxLength;
+}
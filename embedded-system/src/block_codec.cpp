@@ -0,0 +1,157 @@
+#include "block_codec.hpp"
+#include <string.h>
+
+enum ColumnKind { DELTA, DELTA_OF_DELTA, XOR_FLOAT };
+
+struct Column {
+    ColumnKind kind;
+    int32_t BlockRecord::*integer;
+    float BlockRecord::*real;
+};
+
+// Column order is part of the format
+static const Column columns[BLOCK_COLUMNS] = {
+    { DELTA,          &BlockRecord::time,       nullptr },
+    { DELTA_OF_DELTA, &BlockRecord::latitude,   nullptr },
+    { DELTA_OF_DELTA, &BlockRecord::longitude,  nullptr },
+    { DELTA,          &BlockRecord::rpm,        nullptr },
+    { DELTA,          &BlockRecord::speed,      nullptr },
+    { DELTA,          &BlockRecord::throttle,   nullptr },
+    { DELTA,          &BlockRecord::accelX,     nullptr },
+    { DELTA,          &BlockRecord::accelY,     nullptr },
+    { XOR_FLOAT,      nullptr, &BlockRecord::maf },
+    { XOR_FLOAT,      nullptr, &BlockRecord::instantMPG },
+    { XOR_FLOAT,      nullptr, &BlockRecord::avgMPG },
+};
+
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+
+// Wrapping difference, so extreme values cannot overflow
+static int32_t diff(int32_t a, int32_t b) {
+    return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+
+static uint32_t floatBits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+
+static uint8_t* putVarint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+
+bool BlockEncoder::add(const BlockRecord& record) {
+    if (full()) return false;
+    m_records[m_count++] = record;
+    return true;
+}
+
+
+size_t BlockEncoder::encode(uint8_t* out, size_t size) const {
+    if (size < BLOCK_MAX_BYTES) return 0;
+
+    // Payload first, leaving room for the marker and a 5-byte length
+    uint8_t* payload = out + 6;
+    uint8_t* p = putVarint(payload, m_count);
+    for (const Column& col : columns) {
+        int32_t prev = 0, prevDelta = 0;
+        uint32_t prevBits = 0;
+        for (size_t i = 0; i < m_count; i++) {
+            const BlockRecord& r = m_records[i];
+            if (col.kind == XOR_FLOAT) {
+                uint32_t bits = floatBits(r.*col.real);
+                p = putVarint(p, bits ^ prevBits);
+                prevBits = bits;
+                continue;
+            }
+            int32_t value = r.*col.integer;
+            int32_t delta = diff(value, prev);
+            p = putVarint(p, zigzag(col.kind == DELTA ? delta : diff(delta, prevDelta)));
+            prev = value;
+            prevDelta = delta;
+        }
+    }
+    size_t payloadLen = p - payload;
+
+    uint8_t* h = out;
+    *h++ = BLOCK_MARKER;
+    h = putVarint(h, payloadLen);
+    memmove(h, payload, payloadLen);
+    return (h - out) + payloadLen;
+}
+
+
+size_t blockDecode(const uint8_t* in, size_t length, BlockRecord* out, size_t& count) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + length;
+    uint32_t payloadLen, n;
+    if (p >= end || *p++ != BLOCK_MARKER) return 0;
+    if (!getVarint(p, end, payloadLen) || payloadLen > (size_t)(end - p)) return 0;
+    end = p + payloadLen;
+    if (!getVarint(p, end, n) || n > BLOCK_RECORDS) return 0;
+
+    for (const Column& col : columns) {
+        int32_t prev = 0, prevDelta = 0;
+        uint32_t prevBits = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t v;
+            if (!getVarint(p, end, v)) return 0;
+            if (col.kind == XOR_FLOAT) {
+                prevBits ^= v;
+                memcpy(&(out[i].*col.real), &prevBits, sizeof(prevBits));
+                continue;
+            }
+            int32_t delta = unzigzag(v);
+            if (col.kind == DELTA_OF_DELTA) delta = (int32_t)((uint32_t)delta + (uint32_t)prevDelta);
+            prev = (int32_t)((uint32_t)prev + (uint32_t)delta);
+            prevDelta = delta;
+            out[i].*col.integer = prev;
+        }
+    }
+    count = n;
+    return end - in;
+}
+
+
+size_t blockLength(const uint8_t* in, size_t length, size_t& count) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + length;
+    uint32_t payloadLen, n;
+    if (p >= end || *p++ != BLOCK_MARKER) return 0;
+    if (!getVarint(p, end, payloadLen) || payloadLen > (size_t)(end - p)) return 0;
+    size_t total = (p - in) + payloadLen;
+    end = p + payloadLen;
+    if (!getVarint(p, end, n) || n > BLOCK_RECORDS) return 0;
+    count = n;
+    return total;
+}
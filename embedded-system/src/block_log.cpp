@@ -0,0 +1,126 @@
+#include "block_log.hpp"
+#include "segment.hpp"
+#include "record_reader.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+static BlockEncoder encoder;
+static uint8_t blockBuf[BLOCK_MAX_BYTES];
+static char blockJourney[40];
+
+
+void blockRecordFromSample(const TelemetrySample& sample, BlockRecord& record) {
+    int h = 0, m = 0, s = 0;
+    sscanf(sample.time, "%d:%d:%d", &h, &m, &s);
+    record.time       = h * 3600 + m * 60 + s;
+    record.latitude   = lround(sample.latitude * BLOCK_DEGREE_SCALE);
+    record.longitude  = lround(sample.longitude * BLOCK_DEGREE_SCALE);
+    record.rpm        = sample.rpm;
+    record.speed      = sample.speed;
+    record.throttle   = sample.throttle;
+    record.accelX     = sample.accelX;
+    record.accelY     = sample.accelY;
+    record.maf        = sample.maf;
+    record.instantMPG = sample.instantMPG;
+    record.avgMPG     = sample.avgMPG;
+}
+
+
+//-------------------------------------------------------------------------------
+// Encodes the buffered records and appends them to the sidecar as one block
+//-------------------------------------------------------------------------------
+static void blockWrite() {
+    if (encoder.count() == 0) return;
+    size_t len = encoder.encode(blockBuf, sizeof(blockBuf));
+    encoder.reset();
+
+    char path[48];
+    if (len == 0 || !journeySidecarPath(blockJourney, BLOCK_LOG_EXT, path, sizeof(path))) return;
+    FsFile file = SD.open(path, O_WRONLY | O_CREAT | O_AT_END);
+    if (!file) {
+        Serial.printf("Failed to open block log: %s\n", path);
+        return;
+    }
+    file.write(blockBuf, len);
+    file.close();
+}
+
+
+void blockLogBegin(const char* journeyPath) {
+    strncpy(blockJourney, journeyPath, sizeof(blockJourney) - 1);
+    blockJourney[sizeof(blockJourney) - 1] = '\0';
+    encoder.reset();
+}
+
+
+void blockLogAdd(const TelemetrySample& sample) {
+    BlockRecord record;
+    blockRecordFromSample(sample, record);
+    encoder.add(record);
+    if (encoder.full()) blockWrite();
+}
+
+
+void blockLogFinish() {
+    // Flush the partially filled block
+    blockWrite();
+}
+
+
+//-------------------------------------------------------------------------------
+// Adds the journey's records after the first `skip` to the block log, which
+// must have been started with blockLogBegin(). Returns the records seen.
+//-------------------------------------------------------------------------------
+static uint32_t blockLogAppend(const char* journeyPath, uint32_t skip) {
+    JourneyFile file;
+    if (!file.open(journeyPath)) return 0;
+    RecordReader reader(file);
+    size_t len;
+    const char* line;
+    char time[10];
+    TelemetrySample sample;
+    uint32_t seen = 0;
+    while ((line = reader.next(len)) != nullptr) {
+        if (!journeyParseRecord(line, len, sample, time, sizeof(time), reader.encoding())) continue;
+        if (seen++ >= skip) blockLogAdd(sample);
+    }
+    file.close();
+    return seen;
+}
+
+
+bool blockLogRebuild(const char* journeyPath) {
+    char path[48];
+    if (!journeySidecarPath(journeyPath, BLOCK_LOG_EXT, path, sizeof(path))) return false;
+    FsFile blk = SD.open(path, O_RDWR | O_CREAT);
+    if (!blk) return false;
+
+    // Records held by the whole blocks on the card; a torn last block goes
+    uint32_t covered = 0;
+    uint64_t end = 0;
+    for (;;) {
+        blk.seekSet(end);
+        int n = blk.read(blockBuf, sizeof(blockBuf));
+        size_t count;
+        size_t len = n > 0 ? blockLength(blockBuf, n, count) : 0;
+        if (len == 0) break;
+        covered += count;
+        end += len;
+    }
+    blk.truncate(end);
+    blk.close();
+
+    blockLogBegin(journeyPath);
+    uint32_t records = blockLogAppend(journeyPath, covered);
+    if (records < covered) {
+        // Blocks past the recovered end of the journey: start over
+        SD.remove(path);
+        encoder.reset();
+        blockLogAppend(journeyPath, 0);
+    }
+    blockLogFinish();
+    Serial.printf("Block log %s: %lu of %lu records were in blocks\n", path,
+                  (unsigned long)min(covered, records), (unsigned long)records);
+    return true;
+}
@@ -0,0 +1,103 @@
+#include "catalog.hpp"
+#include "record_reader.hpp"
+#include <ArduinoJson.h>
+
+// External SD filesystem instance
+extern SdFat SD;
+
+static uint32_t currentGen = 0;
+static uint32_t syncedGen = 0;
+
+
+//-------------------------------------------------------------------------------
+// Parses one catalog line; returns false for a corrupt entry
+//-------------------------------------------------------------------------------
+static bool parseEntry(const char* line, size_t len, uint32_t& gen, char* path, size_t size) {
+    JsonDocument doc;
+    if (deserializeJson(doc, line, len)) return false;
+    gen = doc["gen"] | 0;
+    const char* p = doc["path"] | "";
+    if (gen == 0 || !*p) return false;
+    strncpy(path, p, size - 1);
+    path[size - 1] = '\0';
+    return true;
+}
+
+
+void catalogBegin() {
+    // The newest generation is the last valid line of the log
+    FsFile file = SD.open(CATALOG_PATH, O_READ);
+    if (file) {
+        RecordReader reader(file);
+        size_t len;
+        const char* line;
+        char path[40];
+        while ((line = reader.next(len)) != nullptr) {
+            uint32_t gen;
+            if (parseEntry(line, len, gen, path, sizeof(path)) && gen > currentGen) {
+                currentGen = gen;
+            }
+        }
+        file.close();
+    }
+
+    file = SD.open(SYNCED_PATH, O_READ);
+    if (file) {
+        char buf[12] = {0};
+        file.read(buf, sizeof(buf) - 1);
+        syncedGen = strtoul(buf, NULL, 10);
+        file.close();
+    }
+    Serial.printf("Catalog generation: %u (synced %u)\n", (unsigned)currentGen, (unsigned)syncedGen);
+}
+
+
+uint32_t catalogAdd(const char* journeyPath) {
+    FsFile file = SD.open(CATALOG_PATH, O_WRONLY | O_CREAT | O_AT_END);
+    if (!file) {
+        Serial.println("Failed to open catalog.");
+        return 0;
+    }
+    currentGen++;
+    file.printf("{\"gen\":%u,\"path\":\"%s\"}\n", (unsigned)currentGen, journeyPath);
+    file.close();
+    return currentGen;
+}
+
+
+uint32_t catalogGeneration() {
+    return currentGen;
+}
+
+
+uint32_t catalogSyncedGeneration() {
+    return syncedGen;
+}
+
+
+bool catalogAck(uint32_t gen) {
+    if (gen > currentGen) return false;
+    FsFile file = SD.open(SYNCED_PATH, O_WRONLY | O_CREAT | O_TRUNC);
+    if (!file) return false;
+    file.print(gen);
+    file.close();
+    syncedGen = gen;
+    return true;
+}
+
+
+void catalogForEach(uint32_t since, bool (*fn)(uint32_t gen, const char* path, void* ctx), void* ctx) {
+    FsFile file = SD.open(CATALOG_PATH, O_READ);
+    if (!file) return;
+
+    RecordReader reader(file);
+    size_t len;
+    const char* line;
+    char path[40];
+    while ((line = reader.next(len)) != nullptr) {
+        uint32_t gen;
+        if (!parseEntry(line, len, gen, path, sizeof(path)) || gen <= since) continue;
+        if (!fn(gen, path, ctx)) break;
+    }
+    file.close();
+}
@@ -0,0 +1,50 @@
+#include "config.hpp"
+#include <SdFat.h>
+
+// External SD filesystem instance
+extern SdFat SD;
+
+LoggerConfig loggerConfig = { ENCODING_NDJSON, false };
+
+
+void configLoad() {
+    FsFile file = SD.open(CONFIG_PATH, O_READ);
+    if (!file) return;  // Defaults
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, file);
+    file.close();
+    if (err) {
+        Serial.printf("Ignoring %s: %s\n", CONFIG_PATH, err.c_str());
+        return;
+    }
+    const char* encoding = doc["encoding"] | "";
+    if (encoding[0] && !recordEncodingParse(encoding, loggerConfig.encoding)) {
+        Serial.printf("Unknown record encoding '%s', keeping %s\n",
+                      encoding, recordEncodingName(loggerConfig.encoding));
+    }
+    loggerConfig.ubxCapture = doc["ubx_capture"] | loggerConfig.ubxCapture;
+    Serial.printf("Record encoding: %s\n", recordEncodingName(loggerConfig.encoding));
+}
+
+
+bool configSave() {
+    FsFile file = SD.open(CONFIG_PATH, O_WRONLY | O_CREAT | O_TRUNC);
+    if (!file) return false;
+    JsonDocument doc;
+    doc["encoding"] = recordEncodingName(loggerConfig.encoding);
+    doc["ubx_capture"] = loggerConfig.ubxCapture;
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok;
+}
+
+
+void configToJson(JsonObject out) {
+    out["encoding"] = recordEncodingName(loggerConfig.encoding);
+    out["ubx_capture"] = loggerConfig.ubxCapture;
+    JsonArray encodings = out["encodings"].to<JsonArray>();
+    for (uint8_t i = 0; i < ENCODING_COUNT; i++) {
+        encodings.add(recordEncodingName((RecordEncoding)i));
+    }
+}
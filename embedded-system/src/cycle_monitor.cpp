@@ -0,0 +1,117 @@
+#include "cycle_monitor.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+static const char* const phaseNames[CYCLE_PHASES] = {
+    "obd", "gnss_pvt", "gnss_esf", "sd_mutex", "sd_record", "sidecars", "sd_flush", "other"
+};
+
+static CycleStats stats;
+static TickType_t slot;                 // Tick the current cycle was due
+static unsigned long cycleStart;
+static uint32_t phaseUs[CYCLE_PHASES];
+static CyclePhase currentPhase = CYCLE_OTHER;
+static unsigned long phaseStart;
+
+static MetricHistogram* latenessMetric;
+static MetricCounter* lateCounter;
+static MetricCounter* skippedCounter;
+
+
+const char* cyclePhaseName(CyclePhase phase) {
+    return phase < CYCLE_PHASES ? phaseNames[phase] : "?";
+}
+
+
+// Charges the time since the last switch to the phase running until now
+static void switchPhase(CyclePhase phase) {
+    unsigned long now = micros();
+    phaseUs[currentPhase] += now - phaseStart;
+    phaseStart = now;
+    currentPhase = phase;
+}
+
+
+CyclePhaseScope::CyclePhaseScope(CyclePhase phase) : m_outer(currentPhase) {
+    switchPhase(phase);
+}
+
+
+CyclePhaseScope::~CyclePhaseScope() {
+    switchPhase(m_outer);
+}
+
+
+void cycleMonitorBegin() {
+    latenessMetric = metricsHistogram("cycle_lateness_us");
+    lateCounter = metricsCounter("cycle_late_total");
+    skippedCounter = metricsCounter("cycle_skipped_total");
+    slot = xTaskGetTickCount();
+}
+
+
+uint32_t cycleBegin() {
+    cycleStart = micros();
+    phaseStart = cycleStart;
+    currentPhase = CYCLE_OTHER;
+    memset(phaseUs, 0, sizeof(phaseUs));
+    stats.cycles++;
+
+    uint32_t lateMs = (xTaskGetTickCount() - slot) * portTICK_PERIOD_MS;
+    latenessMetric->record(lateMs * 1000);
+    if (lateMs <= CYCLE_LATE_MS) return 0;
+    stats.late++;
+    lateCounter->add();
+    TRACE_INSTANT("cycle.late");
+    return lateMs;
+}
+
+
+//-------------------------------------------------------------------------------
+// An overrun is blamed on the phase with the most time, so a slow card and a
+// slow ECU are told apart in the counters
+//-------------------------------------------------------------------------------
+bool cycleEnd() {
+    switchPhase(CYCLE_OTHER);
+    uint32_t elapsed = micros() - cycleStart;
+    if (elapsed > stats.worstUs) stats.worstUs = elapsed;
+    if (elapsed <= CYCLE_DEADLINE_MS * 1000UL) return false;
+
+    int cause = CYCLE_OTHER;
+    for (int i = 0; i < CYCLE_PHASES; i++) {
+        if (phaseUs[i] > phaseUs[cause]) cause = i;
+    }
+    stats.overruns++;
+    stats.overrunsBy[cause]++;
+    metricsCounter("cycle_overruns_total", "cause", phaseNames[cause])->add();
+    TRACE_INSTANT("cycle.overrun");
+    Serial.printf("Cycle overrun: %lu ms, %s %lu ms\n", (unsigned long)(elapsed / 1000), phaseNames[cause],
+                  (unsigned long)(phaseUs[cause] / 1000));
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// vTaskDelayUntil() on time. Once behind, the next cycle runs at once in the
+// slot it fell into; the slots before that are skipped, so the schedule
+// keeps its phase instead of running missed cycles back to back.
+//-------------------------------------------------------------------------------
+void cycleWait() {
+    const TickType_t period = pdMS_TO_TICKS(CYCLE_PERIOD_MS);
+    TickType_t behind = xTaskGetTickCount() - slot;
+    if (behind < period) {
+        vTaskDelayUntil(&slot, period);
+        return;
+    }
+    uint32_t missed = behind / period - 1;
+    slot += (missed + 1) * period;
+    if (missed) {
+        stats.skipped += missed;
+        skippedCounter->add(missed);
+    }
+}
+
+
+const CycleStats& cycleStats() {
+    return stats;
+}
@@ -0,0 +1,301 @@
+#include "delete_job.hpp"
+#include "record_reader.hpp"
+#include "journey.hpp"
+#include "segment.hpp"
+#include "sd_mutex.hpp"
+
+// External SD filesystem instance and mutex
+extern SdFat SD;
+extern SemaphoreHandle_t sdMutex;
+
+static char queue[DELETE_QUEUE_MAX][DELETE_PATH_MAX];
+static uint8_t queueLen = 0;
+
+// Entry currently being worked on: starts at the job root and descends into
+// subdirectories. Deleted entries need no bookkeeping, so the tree on the
+// card is the only progress state and a job resumes after a reboot.
+static char cursor[DELETE_PATH_MAX];
+static size_t rootLen = 0;
+// Directory read position at each level below the root (deeper levels rescan)
+static uint32_t dirPos[DELETE_DEPTH_MAX];
+static uint8_t depth = 0;
+
+static DeleteJobStatus status;
+
+
+//-------------------------------------------------------------------------------
+// Rewrites the persisted queue (removed when empty). Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+static bool saveQueue() {
+    if (queueLen == 0) {
+        return !SD.exists(DELETE_JOB_PATH) || SD.remove(DELETE_JOB_PATH);
+    }
+    FsFile file = SD.open(DELETE_JOB_PATH, O_WRONLY | O_CREAT | O_TRUNC);
+    if (!file) {
+        Serial.println("Failed to save delete queue.");
+        return false;
+    }
+    for (uint8_t i = 0; i < queueLen; i++) {
+        file.printf("%s\n", queue[i]);
+    }
+    file.close();
+    return true;
+}
+
+
+static void startJob() {
+    status.running = queueLen > 0;
+    status.queued = queueLen;
+    if (!status.running) return;
+    strcpy(cursor, queue[0]);
+    rootLen = strlen(cursor);
+    depth = 0;
+    dirPos[0] = 0;
+    strcpy(status.path, queue[0]);
+    status.removed = 0;
+    status.steps = 0;
+    status.maxHoldUs = 0;
+}
+
+
+//-------------------------------------------------------------------------------
+// Drops the finished job and moves on to the next. Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+static void finishJob(const char* error) {
+    if (error) {
+        status.failed++;
+        strncpy(status.lastError, error, sizeof(status.lastError) - 1);
+        Serial.printf("Delete of %s failed: %s (%s)\n", status.path, error, cursor);
+    } else {
+        status.completed++;
+        status.lastError[0] = '\0';
+        Serial.printf("Deleted %s: %u entries, max hold %u us\n", status.path,
+                      (unsigned)status.removed, (unsigned)status.maxHoldUs);
+    }
+    queueLen--;
+    memmove(queue[0], queue[1], queueLen * DELETE_PATH_MAX);
+    saveQueue();
+    startJob();
+}
+
+
+void deleteJobBegin() {
+    memset(&status, 0, sizeof(status));
+    FsFile file = SD.open(DELETE_JOB_PATH, O_READ);
+    if (file) {
+        RecordReader reader(file);
+        size_t len;
+        const char* line;
+        while ((line = reader.next(len)) != nullptr && queueLen < DELETE_QUEUE_MAX) {
+            if (len == 0 || len >= DELETE_PATH_MAX) continue;
+            memcpy(queue[queueLen], line, len);
+            queue[queueLen][len] = '\0';
+            queueLen++;
+        }
+        file.close();
+    }
+    if (queueLen > 0) {
+        Serial.printf("Resuming %u queued delete(s).\n", (unsigned)queueLen);
+    }
+    startJob();
+}
+
+
+bool deleteJobQueue(const char* path) {
+    if (queueLen >= DELETE_QUEUE_MAX || strlen(path) >= DELETE_PATH_MAX) return false;
+    if (deleteJobPending(path)) return true;
+
+    strcpy(queue[queueLen++], path);
+    if (!saveQueue()) {
+        queueLen--;
+        return false;
+    }
+    if (!status.running) {
+        startJob();
+    }
+    status.queued = queueLen;
+    return true;
+}
+
+
+bool deleteJourney(const char* journeyPath) {
+    bool ok;
+    if (segmentIsSegmented(journeyPath)) {
+        char dir[48];
+        ok = segmentDirPath(journeyPath, dir, sizeof(dir)) && deleteJobQueue(dir);
+    } else {
+        ok = SD.remove(journeyPath);
+    }
+    if (ok) journeyRemoveSidecars(journeyPath);
+    return ok;
+}
+
+
+bool deleteJobPending(const char* path) {
+    for (uint8_t i = 0; i < queueLen; i++) {
+        if (strcmp(queue[i], path) == 0) return true;
+    }
+    return false;
+}
+
+
+//-------------------------------------------------------------------------------
+// True if `path` is the journey being logged, one of its sidecars or segments,
+// or a directory above it. dataTask may start a journey in a day folder that
+// is already queued, so these are left in place. Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+static bool isLive(const char* path) {
+    if (!journeyStats.active) return false;
+    const char* live = journeyStats.path;       // "YYYY-MM-DD/HH-MM-SS.json"
+    const char* dot = strrchr(live, '.');
+    size_t stem = dot ? (size_t)(dot - live) : strlen(live);
+    while (*path == '/') path++;
+    size_t len = strlen(path);
+    if (len < stem) {
+        return len == 0 || (strncmp(live, path, len) == 0 && live[len] == '/');
+    }
+    return strncmp(path, live, stem) == 0 &&
+           (path[stem] == '\0' || path[stem] == '.' || path[stem] == '/');
+}
+
+
+//-------------------------------------------------------------------------------
+// Moves the cursor back up to the parent directory
+//-------------------------------------------------------------------------------
+static void cursorUp() {
+    char* slash = strrchr(cursor, '/');
+    if (slash && (size_t)(slash - cursor) >= rootLen) {
+        *slash = '\0';
+        if (depth > 0) depth--;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// Visits up to `budget` entries below the cursor, depth first, removing them.
+// Each directory is read on from where the last step left it, and entries are
+// removed by their directory index rather than looked up by name, so a step
+// costs the same at the end of a large folder as at the start.
+// Returns nullptr while work remains or is done, otherwise an error message.
+// Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+static const char* deleteStep(uint16_t budget, bool& done) {
+    done = false;
+    while (budget > 0) {
+        bool atRoot = strlen(cursor) == rootLen;
+        FsFile node = SD.open(cursor, O_READ);
+        if (!node) {
+            // Already gone (e.g. removed just before a reboot)
+            if (atRoot) {
+                done = true;
+                return nullptr;
+            }
+            cursorUp();
+            budget--;
+            continue;
+        }
+
+        if (!node.isDir()) {
+            node.close();
+            if (!isLive(cursor)) {
+                if (!SD.remove(cursor)) return "remove failed";
+                status.removed++;
+            }
+            budget--;
+            if (atRoot) {
+                done = true;
+                return nullptr;
+            }
+            cursorUp();
+            continue;
+        }
+
+        // Remove files in this directory; descend into the first subdirectory
+        uint32_t* pos = depth < DELETE_DEPTH_MAX ? &dirPos[depth] : nullptr;
+        if (pos && !node.seekSet(*pos)) *pos = 0;
+        bool descend = false;
+        bool empty = true;
+        while (budget > 0) {
+            FsFile entry = node.openNextFile();
+            if (!entry) break;
+            char name[DELETE_PATH_MAX];
+            entry.getName(name, sizeof(name));
+            bool isDir = entry.isDir();
+            uint32_t index = entry.dirIndex();
+            entry.close();
+            uint32_t next = node.curPosition();
+
+            size_t len = strlen(cursor);
+            if (len + 1 + strlen(name) >= sizeof(cursor)) {
+                node.close();
+                return "path too long";
+            }
+            char child[DELETE_PATH_MAX];
+            memcpy(child, cursor, len);
+            child[len] = '/';
+            strcpy(child + len + 1, name);
+            if (isLive(child)) continue;
+
+            if (isDir) {
+                if (pos) *pos = next;
+                strcpy(cursor, child);
+                if (++depth < DELETE_DEPTH_MAX) dirPos[depth] = 0;
+                descend = true;
+                budget--;
+                break;
+            }
+            FsFile victim;
+            if (!victim.open(&node, index, O_WRONLY) || !victim.remove()) {
+                node.close();
+                return "remove failed";
+            }
+            node.seekSet(next);
+            status.removed++;
+            budget--;
+        }
+        if (!descend && budget == 0) {
+            // Out of budget: may or may not be empty, check next step
+            empty = false;
+            if (pos) *pos = node.curPosition();
+        }
+        node.close();
+        if (descend || !empty) continue;
+
+        // A directory holding the live journey stays
+        if (!isLive(cursor)) {
+            if (!SD.rmdir(cursor)) return "rmdir failed";
+            status.removed++;
+        }
+        budget--;
+        if (atRoot) {
+            done = true;
+            return nullptr;
+        }
+        cursorUp();
+    }
+    return nullptr;
+}
+
+
+void deleteJobService() {
+    static unsigned long lastStep = 0;
+    if (!status.running || millis() - lastStep < DELETE_INTERVAL) return;
+    lastStep = millis();
+
+    if (sdMutexTake(0) != pdTRUE) return;
+    uint32_t t0 = micros();
+    bool done;
+    const char* error = deleteStep(DELETE_BATCH, done);
+    uint32_t held = micros() - t0;
+    status.steps++;
+    if (held > status.maxHoldUs) status.maxHoldUs = held;
+    if (done || error) {
+        finishJob(error);
+    }
+    sdMutexGive();
+}
+
+
+const DeleteJobStatus& deleteJobStatus() {
+    return status;
+}
@@ -0,0 +1,161 @@
+#include "journal.hpp"
+#include "journey.hpp"
+#include "catalog.hpp"
+#include "segment.hpp"
+#include "delete_job.hpp"
+#include "block_log.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+static FsFile journalFile;
+static JournalRecord record;
+static RecoveryReport report;
+
+
+static uint32_t checksum(const JournalRecord& r) {
+    // FNV-1a over everything before the checksum field
+    const uint8_t* p = (const uint8_t*)&r;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(JournalRecord, check); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+
+//-------------------------------------------------------------------------------
+// Overwrites the single journal record in place; a one-sector write, so the
+// record is either old or new after a power loss (the checksum catches the rest)
+//-------------------------------------------------------------------------------
+static void writeRecord() {
+    if (!journalFile) {
+        journalFile = SD.open(JOURNAL_PATH, O_RDWR | O_CREAT);
+        if (!journalFile) {
+            Serial.println("Failed to open journal.");
+            return;
+        }
+    }
+    record.magic = JOURNAL_MAGIC;
+    record.seq++;
+    record.check = checksum(record);
+    journalFile.seekSet(0);
+    journalFile.write((const uint8_t*)&record, sizeof(record));
+    journalFile.sync();
+}
+
+
+static void logRepair(const char* path, uint32_t committed, uint64_t size, const char* action) {
+    FsFile log = SD.open(RECOVERED_PATH, O_WRONLY | O_CREAT | O_AT_END);
+    if (!log) return;
+    log.printf("{\"path\":\"%s\",\"committed\":%lu,\"size\":%lu,\"action\":\"%s\"}\n",
+               path, (unsigned long)committed, (unsigned long)size, action);
+    log.close();
+}
+
+
+//-------------------------------------------------------------------------------
+// Cuts a torn journey back to its last committed record, then writes the
+// summary and catalog entry it would have got on a clean stop
+//-------------------------------------------------------------------------------
+static void repairJourney(const char* path, uint16_t segment, uint32_t committed) {
+    char sdPath[48];
+    snprintf(sdPath, sizeof(sdPath), "/%s", path);
+
+    // Only the segment being written can be torn; earlier ones were closed
+    bool segmented = segmentIsSegmented(sdPath);
+    char dataPath[48];
+    if (segmented) {
+        segmentPath(sdPath, segment, segmentEncoding(sdPath), dataPath, sizeof(dataPath));
+    } else {
+        strcpy(dataPath, sdPath);
+    }
+    FsFile file = SD.open(dataPath, O_RDWR);
+    if (!file && !segmented) return;  // Deleted since, nothing to repair
+    uint64_t size = file ? file.fileSize() : 0;
+
+    if (committed == 0 && segment == 0) {
+        // Nothing was ever committed: drop the journey
+        file.close();
+        deleteJourney(sdPath);
+        logRepair(path, committed, size, "removed");
+    } else {
+        if (file && size > committed) {
+            report.truncatedBytes = size - committed;
+            if (committed == 0) {
+                // A segment started just before the power loss
+                file.close();
+                SD.remove(dataPath);
+            } else {
+                file.truncate(committed);
+            }
+        }
+        file.close();
+        if (segmented) segmentManifestRebuild(sdPath);
+
+        // Stats were only in RAM; rebuild them from the surviving records
+        JourneyStats& stats = journeyStats;
+        if (journeyStatsRebuild(stats, sdPath)) {
+            stats.gen = catalogAdd(stats.path);
+            journeyStatsWrite(stats);
+        }
+        // Up to a block of records was only in RAM too
+        blockLogRebuild(sdPath);
+        logRepair(path, committed, size, size > committed ? "truncated" : "closed");
+    }
+    report.repaired = true;
+    strncpy(report.path, path, sizeof(report.path) - 1);
+    Serial.printf("Recovered journey %s segment %u (committed %lu of %lu bytes)\n",
+                  path, (unsigned)segment, (unsigned long)committed, (unsigned long)size);
+}
+
+
+void journalRecover() {
+    uint32_t start = millis();
+    memset(&report, 0, sizeof(report));
+    memset(&record, 0, sizeof(record));
+
+    journalFile = SD.open(JOURNAL_PATH, O_RDWR | O_CREAT);
+    JournalRecord saved;
+    if (journalFile && journalFile.read((uint8_t*)&saved, sizeof(saved)) == (int)sizeof(saved) &&
+        saved.magic == JOURNAL_MAGIC && saved.check == checksum(saved)) {
+        record.seq = saved.seq;
+        saved.path[sizeof(saved.path) - 1] = '\0';
+        if (saved.path[0]) {
+            repairJourney(saved.path, saved.segment, saved.committed);
+            journalClose();
+        }
+    }
+
+    report.elapsedMs = millis() - start;
+    Serial.printf("Journal recovery: %s in %lu ms\n",
+                  report.repaired ? report.path : "clean", (unsigned long)report.elapsedMs);
+}
+
+
+void journalOpen(const char* journeyPath) {
+    strncpy(record.path, journeyPath, sizeof(record.path) - 1);
+    record.segment = 0;
+    record.committed = 0;
+    writeRecord();
+}
+
+
+void journalCommit(uint16_t segment, uint32_t length) {
+    record.segment = segment;
+    record.committed = length;
+    writeRecord();
+}
+
+
+void journalClose() {
+    memset(record.path, 0, sizeof(record.path));
+    record.segment = 0;
+    record.committed = 0;
+    writeRecord();
+}
+
+
+const RecoveryReport& journalRecovery() {
+    return report;
+}
@@ -0,0 +1,279 @@
+#include "journey.hpp"
+#include "overview.hpp"
+#include "record_reader.hpp"
+#include "segment.hpp"
+#include "time_index.hpp"
+#include "block_log.hpp"
+#include "ubx_capture.hpp"
+#include <math.h>
+
+// External SD filesystem instance
+extern SdFat SD;
+
+// Aggregates for the active journey (guarded by sdMutex)
+JourneyStats journeyStats;
+
+// Sidecar extensions written next to each journey file
+static const char* const sidecarExts[] = { SUMMARY_EXT, OVERVIEW_FINE_EXT, OVERVIEW_COARSE_EXT, STAR_EXT,
+                                            SEGMENT_MANIFEST_EXT, TIME_INDEX_EXT, BLOCK_LOG_EXT,
+                                            UBX_CAPTURE_EXT };
+
+
+void ChannelStats::reset() {
+    min = 0.0;
+    max = 0.0;
+    sum = 0.0;
+    count = 0;
+}
+
+
+void ChannelStats::add(float value) {
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+    sum += value;
+    count++;
+}
+
+
+float ChannelStats::mean() const {
+    return count > 0 ? (float)(sum / count) : 0.0;
+}
+
+
+double haversineKm(double lat1, double lon1, double lat2, double lon2) {
+    const double R = 6371.0;                // Earth radius (km)
+    const double toRad = M_PI / 180.0;
+    double dLat = (lat2 - lat1) * toRad;
+    double dLon = (lon2 - lon1) * toRad;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * toRad) * cos(lat2 * toRad) * sin(dLon / 2) * sin(dLon / 2);
+    return 2 * R * atan2(sqrt(a), sqrt(1 - a));
+}
+
+
+void journeyStatsBegin(JourneyStats& stats, const char* path) {
+    memset(&stats, 0, sizeof(stats));
+    strncpy(stats.path, path, sizeof(stats.path) - 1);
+    stats.rpm.reset();
+    stats.speed.reset();
+    stats.maf.reset();
+    stats.throttle.reset();
+    stats.instantMPG.reset();
+    stats.accelX.reset();
+    stats.accelY.reset();
+    stats.active = true;
+}
+
+
+void journeyStatsUpdate(JourneyStats& stats, const TelemetrySample& sample, float deltaTime) {
+    if (stats.samples == 0) {
+        strncpy(stats.startTime, sample.time, sizeof(stats.startTime) - 1);
+        deltaTime = 0;  // No interval before the first sample
+    }
+    strncpy(stats.endTime, sample.time, sizeof(stats.endTime) - 1);
+    stats.samples++;
+
+    // --- Time moving / idle ---
+    stats.durationSec += deltaTime;
+    if (sample.speed > 0) {
+        stats.movingSec += deltaTime;
+    } else if (sample.rpm > 0) {
+        stats.idleSec += deltaTime;
+    }
+
+    // --- Distance and fuel ---
+    // A zero coordinate means no fix yet, so it is excluded from the route distance
+    bool fix = (sample.latitude != 0.0 || sample.longitude != 0.0);
+    if (fix) {
+        if (stats.hasFix) {
+            stats.distanceKm += haversineKm(stats.lastLat, stats.lastLon,
+                                            sample.latitude, sample.longitude);
+        } else {
+            stats.startLat = sample.latitude;
+            stats.startLon = sample.longitude;
+            stats.hasFix = true;
+        }
+        stats.lastLat = sample.latitude;
+        stats.lastLon = sample.longitude;
+    }
+    stats.obdMiles    += (sample.speed * 0.621371) * deltaTime / 3600.0;
+    stats.fuelGallons += (sample.maf * 0.0805) * deltaTime / 3600.0;
+
+    // --- Channels ---
+    stats.rpm.add(sample.rpm);
+    stats.speed.add(sample.speed);
+    stats.maf.add(sample.maf);
+    stats.throttle.add(sample.throttle);
+    stats.instantMPG.add(sample.instantMPG);
+    stats.accelX.add(sample.accelX);
+    stats.accelY.add(sample.accelY);
+
+    // --- Harsh events (counted once per excursion past the threshold) ---
+    bool accel  = sample.accelX >  HARSH_ACCEL_MG;
+    bool brake  = sample.accelX < -HARSH_BRAKE_MG;
+    bool corner = abs(sample.accelY) > HARSH_CORNER_MG;
+    if (accel && !stats.inAccel) stats.harshAccel++;
+    if (brake && !stats.inBrake) stats.harshBrake++;
+    if (corner && !stats.inCorner) stats.harshCorner++;
+    stats.inAccel = accel;
+    stats.inBrake = brake;
+    stats.inCorner = corner;
+}
+
+
+float journeyStatsAverageMPG(const JourneyStats& stats) {
+    return stats.fuelGallons > 0 ? (float)(stats.obdMiles / stats.fuelGallons) : 0.0;
+}
+
+
+static void channelToJson(const ChannelStats& channel, JsonObject out) {
+    out["min"] = channel.min;
+    out["max"] = channel.max;
+    out["mean"] = channel.mean();
+}
+
+
+void journeyStatsToJson(const JourneyStats& stats, JsonObject out) {
+    // Drive file name without the day folder
+    const char* slash = strrchr(stats.path, '/');
+    out["drive"] = slash ? slash + 1 : stats.path;
+    out["active"] = stats.active;
+    out["gen"] = stats.gen;
+    out["start_time"] = stats.startTime;
+    out["end_time"] = stats.endTime;
+    out["samples"] = stats.samples;
+    out["duration_sec"] = stats.durationSec;
+    out["moving_sec"] = stats.movingSec;
+    out["idle_sec"] = stats.idleSec;
+    out["distance_km"] = stats.distanceKm;
+    out["fuel_gal"] = stats.fuelGallons;
+    out["avg_mpg"] = journeyStatsAverageMPG(stats);
+    if (stats.hasFix) {
+        out["start"]["latitude"] = stats.startLat;
+        out["start"]["longitude"] = stats.startLon;
+        out["end"]["latitude"] = stats.lastLat;
+        out["end"]["longitude"] = stats.lastLon;
+    }
+    out["harsh"]["accel"] = stats.harshAccel;
+    out["harsh"]["brake"] = stats.harshBrake;
+    out["harsh"]["corner"] = stats.harshCorner;
+
+    JsonObject channels = out["channels"].to<JsonObject>();
+    channelToJson(stats.rpm, channels["rpm"].to<JsonObject>());
+    channelToJson(stats.speed, channels["speed"].to<JsonObject>());
+    channelToJson(stats.maf, channels["maf"].to<JsonObject>());
+    channelToJson(stats.throttle, channels["throttle"].to<JsonObject>());
+    channelToJson(stats.instantMPG, channels["instant_mpg"].to<JsonObject>());
+    channelToJson(stats.accelX, channels["accel_x"].to<JsonObject>());
+    channelToJson(stats.accelY, channels["accel_y"].to<JsonObject>());
+}
+
+
+//-------------------------------------------------------------------------------
+// Writes the summary sidecar for a finished journey and marks it inactive.
+// Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+bool journeyStatsWrite(JourneyStats& stats) {
+    if (!stats.active) return false;
+    stats.active = false;
+
+    char path[48];
+    if (!journeySidecarPath(stats.path, SUMMARY_EXT, path, sizeof(path))) {
+        return false;
+    }
+
+    FsFile file = SD.open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (!file) {
+        Serial.printf("Failed to create summary: %s\n", path);
+        return false;
+    }
+    JsonDocument doc;
+    journeyStatsToJson(stats, doc.to<JsonObject>());
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    Serial.printf("Summary written: %s\n", path);
+    return ok;
+}
+
+
+bool journeyParseRecord(const char* line, size_t length, TelemetrySample& sample, char* time, size_t timeSize,
+                        RecordEncoding encoding) {
+    JsonDocument doc;
+    if (recordDeserialize(doc, line, length, encoding)) return false;
+    strncpy(time, doc["gps"]["time"] | "", timeSize - 1);
+    time[timeSize - 1] = '\0';
+    sample.time       = time;
+    sample.latitude   = doc["gps"]["latitude"] | 0.0;
+    sample.longitude  = doc["gps"]["longitude"] | 0.0;
+    sample.rpm        = doc["obd"]["rpm"] | 0;
+    sample.speed      = doc["obd"]["speed"] | 0;
+    sample.maf        = doc["obd"]["maf"] | 0.0f;
+    sample.instantMPG = doc["obd"]["instant_mpg"] | 0.0f;
+    sample.throttle   = doc["obd"]["throttle"] | 0;
+    sample.avgMPG     = doc["obd"]["avg_mpg"] | 0.0f;
+    sample.accelX     = doc["imu"]["accel_x"] | 0;
+    sample.accelY     = doc["imu"]["accel_y"] | 0;
+    return true;
+}
+
+
+static long timeOfDay(const char* time) {
+    int h, m, s;
+    if (sscanf(time, "%d:%d:%d", &h, &m, &s) != 3) return -1;
+    return h * 3600L + m * 60L + s;
+}
+
+
+float journeyTimeDelta(const char* from, const char* to) {
+    long a = timeOfDay(from);
+    long b = timeOfDay(to);
+    if (a < 0 || b < 0) return 0;
+    long delta = b - a;
+    if (delta < 0) delta += 86400;   // Crossed midnight
+    return delta;
+}
+
+
+bool journeyStatsRebuild(JourneyStats& stats, const char* journeyPath) {
+    JourneyFile file;
+    if (!file.open(journeyPath)) return false;
+
+    // SD paths may carry a leading slash; the stats keep the catalog form
+    journeyStatsBegin(stats, journeyPath[0] == '/' ? journeyPath + 1 : journeyPath);
+    RecordReader reader(file);
+    size_t len;
+    const char* line;
+    char time[10], lastTime[10] = "";
+    TelemetrySample sample;
+    while ((line = reader.next(len)) != nullptr) {
+        if (!journeyParseRecord(line, len, sample, time, sizeof(time), reader.encoding())) continue;
+        journeyStatsUpdate(stats, sample, lastTime[0] ? journeyTimeDelta(lastTime, time) : 0);
+        strcpy(lastTime, time);
+    }
+    file.close();
+    return true;
+}
+
+
+bool journeySidecarPath(const char* journeyPath, const char* ext, char* out, size_t size) {
+    const char* dot = strrchr(journeyPath, '.');
+    size_t stem = dot ? (size_t)(dot - journeyPath) : strlen(journeyPath);
+    if (stem + strlen(ext) + 1 > size) return false;
+    memcpy(out, journeyPath, stem);
+    strcpy(out + stem, ext);
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Removes every sidecar belonging to a journey file (missing ones are ignored).
+// Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+void journeyRemoveSidecars(const char* journeyPath) {
+    char path[64];
+    for (const char* ext : sidecarExts) {
+        if (journeySidecarPath(journeyPath, ext, path, sizeof(path)) && SD.exists(path)) {
+            SD.remove(path);
+        }
+    }
+}
@@ -0,0 +1,192 @@
+#include "json_stream.hpp"
+#include "metrics.hpp"
+#include <math.h>
+
+
+JsonStreamWriter::JsonStreamWriter(WebServer& server) : m_server(server) {
+    m_first[0] = true;
+}
+
+
+void JsonStreamWriter::begin(int code, const char* contentType) {
+    m_server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    m_server.send(code, contentType, "");
+}
+
+
+void JsonStreamWriter::end() {
+    flush();
+    m_server.sendContent("");  // Terminating chunk
+}
+
+
+void JsonStreamWriter::flush() {
+    if (m_len > 0) {
+        static MetricCounter* served = metricsCounter("http_bytes_total");
+        m_server.sendContent(m_buf, m_len);
+        served->add(m_len);
+        m_total += m_len;
+        m_len = 0;
+    }
+}
+
+
+void JsonStreamWriter::write(char c) {
+    if (m_len == sizeof(m_buf)) flush();
+    m_buf[m_len++] = c;
+}
+
+
+void JsonStreamWriter::write(const char* data, size_t length) {
+    while (length > 0) {
+        if (m_len == sizeof(m_buf)) flush();
+        size_t n = min(length, sizeof(m_buf) - m_len);
+        memcpy(m_buf + m_len, data, n);
+        m_len += n;
+        data += n;
+        length -= n;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// Emits the comma between siblings (nothing directly after a key)
+//-------------------------------------------------------------------------------
+void JsonStreamWriter::separator() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (!m_first[m_depth]) write(',');
+    m_first[m_depth] = false;
+}
+
+
+void JsonStreamWriter::beginArray() {
+    separator();
+    write('[');
+    if (m_depth < JSON_STREAM_MAX_DEPTH) m_depth++;
+    m_first[m_depth] = true;
+}
+
+
+void JsonStreamWriter::endArray() {
+    write(']');
+    if (m_depth > 0) m_depth--;
+}
+
+
+void JsonStreamWriter::beginObject() {
+    separator();
+    write('{');
+    if (m_depth < JSON_STREAM_MAX_DEPTH) m_depth++;
+    m_first[m_depth] = true;
+}
+
+
+void JsonStreamWriter::endObject() {
+    write('}');
+    if (m_depth > 0) m_depth--;
+}
+
+
+void JsonStreamWriter::key(const char* name) {
+    value(name);
+    write(':');
+    m_afterKey = true;
+}
+
+
+void JsonStreamWriter::value(const char* str) {
+    separator();
+    write('"');
+    for (const char* p = str; *p; p++) {
+        char c = *p;
+        if (c == '"' || c == '\\') {
+            write('\\');
+            write(c);
+        } else if ((uint8_t)c < 0x20) {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            write(esc, 6);
+        } else {
+            write(c);
+        }
+    }
+    write('"');
+}
+
+
+void JsonStreamWriter::value(int32_t number) {
+    char tmp[12];
+    separator();
+    write(tmp, snprintf(tmp, sizeof(tmp), "%ld", (long)number));
+}
+
+
+void JsonStreamWriter::value(uint32_t number) {
+    char tmp[12];
+    separator();
+    write(tmp, snprintf(tmp, sizeof(tmp), "%lu", (unsigned long)number));
+}
+
+
+void JsonStreamWriter::value(uint64_t number) {
+    char tmp[22];
+    separator();
+    write(tmp, snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)number));
+}
+
+
+void JsonStreamWriter::value(double number, uint8_t decimals) {
+    char tmp[32];
+    separator();
+    if (isnan(number) || isinf(number)) {
+        write("null", 4);
+        return;
+    }
+    write(tmp, snprintf(tmp, sizeof(tmp), "%.*f", decimals, number));
+}
+
+
+void JsonStreamWriter::value(bool flag) {
+    separator();
+    if (flag) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+}
+
+
+// ArduinoJson writer over the buffer
+struct JsonStreamWriter::Sink {
+    JsonStreamWriter& out;
+
+    size_t write(uint8_t c) {
+        out.write((char)c);
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        out.write((const char*)data, length);
+        return length;
+    }
+};
+
+
+void JsonStreamWriter::value(JsonVariantConst json) {
+    separator();
+    Sink sink{*this};
+    serializeJson(json, sink);
+}
+
+
+void JsonStreamWriter::raw(const char* json, size_t length) {
+    separator();
+    write(json, length);
+}
+
+
+void JsonStreamWriter::append(const char* json, size_t length) {
+    write(json, length);
+}
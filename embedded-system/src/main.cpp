@@ -4,6 +4,24 @@
 #include <SparkFun_u-blox_GNSS_Arduino_Library.h>
 #include "obd.hpp"
 #include "server.hpp"
+#include "journey.hpp"
+#include "overview.hpp"
+#include "catalog.hpp"
+#include "sd_tune.hpp"
+#include "storage.hpp"
+#include "delete_job.hpp"
+#include "journal.hpp"
+#include "segment.hpp"
+#include "time_index.hpp"
+#include "block_log.hpp"
+#include "config.hpp"
+#include "record_reader.hpp"
+#include "ubx_capture.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "sd_mutex.hpp"
+#include "task_stats.hpp"
+#include "cycle_monitor.hpp"
 
 #include <SdFat.h>
 #include <ArduinoJson.h>
@@ -23,7 +41,10 @@ const char* password = "12345678";
 
 // Global variables for file/folder names
 char folderName[20];
-char fileName[40];
+char fileName[40];          // Journey path; records go to its segments
+uint16_t segmentIndex = 0;  // Segment logFile is writing
+uint64_t segmentBase = 0;   // Journey offset of the start of that segment
+RecordEncoding journeyEncoding = ENCODING_NDJSON;   // Fixed for the whole journey
 
 // Module instances
 OBD obd;
@@ -32,6 +53,7 @@ SdFat SD;
 FsFile logFile;
 
 SemaphoreHandle_t sdMutex;
+TaskHandle_t dataTaskHandle = NULL;
 
 // Global variables for fuel efficiency calculations
 float totalSpeedTimeProduct = 0.0;
@@ -85,8 +107,21 @@ void dataTask(void *pvParameters) {
         // Reset the timer after calibration.
         lastTime = millis();
     }
-    
+
+    // Latency histograms and counters (GET /metrics)
+    MetricHistogram* cycleMetric = metricsHistogram("cycle_us");
+    MetricHistogram* pvtMetric = metricsHistogram("gnss_pvt_us");
+    MetricHistogram* esfMetric = metricsHistogram("gnss_esf_us");
+    MetricCounter* esfFailures = metricsCounter("gnss_esf_failures_total");
+    MetricHistogram* writeMetric = metricsHistogram("sd_write_us");
+    MetricHistogram* syncMetric = metricsHistogram("sd_sync_us");
+
+    // Cycles run on a fixed 1 s grid; the work no longer stretches the period
+    cycleMonitorBegin();
     for (;;) {
+        TRACE_INSTANT("cycle");
+        uint32_t lateMs = cycleBegin();
+        unsigned long cycleStart = micros();
         unsigned long currentTime = millis();
         float deltaTime = (currentTime - lastTime) / 1000.0; // seconds
 
@@ -94,10 +129,14 @@ void dataTask(void *pvParameters) {
         float maf = 0.0, mpg = 0.0, avgMPG = 0.0;
         
         // --- OBD-II Data Retrieval ---
-        obd.readRPM(rpm);
-        obd.readSpeed(speed);
-        obd.readMAF(maf);
-        obd.readThrottle(throttle);
+        {
+            TRACE_SCOPE("obd");
+            CYCLE_PHASE(CYCLE_OBD);
+            obd.readRPM(rpm);
+            obd.readSpeed(speed);
+            obd.readMAF(maf);
+            obd.readThrottle(throttle);
+        }
         
         // --- Fuel Efficiency Calculation ---
         if (speed > 0 && maf > 0) {
@@ -108,15 +147,25 @@ void dataTask(void *pvParameters) {
         }
 
         // --- GPS Data Retrieval ---
-        byte SIV = myGNSS.getSIV();
-        double latitude = myGNSS.getLatitude() / 10000000.0;
-        double longitude = myGNSS.getLongitude() / 10000000.0;
-        uint8_t hour = myGNSS.getHour();
-        uint8_t minute = myGNSS.getMinute();
-        uint8_t second = myGNSS.getSecond();
-        uint16_t day = myGNSS.getDay();
-        uint16_t month = myGNSS.getMonth();
-        uint16_t year = myGNSS.getYear();
+        byte SIV;
+        double latitude, longitude;
+        uint8_t hour, minute, second;
+        uint16_t day, month, year;
+        {
+            TRACE_SCOPE("gnss.pvt");
+            CYCLE_PHASE(CYCLE_GNSS_PVT);
+            unsigned long start = micros();
+            SIV = myGNSS.getSIV();
+            latitude = myGNSS.getLatitude() / 10000000.0;
+            longitude = myGNSS.getLongitude() / 10000000.0;
+            hour = myGNSS.getHour();
+            minute = myGNSS.getMinute();
+            second = myGNSS.getSecond();
+            day = myGNSS.getDay();
+            month = myGNSS.getMonth();
+            year = myGNSS.getYear();
+            pvtMetric->record(micros() - start);
+        }
 
         char timeStr[10];
         sprintf(timeStr, "%02d:%02d:%02d", hour, minute, second);
@@ -126,9 +175,17 @@ void dataTask(void *pvParameters) {
 
         // --- IMU Data Retrieval ---
         int accelX = 0, accelY = 0;
-        if (myGNSS.getEsfIns()) {
-            accelX = myGNSS.packetUBXESFINS->data.xAccel;
-            accelY = -myGNSS.packetUBXESFINS->data.yAccel;  // Invert Y-axis 
+        {
+            TRACE_SCOPE("gnss.esf");
+            CYCLE_PHASE(CYCLE_GNSS_ESF);
+            unsigned long start = micros();
+            if (myGNSS.getEsfIns()) {
+                accelX = myGNSS.packetUBXESFINS->data.xAccel;
+                accelY = -myGNSS.packetUBXESFINS->data.yAccel;  // Invert Y-axis 
+            } else {
+                esfFailures->add();
+            }
+            esfMetric->record(micros() - start);
         }
 
         // --- Debug Output ---
@@ -144,14 +201,28 @@ void dataTask(void *pvParameters) {
         // --- Logging Data to SD Card (Using Mutex) ---
         // Log only if calibration is done, the button is pressed and a journey is active.
         if (loggingActive) {
-            if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000))) { // Protect SD access
+            bool locked;
+            {
+                TRACE_SCOPE("sd.mutex");
+                CYCLE_PHASE(CYCLE_SD_MUTEX);
+                locked = sdMutexTake(pdMS_TO_TICKS(1000));
+            }
+            if (locked) { // Protect SD access
                 if (firstLog) {
                     sprintf(folderName, "%04d-%02d-%02d", year, month, day);
                     if (!SD.exists(folderName)) SD.mkdir(folderName);
                     sprintf(fileName, "%s/%02d-%02d-%02d.json", folderName, hour, minute, second);
-                    logFile = SD.open(fileName, O_RDWR | O_CREAT | O_AT_END);
-                    if (logFile) {
+                    segmentIndex = 0;
+                    segmentBase = 0;
+                    journeyEncoding = loggerConfig.encoding;
+                    if (segmentOpen(fileName, segmentIndex, journeyEncoding, logFile)) {
                         Serial.printf("Log file created: %s\n", fileName);
+                        journeyStatsBegin(journeyStats, fileName);
+                        overviewBegin(fileName);
+                        timeIndexBegin(fileName);
+                        blockLogBegin(fileName);
+                        ubxCaptureBegin(fileName);
+                        journalOpen(fileName);
                         firstLog = false;
                     } else {
                         Serial.println("Failed to create log file.");
@@ -159,6 +230,8 @@ void dataTask(void *pvParameters) {
                 }
 
                 if (logFile) {
+                    TRACE_SCOPE("sd.record");
+                    CYCLE_PHASE(CYCLE_SD_RECORD);
                     StaticJsonDocument<256> jsonDoc;
                     jsonDoc["gps"]["time"] = timeStr;
                     jsonDoc["gps"]["latitude"] = latitude;
@@ -171,26 +244,67 @@ void dataTask(void *pvParameters) {
                     jsonDoc["obd"]["avg_mpg"] = avgMPG;
                     jsonDoc["imu"]["accel_x"] = accelX;
                     jsonDoc["imu"]["accel_y"] = accelY;
-
-                    if (serializeJson(jsonDoc, logFile) == 0) {
-                        Serial.println("Failed to serialize JSON.");
+                    // Only on late samples: how far behind its 1 s slot it was taken
+                    if (lateMs) jsonDoc["late_ms"] = lateMs;
+
+                    // Encoded in full first so a record is written in one go
+                    uint64_t recordOffset = segmentBase + logFile.fileSize();
+                    uint8_t record[RECORD_MAX_LEN];
+                    size_t recordLen = recordSerialize(jsonDoc, journeyEncoding, record, sizeof(record));
+                    unsigned long writeStart = micros();
+                    bool logged = recordLen > 0 && logFile.write(record, recordLen) == recordLen;
+                    writeMetric->record(micros() - writeStart);
+                    if (!logged) {
+                        Serial.println("Failed to serialize record.");
                     } else {
-                        logFile.println();
+                        TRACE_SCOPE("sidecars");
+                        CYCLE_PHASE(CYCLE_SIDECARS);
                         Serial.println("\nData logged.");
+
+                        // Keep the running journey summary up to date
+                        TelemetrySample sample = { timeStr, latitude, longitude, rpm, speed, maf,
+                                                   mpg, throttle, avgMPG, accelX, accelY };
+                        journeyStatsUpdate(journeyStats, sample, deltaTime);
+                        overviewUpdate(sample, journeyStats.durationSec);
+                        timeIndexUpdate(timeStr, recordOffset);
+                        blockLogAdd(sample);
+                        ubxCaptureDrain(myGNSS);
+                    }
+                    {
+                        TRACE_SCOPE("sd.flush");
+                        CYCLE_PHASE(CYCLE_SD_FLUSH);
+                        unsigned long syncStart = micros();
+                        logFile.flush();
+                        syncMetric->record(micros() - syncStart);
+                    }
+                    // Everything up to here is a complete record; recovery
+                    // truncates back to this length after a power loss
+                    if (logged) journalCommit(segmentIndex, logFile.fileSize());
+
+                    // A full segment is closed for good and the next one started
+                    if (logFile.fileSize() >= SEGMENT_BYTES && segmentIndex < SEGMENT_MAX) {
+                        segmentBase += logFile.fileSize();
+                        segmentClose(fileName, segmentIndex, logFile);
+                        segmentIndex++;
+                        if (segmentOpen(fileName, segmentIndex, journeyEncoding, logFile)) {
+                            journalCommit(segmentIndex, 0);
+                        }
                     }
-                    logFile.flush();
                 } else {
                     Serial.println("Log file not open. Retrying...");
-                    logFile = SD.open(fileName, O_RDWR | O_CREAT | O_AT_END);
+                    segmentOpen(fileName, segmentIndex, journeyEncoding, logFile);
                 }
-                xSemaphoreGive(sdMutex); // Release SD Mutex
+                sdMutexGive(); // Release SD Mutex
             } else {
+                TRACE_INSTANT("sd.timeout");
                 Serial.println("SD mutex timeout, skipping write...");
             }
         }
 
+        cycleMetric->record(micros() - cycleStart);
+        cycleEnd();
         lastTime = currentTime;
-        vTaskDelay(pdMS_TO_TICKS(1000));  // 1-second delay 
+        cycleWait();
     }
 }
 
@@ -200,11 +314,15 @@ void setup() {
     delay(1000);
     Serial.println("Initialising System...");
 
-    // --- SD Card Initialization ---
-    if (!SD.begin(SD_CS_PIN, 1000000)) {
+    // --- SD Card Initialization (probes for the fastest reliable SPI clock) ---
+    if (!sdAutoTune(SD_CS_PIN)) {
         Serial.println("SD card initialization failed!");
     } else {
         Serial.println("SD card initialized successfully.");
+        configLoad();
+        catalogBegin();
+        deleteJobBegin();
+        journalRecover();
     }
 
     // --- WiFi Access Point ---
@@ -236,9 +354,11 @@ void setup() {
         16384,        // Stack size.
         NULL,         // Parameter.
         1,            // Task priority.
-        NULL,         // Task handle.
+        &dataTaskHandle, // Task handle.
         1             // Run on Core 1.
     );
+    taskStatsWatch(dataTaskHandle);
+    taskStatsWatch(xTaskGetCurrentTaskHandle());  // loop()
 }
 
 // Main Loop: Handle Web Server, Button, and LED (runs on Core 0)
@@ -250,9 +370,11 @@ void loop() {
         if (!gnssInitialized) {
             Wire1.setPins(SDA1, SCL1);
             Wire1.begin();
+            ubxCaptureSetup(myGNSS);
             if (myGNSS.begin(Wire1)) {
                 Serial.println("GNSS Module Initialized");
                 myGNSS.setI2COutput(COM_TYPE_UBX);
+                ubxCaptureEnable(myGNSS);
                 gnssInitialized = true;
             } else {
                 Serial.println("Failed to initialize NEO-M8U Module");
@@ -293,14 +415,24 @@ void loop() {
         } else {
             // Logging just deactivated—close the current log file if open.
             if (logFile) {
-                if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000))) {
-                    logFile.close();
-                    xSemaphoreGive(sdMutex);
+                if (sdMutexTake(pdMS_TO_TICKS(1000))) {
+                    overviewFinish();
+                    blockLogFinish();
+                    journeyStats.gen = catalogAdd(journeyStats.path);
+                    journeyStatsWrite(journeyStats);
+                    segmentClose(fileName, segmentIndex, logFile);
+                    journalClose();
+                    sdMutexGive();
                     Serial.println("Log file closed.");
                 }
             }
         }
         lastLoggingState = loggingActive;
     }
+
+    // Background SD housekeeping (free-space count, queued deletes, retention)
+    storageService();
+    // Task stacks, CPU and heap history (GET /tasks)
+    taskStatsService();
     delay(10);  // Short delay 
 }
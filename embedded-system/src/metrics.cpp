@@ -0,0 +1,149 @@
+#include "metrics.hpp"
+
+struct Metric {
+    const char* name;
+    const char* labelKey;
+    const char* labelValue;
+    MetricHistogram* histogram; // Null for a counter
+    MetricCounter counter;
+};
+
+static Metric metrics[METRICS_MAX];
+static uint32_t metricCount = 0;
+static portMUX_TYPE metricsLock = portMUX_INITIALIZER_UNLOCKED;
+static MetricHistogram spareHistogram;
+static MetricCounter spareCounter;
+
+
+static int bucketOf(uint32_t value) {
+    if (value < (1u << METRIC_SUB_BITS)) return value;
+    int exponent = 31 - __builtin_clz(value);
+    int shift = exponent - METRIC_SUB_BITS;
+    return ((shift + 1) << METRIC_SUB_BITS) + ((value >> shift) & ((1u << METRIC_SUB_BITS) - 1));
+}
+
+
+// Smallest value that falls in bucket i
+static uint64_t bucketStart(int i) {
+    if (i < (1 << METRIC_SUB_BITS)) return i;
+    int shift = (i >> METRIC_SUB_BITS) - 1;
+    uint64_t sub = i & ((1 << METRIC_SUB_BITS) - 1);
+    return ((1ull << METRIC_SUB_BITS) + sub) << shift;
+}
+
+
+void MetricHistogram::record(uint32_t value) {
+    __atomic_fetch_add(&m_buckets[bucketOf(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m_sum, (uint64_t)value, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&m_max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&m_max, &max, value, true, __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED)) {}
+}
+
+
+uint32_t MetricHistogram::percentile(float p) const {
+    uint32_t count = m_count;
+    if (count == 0) return 0;
+    uint32_t rank = (uint32_t)(p / 100 * (count - 1)) + 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            uint64_t mid = (bucketStart(i) + bucketStart(i + 1) - 1) / 2;
+            return mid < m_max ? (uint32_t)mid : m_max;
+        }
+    }
+    return m_max;
+}
+
+
+static bool same(const char* a, const char* b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+
+//-------------------------------------------------------------------------------
+// Lookup is a linear scan; creation happens under a spinlock so two tasks
+// asking for the same new metric get the same one
+//-------------------------------------------------------------------------------
+static Metric* findOrCreate(const char* name, const char* labelKey, const char* labelValue, bool histogram) {
+    uint32_t count = __atomic_load_n(&metricCount, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        Metric& m = metrics[i];
+        if (same(m.name, name) && same(m.labelValue, labelValue) && same(m.labelKey, labelKey)) return &m;
+    }
+
+    // Allocated outside the lock; dropped if another task got there first
+    MetricHistogram* storage = histogram ? new MetricHistogram() : nullptr;
+    Metric* found = nullptr;
+    portENTER_CRITICAL(&metricsLock);
+    for (uint32_t i = 0; i < metricCount && !found; i++) {
+        Metric& m = metrics[i];
+        if (same(m.name, name) && same(m.labelValue, labelValue) && same(m.labelKey, labelKey)) found = &m;
+    }
+    if (!found && metricCount < METRICS_MAX && (storage || !histogram)) {
+        found = &metrics[metricCount];
+        found->name = name;
+        found->labelKey = labelKey;
+        found->labelValue = labelValue;
+        found->histogram = storage;
+        storage = nullptr;
+        __atomic_store_n(&metricCount, metricCount + 1, __ATOMIC_RELEASE);
+    }
+    portEXIT_CRITICAL(&metricsLock);
+    delete storage;
+    return found;
+}
+
+
+MetricHistogram* metricsHistogram(const char* name, const char* labelKey, const char* labelValue) {
+    Metric* m = findOrCreate(name, labelKey, labelValue, true);
+    return m && m->histogram ? m->histogram : &spareHistogram;
+}
+
+
+MetricCounter* metricsCounter(const char* name, const char* labelKey, const char* labelValue) {
+    Metric* m = findOrCreate(name, labelKey, labelValue, false);
+    return m && !m->histogram ? &m->counter : &spareCounter;
+}
+
+
+static void writeLine(MetricsSink sink, void* context, const char* format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n > 0) sink(line, min((size_t)n, sizeof(line) - 1), context);
+}
+
+
+void metricsWrite(MetricsSink sink, void* context) {
+    writeLine(sink, context, "# uptime %lu s; histogram values in microseconds\n", millis() / 1000);
+    uint32_t count = __atomic_load_n(&metricCount, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        const Metric& m = metrics[i];
+        char name[96];
+        if (m.labelKey) snprintf(name, sizeof(name), "%s{%s=\"%s\"}", m.name, m.labelKey, m.labelValue);
+        else snprintf(name, sizeof(name), "%s", m.name);
+
+        if (!m.histogram) {
+            writeLine(sink, context, "%s %u\n", name, (unsigned)m.counter.value());
+            continue;
+        }
+        const MetricHistogram& h = *m.histogram;
+        writeLine(sink, context, "%s count=%u sum=%llu p50=%u p90=%u p99=%u max=%u\n", name, (unsigned)h.count(),
+                  (unsigned long long)h.sum(), (unsigned)h.percentile(50), (unsigned)h.percentile(90),
+                  (unsigned)h.percentile(99), (unsigned)h.max());
+    }
+
+    writeLine(sink, context, "heap_free_bytes %u\n", (unsigned)ESP.getFreeHeap());
+    writeLine(sink, context, "heap_min_free_bytes %u\n", (unsigned)ESP.getMinFreeHeap());
+    writeLine(sink, context, "heap_largest_block_bytes %u\n", (unsigned)ESP.getMaxAllocHeap());
+    if (ESP.getPsramSize() > 0) {
+        writeLine(sink, context, "psram_free_bytes %u\n", (unsigned)ESP.getFreePsram());
+        writeLine(sink, context, "psram_min_free_bytes %u\n", (unsigned)ESP.getMinFreePsram());
+        writeLine(sink, context, "psram_largest_block_bytes %u\n", (unsigned)ESP.getMaxAllocPsram());
+    }
+}
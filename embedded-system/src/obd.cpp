@@ -1,4 +1,6 @@
 #include "obd.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
 #include <Arduino.h>
 
 // Constructor
@@ -12,17 +14,21 @@ bool OBD::initialise() {
 
 
 bool OBD::sendPIDCommand(const char* pid, char* response, int bufsize) {
+    TRACE_SCOPE_ARG("obd.pid", pid);   // pid is a literal at every call site
     unsigned long startTime = millis();
+    unsigned long startMicros = micros();
     write(pid);  // Transmit the PID request
 
     // Loop until we receive data or timeout
     while (millis() - startTime < OBD_TIMEOUT_LONG) {
         int len = receive(response, bufsize, OBD_TIMEOUT_LONG);
         if (len > 0) {
+            metricsHistogram("obd_pid_us", "pid", pid)->record(micros() - startMicros);
             return true;  // Successful read
         }
     }
     // Timeout without data
+    metricsCounter("obd_timeouts_total", "pid", pid)->add();
     return false;
 }
 
@@ -0,0 +1,124 @@
+#include "overview.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+static OverviewLevel levels[OVERVIEW_LEVELS] = {
+    { OVERVIEW_FINE_SEC, OVERVIEW_FINE_EXT, {}, {} },
+    { OVERVIEW_COARSE_SEC, OVERVIEW_COARSE_EXT, {}, {} },
+};
+
+
+static void bucketReset(OverviewBucket& b, uint32_t index) {
+    b.index = index;
+    b.count = 0;
+    b.time[0] = '\0';
+    b.speed.reset();
+    b.rpm.reset();
+    b.throttle.reset();
+    b.maf.reset();
+    b.instantMPG.reset();
+    b.accelX.reset();
+    b.accelY.reset();
+}
+
+
+static void channelToArray(const ChannelStats& c, JsonArray out) {
+    out.add(c.min);
+    out.add(c.max);
+    out.add(c.mean());
+}
+
+
+//-------------------------------------------------------------------------------
+// Appends one closed bucket as a compact NDJSON line to the level's sidecar:
+// {"t":"HH:MM:SS","n":10,"first":[lat,lon],"last":[lat,lon],"speed":[min,max,mean],...}
+//-------------------------------------------------------------------------------
+static void bucketWrite(OverviewLevel& level) {
+    const OverviewBucket& b = level.bucket;
+    if (b.count == 0 || !level.file) return;
+
+    JsonDocument doc;
+    doc["t"] = b.time;
+    doc["n"] = b.count;
+    JsonArray first = doc["first"].to<JsonArray>();
+    first.add(b.firstLat);
+    first.add(b.firstLon);
+    JsonArray last = doc["last"].to<JsonArray>();
+    last.add(b.lastLat);
+    last.add(b.lastLon);
+    channelToArray(b.speed, doc["speed"].to<JsonArray>());
+    channelToArray(b.rpm, doc["rpm"].to<JsonArray>());
+    channelToArray(b.throttle, doc["throttle"].to<JsonArray>());
+    channelToArray(b.maf, doc["maf"].to<JsonArray>());
+    channelToArray(b.instantMPG, doc["instant_mpg"].to<JsonArray>());
+    channelToArray(b.accelX, doc["accel_x"].to<JsonArray>());
+    channelToArray(b.accelY, doc["accel_y"].to<JsonArray>());
+
+    serializeJson(doc, level.file);
+    level.file.println();
+    // Commits the size, so /overview sees the bucket while the journey runs
+    level.file.flush();
+}
+
+
+void overviewBegin(const char* journeyPath) {
+    for (OverviewLevel& level : levels) {
+        bucketReset(level.bucket, 0);
+        if (level.file) level.file.close();
+        char path[48];
+        if (!journeySidecarPath(journeyPath, level.ext, path, sizeof(path))) continue;
+        level.file = SD.open(path, O_WRONLY | O_CREAT | O_AT_END);
+        if (!level.file) {
+            Serial.printf("Failed to open overview: %s\n", path);
+        }
+    }
+}
+
+
+void overviewUpdate(const TelemetrySample& sample, float elapsedSec) {
+    for (OverviewLevel& level : levels) {
+        OverviewBucket& b = level.bucket;
+        uint32_t index = (uint32_t)(elapsedSec / level.widthSec);
+
+        // Crossing a bucket boundary closes the previous bucket
+        if (b.count > 0 && index != b.index) {
+            bucketWrite(level);
+        }
+        if (b.count == 0 || index != b.index) {
+            bucketReset(b, index);
+            strncpy(b.time, sample.time, sizeof(b.time) - 1);
+            b.firstLat = sample.latitude;
+            b.firstLon = sample.longitude;
+        }
+
+        b.count++;
+        b.lastLat = sample.latitude;
+        b.lastLon = sample.longitude;
+        b.speed.add(sample.speed);
+        b.rpm.add(sample.rpm);
+        b.throttle.add(sample.throttle);
+        b.maf.add(sample.maf);
+        b.instantMPG.add(sample.instantMPG);
+        b.accelX.add(sample.accelX);
+        b.accelY.add(sample.accelY);
+    }
+}
+
+
+void overviewFinish() {
+    // Flush the partially filled buckets
+    for (OverviewLevel& level : levels) {
+        bucketWrite(level);
+        bucketReset(level.bucket, 0);
+        level.file.close();
+    }
+}
+
+
+const char* overviewLevelExt(int widthSec) {
+    for (const OverviewLevel& level : levels) {
+        if (level.widthSec == widthSec) return level.ext;
+    }
+    return nullptr;
+}
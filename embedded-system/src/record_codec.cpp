@@ -0,0 +1,378 @@
+#include "record_codec.hpp"
+#include <math.h>
+#include <string.h>
+
+// Nesting allowed when skipping or decoding a binary item
+#define RECORD_MAX_DEPTH 10
+
+static const char* const names[ENCODING_COUNT] = { "ndjson", "msgpack", "cbor" };
+static const char* const exts[ENCODING_COUNT] = { ".json", ".mpk", ".cbor" };
+static const char* const contentTypes[ENCODING_COUNT] = {
+    "application/json", "application/msgpack", "application/cbor"
+};
+
+
+const char* recordEncodingName(RecordEncoding encoding) {
+    return encoding < ENCODING_COUNT ? names[encoding] : names[ENCODING_NDJSON];
+}
+
+
+const char* recordEncodingExt(RecordEncoding encoding) {
+    return encoding < ENCODING_COUNT ? exts[encoding] : exts[ENCODING_NDJSON];
+}
+
+
+const char* recordEncodingContentType(RecordEncoding encoding) {
+    return encoding < ENCODING_COUNT ? contentTypes[encoding] : contentTypes[ENCODING_NDJSON];
+}
+
+
+bool recordEncodingParse(const char* name, RecordEncoding& encoding) {
+    for (uint8_t i = 0; i < ENCODING_COUNT; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            encoding = (RecordEncoding)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//-------------------------------------------------------------------------------
+// CBOR (RFC 8949) writer for the subset ArduinoJson values need
+//-------------------------------------------------------------------------------
+struct CborWriter {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok;
+
+    void byte(uint8_t b) {
+        if (p < end) *p++ = b; else ok = false;
+    }
+    void bigEndian(uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) byte((uint8_t)(v >> (8 * i)));
+    }
+    void head(uint8_t major, uint64_t arg) {
+        major <<= 5;
+        if (arg < 24) {
+            byte(major | arg);
+        } else if (arg <= 0xFF) {
+            byte(major | 24);
+            bigEndian(arg, 1);
+        } else if (arg <= 0xFFFF) {
+            byte(major | 25);
+            bigEndian(arg, 2);
+        } else if (arg <= 0xFFFFFFFF) {
+            byte(major | 26);
+            bigEndian(arg, 4);
+        } else {
+            byte(major | 27);
+            bigEndian(arg, 8);
+        }
+    }
+    void text(const char* s, size_t n) {
+        head(3, n);
+        if ((size_t)(end - p) < n) {
+            ok = false;
+            return;
+        }
+        memcpy(p, s, n);
+        p += n;
+    }
+};
+
+
+static void cborWrite(CborWriter& w, JsonVariantConst v) {
+    if (v.is<JsonObjectConst>()) {
+        JsonObjectConst obj = v.as<JsonObjectConst>();
+        w.head(5, obj.size());
+        for (JsonPairConst kv : obj) {
+            w.text(kv.key().c_str(), kv.key().size());
+            cborWrite(w, kv.value());
+        }
+    } else if (v.is<JsonArrayConst>()) {
+        JsonArrayConst arr = v.as<JsonArrayConst>();
+        w.head(4, arr.size());
+        for (JsonVariantConst item : arr) cborWrite(w, item);
+    } else if (v.is<const char*>()) {
+        JsonString s = v.as<JsonString>();
+        w.text(s.c_str(), s.size());
+    } else if (v.is<bool>()) {
+        w.byte(v.as<bool>() ? 0xF5 : 0xF4);
+    } else if (v.is<long>()) {
+        long i = v.as<long>();
+        if (i >= 0) w.head(0, (uint64_t)i); else w.head(1, (uint64_t)(-1 - i));
+    } else if (v.is<unsigned long>()) {
+        w.head(0, v.as<unsigned long>());
+    } else if (v.is<double>()) {
+        // Single precision when it loses nothing, as MessagePack does
+        double d = v.as<double>();
+        float f = (float)d;
+        if ((double)f == d) {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            w.byte(0xFA);
+            w.bigEndian(bits, 4);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            w.byte(0xFB);
+            w.bigEndian(bits, 8);
+        }
+    } else {
+        w.byte(0xF6);  // null
+    }
+}
+
+
+size_t recordSerialize(JsonVariantConst record, RecordEncoding encoding, uint8_t* out, size_t size) {
+    if (encoding == ENCODING_MSGPACK) {
+        size_t n = serializeMsgPack(record, out, size);
+        return n < size ? n : 0;
+    }
+    if (encoding == ENCODING_CBOR) {
+        CborWriter w = { out, out + size, true };
+        cborWrite(w, record);
+        return w.ok ? (size_t)(w.p - out) : 0;
+    }
+
+    // serializeJson() always leaves room for a terminator
+    size_t n = serializeJson(record, (char*)out, size);
+    if (n == 0 || n + 1 >= size) return 0;
+    out[n++] = '\n';
+    return n;
+}
+
+
+//-------------------------------------------------------------------------------
+// Item skipping: finds where one binary record ends without decoding it
+//-------------------------------------------------------------------------------
+static uint64_t bigEndianAt(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+
+// Reads a CBOR head; returns false if truncated or indefinite-length
+static bool cborHead(const uint8_t*& p, const uint8_t* end, uint8_t& major, uint8_t& info, uint64_t& arg) {
+    if (p >= end) return false;
+    major = *p >> 5;
+    info = *p & 0x1F;
+    p++;
+    if (info < 24) {
+        arg = info;
+        return true;
+    }
+    if (info > 27) return false;
+    int bytes = 1 << (info - 24);
+    if (end - p < bytes) return false;
+    arg = bigEndianAt(p, bytes);
+    p += bytes;
+    return true;
+}
+
+
+static const uint8_t* cborSkip(const uint8_t* p, const uint8_t* end, uint8_t depth) {
+    uint8_t major, info;
+    uint64_t arg;
+    if (depth > RECORD_MAX_DEPTH || !cborHead(p, end, major, info, arg)) return nullptr;
+    switch (major) {
+        case 2: case 3:     // Byte / text string
+            return arg <= (uint64_t)(end - p) ? p + arg : nullptr;
+        case 4: case 5: {   // Array / map
+            uint64_t items = major == 5 ? arg * 2 : arg;
+            for (uint64_t i = 0; i < items && p; i++) p = cborSkip(p, end, depth + 1);
+            return p;
+        }
+        case 6:             // Tag: one item follows
+            return cborSkip(p, end, depth + 1);
+        default:            // Integers, simple values, floats
+            return p;
+    }
+}
+
+
+static const uint8_t* msgpackSkip(const uint8_t* p, const uint8_t* end, uint8_t depth) {
+    if (depth > RECORD_MAX_DEPTH || p >= end) return nullptr;
+    uint8_t b = *p++;
+    uint64_t items = 0;     // Nested items that follow
+    uint64_t bytes = 0;     // Payload bytes that follow
+
+    if (b <= 0x7F || b >= 0xE0 || b == 0xC0 || b == 0xC2 || b == 0xC3) {
+        // Fixint, nil, bool
+    } else if (b <= 0x8F) {
+        items = (b & 0x0F) * 2;
+    } else if (b <= 0x9F) {
+        items = b & 0x0F;
+    } else if (b <= 0xBF) {
+        bytes = b & 0x1F;
+    } else {
+        // Sized types: width of the length/value field
+        static const struct { uint8_t type, lenBytes, fixed; char kind; } sized[] = {
+            { 0xC4, 1, 0, 'b' }, { 0xC5, 2, 0, 'b' }, { 0xC6, 4, 0, 'b' },
+            { 0xC7, 1, 1, 'b' }, { 0xC8, 2, 1, 'b' }, { 0xC9, 4, 1, 'b' },
+            { 0xCA, 0, 4, 'f' }, { 0xCB, 0, 8, 'f' },
+            { 0xCC, 0, 1, 'f' }, { 0xCD, 0, 2, 'f' }, { 0xCE, 0, 4, 'f' }, { 0xCF, 0, 8, 'f' },
+            { 0xD0, 0, 1, 'f' }, { 0xD1, 0, 2, 'f' }, { 0xD2, 0, 4, 'f' }, { 0xD3, 0, 8, 'f' },
+            { 0xD4, 0, 2, 'f' }, { 0xD5, 0, 3, 'f' }, { 0xD6, 0, 5, 'f' }, { 0xD7, 0, 9, 'f' },
+            { 0xD8, 0, 17, 'f' },
+            { 0xD9, 1, 0, 'b' }, { 0xDA, 2, 0, 'b' }, { 0xDB, 4, 0, 'b' },
+            { 0xDC, 2, 0, 'a' }, { 0xDD, 4, 0, 'a' }, { 0xDE, 2, 0, 'm' }, { 0xDF, 4, 0, 'm' },
+        };
+        bool known = false;
+        for (const auto& s : sized) {
+            if (s.type != b) continue;
+            known = true;
+            if (end - p < s.lenBytes) return nullptr;
+            uint64_t n = bigEndianAt(p, s.lenBytes);
+            p += s.lenBytes;
+            if (s.kind == 'a') items = n;
+            else if (s.kind == 'm') items = n * 2;
+            else bytes = (s.kind == 'b' ? n : 0) + s.fixed;    // ext adds its type byte
+            break;
+        }
+        if (!known) return nullptr;
+    }
+
+    if (bytes > (uint64_t)(end - p)) return nullptr;
+    p += bytes;
+    for (uint64_t i = 0; i < items && p; i++) p = msgpackSkip(p, end, depth + 1);
+    return p;
+}
+
+
+size_t recordItemLength(const uint8_t* in, size_t length, RecordEncoding encoding) {
+    const uint8_t* end = in + length;
+    const uint8_t* p = encoding == ENCODING_CBOR ? cborSkip(in, end, 0)
+                     : encoding == ENCODING_MSGPACK ? msgpackSkip(in, end, 0) : nullptr;
+    return p ? (size_t)(p - in) : 0;
+}
+
+
+//-------------------------------------------------------------------------------
+// CBOR reader into a JsonDocument, applying an ArduinoJson-style filter
+// (true keeps a whole subtree, an object keeps the keys it names)
+//-------------------------------------------------------------------------------
+static float halfToFloat(uint16_t h) {
+    int exp = (h >> 10) & 0x1F;
+    int mant = h & 0x3FF;
+    float v = exp == 0 ? ldexpf(mant, -24)
+            : exp == 31 ? (mant ? NAN : INFINITY)
+            : ldexpf(mant + 1024, exp - 25);
+    return (h & 0x8000) ? -v : v;
+}
+
+
+static DeserializationError::Code cborDecode(const uint8_t*& p, const uint8_t* end, JsonVariant out,
+                                             JsonVariantConst filter, uint8_t depth) {
+    // Filtered out: skip the whole item
+    if (!filter.is<JsonObjectConst>() && !filter.as<bool>()) {
+        p = cborSkip(p, end, depth);
+        return p ? DeserializationError::Ok : DeserializationError::IncompleteInput;
+    }
+    bool keepAll = !filter.is<JsonObjectConst>();
+
+    uint8_t major, info;
+    uint64_t arg;
+    if (depth > RECORD_MAX_DEPTH) return DeserializationError::TooDeep;
+    if (!cborHead(p, end, major, info, arg)) return DeserializationError::InvalidInput;
+    switch (major) {
+        case 0:
+            return out.set(arg) ? DeserializationError::Ok : DeserializationError::NoMemory;
+        case 1:
+            // -1 - arg must fit an int64_t (a 32-bit long would wrap)
+            if (arg > (uint64_t)INT64_MAX) return DeserializationError::InvalidInput;
+            return out.set(-1 - (int64_t)arg) ? DeserializationError::Ok : DeserializationError::NoMemory;
+        case 2:
+        case 3:
+            if (arg > (uint64_t)(end - p)) return DeserializationError::IncompleteInput;
+            if (!out.set(JsonString((const char*)p, (size_t)arg))) return DeserializationError::NoMemory;
+            p += arg;
+            return DeserializationError::Ok;
+        case 4: {
+            JsonArray arr = out.to<JsonArray>();
+            for (uint64_t i = 0; i < arg; i++) {
+                JsonVariant item = arr.add<JsonVariant>();
+                DeserializationError::Code err = cborDecode(p, end, item, keepAll ? filter : filter["*"],
+                                                            depth + 1);
+                if (err) return err;
+            }
+            return DeserializationError::Ok;
+        }
+        case 5: {
+            JsonObject obj = out.to<JsonObject>();
+            for (uint64_t i = 0; i < arg; i++) {
+                uint8_t keyMajor, keyInfo;
+                uint64_t keyLen;
+                if (!cborHead(p, end, keyMajor, keyInfo, keyLen) || keyMajor != 3) {
+                    return DeserializationError::InvalidInput;
+                }
+                if (keyLen > (uint64_t)(end - p)) return DeserializationError::IncompleteInput;
+                JsonString key((const char*)p, (size_t)keyLen);
+                p += keyLen;
+
+                JsonVariantConst child = keepAll ? filter : filter[key];
+                if (!child.is<JsonObjectConst>() && !child.as<bool>()) {
+                    p = cborSkip(p, end, depth + 1);
+                    if (!p) return DeserializationError::IncompleteInput;
+                    continue;
+                }
+                DeserializationError::Code err = cborDecode(p, end, obj[key].to<JsonVariant>(), child, depth + 1);
+                if (err) return err;
+            }
+            return DeserializationError::Ok;
+        }
+        case 6:
+            return cborDecode(p, end, out, filter, depth + 1);    // Tags are ignored
+        default: {
+            bool ok;
+            if (info == 20 || info == 21) {
+                ok = out.set(info == 21);
+            } else if (info == 22 || info == 23) {
+                out.clear();
+                ok = true;
+            } else if (info == 25) {
+                ok = out.set(halfToFloat((uint16_t)arg));
+            } else if (info == 26) {
+                uint32_t bits = (uint32_t)arg;
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                ok = out.set(f);
+            } else if (info == 27) {
+                double d;
+                memcpy(&d, &arg, sizeof(d));
+                ok = out.set(d);
+            } else {
+                return DeserializationError::InvalidInput;
+            }
+            return ok ? DeserializationError::Ok : DeserializationError::NoMemory;
+        }
+    }
+}
+
+
+DeserializationError recordDeserialize(JsonDocument& doc, const char* in, size_t length,
+                                       RecordEncoding encoding, JsonVariantConst filter) {
+    if (encoding == ENCODING_MSGPACK) {
+        return deserializeMsgPack(doc, in, length, DeserializationOption::Filter(filter));
+    }
+    if (encoding == ENCODING_CBOR) {
+        doc.clear();
+        const uint8_t* p = (const uint8_t*)in;
+        return cborDecode(p, p + length, doc.to<JsonVariant>(), filter, 0);
+    }
+    return deserializeJson(doc, in, length, DeserializationOption::Filter(filter));
+}
+
+
+DeserializationError recordDeserialize(JsonDocument& doc, const char* in, size_t length,
+                                       RecordEncoding encoding) {
+    if (encoding == ENCODING_MSGPACK) return deserializeMsgPack(doc, in, length);
+    if (encoding == ENCODING_CBOR) {
+        JsonDocument all;
+        all.set(true);
+        return recordDeserialize(doc, in, length, encoding, all.as<JsonVariantConst>());
+    }
+    return deserializeJson(doc, in, length);
+}
@@ -0,0 +1,75 @@
+#include "record_query.hpp"
+#include "journey.hpp"
+
+
+bool recordFieldFilter(const String& fields, JsonDocument& filter) {
+    filter["gps"]["time"] = true;
+    if (fields.isEmpty()) {
+        filter.clear();
+        filter.set(true);  // Keep everything
+        return true;
+    }
+
+    int start = 0;
+    while (start <= (int)fields.length()) {
+        int comma = fields.indexOf(',', start);
+        if (comma < 0) comma = fields.length();
+        String field = fields.substring(start, comma);
+        field.trim();
+        start = comma + 1;
+        if (field.isEmpty()) continue;
+
+        int dot = field.indexOf('.');
+        String group = dot < 0 ? field : field.substring(0, dot);
+        String channel = dot < 0 ? String() : field.substring(dot + 1);
+        if (group.isEmpty() || channel.indexOf('.') >= 0) return false;
+        if (channel.isEmpty()) {
+            filter[group] = true;
+        } else if (!filter[group].is<bool>()) {
+            filter[group][channel] = true;
+        }
+    }
+    return true;
+}
+
+
+static bool isClockTime(const char* time) {
+    return strlen(time) == 8 && time[2] == ':' && time[5] == ':';
+}
+
+
+bool RecordWindow::begin(const char* from, const char* to) {
+    if ((from[0] && !isClockTime(from)) || (to[0] && !isClockTime(to))) return false;
+    strcpy(m_from, from);
+    strcpy(m_to, to);
+    m_last[0] = '\0';
+    m_elapsed = 0;
+    m_fromElapsed = 0;
+    m_toElapsed = LONG_MAX;
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Signed seconds from `start` to `time` on the clock, within 12 h either way
+//-------------------------------------------------------------------------------
+static long clockOffset(const char* start, const char* time) {
+    long delta = journeyTimeDelta(start, time);
+    return delta > 43200 ? delta - 86400 : delta;
+}
+
+
+int RecordWindow::check(const char* time) {
+    if (isClockTime(time)) {
+        if (!m_last[0]) {
+            // The first record anchors the bounds
+            if (m_from[0]) m_fromElapsed = clockOffset(time, m_from);
+            if (m_to[0]) m_toElapsed = clockOffset(time, m_to);
+        } else {
+            m_elapsed += journeyTimeDelta(m_last, time);
+        }
+        strcpy(m_last, time);
+    }
+    if (m_elapsed > m_toElapsed) return 1;
+    return m_elapsed < m_fromElapsed ? -1 : 0;
+}
@@ -0,0 +1,91 @@
+#include "record_reader.hpp"
+#include "segment.hpp"
+
+
+RecordReader::RecordReader(FsFile& file) : m_file(&file) {
+    m_bufOffset = file.curPosition();
+}
+
+
+RecordReader::RecordReader(JourneyFile& journey) : m_journey(&journey) {
+    m_bufOffset = journey.curPosition();
+    m_encoding = journey.encoding();
+}
+
+
+bool RecordReader::fill() {
+    m_bufOffset += m_len;
+    int n = m_file ? m_file->read(m_buf, sizeof(m_buf)) : m_journey->read(m_buf, sizeof(m_buf));
+    m_pos = 0;
+    m_len = n > 0 ? n : 0;
+    return m_len > 0;
+}
+
+
+//-------------------------------------------------------------------------------
+// Binary records have no delimiter: keep at least a whole record's worth of
+// bytes buffered and measure the item at the front
+//-------------------------------------------------------------------------------
+const char* RecordReader::nextItem(size_t& length) {
+    if (m_len - m_pos < RECORD_MAX_LEN) {
+        memmove(m_buf, m_buf + m_pos, m_len - m_pos);
+        m_bufOffset += m_pos;
+        m_len -= m_pos;
+        m_pos = 0;
+        while (m_len < sizeof(m_buf)) {
+            int n = m_file ? m_file->read(m_buf + m_len, sizeof(m_buf) - m_len)
+                           : m_journey->read(m_buf + m_len, sizeof(m_buf) - m_len);
+            if (n <= 0) break;
+            m_len += n;
+        }
+    }
+
+    // A torn tail or an item longer than RECORD_MAX_LEN ends the stream:
+    // without a delimiter there is no way to resynchronise
+    size_t n = recordItemLength(m_buf + m_pos, m_len - m_pos, m_encoding);
+    if (n == 0 || n > RECORD_MAX_LEN) return nullptr;
+
+    m_recordOffset = m_bufOffset + m_pos;
+    memcpy(m_line, m_buf + m_pos, n);
+    m_pos += n;
+    length = n;
+    return m_line;
+}
+
+
+const char* RecordReader::next(size_t& length) {
+    if (m_encoding != ENCODING_NDJSON) return nextItem(length);
+
+    size_t used = 0;
+    bool overflow = false;
+
+    for (;;) {
+        if (m_pos >= m_len && !fill()) {
+            // EOF: return a trailing record without a newline
+            if (used > 0 && !overflow) break;
+            return nullptr;
+        }
+        if (used == 0 && !overflow) {
+            m_recordOffset = m_bufOffset + m_pos;
+        }
+
+        char c = m_buf[m_pos++];
+        if (c == '\n') {
+            if (used > 0 && !overflow) break;
+            // Empty or overlong line: start over with the next one
+            used = 0;
+            overflow = false;
+            continue;
+        }
+        if (c == '\r') continue;
+        if (used < RECORD_MAX_LEN) {
+            m_line[used++] = c;
+        } else {
+            overflow = true;
+        }
+    }
+
+    m_line[used] = '\0';
+    length = used;
+    return m_line;
+}
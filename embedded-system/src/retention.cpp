@@ -0,0 +1,238 @@
+#include "retention.hpp"
+#include "storage.hpp"
+#include "journey.hpp"
+#include "catalog.hpp"
+#include "delete_job.hpp"
+#include "segment.hpp"
+#include "sd_mutex.hpp"
+#include <ArduinoJson.h>
+
+// External SD filesystem instance and mutex
+extern SdFat SD;
+extern SemaphoreHandle_t sdMutex;
+
+#define MB(x) ((uint64_t)(x) * 1024 * 1024)
+
+static RetentionStatus retention;
+
+// Days up to and including this one had nothing evictable in the current pass
+static char dayCursor[11];
+
+
+//-------------------------------------------------------------------------------
+// "YYYY-MM-DD" -> days since 1970-01-01, or -1 if the name is not a date
+//-------------------------------------------------------------------------------
+static int32_t dayNumber(const char* name) {
+    int y, m, d;
+    if (strlen(name) != 10 || sscanf(name, "%4d-%2d-%2d", &y, &m, &d) != 3) return -1;
+    // Days-from-civil (proleptic Gregorian)
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    int32_t yoe = y - era * 400;
+    int32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+
+//-------------------------------------------------------------------------------
+// Finds the oldest day folder after `after` ("" for the first), and the newest
+// day on the card. Days queued for deletion are ignored.
+//-------------------------------------------------------------------------------
+static bool findDay(const char* after, char* oldest, char* newest) {
+    FsFile root = SD.open("/");
+    if (!root) return false;
+    oldest[0] = '\0';
+    newest[0] = '\0';
+
+    char name[16];
+    char path[sizeof(name) + 1];
+    FsFile entry;
+    while ((entry = root.openNextFile())) {
+        bool isDir = entry.isDir();
+        entry.getName(name, sizeof(name));
+        entry.close();
+        if (!isDir || dayNumber(name) < 0) continue;
+        snprintf(path, sizeof(path), "/%s", name);
+        if (deleteJobPending(path)) continue;
+
+        if (strcmp(name, newest) > 0) strcpy(newest, name);
+        if (strcmp(name, after) > 0 && (!oldest[0] || strcmp(name, oldest) < 0)) {
+            strcpy(oldest, name);
+        }
+    }
+    root.close();
+    return oldest[0] != '\0';
+}
+
+
+//-------------------------------------------------------------------------------
+// True once the client has acknowledged the journey's catalog generation
+//-------------------------------------------------------------------------------
+static bool journeySynced(const char* journeyPath) {
+    char path[48];
+    if (!journeySidecarPath(journeyPath, SUMMARY_EXT, path, sizeof(path))) return false;
+    FsFile file = SD.open(path, O_READ);
+    if (!file) return false;    // No summary: never closed cleanly, never synced
+
+    JsonDocument filter;
+    filter["gen"] = true;
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, file, DeserializationOption::Filter(filter));
+    file.close();
+    uint32_t gen = doc["gen"] | 0;
+    return !err && gen > 0 && gen <= catalogSyncedGeneration();
+}
+
+
+static bool journeyStarred(const char* journeyPath) {
+    char path[48];
+    return journeySidecarPath(journeyPath, STAR_EXT, path, sizeof(path)) && SD.exists(path);
+}
+
+
+//-------------------------------------------------------------------------------
+// Oldest evictable journey in a day folder; fills `path` with "/day/drive.json"
+//-------------------------------------------------------------------------------
+static bool findEvictable(const char* day, char* path, size_t size) {
+    char dirPath[16];
+    snprintf(dirPath, sizeof(dirPath), "/%s", day);
+    FsFile dir = SD.open(dirPath);
+    if (!dir) return false;
+
+    char best[32] = "";
+    char name[32];
+    char candidate[48];
+    FsFile entry;
+    while ((entry = dir.openNextFile())) {
+        bool isDir = entry.isDir();
+        entry.getName(name, sizeof(name));
+        entry.close();
+        if (name[0] == '.') continue;
+        if (isDir) {
+            // Segment directory "HH-MM-SS", unless already being deleted
+            if (strlen(name) != 8 || name[2] != '-' || name[5] != '-') continue;
+            snprintf(candidate, sizeof(candidate), "%s/%s", dirPath, name);
+            if (deleteJobPending(candidate)) continue;
+            strcat(name, ".json");
+        } else {
+            const char* ext = strrchr(name, '.');
+            if (!ext || strcmp(ext, ".json")) continue;
+        }
+        if (best[0] && strcmp(name, best) >= 0) continue;
+
+        snprintf(candidate, sizeof(candidate), "%s/%s", dirPath, name);
+        if (RETAIN_KEEP_STARRED && journeyStarred(candidate)) continue;
+        if (!journeySynced(candidate)) continue;
+        strcpy(best, name);
+    }
+    dir.close();
+
+    if (!best[0]) return false;
+    snprintf(path, size, "%s/%s", dirPath, best);
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Removes a journey, its sidecars and the day folder once it is empty
+//-------------------------------------------------------------------------------
+static bool evict(const char* path) {
+    JourneyFile file;
+    uint64_t size = file.open(path) ? file.size() : 0;
+    file.close();
+
+    // Segment directories are handed to the background delete job
+    if (!deleteJourney(path)) {
+        Serial.printf("Retention: failed to remove %s\n", path);
+        return false;
+    }
+    retention.evicted++;
+    retention.evictedBytes += size;
+    strncpy(retention.lastEvicted, path + 1, sizeof(retention.lastEvicted) - 1);
+    Serial.printf("Retention: evicted %s (%lu bytes)\n", path, (unsigned long)size);
+
+    char dirPath[16];
+    const char* slash = strrchr(path, '/');
+    size_t len = slash - path;
+    if (len < sizeof(dirPath)) {
+        memcpy(dirPath, path, len);
+        dirPath[len] = '\0';
+        FsFile dir = SD.open(dirPath);
+        FsFile entry = dir ? dir.openNextFile() : FsFile();
+        bool empty = dir && !entry;
+        entry.close();
+        dir.close();
+        if (empty) SD.rmdir(dirPath);
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// One bounded step: looks at a single day folder and evicts at most one
+// journey. Returns false when the pass has run out of candidates.
+//-------------------------------------------------------------------------------
+static bool evictStep(bool spaceWanted) {
+    char day[11], newest[11];
+    if (!findDay(dayCursor, day, newest)) return false;
+
+    // Age-only eviction stops at the first day inside the retention window
+    if (!spaceWanted && dayNumber(day) > dayNumber(newest) - RETAIN_MAX_AGE_DAYS) {
+        return false;
+    }
+
+    char path[48];
+    if (findEvictable(day, path, sizeof(path))) {
+        return evict(path);
+    }
+    strcpy(dayCursor, day);     // Nothing here, try the next day
+    return true;
+}
+
+
+void retentionService() {
+    static unsigned long nextRun = 0;
+    if ((long)(millis() - nextRun) < 0) return;
+    if (sdMutexTake(0) != pdTRUE) return;
+
+    uint64_t total, free;
+    if (!storageSpace(total, free)) {
+        // Free count not known yet
+        sdMutexGive();
+        nextRun = millis() + RETAIN_IDLE_INTERVAL;
+        return;
+    }
+    uint64_t used = total - free;
+
+    // Hysteresis: once evicting, continue until the target is reached
+    uint64_t lowMark = retention.evicting ? MB(RETAIN_TARGET_FREE_MB) : MB(RETAIN_LOW_FREE_MB);
+    bool spaceWanted = free < lowMark ||
+                       (RETAIN_MAX_USED_MB > 0 && used > MB(RETAIN_MAX_USED_MB));
+    if (!spaceWanted) retention.blocked = false;
+    retention.evicting = spaceWanted;
+
+    unsigned long interval = RETAIN_IDLE_INTERVAL;
+    if (spaceWanted || RETAIN_MAX_AGE_DAYS > 0) {
+        if (evictStep(spaceWanted)) {
+            interval = RETAIN_STEP_INTERVAL;
+        } else {
+            // Pass finished: start again from the oldest day after a pause
+            dayCursor[0] = '\0';
+            interval = RETAIN_BLOCKED_INTERVAL;
+            if (spaceWanted && !retention.blocked) {
+                Serial.println("Retention: card nearly full and no synced journeys to evict.");
+            }
+            retention.blocked = spaceWanted;
+        }
+    } else {
+        dayCursor[0] = '\0';
+    }
+    sdMutexGive();
+    nextRun = millis() + interval;
+}
+
+
+const RetentionStatus& retentionStatus() {
+    return retention;
+}
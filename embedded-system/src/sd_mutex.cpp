@@ -0,0 +1,32 @@
+#include "sd_mutex.hpp"
+#include "metrics.hpp"
+
+// Owner of the current hold; only the holder writes these
+static const char* holder = nullptr;
+static unsigned long heldSince = 0;
+
+
+BaseType_t sdMutexTake(TickType_t timeout) {
+    const char* task = pcTaskGetName(NULL);
+    unsigned long start = micros();
+    BaseType_t taken = xSemaphoreTake(sdMutex, timeout);
+    unsigned long now = micros();
+    if (taken != pdTRUE) {
+        // A zero timeout is a try (background work that comes back later)
+        if (timeout > 0) metricsCounter("sd_mutex_timeouts_total", "task", task)->add();
+        return taken;
+    }
+    metricsHistogram("sd_mutex_wait_us", "task", task)->record(now - start);
+    holder = task;
+    heldSince = now;
+    return taken;
+}
+
+
+void sdMutexGive() {
+    const char* task = holder;
+    unsigned long held = micros() - heldSince;
+    holder = nullptr;
+    xSemaphoreGive(sdMutex);
+    if (task) metricsHistogram("sd_mutex_hold_us", "task", task)->record(held);
+}
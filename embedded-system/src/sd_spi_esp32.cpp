@@ -0,0 +1,171 @@
+#include "sd_spi_esp32.hpp"
+
+#if SPI_DRIVER_SELECT == 3
+#include <esp_heap_caps.h>
+#include "trace.hpp"
+
+SdSpiEsp32 sdSpi;
+
+
+//-------------------------------------------------------------------------------
+// Initialises the SPI bus once; SdFat calls begin() on every mount
+//-------------------------------------------------------------------------------
+void SdSpiEsp32::begin(SdSpiConfig config) {
+    (void)config;
+    if (m_busReady) return;
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = MOSI;
+    bus.miso_io_num = MISO;
+    bus.sclk_io_num = SCK;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = SD_SPI_CHUNK;
+
+    esp_err_t err = spi_bus_initialize(SD_SPI_HOST, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        Serial.printf("SD SPI bus init failed: %d\n", err);
+        return;
+    }
+    if (!m_ones) {
+        m_ones = (uint8_t*)heap_caps_malloc(SD_SPI_CHUNK, MALLOC_CAP_DMA);
+        if (!m_ones) {
+            Serial.println("SD SPI: no DMA memory");
+            return;
+        }
+        memset(m_ones, 0xFF, SD_SPI_CHUNK);
+    }
+    m_busReady = true;
+}
+
+
+void SdSpiEsp32::end() {
+    if (m_device) {
+        spi_bus_remove_device(m_device);
+        m_device = nullptr;
+        m_deviceHz = 0;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// (Re)adds the card at the requested clock. Chip select stays with SdFat,
+// which drives it as a plain GPIO around each command.
+//-------------------------------------------------------------------------------
+bool SdSpiEsp32::attach() {
+    if (m_device && m_deviceHz == m_clockHz) return true;
+    end();
+
+    spi_device_interface_config_t dev = {};
+    dev.mode = 0;
+    dev.clock_speed_hz = m_clockHz;
+    dev.spics_io_num = -1;
+    dev.queue_size = SD_SPI_QUEUE;
+
+    if (spi_bus_add_device(SD_SPI_HOST, &dev, &m_device) != ESP_OK) {
+        m_device = nullptr;
+        return false;
+    }
+    m_deviceHz = m_clockHz;
+    return true;
+}
+
+
+void SdSpiEsp32::activate() {
+    if (m_busReady && attach()) {
+        spi_device_acquire_bus(m_device, portMAX_DELAY);
+    }
+}
+
+
+void SdSpiEsp32::deactivate() {
+    if (m_device) {
+        spi_device_release_bus(m_device);
+    }
+}
+
+
+uint8_t SdSpiEsp32::receive() {
+    if (!m_device) return 0xFF;
+    spi_transaction_t t = {};
+    t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    t.length = 8;
+    t.tx_data[0] = 0xFF;
+    spi_device_polling_transmit(m_device, &t);
+    return t.rx_data[0];
+}
+
+
+uint8_t SdSpiEsp32::receive(uint8_t* buf, size_t count) {
+    return transfer(nullptr, buf, count);
+}
+
+
+void SdSpiEsp32::send(uint8_t data) {
+    if (!m_device) return;
+    spi_transaction_t t = {};
+    t.flags = SPI_TRANS_USE_TXDATA;
+    t.length = 8;
+    t.tx_data[0] = data;
+    spi_device_polling_transmit(m_device, &t);
+}
+
+
+void SdSpiEsp32::send(const uint8_t* buf, size_t count) {
+    TRACE_SCOPE("sd.send");     // Data blocks; commands go byte by byte
+    transfer(buf, nullptr, count);
+}
+
+
+//-------------------------------------------------------------------------------
+// Full-duplex transfer of count bytes. A null tx clocks out 0xFF, which the
+// card needs while it sends data. Short transfers are polled; longer ones are
+// split into DMA chunks with up to SD_SPI_QUEUE queued at a time.
+// Returns zero on success.
+//-------------------------------------------------------------------------------
+uint8_t SdSpiEsp32::transfer(const uint8_t* tx, uint8_t* rx, size_t count) {
+    if (!m_device) return 1;
+
+    if (count < SD_SPI_DMA_MIN) {
+        spi_transaction_t t = {};
+        t.length = count * 8;
+        t.tx_buffer = tx ? tx : m_ones;
+        t.rx_buffer = rx;
+        return spi_device_polling_transmit(m_device, &t) == ESP_OK ? 0 : 1;
+    }
+
+    spi_transaction_t trans[SD_SPI_QUEUE];
+    size_t queued = 0;      // Transactions in flight
+    size_t next = 0;        // Slot for the next transaction
+    size_t offset = 0;
+    uint8_t status = 0;
+
+    while (offset < count || queued > 0) {
+        // Keep the queue full while there is data left
+        if (offset < count && queued < SD_SPI_QUEUE) {
+            size_t n = min(count - offset, (size_t)SD_SPI_CHUNK);
+            spi_transaction_t& t = trans[next];
+            memset(&t, 0, sizeof(t));
+            t.length = n * 8;
+            t.tx_buffer = tx ? tx + offset : m_ones;
+            t.rx_buffer = rx ? rx + offset : nullptr;
+            if (spi_device_queue_trans(m_device, &t, portMAX_DELAY) != ESP_OK) {
+                status = 1;
+                offset = count;     // Stop queuing, drain what is in flight
+                continue;
+            }
+            offset += n;
+            next = (next + 1) % SD_SPI_QUEUE;
+            queued++;
+            continue;
+        }
+
+        spi_transaction_t* done;
+        if (spi_device_get_trans_result(m_device, &done, portMAX_DELAY) != ESP_OK) {
+            return 1;
+        }
+        queued--;
+    }
+    return status;
+}
+#endif  // SPI_DRIVER_SELECT == 3
@@ -0,0 +1,164 @@
+#include "sd_tune.hpp"
+#include "sd_spi_esp32.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+SdTuneResult sdTune;
+
+// Candidate clocks, slowest first
+static const uint32_t probeSteps[] = {
+    SD_SCK_MHZ(4), SD_SCK_MHZ(10), SD_SCK_MHZ(20), SD_SCK_MHZ(40)
+};
+static const int probeStepCount = sizeof(probeSteps) / sizeof(probeSteps[0]);
+
+// Sectors written per multi-sector transfer
+#define PROBE_CHUNK_SECTORS 8
+
+
+//-------------------------------------------------------------------------------
+// Card configuration at a given clock: the DMA driver when it is selected
+// (SPI_DRIVER_SELECT=3), otherwise SdFat's generic SPI library driver
+//-------------------------------------------------------------------------------
+static SdSpiConfig sdConfig(SdCsPin_t csPin, uint32_t clockHz) {
+#if SPI_DRIVER_SELECT == 3
+    return SdSpiConfig(csPin, DEDICATED_SPI, clockHz, &sdSpi);
+#else
+    return SdSpiConfig(csPin, DEDICATED_SPI, clockHz);
+#endif
+}
+
+
+//-------------------------------------------------------------------------------
+// Fills a buffer with a pattern unique to the round and sector
+//-------------------------------------------------------------------------------
+static void fillPattern(uint8_t* buf, size_t sectors, uint32_t seed) {
+    uint32_t x = seed * 2654435761u + 1;
+    uint32_t* words = (uint32_t*)buf;
+    for (size_t i = 0; i < sectors * 512 / 4; i++) {
+        // xorshift32
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        words[i] = x;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// Writes, reads back and compares the scratch range once.
+// Adds the time spent writing and reading to the totals (microseconds).
+//-------------------------------------------------------------------------------
+static bool probeRound(uint32_t firstSector, uint32_t round, uint8_t* buf, uint8_t* expect,
+                       uint32_t& writeUs, uint32_t& readUs) {
+    SdCard* card = SD.card();
+    for (uint32_t s = 0; s < SD_PROBE_SECTORS; s += PROBE_CHUNK_SECTORS) {
+        fillPattern(expect, PROBE_CHUNK_SECTORS, (round << 16) ^ s);
+
+        uint32_t t0 = micros();
+        if (!card->writeSectors(firstSector + s, expect, PROBE_CHUNK_SECTORS) || !card->syncDevice()) {
+            return false;
+        }
+        uint32_t t1 = micros();
+        if (!card->readSectors(firstSector + s, buf, PROBE_CHUNK_SECTORS)) {
+            return false;
+        }
+        uint32_t t2 = micros();
+        writeUs += t1 - t0;
+        readUs += t2 - t1;
+
+        if (memcmp(buf, expect, PROBE_CHUNK_SECTORS * 512) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// Runs every round at one clock; fills throughput when all of them pass
+//-------------------------------------------------------------------------------
+static bool probeClock(SdCsPin_t csPin, uint32_t clockHz, uint32_t firstSector,
+                       uint8_t* buf, uint8_t* expect, float& readMBps, float& writeMBps) {
+    if (!SD.begin(sdConfig(csPin, clockHz))) return false;
+
+    uint32_t writeUs = 0, readUs = 0;
+    for (uint32_t round = 0; round < SD_PROBE_ROUNDS; round++) {
+        if (!probeRound(firstSector, round, buf, expect, writeUs, readUs)) {
+            return false;
+        }
+    }
+    float bytes = (float)SD_PROBE_ROUNDS * SD_PROBE_SECTORS * 512;
+    writeMBps = writeUs ? bytes / writeUs : 0;  // bytes/us == MB/s
+    readMBps = readUs ? bytes / readUs : 0;
+    return true;
+}
+
+
+bool sdAutoTune(SdCsPin_t csPin) {
+    memset(&sdTune, 0, sizeof(sdTune));
+
+    // Mount at the safe clock and make sure the scratch range exists
+    if (!SD.begin(sdConfig(csPin, SD_SAFE_SCK))) return false;
+    sdTune.mounted = true;
+    sdTune.clockHz = SD_SAFE_SCK;
+
+    uint32_t firstSector = 0, lastSector = 0;
+    FsFile scratch = SD.open(SD_PROBE_PATH, O_RDWR | O_CREAT);
+    bool ready = scratch &&
+                 (scratch.fileSize() >= (uint64_t)SD_PROBE_SECTORS * 512 ||
+                  scratch.preAllocate((uint64_t)SD_PROBE_SECTORS * 512)) &&
+                 scratch.contiguousRange(&firstSector, &lastSector) &&
+                 lastSector - firstSector + 1 >= SD_PROBE_SECTORS;
+    scratch.close();
+
+    uint8_t* buf = (uint8_t*)malloc(PROBE_CHUNK_SECTORS * 512);
+    uint8_t* expect = (uint8_t*)malloc(PROBE_CHUNK_SECTORS * 512);
+    if (!ready || !buf || !expect) {
+        Serial.println("SD probe unavailable, keeping safe clock.");
+        free(buf);
+        free(expect);
+        return true;
+    }
+
+    // Step the clock up until a step fails
+    int best = -1;
+    float readMBps = 0, writeMBps = 0;
+    for (int i = 0; i < probeStepCount; i++) {
+        float r, w;
+        bool ok = probeClock(csPin, probeSteps[i], firstSector, buf, expect, r, w);
+        Serial.printf("SD probe %lu Hz: %s\n", (unsigned long)probeSteps[i], ok ? "pass" : "fail");
+        if (!ok) break;
+        best = i;
+        readMBps = r;
+        writeMBps = w;
+    }
+
+    // Safety margin: a short probe passing at a clock, even the top one, does
+    // not show the card holds it over a drive's heat and vibration, so run one
+    // step below the fastest pass
+    int chosen = best > 0 ? best - 1 : best;
+    if (best >= 0) sdTune.maxPassHz = probeSteps[best];
+    uint32_t clockHz = chosen >= 0 ? probeSteps[chosen] : SD_SAFE_SCK;
+
+    if (chosen != best && chosen >= 0 &&
+        !probeClock(csPin, clockHz, firstSector, buf, expect, readMBps, writeMBps)) {
+        clockHz = SD_SAFE_SCK;
+        readMBps = writeMBps = 0;
+    }
+    free(buf);
+    free(expect);
+
+    // Remount at the chosen clock
+    if (!SD.begin(sdConfig(csPin, clockHz))) {
+        clockHz = SD_SAFE_SCK;
+        readMBps = writeMBps = 0;
+        sdTune.mounted = SD.begin(sdConfig(csPin, clockHz));
+    }
+    sdTune.clockHz = clockHz;
+    sdTune.readMBps = readMBps;
+    sdTune.writeMBps = writeMBps;
+    Serial.printf("SD clock %lu Hz, read %.2f MB/s, write %.2f MB/s\n",
+                  (unsigned long)clockHz, readMBps, writeMBps);
+    return sdTune.mounted;
+}
@@ -0,0 +1,181 @@
+#include "segment.hpp"
+#include "journey.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+
+bool segmentDirPath(const char* journeyPath, char* out, size_t size) {
+    return journeySidecarPath(journeyPath, "", out, size);
+}
+
+
+bool segmentPath(const char* journeyPath, uint16_t index, RecordEncoding encoding, char* out, size_t size) {
+    char dir[48];
+    if (!segmentDirPath(journeyPath, dir, sizeof(dir))) return false;
+    return snprintf(out, size, "%s/%03u%s", dir, (unsigned)index, recordEncodingExt(encoding)) < (int)size;
+}
+
+
+bool segmentIsSegmented(const char* journeyPath) {
+    char dir[48];
+    if (!segmentDirPath(journeyPath, dir, sizeof(dir))) return false;
+    FsFile f = SD.open(dir, O_READ);
+    bool isDir = f && f.isDir();
+    f.close();
+    return isDir;
+}
+
+
+bool segmentJourneyExists(const char* journeyPath) {
+    return SD.exists(journeyPath) || segmentIsSegmented(journeyPath);
+}
+
+
+RecordEncoding segmentEncoding(const char* journeyPath) {
+    char path[48];
+    for (uint8_t i = 0; i < ENCODING_COUNT; i++) {
+        if (segmentPath(journeyPath, 0, (RecordEncoding)i, path, sizeof(path)) && SD.exists(path)) {
+            return (RecordEncoding)i;
+        }
+    }
+    return ENCODING_NDJSON;
+}
+
+
+bool segmentOpen(const char* journeyPath, uint16_t index, RecordEncoding encoding, FsFile& file) {
+    char path[48];
+    if (index > SEGMENT_MAX || !segmentDirPath(journeyPath, path, sizeof(path))) return false;
+    if (!SD.exists(path) && !SD.mkdir(path)) return false;
+    if (!segmentPath(journeyPath, index, encoding, path, sizeof(path))) return false;
+    file = SD.open(path, O_RDWR | O_CREAT | O_AT_END);
+    return file;
+}
+
+
+static bool manifestAppend(const char* journeyPath, uint16_t index, uint32_t bytes) {
+    char path[48];
+    if (!journeySidecarPath(journeyPath, SEGMENT_MANIFEST_EXT, path, sizeof(path))) return false;
+    FsFile manifest = SD.open(path, O_WRONLY | O_CREAT | O_AT_END);
+    if (!manifest) return false;
+    manifest.printf("{\"seg\":%u,\"bytes\":%lu}\n", (unsigned)index, (unsigned long)bytes);
+    manifest.close();
+    return true;
+}
+
+
+bool segmentClose(const char* journeyPath, uint16_t index, FsFile& file) {
+    uint32_t bytes = file.fileSize();
+    file.close();
+    return manifestAppend(journeyPath, index, bytes);
+}
+
+
+bool segmentManifestRebuild(const char* journeyPath) {
+    char path[48];
+    if (!journeySidecarPath(journeyPath, SEGMENT_MANIFEST_EXT, path, sizeof(path))) return false;
+    if (SD.exists(path)) SD.remove(path);
+
+    RecordEncoding encoding = segmentEncoding(journeyPath);
+    for (uint16_t i = 0; i <= SEGMENT_MAX; i++) {
+        if (!segmentPath(journeyPath, i, encoding, path, sizeof(path))) return false;
+        FsFile seg = SD.open(path, O_READ);
+        if (!seg) break;
+        uint32_t bytes = seg.fileSize();
+        seg.close();
+        if (!manifestAppend(journeyPath, i, bytes)) return false;
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------
+// JourneyFile
+//-------------------------------------------------------------------------------
+bool JourneyFile::open(const char* journeyPath) {
+    close();
+    strncpy(m_journey, journeyPath, sizeof(m_journey) - 1);
+    m_journey[sizeof(m_journey) - 1] = '\0';
+
+    // Journeys recorded before segmenting are a single file
+    m_file = SD.open(m_journey, O_READ);
+    if (m_file && !m_file.isDir()) {
+        m_segmented = false;
+        m_encoding = ENCODING_NDJSON;
+        m_segments = 1;
+        m_size = m_file.fileSize();
+        m_isOpen = true;
+        return true;
+    }
+    m_file.close();
+
+    // Segmented: total size is the sum of the segment files
+    char path[48];
+    m_size = 0;
+    m_encoding = segmentEncoding(m_journey);
+    for (m_segments = 0; m_segments <= SEGMENT_MAX; m_segments++) {
+        if (!segmentPath(m_journey, m_segments, m_encoding, path, sizeof(path))) break;
+        FsFile seg = SD.open(path, O_READ);
+        if (!seg) break;
+        m_size += seg.fileSize();
+        seg.close();
+    }
+    if (m_segments == 0) return false;
+
+    m_segmented = true;
+    m_isOpen = openSegment(0);
+    m_segmentStart = 0;
+    return m_isOpen;
+}
+
+
+void JourneyFile::close() {
+    m_file.close();
+    m_isOpen = false;
+    m_segments = 0;
+    m_segment = 0;
+    m_segmentStart = 0;
+    m_size = 0;
+}
+
+
+bool JourneyFile::openSegment(uint16_t index) {
+    char path[48];
+    m_file.close();
+    if (!segmentPath(m_journey, index, m_encoding, path, sizeof(path))) return false;
+    m_file = SD.open(path, O_READ);
+    m_segment = index;
+    return m_file;
+}
+
+
+int JourneyFile::read(void* buf, size_t count) {
+    if (!m_isOpen) return -1;
+    int n = m_file.read(buf, count);
+    // End of a segment: carry on in the next one
+    while (n == 0 && m_segmented && m_segment + 1 < m_segments) {
+        m_segmentStart += m_file.fileSize();
+        if (!openSegment(m_segment + 1)) return -1;
+        n = m_file.read(buf, count);
+    }
+    return n;
+}
+
+
+bool JourneyFile::seekSet(uint64_t position) {
+    if (!m_isOpen || position > m_size) return false;
+    if (!m_segmented) return m_file.seekSet(position);
+
+    // Walk the segment sizes to the one containing `position`
+    uint64_t start = 0;
+    for (uint16_t i = 0; i < m_segments; i++) {
+        if (!openSegment(i)) return false;
+        uint64_t bytes = m_file.fileSize();
+        if (position < start + bytes || i + 1 == m_segments) {
+            m_segmentStart = start;
+            return m_file.seekSet(position - start);
+        }
+        start += bytes;
+    }
+    return false;
+}
@@ -1,4 +1,23 @@
 #include "server.hpp"
+#include "journey.hpp"
+#include "overview.hpp"
+#include "catalog.hpp"
+#include "json_stream.hpp"
+#include "sd_tune.hpp"
+#include "storage.hpp"
+#include "delete_job.hpp"
+#include "retention.hpp"
+#include "journal.hpp"
+#include "record_reader.hpp"
+#include "record_query.hpp"
+#include "segment.hpp"
+#include "time_index.hpp"
+#include "block_log.hpp"
+#include "config.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "sd_mutex.hpp"
+#include "task_stats.hpp"
 #include <Arduino.h>
 #include <Wire.h>
 #include <SPI.h>
@@ -9,9 +28,6 @@
 extern SdFat SD;
 WebServer server(80);
 
-// Function declaration
-bool deleteRecursively(const char* path);
-
 //-------------------------------------------------------------------------------
 // Ensures a dummy JSON file exists under /test; creates it with sample data if not
 //-------------------------------------------------------------------------------
@@ -58,7 +74,135 @@ void handleRoot() {
 }
 
 //-------------------------------------------------------------------------------
-// Handler for GET /days
+// Body chunks go out through these so they count towards http_bytes_total
+//-------------------------------------------------------------------------------
+static void sendContent(const char* data, size_t length) {
+    static MetricCounter* served = metricsCounter("http_bytes_total");
+    server.sendContent(data, length);
+    served->add(length);
+}
+
+static void sendContent(const char* text) {
+    sendContent(text, strlen(text));
+}
+
+static void sendContent(const String& text) {
+    sendContent(text.c_str(), text.length());
+}
+
+//-------------------------------------------------------------------------------
+// Directory listings with optional cursor pagination (?after=NAME&limit=N).
+// A page holds the `limit` smallest names sorting after the cursor; when the
+// page is full the cursor for the next one is returned in X-Next-After.
+//-------------------------------------------------------------------------------
+#define LIST_MAX_LIMIT 50
+
+struct NamePage {
+    char names[LIST_MAX_LIMIT][32];
+    int count;
+    int limit;
+};
+
+// Only ever used from the web server loop, so kept off the stack
+static NamePage listPage;
+
+static void pageAdd(NamePage& page, const char* name, const char* after) {
+    if (after[0] && strcmp(name, after) <= 0) return;
+
+    // Insertion sort, dropping the largest name once the page is full
+    int i = page.count;
+    if (i == page.limit) {
+        if (strcmp(name, page.names[i - 1]) >= 0) return;
+        i--;
+    } else {
+        page.count++;
+    }
+    while (i > 0 && strcmp(name, page.names[i - 1]) < 0) {
+        memcpy(page.names[i], page.names[i - 1], sizeof(page.names[i]));
+        i--;
+    }
+    strncpy(page.names[i], name, sizeof(page.names[i]) - 1);
+    page.names[i][sizeof(page.names[i]) - 1] = '\0';
+}
+
+static bool isDayEntry(FsFile& entry, char* name) {
+    if (!entry.isDir() || name[0] == '.') return false;
+    // Days queued for deletion are already gone as far as the client is concerned
+    char path[DELETE_PATH_MAX];
+    snprintf(path, sizeof(path), "/%s", name);
+    return !deleteJobPending(path);
+}
+
+// Day folder being listed by handleDrives(), for the pending-delete check
+static char listDay[12];
+
+static bool isDriveEntry(FsFile& entry, char* name) {
+    if (name[0] == '.') return false;
+    if (!entry.isDir()) return strstr(name, ".json");
+
+    // A segment directory "HH-MM-SS" is listed under its journey name
+    if (strlen(name) != 8 || name[2] != '-' || name[5] != '-') return false;
+    char path[DELETE_PATH_MAX];
+    snprintf(path, sizeof(path), "/%s/%s", listDay, name);
+    if (deleteJobPending(path)) return false;
+    strcat(name, ".json");
+    return true;
+}
+
+//-------------------------------------------------------------------------------
+// Streams the names in `dir` accepted by `accept` as a JSON array. `accept`
+// may rewrite the name (32 byte buffer). Caller must hold sdMutex.
+//-------------------------------------------------------------------------------
+static void streamListing(FsFile& dir, bool (*accept)(FsFile&, char*)) {
+    JsonStreamWriter json(server);
+    bool paged = server.hasArg("after") || server.hasArg("limit");
+
+    if (!paged) {
+        // Directory order, no buffering
+        json.begin();
+        json.beginArray();
+        while (true) {
+            FsFile entry = dir.openNextFile();
+            if (!entry) break;
+            char name[32];
+            entry.getName(name, sizeof(name));
+            if (accept(entry, name)) json.value(name);
+            entry.close();
+        }
+        json.endArray();
+        json.end();
+        return;
+    }
+
+    NamePage& page = listPage;
+    String after = server.arg("after");
+    page.count = 0;
+    page.limit = server.hasArg("limit") ? server.arg("limit").toInt() : LIST_MAX_LIMIT;
+    page.limit = constrain(page.limit, 1, LIST_MAX_LIMIT);
+    while (true) {
+        FsFile entry = dir.openNextFile();
+        if (!entry) break;
+        char name[32];
+        entry.getName(name, sizeof(name));
+        if (accept(entry, name)) pageAdd(page, name, after.c_str());
+        entry.close();
+    }
+
+    if (page.count == page.limit) {
+        server.sendHeader("Access-Control-Expose-Headers", "X-Next-After");
+        server.sendHeader("X-Next-After", page.names[page.count - 1]);
+    }
+    json.begin();
+    json.beginArray();
+    for (int i = 0; i < page.count; i++) {
+        json.value(page.names[i]);
+    }
+    json.endArray();
+    json.end();
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /days[?after=YYYY-MM-DD&limit=N]
 // Lists top‑level directories (YYYY‑MM‑DD folders) as JSON array
 //-------------------------------------------------------------------------------
 void handleDays() {
@@ -66,42 +210,20 @@ void handleDays() {
     Serial.println("Listing available days...");
 
     // Lock SD card for safe multi‑thread access 
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
         FsFile root = SD.open("/");
         if (!root) {
             // Couldn’t open root directory
             Serial.println("Failed to open root directory");
             server.send(500, "text/plain", "Failed to open root directory");
-            xSemaphoreGive(sdMutex);
+            sdMutexGive();
             return;
         }
 
-        String json = "[";
-        bool first = true;
-
-        // Iterate each entry in root
-        while (true) {
-            FsFile entry = root.openNextFile();
-            if (!entry) break;                     // No more entries
-
-            if (entry.isDir()) {
-                char name[32];
-                entry.getName(name, sizeof(name));
-                // Skip hidden dirs starting with '.'
-                if (name[0] != '.') {
-                    if (!first) json += ",";
-                    json += "\"" + String(name) + "\"";
-                    first = false;
-                }
-            }
-            entry.close();
-        }
-        json += "]";
-        root.close();
-
         // Send JSON list of day folders
-        server.send(200, "application/json", json);
-        xSemaphoreGive(sdMutex);
+        streamListing(root, isDayEntry);
+        root.close();
+        sdMutexGive();
     } else {
         // Mutex lock timed out
         Serial.println("SD Mutex timeout in handleDays()");
@@ -110,7 +232,7 @@ void handleDays() {
 }
 
 //-------------------------------------------------------------------------------
-// Handler for GET /drives?day=YYYY-MM-DD
+// Handler for GET /drives?day=YYYY-MM-DD[&after=FILE.json&limit=N]
 // Lists all JSON files (drives) under the specified day folder
 //-------------------------------------------------------------------------------
 void handleDrives() {
@@ -126,51 +248,384 @@ void handleDrives() {
     Serial.println(day);
 
     String path = "/" + day;
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
         FsFile dir = SD.open(path.c_str());
         if (!dir || !dir.isDir()) {
             // Folder doesn’t exist
             Serial.println("Day folder not found");
             server.send(404, "text/plain", "Day folder not found");
-            xSemaphoreGive(sdMutex);
+            sdMutexGive();
+            return;
+        }
+
+        // Return JSON array of drive filenames (journeys only, no sidecars)
+        strncpy(listDay, day.c_str(), sizeof(listDay) - 1);
+        streamListing(dir, isDriveEntry);
+        dir.close();
+        sdMutexGive();
+    } else {
+        Serial.println("SD Mutex timeout in handleDrives()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Streams the records of an open drive file that fall inside `window`,
+// keeping only the requested fields and every Nth record. The response uses
+// chunked transfer encoding because its length is not known up front.
+//-------------------------------------------------------------------------------
+static void streamDriveQuery(JourneyFile& file, const JsonDocument& filter,
+                             RecordWindow& window, long every) {
+    unsigned long startMs = millis();
+    uint32_t scanned = 0, matched = 0, sent = 0;
+    size_t bytes = 0;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    char out[1024];
+    size_t used = 0;
+    JsonDocument doc;
+    RecordReader reader(file);
+    size_t len;
+    const char* line;
+    while ((line = reader.next(len)) != nullptr) {
+        scanned++;
+        if (recordDeserialize(doc, line, len, reader.encoding(), filter)) {
+            continue;  // Skip corrupt records
+        }
+
+        // Time range, on elapsed time so a drive may cross midnight
+        int place = window.check(doc["gps"]["time"] | "");
+        if (place < 0) continue;
+        if (place > 0) break;
+
+        // Decimation
+        if ((matched++ % every) != 0) continue;
+
+        size_t need = measureJson(doc) + 1;
+        if (used + need > sizeof(out)) {
+            sendContent(out, used);
+            bytes += used;
+            used = 0;
+        }
+        if (need > sizeof(out)) continue;
+        used += serializeJson(doc, out + used, sizeof(out) - used);
+        out[used++] = '\n';
+        sent++;
+    }
+    if (used > 0) {
+        sendContent(out, used);
+        bytes += used;
+    }
+    sendContent("");  // Terminating chunk
+
+    Serial.printf("Drive query: %u scanned, %u sent, %u bytes of %u in %lu ms\n",
+                  (unsigned)scanned, (unsigned)sent, (unsigned)bytes, (unsigned)file.size(),
+                  millis() - startMs);
+}
+
+//-------------------------------------------------------------------------------
+// Streams a journey (all of its segments) from the current position to the
+// end with a known Content-Length, as stored (NDJSON, MessagePack or CBOR)
+//-------------------------------------------------------------------------------
+static void streamJourney(JourneyFile& file) {
+    server.sendHeader("Content-Type", recordEncodingContentType(file.encoding()));
+    server.setContentLength(file.size() - file.curPosition());
+    server.send(200);
+
+    const size_t bufSize = 512;
+    uint8_t buf[bufSize];
+    while (file.available()) {
+        int n = file.read(buf, bufSize);
+        if (n <= 0) break;
+        sendContent((const char*)buf, n);
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Positions `file` for at=HH:MM:SS using the journey's time index, falling
+// back to a linear scan when it has none (or when seek=scan asks for one, to
+// compare the two). The time taken is returned in X-Seek-Us.
+//-------------------------------------------------------------------------------
+static void seekJourney(JourneyFile& file, const String& path, const String& at) {
+    unsigned long startUs = micros();
+    uint64_t offset = 0;
+    bool indexed = server.arg("seek") != "scan" &&
+                   timeIndexSeek(path.c_str(), at.c_str(), file.size(), offset);
+    if (!indexed) {
+        timeIndexScan(file, at.c_str(), offset);
+    }
+    file.seekSet(offset);
+    unsigned long us = micros() - startUs;
+
+    server.sendHeader("Access-Control-Expose-Headers", "X-Seek-Us, X-Seek-Method");
+    server.sendHeader("X-Seek-Us", String(us));
+    server.sendHeader("X-Seek-Method", indexed ? "index" : "scan");
+    Serial.printf("Seek to %s: offset %lu of %lu by %s in %lu us\n", at.c_str(),
+                  (unsigned long)offset, (unsigned long)file.size(), indexed ? "index" : "scan", us);
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /drive?day=YYYY-MM-DD&drive=FILE.json
+// Streams the contents of a specific drive file. Optional query parameters
+// select a subset on the device:
+//   fields=gps.latitude,gps.longitude,obd.speed  channels to keep
+//   from=HH:MM:SS&to=HH:MM:SS                    time window
+//   every=N                                      keep every Nth record
+//   at=HH:MM:SS                                  start at the indexed record
+//                                                at or before this time
+// Records are sent as NDJSON; journeys logged as MessagePack or CBOR are
+// converted on the fly. format=raw sends them as stored instead, with the
+// matching Content-Type. format=blocks instead returns the column-block copy of the whole journey
+// (application/octet-stream, decoded by tools/jblock.cpp).
+//-------------------------------------------------------------------------------
+void handleDrive() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!server.hasArg("day") || !server.hasArg("drive")) {
+        server.send(400, "text/plain", "Missing 'day' or 'drive' parameter");
+        return;
+    }
+    String day   = server.arg("day");
+    String drive = server.arg("drive");
+
+    // Prevent path traversal
+    if (day.startsWith(".") || drive.startsWith(".")) {
+        server.send(403, "text/plain", "Access forbidden");
+        return;
+    }
+
+    String format = server.arg("format");
+    if (!format.isEmpty() && format != "json" && format != "raw" && format != "blocks") {
+        server.send(400, "text/plain", "Invalid 'format' parameter");
+        return;
+    }
+
+    // Optional seek, checked before the SD card is locked
+    String at = server.arg("at");
+    if (!at.isEmpty() && (at.length() != 8 || at[2] != ':' || at[5] != ':')) {
+        server.send(400, "text/plain", "Invalid 'at' parameter");
+        return;
+    }
+
+    // Optional projection / time range / downsampling
+    bool query = server.hasArg("fields") || server.hasArg("from") ||
+                 server.hasArg("to") || server.hasArg("every");
+    JsonDocument filter;
+    RecordWindow window;
+    window.begin("", "");
+    long every = 1;
+    if (query) {
+        if (!recordFieldFilter(server.arg("fields"), filter)) {
+            server.send(400, "text/plain", "Invalid 'fields' parameter");
+            return;
+        }
+        if (!window.begin(server.arg("from").c_str(), server.arg("to").c_str())) {
+            server.send(400, "text/plain", "Invalid 'from' or 'to' parameter");
+            return;
+        }
+        if (server.hasArg("every")) {
+            every = server.arg("every").toInt();
+            if (every < 1) {
+                server.send(400, "text/plain", "Invalid 'every' parameter");
+                return;
+            }
+        }
+    }
+
+    String path = "/" + day + "/" + drive;
+    if (format == "blocks") {
+        char blkPath[64];
+        if (!journeySidecarPath(path.c_str(), BLOCK_LOG_EXT, blkPath, sizeof(blkPath))) {
+            server.send(400, "text/plain", "Invalid 'drive' parameter");
+            return;
+        }
+        if (sdMutexTake(pdMS_TO_TICKS(1000)) != pdTRUE) {
+            Serial.println("SD Mutex timeout in handleDrive()");
+            server.send(500, "text/plain", "SD card access timeout");
+            return;
+        }
+        FsFile file = SD.open(blkPath, O_READ);
+        if (!file) {
+            server.send(404, "text/plain", "Block copy not found");
+            sdMutexGive();
+            return;
+        }
+        uint32_t remaining = file.size();
+        sdMutexGive();
+        server.sendHeader("Content-Type", "application/octet-stream");
+        server.setContentLength(remaining);
+        server.send(200);
+
+        // The card is only held for each read, so dataTask can log in between
+        const size_t bufSize = 512;
+        uint8_t buf[bufSize];
+        while (remaining > 0) {
+            if (sdMutexTake(pdMS_TO_TICKS(1000)) != pdTRUE) break;
+            int n = file.read(buf, min((uint32_t)bufSize, remaining));
+            sdMutexGive();
+            if (n <= 0) break;
+            sendContent((const char*)buf, n);
+            remaining -= n;
+        }
+        // Keep the length honest if the file could not be read in full;
+        // a zero byte is not a block marker, so readers stop there
+        memset(buf, 0, bufSize);
+        while (remaining > 0) {
+            uint32_t n = min((uint32_t)bufSize, remaining);
+            sendContent((const char*)buf, n);
+            remaining -= n;
+        }
+        if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+            file.close();
+            sdMutexGive();
+        }
+        return;
+    }
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        JourneyFile file;
+        if (!file.open(path.c_str())) {
+            server.send(404, "text/plain", "Drive file not found");
+            sdMutexGive();
+            return;
+        }
+        if (!at.isEmpty()) {
+            seekJourney(file, path, at);
+        }
+
+        if (query || (file.encoding() != ENCODING_NDJSON && format != "raw")) {
+            if (!query) filter.set(true);
+            streamDriveQuery(file, filter, window, every);
+            file.close();
+            sdMutexGive();
+            return;
+        }
+
+        // Send headers, then stream file in chunks
+        streamJourney(file);
+        file.close();
+        sdMutexGive();
+    } else {
+        Serial.println("SD Mutex timeout in handleDrive()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /summary?day=YYYY-MM-DD[&drive=FILE.json]
+// Returns the stored summary of one drive, or a JSON array of all summaries
+// for the day. The journey being recorded is reported from its live aggregates.
+//-------------------------------------------------------------------------------
+void handleSummary() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!server.hasArg("day")) {
+        server.send(400, "text/plain", "Missing 'day' parameter");
+        return;
+    }
+    String day   = server.arg("day");
+    String drive = server.arg("drive");
+
+    // Prevent path traversal
+    if (day.startsWith(".") || drive.startsWith(".")) {
+        server.send(403, "text/plain", "Access forbidden");
+        return;
+    }
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        String activeDrive;
+        if (journeyStats.active && strncmp(journeyStats.path, day.c_str(), day.length()) == 0 &&
+            journeyStats.path[day.length()] == '/') {
+            activeDrive = journeyStats.path + day.length() + 1;
+        }
+
+        // Single drive
+        if (!drive.isEmpty()) {
+            String json;
+            if (drive == activeDrive) {
+                JsonDocument doc;
+                journeyStatsToJson(journeyStats, doc.to<JsonObject>());
+                serializeJson(doc, json);
+            } else {
+                char path[64];
+                String journey = day + "/" + drive;
+                FsFile file;
+                if (journeySidecarPath(journey.c_str(), SUMMARY_EXT, path, sizeof(path))) {
+                    file = SD.open(path, O_READ);
+                }
+                if (!file) {
+                    server.send(404, "text/plain", "Summary not found");
+                    sdMutexGive();
+                    return;
+                }
+                char buf[128];
+                while (file.available()) {
+                    int n = file.read(buf, sizeof(buf));
+                    if (n <= 0) break;
+                    json.concat(buf, n);
+                }
+                file.close();
+            }
+            server.send(200, "application/json", json);
+            sdMutexGive();
+            return;
+        }
+
+        // Whole day
+        FsFile dir = SD.open(("/" + day).c_str());
+        if (!dir || !dir.isDir()) {
+            Serial.println("Day folder not found");
+            server.send(404, "text/plain", "Day folder not found");
+            sdMutexGive();
             return;
         }
 
-        String json = "[";
-        bool first = true;
+        JsonStreamWriter json(server);
+        json.begin();
+        json.beginArray();
+        if (!activeDrive.isEmpty()) {
+            JsonDocument doc;
+            journeyStatsToJson(journeyStats, doc.to<JsonObject>());
+            json.value(doc.as<JsonVariantConst>());
+        }
         while (true) {
             FsFile entry = dir.openNextFile();
             if (!entry) break;
 
-            // Only include files (skip sub-directories)
-            if (!entry.isDir()) {
-                char name[32];
-                entry.getName(name, sizeof(name));
-                if (name[0] != '.') {
-                    if (!first) json += ",";
-                    json += "\"" + String(name) + "\"";
-                    first = false;
+            char name[32];
+            entry.getName(name, sizeof(name));
+            if (!entry.isDir() && strstr(name, SUMMARY_EXT)) {
+                // Copy the stored summary through unchanged
+                char buf[128];
+                bool first = true;
+                while (entry.available()) {
+                    int n = entry.read(buf, sizeof(buf));
+                    if (n <= 0) break;
+                    if (first) {
+                        json.raw(buf, n);
+                        first = false;
+                    } else {
+                        json.append(buf, n);
+                    }
                 }
             }
             entry.close();
         }
-        json += "]";
+        json.endArray();
+        json.end();
         dir.close();
-
-        // Return JSON array of drive filenames
-        server.send(200, "application/json", json);
-        xSemaphoreGive(sdMutex);
+        sdMutexGive();
     } else {
-        Serial.println("SD Mutex timeout in handleDrives()");
+        Serial.println("SD Mutex timeout in handleSummary()");
         server.send(500, "text/plain", "SD card access timeout");
     }
 }
 
 //-------------------------------------------------------------------------------
-// Handler for GET /drive?day=YYYY-MM-DD&drive=FILE.json
-// Streams the contents of a specific drive file
+// Handler for GET /overview?day=YYYY-MM-DD&drive=FILE.json[&level=10|60]
+// Streams the aggregate buckets of a drive (one NDJSON line per bucket) so a
+// long journey can be drawn without downloading every 1 Hz record.
 //-------------------------------------------------------------------------------
-void handleDrive() {
+void handleOverview() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     if (!server.hasArg("day") || !server.hasArg("drive")) {
         server.send(400, "text/plain", "Missing 'day' or 'drive' parameter");
@@ -178,23 +633,34 @@ void handleDrive() {
     }
     String day   = server.arg("day");
     String drive = server.arg("drive");
+    int level = server.hasArg("level") ? server.arg("level").toInt() : OVERVIEW_COARSE_SEC;
 
     // Prevent path traversal
     if (day.startsWith(".") || drive.startsWith(".")) {
         server.send(403, "text/plain", "Access forbidden");
         return;
     }
+    const char* ext = overviewLevelExt(level);
+    if (!ext) {
+        server.send(400, "text/plain", "Invalid 'level' parameter");
+        return;
+    }
 
-    String path = "/" + day + "/" + drive;
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        FsFile file = SD.open(path.c_str(), O_READ);
+    char path[64];
+    String journey = "/" + day + "/" + drive;
+    if (!journeySidecarPath(journey.c_str(), ext, path, sizeof(path))) {
+        server.send(400, "text/plain", "Invalid 'drive' parameter");
+        return;
+    }
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        FsFile file = SD.open(path, O_READ);
         if (!file) {
-            server.send(404, "text/plain", "Drive file not found");
-            xSemaphoreGive(sdMutex);
+            server.send(404, "text/plain", "Overview not found");
+            sdMutexGive();
             return;
         }
 
-        // Send headers, then stream file in chunks
         server.sendHeader("Content-Type", "application/json");
         server.setContentLength(file.size());
         server.send(200);
@@ -203,12 +669,12 @@ void handleDrive() {
         uint8_t buf[bufSize];
         while (file.available()) {
             size_t n = file.read(buf, bufSize);
-            server.sendContent((const char*)buf, n);
+            sendContent((const char*)buf, n);
         }
         file.close();
-        xSemaphoreGive(sdMutex);
+        sdMutexGive();
     } else {
-        Serial.println("SD Mutex timeout in handleDrive()");
+        Serial.println("SD Mutex timeout in handleOverview()");
         server.send(500, "text/plain", "SD card access timeout");
     }
 }
@@ -221,7 +687,7 @@ void handleLiveData() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     Serial.println("Fetching latest drive data...");
 
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
         // 1) Scan root for latest YYYY-MM-DD folder
         FsFile root = SD.open("/");
         String latestDay;
@@ -243,24 +709,25 @@ void handleLiveData() {
 
         if (latestDay.isEmpty()) {
             server.send(404, "text/plain", "No log data found");
-            xSemaphoreGive(sdMutex);
+            sdMutexGive();
             return;
         }
 
-        // 2) Scan that folder for latest HH-MM-SS*.json file
+        // 2) Scan that folder for latest HH-MM-SS*.json file or segment directory
         FsFile dayDir = SD.open(("/" + latestDay).c_str());
         String latestDrive;
         while (true) {
             FsFile e = dayDir.openNextFile();
             if (!e) break;
-            if (!e.isDir()) {
-                char n[32];
-                e.getName(n, sizeof(n));
-                // Check for time‑formatted name
-                if (strlen(n)>=12 && n[2]=='-' && n[5]=='-' && strstr(n, ".json") &&
-                    (latestDrive.isEmpty() || String(n) > latestDrive)) {
-                    latestDrive = n;
-                }
+            char n[32];
+            e.getName(n, sizeof(n));
+            if (e.isDir() && strlen(n)==8 && n[2]=='-' && n[5]=='-') {
+                strcat(n, ".json");
+            }
+            // Check for time‑formatted name
+            if (strlen(n)>=12 && n[2]=='-' && n[5]=='-' && strstr(n, ".json") &&
+                (latestDrive.isEmpty() || String(n) > latestDrive)) {
+                latestDrive = n;
             }
             e.close();
         }
@@ -268,34 +735,555 @@ void handleLiveData() {
 
         if (latestDrive.isEmpty()) {
             server.send(404, "text/plain", "No latest drive data found");
-            xSemaphoreGive(sdMutex);
+            sdMutexGive();
             return;
         }
 
         // 3) Stream that latest file
-        FsFile file = SD.open(("/" + latestDay + "/" + latestDrive).c_str(), O_READ);
-        if (!file) {
+        JourneyFile file;
+        if (!file.open(("/" + latestDay + "/" + latestDrive).c_str())) {
             server.send(404, "text/plain", "Latest drive file not found");
-            xSemaphoreGive(sdMutex);
+            sdMutexGive();
             return;
         }
-        server.sendHeader("Content-Type", "application/json");
-        server.setContentLength(file.size());
+        if (file.encoding() != ENCODING_NDJSON) {
+            // Binary journey: the client expects NDJSON
+            JsonDocument all;
+            all.set(true);
+            RecordWindow window;
+            window.begin("", "");
+            streamDriveQuery(file, all, window, 1);
+        } else {
+            streamJourney(file);
+        }
+        file.close();
+        sdMutexGive();
+    } else {
+        Serial.println("SD Mutex timeout in handleLiveData()");
+        server.send(500, "text/plain", "SD busy, try again later");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Bulk sync: journeys newer than a catalog generation, streamed as one response
+//-------------------------------------------------------------------------------
+#define SYNC_MAX_JOURNEYS 32
+
+struct SyncEntry {
+    uint32_t gen;
+    uint32_t size;
+    RecordEncoding encoding;
+    char path[40];          // "YYYY-MM-DD/HH-MM-SS.json"
+};
+
+struct SyncPlan {
+    SyncEntry entries[SYNC_MAX_JOURNEYS];
+    int count;
+    uint32_t lastGen;       // Last catalog generation consumed
+    bool more;              // Stopped at SYNC_MAX_JOURNEYS
+};
+
+// Only ever used from the web server loop, so kept off the stack
+static SyncPlan syncPlan;
+
+static bool collectSyncEntry(uint32_t gen, const char* path, void* ctx) {
+    SyncPlan* plan = (SyncPlan*)ctx;
+
+    // A journey that changed again replaces its earlier entry
+    for (int i = 0; i < plan->count; i++) {
+        if (strcmp(plan->entries[i].path, path) == 0) {
+            plan->entries[i].gen = gen;
+            plan->lastGen = gen;
+            return true;
+        }
+    }
+    if (plan->count == SYNC_MAX_JOURNEYS) {
+        plan->more = true;
+        return false;
+    }
+    SyncEntry& e = plan->entries[plan->count++];
+    e.gen = gen;
+    e.size = 0;
+    strncpy(e.path, path, sizeof(e.path) - 1);
+    e.path[sizeof(e.path) - 1] = '\0';
+    plan->lastGen = gen;
+    return true;
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /sync[?since=GEN]
+// Streams every journey added or changed after `since` (default: the last
+// acknowledged generation) in one chunked response:
+//   {"gen":G,"since":S,"more":false,"journeys":[{"gen":..,"day":..,"drive":..,"size":N,"encoding":E},..]}\n
+// followed, for each journey in manifest order, by
+//   {"day":..,"drive":..,"size":N}\n<N bytes of journey data in encoding E>
+// The client acknowledges `gen` with POST /sync/ack; when `more` is true it
+// should call again with since=gen.
+//-------------------------------------------------------------------------------
+void handleSync() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10)
+                                           : catalogSyncedGeneration();
+    unsigned long startMs = millis();
+
+    // 1) Build the manifest
+    SyncPlan& plan = syncPlan;
+    plan.count = 0;
+    plan.lastGen = since;
+    plan.more = false;
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) != pdTRUE) {
+        Serial.println("SD Mutex timeout in handleSync()");
+        server.send(500, "text/plain", "SD card access timeout");
+        return;
+    }
+    catalogForEach(since, collectSyncEntry, &plan);
+    if (!plan.more) plan.lastGen = max(plan.lastGen, catalogGeneration());
+
+    // Drop journeys deleted since they were catalogued
+    int kept = 0;
+    for (int i = 0; i < plan.count; i++) {
+        String path = "/" + String(plan.entries[i].path);
+        JourneyFile file;
+        if (!file.open(path.c_str())) continue;
+        plan.entries[i].size = file.size();
+        plan.entries[i].encoding = file.encoding();
+        file.close();
+        plan.entries[kept++] = plan.entries[i];
+    }
+    plan.count = kept;
+    sdMutexGive();
+
+    JsonDocument manifest;
+    manifest["gen"] = plan.lastGen;
+    manifest["since"] = since;
+    manifest["more"] = plan.more;
+    JsonArray journeys = manifest["journeys"].to<JsonArray>();
+    for (int i = 0; i < plan.count; i++) {
+        const SyncEntry& e = plan.entries[i];
+        JsonObject j = journeys.add<JsonObject>();
+        j["gen"] = e.gen;
+        j["day"] = String(e.path).substring(0, 10);
+        j["drive"] = e.path + 11;
+        j["size"] = e.size;
+        j["encoding"] = recordEncodingName(e.encoding);
+    }
+    String header;
+    serializeJson(manifest, header);
+    header += "\n";
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+    sendContent(header);
+    size_t bytes = header.length();
+
+    // 2) Stream each journey, releasing the SD card between reads
+    static uint8_t buf[1024];
+    for (int i = 0; i < plan.count; i++) {
+        const SyncEntry& e = plan.entries[i];
+        char frame[96];
+        snprintf(frame, sizeof(frame), "{\"day\":\"%.10s\",\"drive\":\"%s\",\"size\":%u}\n",
+                 e.path, e.path + 11, (unsigned)e.size);
+        sendContent(frame);
+        bytes += strlen(frame);
+
+        // The card is only held for each read, so dataTask can log in between
+        uint32_t remaining = e.size;
+        String path = "/" + String(e.path);
+        JourneyFile file;
+        if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+            file.open(path.c_str());
+            sdMutexGive();
+        }
+        while (file && remaining > 0) {
+            if (sdMutexTake(pdMS_TO_TICKS(1000)) != pdTRUE) break;
+            int n = file.read(buf, min((uint32_t)sizeof(buf), remaining));
+            sdMutexGive();
+            if (n <= 0) break;
+            sendContent((const char*)buf, n);
+            remaining -= n;
+        }
+        if (file && sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+            file.close();
+            sdMutexGive();
+        }
+        // Keep the framing intact if the file could not be read in full
+        memset(buf, '\n', sizeof(buf));
+        while (remaining > 0) {
+            uint32_t n = min((uint32_t)sizeof(buf), remaining);
+            sendContent((const char*)buf, n);
+            remaining -= n;
+        }
+        bytes += e.size;
+    }
+    sendContent("");  // Terminating chunk
+
+    Serial.printf("Sync since %u: %d journeys, %u bytes in %lu ms\n",
+                  (unsigned)since, plan.count, (unsigned)bytes, millis() - startMs);
+}
+
+//-------------------------------------------------------------------------------
+// Handler for POST /sync/ack?gen=GEN
+// Records that the client holds everything up to GEN, making the next
+// /sync without `since` incremental.
+//-------------------------------------------------------------------------------
+void handleSyncAck() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!server.hasArg("gen")) {
+        server.send(400, "text/plain", "Missing 'gen' parameter");
+        return;
+    }
+    uint32_t gen = strtoul(server.arg("gen").c_str(), NULL, 10);
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        bool ok = catalogAck(gen);
+        sdMutexGive();
+        if (ok) {
+            server.send(200, "text/plain", "Acknowledged");
+        } else {
+            server.send(400, "text/plain", "Invalid 'gen' parameter");
+        }
+    } else {
+        Serial.println("SD Mutex timeout in handleSyncAck()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Handler for POST /star
+// Stars (on=1, default) or unstars (on=0) a journey; starred journeys are never
+// evicted by the retention manager
+//-------------------------------------------------------------------------------
+void handleStar() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!server.hasArg("day") || !server.hasArg("drive")) {
+        server.send(400, "text/plain", "Missing 'day' or 'drive' parameter");
+        return;
+    }
+    String day   = server.arg("day");
+    String drive = server.arg("drive");
+    bool on = !server.hasArg("on") || server.arg("on") != "0";
+
+    // Prevent path traversal
+    if (day.startsWith(".") || drive.startsWith(".")) {
+        server.send(403, "text/plain", "Access forbidden");
+        return;
+    }
+
+    char path[64];
+    String journey = "/" + day + "/" + drive;
+    if (!journey.endsWith(".json") || !journeySidecarPath(journey.c_str(), STAR_EXT, path, sizeof(path))) {
+        server.send(400, "text/plain", "Invalid 'drive' parameter");
+        return;
+    }
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        bool ok;
+        if (!segmentJourneyExists(journey.c_str())) {
+            sdMutexGive();
+            server.send(404, "text/plain", "Drive not found");
+            return;
+        }
+        if (on) {
+            FsFile marker = SD.open(path, O_WRONLY | O_CREAT);
+            ok = marker;
+            marker.close();
+        } else {
+            ok = !SD.exists(path) || SD.remove(path);
+        }
+        sdMutexGive();
+        if (ok) {
+            server.send(200, "text/plain", on ? "Starred" : "Unstarred");
+        } else {
+            server.send(500, "text/plain", "Failed to update star");
+        }
+    } else {
+        Serial.println("SD Mutex timeout in handleStar()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Checks day/drive arguments and builds "/day/drive". Sends the error and
+// returns false if they are missing or unsafe.
+//-------------------------------------------------------------------------------
+static bool journeyArgs(String& path) {
+    if (!server.hasArg("day") || !server.hasArg("drive")) {
+        server.send(400, "text/plain", "Missing 'day' or 'drive' parameter");
+        return false;
+    }
+    String day   = server.arg("day");
+    String drive = server.arg("drive");
+    if (day.startsWith(".") || drive.startsWith(".")) {
+        server.send(403, "text/plain", "Access forbidden");
+        return false;
+    }
+    path = "/" + day + "/" + drive;
+    return true;
+}
+
+// True if `path` ("/day/drive") is the journey being logged
+static bool isActiveJourney(const String& path) {
+    return journeyStats.active && path.substring(1) == journeyStats.path;
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /segments?day=YYYY-MM-DD&drive=FILE.json
+// Lists the segments of a journey as [{"seg":0,"bytes":N,"closed":true},..].
+// Closed segments never change, so a client only refetches the open one.
+// A journey recorded before segmenting is reported as a single segment 0.
+//-------------------------------------------------------------------------------
+void handleSegments() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String path;
+    if (!journeyArgs(path)) return;
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        bool active = isActiveJourney(path);
+        bool segmented = segmentIsSegmented(path.c_str());
+        JsonStreamWriter json(server);
+        if (!segmented) {
+            FsFile file = SD.open(path.c_str(), O_READ);
+            if (!file) {
+                server.send(404, "text/plain", "Drive file not found");
+                sdMutexGive();
+                return;
+            }
+            json.begin();
+            json.beginArray();
+            json.beginObject();
+            json.key("seg");
+            json.value((uint32_t)0);
+            json.key("bytes");
+            json.value((uint32_t)file.fileSize());
+            json.key("closed");
+            json.value(!active);
+            json.endObject();
+            json.endArray();
+            json.end();
+            file.close();
+            sdMutexGive();
+            return;
+        }
+
+        json.begin();
+        json.beginArray();
+        RecordEncoding encoding = segmentEncoding(path.c_str());
+        char segPath[48];
+        for (uint16_t i = 0; i <= SEGMENT_MAX; i++) {
+            if (!segmentPath(path.c_str(), i, encoding, segPath, sizeof(segPath))) break;
+            FsFile seg = SD.open(segPath, O_READ);
+            if (!seg) break;
+            uint32_t bytes = seg.fileSize();
+            seg.close();
+
+            // Only the last segment of the active journey is still growing
+            char next[48];
+            bool last = !segmentPath(path.c_str(), i + 1, encoding, next, sizeof(next)) || !SD.exists(next);
+            json.beginObject();
+            json.key("seg");
+            json.value((uint32_t)i);
+            json.key("bytes");
+            json.value(bytes);
+            json.key("closed");
+            json.value(!(active && last));
+            json.endObject();
+        }
+        json.endArray();
+        json.end();
+        sdMutexGive();
+    } else {
+        Serial.println("SD Mutex timeout in handleSegments()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /segment?day=YYYY-MM-DD&drive=FILE.json&seg=N
+// Streams one segment of a journey. Closed segments are sent as immutable.
+//-------------------------------------------------------------------------------
+void handleSegment() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String path;
+    if (!journeyArgs(path)) return;
+    if (!server.hasArg("seg")) {
+        server.send(400, "text/plain", "Missing 'seg' parameter");
+        return;
+    }
+    long index = server.arg("seg").toInt();
+    if (index < 0 || index > SEGMENT_MAX) {
+        server.send(400, "text/plain", "Invalid 'seg' parameter");
+        return;
+    }
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        bool active = isActiveJourney(path);
+        bool closed;
+        RecordEncoding encoding = ENCODING_NDJSON;
+        FsFile file;
+        char segPath[48];
+        if (segmentIsSegmented(path.c_str())) {
+            char next[48];
+            encoding = segmentEncoding(path.c_str());
+            if (segmentPath(path.c_str(), index, encoding, segPath, sizeof(segPath))) {
+                file = SD.open(segPath, O_READ);
+            }
+            closed = !active ||
+                     (segmentPath(path.c_str(), index + 1, encoding, next, sizeof(next)) && SD.exists(next));
+        } else {
+            // A legacy journey is its own segment 0
+            if (index == 0) file = SD.open(path.c_str(), O_READ);
+            closed = !active;
+        }
+        if (!file || file.isDir()) {
+            server.send(404, "text/plain", "Segment not found");
+            sdMutexGive();
+            return;
+        }
+
+        if (closed) {
+            server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+        } else {
+            server.sendHeader("Cache-Control", "no-cache");
+        }
+        server.sendHeader("Content-Type", recordEncodingContentType(encoding));
+        server.setContentLength(file.fileSize());
         server.send(200);
         const size_t bufSize = 512;
         uint8_t buf[bufSize];
         while (file.available()) {
-            size_t n = file.read(buf, bufSize);
-            server.sendContent((const char*)buf, n);
+            int n = file.read(buf, bufSize);
+            if (n <= 0) break;
+            sendContent((const char*)buf, n);
         }
         file.close();
-        xSemaphoreGive(sdMutex);
+        sdMutexGive();
     } else {
-        Serial.println("SD Mutex timeout in handleLiveData()");
-        server.send(500, "text/plain", "SD busy, try again later");
+        Serial.println("SD Mutex timeout in handleSegment()");
+        server.send(500, "text/plain", "SD card access timeout");
     }
 }
 
+//-------------------------------------------------------------------------------
+// Handler for GET /config
+// Returns the logger settings and the record encodings available
+//-------------------------------------------------------------------------------
+void handleConfig() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    JsonDocument doc;
+    configToJson(doc.to<JsonObject>());
+    String body;
+    serializeJson(doc, body);
+    server.send(200, "application/json", body);
+}
+
+//-------------------------------------------------------------------------------
+// Handler for POST /config?encoding=ndjson|msgpack|cbor&ubx_capture=0|1
+// Changes the record encoding (from the next journey on) and/or raw GNSS
+// capture (from the next GNSS start) and saves them
+//-------------------------------------------------------------------------------
+void handleConfigUpdate() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!server.hasArg("encoding") && !server.hasArg("ubx_capture")) {
+        server.send(400, "text/plain", "Missing 'encoding' or 'ubx_capture' parameter");
+        return;
+    }
+    RecordEncoding encoding = loggerConfig.encoding;
+    if (server.hasArg("encoding") && !recordEncodingParse(server.arg("encoding").c_str(), encoding)) {
+        server.send(400, "text/plain", "Invalid 'encoding' parameter");
+        return;
+    }
+    bool ubxCapture = loggerConfig.ubxCapture;
+    if (server.hasArg("ubx_capture")) {
+        String value = server.arg("ubx_capture");
+        if (value != "0" && value != "1") {
+            server.send(400, "text/plain", "Invalid 'ubx_capture' parameter");
+            return;
+        }
+        ubxCapture = value == "1";
+    }
+
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        loggerConfig.encoding = encoding;
+        loggerConfig.ubxCapture = ubxCapture;
+        bool ok = configSave();
+        sdMutexGive();
+        if (!ok) {
+            server.send(500, "text/plain", "Failed to save config");
+            return;
+        }
+        handleConfig();
+    } else {
+        Serial.println("SD Mutex timeout in handleConfigUpdate()");
+        server.send(500, "text/plain", "SD card access timeout");
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Members of a small document into the object being streamed (task_stats
+// builds the /tasks and /sdinfo fields; the history is streamed a sample at
+// a time)
+//-------------------------------------------------------------------------------
+static void writeMembers(JsonStreamWriter& json, JsonObjectConst object) {
+    for (JsonPairConst member : object) {
+        json.key(member.key().c_str());
+        json.value(member.value());
+    }
+}
+
+static void writeTasks(JsonStreamWriter& json) {
+    JsonDocument doc;
+    taskStatsToJson(doc.to<JsonObject>());
+    writeMembers(json, doc.as<JsonObjectConst>());
+}
+
+static void writeHeap(JsonStreamWriter& json, const SystemSample& sample) {
+    JsonDocument doc;
+    systemSampleToJson(sample, doc.to<JsonObject>());
+    writeMembers(json, doc.as<JsonObjectConst>());
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /tasks
+// Per-task stack high-water marks and CPU share, heap and PSRAM, and the
+// sample history (every TASK_STATS_INTERVAL ms), for sizing stacks and
+// spotting fragmentation. CPU fields need run time stats (TASK_STATS_RUN_TIME).
+//-------------------------------------------------------------------------------
+void handleTasks() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    size_t samples = taskStatsHistorySize();
+    if (samples == 0) {
+        server.send(503, "text/plain", "No sample yet");
+        return;
+    }
+
+    JsonStreamWriter json(server);
+    json.begin();
+    json.beginObject();
+    json.key("interval_ms");
+    json.value((uint32_t)TASK_STATS_INTERVAL);
+    json.key("uptime_sec");
+    json.value(taskStatsHistory(samples - 1).uptimeSec);
+    writeHeap(json, taskStatsHistory(samples - 1));
+    json.key("heap_size");
+    json.value((uint32_t)ESP.getHeapSize());
+    json.key("psram_size");
+    json.value((uint32_t)ESP.getPsramSize());
+    writeTasks(json);
+
+    json.key("history");
+    json.beginArray();
+    for (size_t i = 0; i < samples; i++) {
+        json.beginObject();
+        json.key("uptime_sec");
+        json.value(taskStatsHistory(i).uptimeSec);
+        writeHeap(json, taskStatsHistory(i));
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    json.end();
+}
+
 //-------------------------------------------------------------------------------
 // Handler for GET /sdinfo
 // Reports SD card health and sizes, plus ESP32 uptime
@@ -304,31 +1292,91 @@ void handleSDInfo() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     Serial.println("Fetching SD diagnostics...");
 
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        String json = "{";
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        JsonStreamWriter json(server);
+        json.begin();
+        json.beginObject();
         FsVolume* vol = SD.vol();  // Get volume metadata
         if (!vol) {
             // No card detected
-            json += "\"sd_status\":\"Not detected\"";
+            json.key("sd_status");
+            json.value("Not detected");
         } else {
-            // Calculate sizes 
+            // Calculate sizes. The free count is maintained by SdFat once the
+            // background scan has finished; until then it is reported as pending
+            // rather than scanning the whole FAT here.
+            bool known = storageFreeKnown();
             uint32_t spc = vol->sectorsPerCluster();
             uint32_t cc  = vol->clusterCount();
-            uint32_t fc  = vol->freeClusterCount();
+            uint32_t fc  = known ? vol->freeClusterCount() : 0;
             uint64_t total = (uint64_t)cc * spc * 512;
             uint64_t free  = (uint64_t)fc * spc * 512;
-            uint64_t used  = total - free;
+            uint64_t used  = known ? total - free : 0;
+
+            json.key("sd_status");
+            json.value("OK");
+            json.key("total_size");
+            json.value(total / 1024.0 / 1024.0, 2);
+            json.key("used_size");
+            json.value(used / 1024.0 / 1024.0, 2);
+            json.key("free_size");
+            json.value(free / 1024.0 / 1024.0, 2);
+            json.key("free_pending");
+            json.value(!known);
+
+            // Retention manager (see retention.hpp for the policy)
+            const RetentionStatus& retention = retentionStatus();
+            json.key("retention");
+            json.beginObject();
+            json.key("evicting");
+            json.value(retention.evicting);
+            json.key("blocked");
+            json.value(retention.blocked);
+            json.key("evicted");
+            json.value(retention.evicted);
+            json.key("evicted_mb");
+            json.value(retention.evictedBytes / 1024.0 / 1024.0, 2);
+            json.key("last_evicted");
+            json.value(retention.lastEvicted);
+            json.endObject();
+
+            // Journal recovery pass at the last boot
+            const RecoveryReport& recovery = journalRecovery();
+            json.key("recovery");
+            json.beginObject();
+            json.key("elapsed_ms");
+            json.value(recovery.elapsedMs);
+            json.key("repaired");
+            json.value(recovery.path);
+            json.key("truncated_bytes");
+            json.value(recovery.truncatedBytes);
+            json.endObject();
 
-            json += "\"sd_status\":\"OK\","
-                    "\"total_size\":" + String(total/1024.0/1024.0,2) + ","
-                    "\"used_size\":"  + String(used /1024.0/1024.0,2) + ","
-                    "\"free_size\":"  + String(free /1024.0/1024.0,2);
+            // SPI clock chosen at start-up and throughput measured there
+            json.key("spi_clock_mhz");
+            json.value(sdTune.clockHz / 1e6, 1);
+            json.key("read_mbps");
+            json.value(sdTune.readMBps, 2);
+            json.key("write_mbps");
+            json.value(sdTune.writeMBps, 2);
         }
 
         // Append ESP32 uptime in seconds
-        json += ",\"esp32_uptime_sec\":" + String(millis()/1000) + "}";
-        server.send(200, "application/json", json);
-        xSemaphoreGive(sdMutex);
+        json.key("esp32_uptime_sec");
+        json.value((uint32_t)(millis() / 1000));
+
+        // Heap and task stacks at the last sample (full history on /tasks)
+        size_t samples = taskStatsHistorySize();
+        if (samples > 0) {
+            json.key("system");
+            json.beginObject();
+            writeHeap(json, taskStatsHistory(samples - 1));
+            writeTasks(json);
+            json.endObject();
+        }
+        json.endObject();
+        json.end();
+        sdMutexGive();
     } else {
         Serial.println("SD Mutex timeout in handleSDInfo()");
         server.send(500, "text/plain", "SD card access timeout");
@@ -366,13 +1414,61 @@ void handleDelete() {
         return;
     }
 
+    // The journey being logged cannot be removed from under the logger
+    if (journeyStats.active) {
+        String active = String("/") + journeyStats.path;
+        if (active == path || active == path + ".json" || active.startsWith(path + "/")) {
+            server.send(409, "text/plain", "Journey in progress");
+            return;
+        }
+    }
+
     Serial.printf("Deleting path: %s\n", path.c_str());
-    if (xSemaphoreTake(sdMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        bool ok = deleteRecursively(path.c_str());
-        xSemaphoreGive(sdMutex);
+    if (sdMutexTake(pdMS_TO_TICKS(1000)) == pdTRUE) {
+        FsFile f = SD.open(path.c_str(), O_READ);
+        if (!f && path.endsWith(".json") && segmentIsSegmented(path.c_str())) {
+            // Segmented journey: the segment directory goes in the background
+            bool queued = deleteJourney(path.c_str());
+            sdMutexGive();
+            if (queued) {
+                server.send(202, "text/plain", "Delete queued");
+            } else {
+                server.send(503, "text/plain", "Delete queue full");
+            }
+            return;
+        }
+        if (!f) {
+            sdMutexGive();
+            Serial.printf("Path not found: %s\n", path.c_str());
+            server.send(500, "text/plain", "Failed to delete");
+            return;
+        }
+        bool isDir = f.isDir();
+        f.close();
+
+        if (isDir) {
+            // Directory trees are removed in the background a few entries at a
+            // time, so logging is never blocked for long (see delete_job.cpp)
+            bool queued = deleteJobQueue(path.c_str());
+            sdMutexGive();
+            if (queued) {
+                server.send(202, "text/plain", "Delete queued");
+            } else {
+                server.send(503, "text/plain", "Delete queue full");
+            }
+            return;
+        }
+
+        // A single journey takes its sidecars with it
+        bool ok = SD.remove(path.c_str());
+        if (ok && path.endsWith(".json")) {
+            journeyRemoveSidecars(path.c_str());
+        }
+        sdMutexGive();
         if (ok) {
             server.send(200, "text/plain", "Deleted successfully");
         } else {
+            Serial.printf("Failed to remove file: %s\n", path.c_str());
             server.send(500, "text/plain", "Failed to delete");
         }
     } else {
@@ -382,57 +1478,107 @@ void handleDelete() {
 }
 
 //-------------------------------------------------------------------------------
-// Recursively deletes a file or directory at given path
-// Returns true on success, false on any error
+// Handler for GET /delete/status
+// Reports the background delete queue and the longest SD lock a step has held
 //-------------------------------------------------------------------------------
-bool deleteRecursively(const char* path) {
-    FsFile f = SD.open(path);
-    if (!f) {
-        Serial.printf("Path not found: %s\n", path);
-        return false;
-    }
+void handleDeleteStatus() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
 
-    if (f.isDir()) {
-        // Delete all entries within directory first
-        while (true) {
-            FsFile e = f.openNextFile();
-            if (!e) break;
-            char name[32];
-            e.getName(name, sizeof(name));
-            // Skip . and .. protections
-            if (strcmp(name, ".") && strcmp(name, "..")) {
-                String sub = String(path) + "/" + name;
-                // Recurse or remove file
-                if (e.isDir()) {
-                    if (!deleteRecursively(sub.c_str())) {
-                        e.close(); f.close();
-                        return false;
-                    }
-                } else {
-                    if (!SD.remove(sub.c_str())) {
-                        Serial.printf("Failed to delete file: %s\n", sub.c_str());
-                        e.close(); f.close();
-                        return false;
-                    }
-                }
-            }
-            e.close();
-        }
-        f.close();
-        // Now remove the empty directory
-        if (!SD.rmdir(path)) {
-            Serial.printf("Failed to remove directory: %s\n", path);
-            return false;
-        }
-    } else {
-        // Single file removal
-        f.close();
-        if (!SD.remove(path)) {
-            Serial.printf("Failed to remove file: %s\n", path);
-            return false;
+    const DeleteJobStatus& status = deleteJobStatus();
+    JsonStreamWriter json(server);
+    json.begin();
+    json.beginObject();
+    json.key("running");
+    json.value(status.running);
+    json.key("path");
+    json.value(status.path);
+    json.key("queued");
+    json.value((uint32_t)status.queued);
+    json.key("removed");
+    json.value(status.removed);
+    json.key("steps");
+    json.value(status.steps);
+    json.key("max_hold_ms");
+    json.value(status.maxHoldUs / 1000.0, 2);
+    json.key("completed");
+    json.value(status.completed);
+    json.key("failed");
+    json.value(status.failed);
+    json.key("last_error");
+    json.value(status.lastError);
+    json.endObject();
+    json.end();
+}
+
+// Appends an export (trace, metrics) to a streamed response
+static void streamSink(const char* data, size_t length, void* context) {
+    ((JsonStreamWriter*)context)->append(data, length);
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /trace[?save=1][&clear=1]
+// Streams the trace rings as Chrome Trace Event JSON (open in ui.perfetto.dev),
+// or with save=1 writes them to TRACE_SD_PATH instead. clear=1 starts the
+// next export after the events exported now.
+//-------------------------------------------------------------------------------
+void handleTrace() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    bool clear = server.hasArg("clear") && server.arg("clear") != "0";
+
+    if (server.hasArg("save") && server.arg("save") != "0") {
+        if (sdMutexTake(pdMS_TO_TICKS(1000)) != pdTRUE) {
+            Serial.println("SD Mutex timeout in handleTrace()");
+            server.send(500, "text/plain", "SD card access timeout");
+            return;
         }
+        size_t events = traceSave();
+        sdMutexGive();
+        if (clear) traceClear();
+
+        JsonStreamWriter json(server);
+        json.begin();
+        json.beginObject();
+        json.key("path");
+        json.value(TRACE_SD_PATH);
+        json.key("events");
+        json.value((uint32_t)events);
+        json.endObject();
+        json.end();
+        return;
     }
-    return true;
+
+    JsonStreamWriter json(server);
+    json.begin();
+    traceWrite(streamSink, &json);
+    json.end();
+    if (clear) traceClear();
+}
+
+//-------------------------------------------------------------------------------
+// Handler for GET /metrics
+// Latency histograms, counters and heap gauges, one line each (see metrics.hpp)
+//-------------------------------------------------------------------------------
+void handleMetrics() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    JsonStreamWriter out(server);
+    out.begin(200, "text/plain");
+    metricsWrite(streamSink, &out);
+    out.end();
+}
+
+//-------------------------------------------------------------------------------
+// Binds a handler to a URL path, traced as an "http" slice named by the path
+// and timed in http_us (the histogram is created on the route's first request)
+//-------------------------------------------------------------------------------
+static void route(const char* uri, HTTPMethod method, void (*handler)()) {
+    MetricHistogram* latency = nullptr;
+    server.on(uri, method, [uri, handler, latency]() mutable {
+        TRACE_SCOPE_ARG("http", uri);
+        if (!latency) latency = metricsHistogram("http_us", "route", uri);
+        unsigned long start = micros();
+        handler();
+        latency->record(micros() - start);
+    });
 }
 
 //-------------------------------------------------------------------------------
@@ -445,14 +1591,27 @@ void setupServer() {
     createDummyFileIfNotExists();
 
     // Bind URL paths to handler functions
-    server.on("/", HTTP_GET, handleRoot);
-    server.on("/days", HTTP_GET, handleDays);
-    server.on("/drives", HTTP_GET, handleDrives);
-    server.on("/drive", HTTP_GET, handleDrive);
-    server.on("/live", HTTP_GET, handleLiveData);
-    server.on("/sdinfo", HTTP_GET, handleSDInfo);
-    server.on("/delete", HTTP_OPTIONS, handleDeleteOptions);
-    server.on("/delete", HTTP_DELETE, handleDelete);
+    route("/", HTTP_GET, handleRoot);
+    route("/days", HTTP_GET, handleDays);
+    route("/drives", HTTP_GET, handleDrives);
+    route("/drive", HTTP_GET, handleDrive);
+    route("/summary", HTTP_GET, handleSummary);
+    route("/overview", HTTP_GET, handleOverview);
+    route("/live", HTTP_GET, handleLiveData);
+    route("/segments", HTTP_GET, handleSegments);
+    route("/segment", HTTP_GET, handleSegment);
+    route("/sync", HTTP_GET, handleSync);
+    route("/sync/ack", HTTP_POST, handleSyncAck);
+    route("/star", HTTP_POST, handleStar);
+    route("/config", HTTP_GET, handleConfig);
+    route("/config", HTTP_POST, handleConfigUpdate);
+    route("/sdinfo", HTTP_GET, handleSDInfo);
+    route("/delete", HTTP_OPTIONS, handleDeleteOptions);
+    route("/delete", HTTP_DELETE, handleDelete);
+    route("/delete/status", HTTP_GET, handleDeleteStatus);
+    route("/trace", HTTP_GET, handleTrace);
+    route("/metrics", HTTP_GET, handleMetrics);
+    route("/tasks", HTTP_GET, handleTasks);
 
     // Boost Wi-Fi transmit power 
     WiFi.setTxPower(WIFI_POWER_19_5dBm);
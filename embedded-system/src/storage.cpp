@@ -0,0 +1,61 @@
+#include "storage.hpp"
+#include "delete_job.hpp"
+#include "retention.hpp"
+#include "sd_mutex.hpp"
+
+// External SD filesystem instance and mutex
+extern SdFat SD;
+extern SemaphoreHandle_t sdMutex;
+
+static bool scanFailed = false;
+
+
+//-------------------------------------------------------------------------------
+// Counts free clusters in slices after mount. SdFat keeps the count up to date
+// on every allocate/free from then on (MAINTAIN_FREE_CLUSTER_COUNT), so
+// /sdinfo never has to read the whole FAT.
+//-------------------------------------------------------------------------------
+static void freeScanStep() {
+    static unsigned long lastStep = 0;
+    static unsigned long startedAt = 0;
+    if (scanFailed || millis() - lastStep < FREE_SCAN_INTERVAL) return;
+    lastStep = millis();
+
+    if (sdMutexTake(0) != pdTRUE) return;
+    FsVolume* vol = SD.vol();
+    if (vol && vol->fatType() && !vol->freeClusterCountKnown()) {
+        if (startedAt == 0) startedAt = millis();
+        int8_t rc = vol->freeClusterCountStep(FREE_SCAN_SECTORS);
+        if (rc < 0) {
+            scanFailed = true;
+            Serial.println("Free cluster scan failed.");
+        } else if (rc > 0) {
+            Serial.printf("Free clusters counted: %ld in %lu ms\n",
+                          (long)vol->freeClusterCount(), millis() - startedAt);
+        }
+    }
+    sdMutexGive();
+}
+
+
+void storageService() {
+    freeScanStep();
+    deleteJobService();
+    retentionService();
+}
+
+
+bool storageFreeKnown() {
+    FsVolume* vol = SD.vol();
+    return vol && vol->fatType() && vol->freeClusterCountKnown();
+}
+
+
+bool storageSpace(uint64_t& totalBytes, uint64_t& freeBytes) {
+    if (!storageFreeKnown()) return false;
+    FsVolume* vol = SD.vol();
+    uint64_t bytesPerCluster = (uint64_t)vol->sectorsPerCluster() * 512;
+    totalBytes = vol->clusterCount() * bytesPerCluster;
+    freeBytes = vol->freeClusterCount() * bytesPerCluster;
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "task_stats.hpp"
+
+static TaskInfo tasks[TASK_STATS_MAX];
+static size_t taskCount = 0;
+static size_t taskTotal = 0;
+
+static SystemSample history[TASK_STATS_HISTORY];
+static size_t historyHead = 0;          // Next slot to write
+static size_t historySize = 0;
+
+static TaskHandle_t watched[TASK_STATS_MAX];
+static size_t watchedCount = 0;
+
+
+void taskStatsWatch(TaskHandle_t task) {
+    if (task && watchedCount < TASK_STATS_MAX) watched[watchedCount++] = task;
+}
+
+
+#if configUSE_TRACE_FACILITY
+
+// Run time of each task at the previous sample, to turn totals into shares
+struct RunTimeMark {
+    TaskHandle_t task;
+    uint32_t runTime;
+    uint64_t sum;               // runTime widened across wraps
+};
+
+static TaskStatus_t snapshot[TASK_STATS_MAX * 2];
+static RunTimeMark marks[TASK_STATS_MAX * 2];
+static size_t markCount = 0;
+static uint64_t sums[TASK_STATS_MAX * 2];
+static uint32_t lastTotal = 0;
+
+
+static const RunTimeMark* previousMark(TaskHandle_t task) {
+    for (size_t i = 0; i < markCount; i++) {
+        if (marks[i].task == task) return &marks[i];
+    }
+    return nullptr;     // New task: nothing to compare against yet
+}
+
+
+//-------------------------------------------------------------------------------
+// Core load is 100 % less the idle task's share when the core has one, else
+// the sum of the tasks pinned to it. Counter differences are taken as
+// unsigned 32 bits, which is right across one wrap; samples are seconds
+// apart and the counter wraps after about 71 minutes at 1 MHz.
+//-------------------------------------------------------------------------------
+void taskStatsSample(const TaskStatus_t* status, UBaseType_t n, uint32_t total, SystemSample& sample) {
+    if (n > TASK_STATS_MAX * 2) n = TASK_STATS_MAX * 2;
+    uint32_t elapsed = total - lastTotal;
+    float busy[2] = { 0, 0 };
+    float idle[2] = { -1, -1 };
+
+    taskCount = 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t& s = status[i];
+        int core = -1;
+#if configTASKLIST_INCLUDE_COREID
+        if (s.xCoreID == 0 || s.xCoreID == 1) core = s.xCoreID;
+#endif
+        float percent = 0;
+        sums[i] = 0;
+#if configGENERATE_RUN_TIME_STATS
+        const RunTimeMark* mark = previousMark(s.xHandle);
+        uint32_t advance = mark ? s.ulRunTimeCounter - mark->runTime : 0;
+        sums[i] = mark ? mark->sum + advance : s.ulRunTimeCounter;
+        if (elapsed > 0) percent = 100.0f * advance / elapsed;
+#endif
+        bool isIdle = strncmp(s.pcTaskName, TASK_STATS_IDLE, strlen(TASK_STATS_IDLE)) == 0;
+        if (core >= 0) {
+            if (isIdle) idle[core] = percent;
+            else busy[core] += percent;
+        }
+
+        if (taskCount < TASK_STATS_MAX) {
+            TaskInfo& info = tasks[taskCount++];
+            strncpy(info.name, s.pcTaskName, sizeof(info.name) - 1);
+            info.name[sizeof(info.name) - 1] = '\0';
+            info.core = core;
+            info.priority = s.uxCurrentPriority;
+            info.stackFree = s.usStackHighWaterMark;
+            info.runtimeMs = sums[i] / 1000;
+            info.cpuPercent = percent;
+        }
+    }
+
+    markCount = 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        marks[markCount++] = { status[i].xHandle, status[i].ulRunTimeCounter, sums[i] };
+    }
+    bool known = TASK_STATS_RUN_TIME && lastTotal != 0 && elapsed > 0;
+    lastTotal = total;
+    for (int core = 0; core < 2; core++) {
+        float load = idle[core] >= 0 ? 100 - idle[core] : busy[core];
+        sample.load[core] = known ? (int8_t)constrain(load + 0.5f, 0.0f, 100.0f) : -1;
+    }
+}
+
+
+// Every task from uxTaskGetSystemState()
+static void sampleTasks(SystemSample& sample) {
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(snapshot, TASK_STATS_MAX * 2, &total);
+    taskTotal = uxTaskGetNumberOfTasks();
+    taskStatsSample(snapshot, n, total, sample);
+}
+
+#else
+
+// Only the watched tasks, with their stack high-water marks
+static void sampleTasks(SystemSample& sample) {
+    taskTotal = uxTaskGetNumberOfTasks();
+    taskCount = 0;
+    for (size_t i = 0; i < watchedCount; i++) {
+        TaskInfo& info = tasks[taskCount++];
+        memset(&info, 0, sizeof(info));
+        strncpy(info.name, pcTaskGetName(watched[i]), sizeof(info.name) - 1);
+        info.core = -1;
+        info.stackFree = uxTaskGetStackHighWaterMark(watched[i]);
+    }
+    sample.load[0] = sample.load[1] = -1;
+}
+
+#endif
+
+
+void taskStatsService() {
+    static unsigned long lastSample = 0;
+    if (historySize > 0 && millis() - lastSample < TASK_STATS_INTERVAL) return;
+    lastSample = millis();
+
+    SystemSample& sample = history[historyHead];
+    sample.uptimeSec = millis() / 1000;
+    sample.heapFree = ESP.getFreeHeap();
+    sample.heapMinFree = ESP.getMinFreeHeap();
+    sample.heapLargest = ESP.getMaxAllocHeap();
+    sample.psramFree = ESP.getFreePsram();
+    sample.psramLargest = ESP.getMaxAllocPsram();
+    sampleTasks(sample);
+
+    historyHead = (historyHead + 1) % TASK_STATS_HISTORY;
+    if (historySize < TASK_STATS_HISTORY) historySize++;
+}
+
+
+const TaskInfo* taskStatsTasks(size_t& count, size_t& total) {
+    count = taskCount;
+    total = taskTotal;
+    return tasks;
+}
+
+
+size_t taskStatsHistorySize() {
+    return historySize;
+}
+
+
+const SystemSample& taskStatsHistory(size_t i) {
+    return history[(historyHead + TASK_STATS_HISTORY - historySize + i) % TASK_STATS_HISTORY];
+}
+
+
+void taskStatsToJson(JsonObject out) {
+    out["task_count"] = (uint32_t)taskTotal;
+    JsonArray list = out["tasks"].to<JsonArray>();
+    for (size_t i = 0; i < taskCount; i++) {
+        JsonObject task = list.add<JsonObject>();
+        task["name"] = tasks[i].name;
+        task["core"] = tasks[i].core;
+        task["priority"] = tasks[i].priority;
+        task["stack_free"] = tasks[i].stackFree;
+#if TASK_STATS_RUN_TIME
+        task["runtime_ms"] = tasks[i].runtimeMs;
+        task["cpu_pct"] = roundf(tasks[i].cpuPercent * 10) / 10;
+#endif
+    }
+}
+
+
+void systemSampleToJson(const SystemSample& sample, JsonObject out) {
+    out["heap_free"] = sample.heapFree;
+    out["heap_min_free"] = sample.heapMinFree;
+    out["heap_largest_block"] = sample.heapLargest;
+    out["psram_free"] = sample.psramFree;
+    out["psram_largest_block"] = sample.psramLargest;
+#if TASK_STATS_RUN_TIME
+    JsonArray load = out["load_pct"].to<JsonArray>();
+    load.add(sample.load[0]);
+    load.add(sample.load[1]);
+#endif
+}
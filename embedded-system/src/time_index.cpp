@@ -0,0 +1,145 @@
+#include "time_index.hpp"
+#include "journey.hpp"
+#include "segment.hpp"
+#include "record_reader.hpp"
+
+// External SD filesystem instance
+extern SdFat SD;
+
+// Writer state for the journey being logged
+static char indexJourney[40];
+static uint32_t records = 0;
+static uint32_t elapsed = 0;
+static char lastTime[10];
+
+
+void timeIndexBegin(const char* journeyPath) {
+    strncpy(indexJourney, journeyPath, sizeof(indexJourney) - 1);
+    indexJourney[sizeof(indexJourney) - 1] = '\0';
+    records = 0;
+    elapsed = 0;
+    lastTime[0] = '\0';
+}
+
+
+void timeIndexUpdate(const char* time, uint64_t offset) {
+    if (records > 0) elapsed += journeyTimeDelta(lastTime, time);
+    strncpy(lastTime, time, sizeof(lastTime) - 1);
+    lastTime[sizeof(lastTime) - 1] = '\0';
+    if (records++ % TIME_INDEX_EVERY != 0) return;
+
+    char path[48];
+    if (!journeySidecarPath(indexJourney, TIME_INDEX_EXT, path, sizeof(path))) return;
+    FsFile file = SD.open(path, O_WRONLY | O_CREAT | O_AT_END);
+    if (!file) {
+        Serial.printf("Failed to open time index: %s\n", path);
+        return;
+    }
+    if (file.fileSize() == 0) {
+        TimeIndexHeader header = {};
+        header.magic = TIME_INDEX_MAGIC;
+        strncpy(header.startTime, time, sizeof(header.startTime) - 1);
+        file.write(&header, sizeof(header));
+    }
+    TimeIndexEntry entry = { elapsed, (uint32_t)offset };
+    file.write(&entry, sizeof(entry));
+    file.close();
+}
+
+
+//-------------------------------------------------------------------------------
+// Times are only "HH:MM:SS", so a time past the end of the journey and one
+// before its start look alike; take whichever is nearer on the clock.
+//-------------------------------------------------------------------------------
+static bool beforeStart(uint32_t target, uint32_t duration) {
+    return target > duration && 86400 - target < target - duration;
+}
+
+
+static bool readEntry(FsFile& file, uint32_t index, TimeIndexEntry& entry) {
+    return file.seekSet(sizeof(TimeIndexHeader) + (uint64_t)index * sizeof(entry)) &&
+           file.read(&entry, sizeof(entry)) == sizeof(entry);
+}
+
+
+bool timeIndexSeek(const char* journeyPath, const char* time, uint64_t size, uint64_t& offset) {
+    char path[48];
+    if (!journeySidecarPath(journeyPath, TIME_INDEX_EXT, path, sizeof(path))) return false;
+    FsFile file = SD.open(path, O_READ);
+    if (!file) return false;
+
+    TimeIndexHeader header;
+    if (file.read(&header, sizeof(header)) != sizeof(header) || header.magic != TIME_INDEX_MAGIC) {
+        file.close();
+        return false;
+    }
+    header.startTime[sizeof(header.startTime) - 1] = '\0';
+    uint32_t count = (file.fileSize() - sizeof(header)) / sizeof(TimeIndexEntry);
+
+    // Offsets only grow, so the entries still inside the journey are a prefix
+    TimeIndexEntry entry;
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (!readEntry(file, mid, entry)) break;
+        if (entry.offset < size) lo = mid + 1; else hi = mid;
+    }
+    uint32_t usable = lo;
+    if (usable == 0 || !readEntry(file, usable - 1, entry)) {
+        file.close();
+        return false;
+    }
+
+    uint32_t target = journeyTimeDelta(header.startTime, time);
+    if (beforeStart(target, entry.elapsed)) {
+        offset = 0;
+        file.close();
+        return true;
+    }
+
+    // Last entry at or before the target (entry 0 is always at elapsed 0)
+    lo = 0;
+    hi = usable;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (!readEntry(file, mid, entry)) break;
+        if (entry.elapsed <= target) lo = mid; else hi = mid;
+    }
+    bool ok = readEntry(file, lo, entry);
+    file.close();
+    if (ok) offset = entry.offset;
+    return ok;
+}
+
+
+bool timeIndexScan(JourneyFile& file, const char* time, uint64_t& offset) {
+    if (!file.seekSet(0)) return false;
+
+    JsonDocument filter;
+    filter["gps"]["time"] = true;
+    JsonDocument doc;
+    RecordReader reader(file);
+    size_t len;
+    const char* line;
+    char first[10] = "", last[10] = "";
+    uint32_t target = 0, scanElapsed = 0;
+    while ((line = reader.next(len)) != nullptr) {
+        if (recordDeserialize(doc, line, len, reader.encoding(), filter)) continue;
+        const char* t = doc["gps"]["time"] | "";
+        if (!t[0]) continue;
+        if (!first[0]) {
+            strncpy(first, t, sizeof(first) - 1);
+            strcpy(last, first);
+            target = journeyTimeDelta(first, time);
+        }
+        scanElapsed += journeyTimeDelta(last, t);
+        strncpy(last, t, sizeof(last) - 1);
+        if (scanElapsed >= target) {
+            offset = reader.recordOffset();
+            return true;
+        }
+    }
+    if (!first[0]) return false;
+    offset = beforeStart(target, scanElapsed) ? 0 : file.size();
+    return true;
+}
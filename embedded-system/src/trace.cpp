@@ -0,0 +1,173 @@
+#include "trace.hpp"
+#include <SdFat.h>
+#include <esp_timer.h>
+
+// External SD filesystem instance
+extern SdFat SD;
+
+#if TRACE_ENABLED
+
+struct TraceEvent {
+    const char* name;
+    const char* arg;
+    const char* task;
+    uint64_t start;             // CPU cycles since boot
+    uint32_t cycles;            // Duration
+    char phase;                 // 'X' slice, 'i' instant
+    uint32_t seq;               // Event number + 1 once written, 0 while being written
+};
+
+struct TraceRing {
+    uint32_t head;              // Next event number
+    uint32_t since;             // First event number to export
+    TraceEvent events[TRACE_RING_EVENTS];
+};
+
+static TraceRing rings[TRACE_CORES];
+
+
+//-------------------------------------------------------------------------------
+// The 32-bit cycle counter wraps every 18 s at 240 MHz. The high bits come
+// from esp_timer, which counts from boot as the cycle counter does; the two
+// drift apart by far less than half a wrap, so the nearest 64-bit value with
+// the counter's low bits is the right one.
+//-------------------------------------------------------------------------------
+static uint64_t traceNow() {
+    uint32_t cycles = ESP.getCycleCount();
+    uint64_t estimate = (uint64_t)esp_timer_get_time() * ESP.getCpuFreqMHz();
+    uint64_t now = (estimate & ~0xFFFFFFFFull) | cycles;
+    int64_t error = (int64_t)(now - estimate);
+    if (error > 0x80000000ll && now >= 0x100000000ull) now -= 0x100000000ull;
+    else if (error < -0x80000000ll) now += 0x100000000ull;
+    return now;
+}
+
+
+static void traceRecord(char phase, const char* name, const char* arg, uint64_t start, uint32_t cycles) {
+    TraceRing& ring = rings[xPortGetCoreID() % TRACE_CORES];
+    uint32_t number = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED);
+    TraceEvent& event = ring.events[number % TRACE_RING_EVENTS];
+    __atomic_store_n(&event.seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event.name = name;
+    event.arg = arg;
+    event.task = pcTaskGetName(NULL);
+    event.start = start;
+    event.cycles = cycles;
+    event.phase = phase;
+    __atomic_store_n(&event.seq, number + 1, __ATOMIC_RELEASE);
+}
+
+
+TraceScope::TraceScope(const char* name, const char* arg) : m_name(name), m_arg(arg), m_start(traceNow()) {}
+
+
+TraceScope::~TraceScope() {
+    uint64_t end = traceNow();
+    traceRecord('X', m_name, m_arg, m_start, (uint32_t)(end - m_start));
+}
+
+
+void traceInstant(const char* name, const char* arg) {
+    traceRecord('i', name, arg, traceNow(), 0);
+}
+
+
+void traceClear() {
+    for (TraceRing& ring : rings) {
+        ring.since = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+    }
+}
+
+
+#define TRACE_TASKS 8           // Distinct tasks named in one export
+
+size_t traceWrite(TraceSink sink, void* context) {
+    const char* tasks[TRACE_TASKS] = {};
+    int taskCore[TRACE_TASKS];
+    double mhz = ESP.getCpuFreqMHz();
+    char buf[256];
+    size_t count = 0;
+
+    const char* header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    sink(header, strlen(header), context);
+    for (int core = 0; core < TRACE_CORES; core++) {
+        TraceRing& ring = rings[core];
+        uint32_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+        uint32_t first = head - ring.since > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : ring.since;
+        for (uint32_t number = first; number != head; number++) {
+            // Copy, then keep the copy only if no writer touched the slot meanwhile
+            TraceEvent& slot = ring.events[number % TRACE_RING_EVENTS];
+            if (__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != number + 1) continue;
+            TraceEvent event = slot;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot.seq, __ATOMIC_RELAXED) != number + 1) continue;
+
+            int tid = 0;
+            while (tid < TRACE_TASKS && tasks[tid] && tasks[tid] != event.task) tid++;
+            if (tid == TRACE_TASKS) tid = TRACE_TASKS - 1;
+            if (!tasks[tid]) {
+                tasks[tid] = event.task;
+                taskCore[tid] = core;
+            }
+
+            char extra[24];
+            if (event.phase == 'X') snprintf(extra, sizeof(extra), ",\"dur\":%.3f", event.cycles / mhz);
+            else strcpy(extra, ",\"s\":\"t\"");
+            char args[64] = "";
+            if (event.arg) snprintf(args, sizeof(args), ",\"args\":{\"detail\":\"%s\"}", event.arg);
+            int n = snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d%s%s}",
+                             count ? "," : "", event.name, event.phase, event.start / mhz, core, tid + 1, extra, args);
+            sink(buf, min((size_t)n, sizeof(buf) - 1), context);
+            count++;
+        }
+    }
+
+    // Metadata: a process per core and a thread per task
+    bool first = count == 0;
+    for (int core = 0; core < TRACE_CORES; core++) {
+        int n = snprintf(buf, sizeof(buf),
+                         "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Core %d\"}}",
+                         first ? "" : ",", core, core);
+        sink(buf, n, context);
+        first = false;
+    }
+    for (int tid = 0; tid < TRACE_TASKS && tasks[tid]; tid++) {
+        int n = snprintf(buf, sizeof(buf),
+                         ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                         taskCore[tid], tid + 1, tasks[tid]);
+        sink(buf, min((size_t)n, sizeof(buf) - 1), context);
+    }
+    sink("]}", 2, context);
+    return count;
+}
+
+#else
+
+size_t traceWrite(TraceSink sink, void* context) {
+    const char* empty = "{\"traceEvents\":[]}";
+    sink(empty, strlen(empty), context);
+    return 0;
+}
+
+
+void traceClear() {}
+
+#endif
+
+
+static void fileSink(const char* data, size_t length, void* context) {
+    ((FsFile*)context)->write(data, length);
+}
+
+
+size_t traceSave() {
+    FsFile file = SD.open(TRACE_SD_PATH, O_WRONLY | O_CREAT | O_TRUNC);
+    if (!file) {
+        Serial.printf("Failed to create trace: %s\n", TRACE_SD_PATH);
+        return 0;
+    }
+    size_t count = traceWrite(fileSink, &file);
+    file.close();
+    return count;
+}
@@ -0,0 +1,64 @@
+#include "ubx_capture.hpp"
+#include "config.hpp"
+#include "journey.hpp"
+#include <SdFat.h>
+#include <SparkFun_u-blox_GNSS_Arduino_Library.h>
+
+// External SD filesystem instance
+extern SdFat SD;
+
+// Journey the capture is appended to
+static char captureJourney[40];
+
+
+void ubxCaptureSetup(SFE_UBLOX_GNSS& gnss) {
+    if (loggerConfig.ubxCapture) gnss.setFileBufferSize(UBX_CAPTURE_BUFFER);
+}
+
+
+//-------------------------------------------------------------------------------
+// The library only allocates a message's storage, and with it the flag that
+// sends it to the file buffer, when the message is first polled
+//-------------------------------------------------------------------------------
+void ubxCaptureEnable(SFE_UBLOX_GNSS& gnss) {
+    if (!loggerConfig.ubxCapture) return;
+    gnss.getPVT();
+    gnss.getEsfIns();
+    gnss.getEsfInfo();
+    gnss.logNAVPVT();
+    gnss.logESFINS();
+    gnss.logESFSTATUS();
+}
+
+
+void ubxCaptureBegin(const char* journeyPath) {
+    strncpy(captureJourney, journeyPath, sizeof(captureJourney) - 1);
+    captureJourney[sizeof(captureJourney) - 1] = '\0';
+}
+
+
+//-------------------------------------------------------------------------------
+// Moves whatever the library has buffered since the last record to the
+// sidecar. Frames are stored whole, so the file is always a valid stream.
+//-------------------------------------------------------------------------------
+void ubxCaptureDrain(SFE_UBLOX_GNSS& gnss) {
+    if (!loggerConfig.ubxCapture || !captureJourney[0]) return;
+    uint16_t available = gnss.fileBufferAvailable();
+    if (available == 0) return;
+
+    char path[48];
+    if (!journeySidecarPath(captureJourney, UBX_CAPTURE_EXT, path, sizeof(path))) return;
+    FsFile file = SD.open(path, O_WRONLY | O_CREAT | O_AT_END);
+    if (!file) {
+        Serial.printf("Failed to open UBX capture: %s\n", path);
+        return;
+    }
+    uint8_t chunk[256];
+    while (available > 0) {
+        uint16_t n = gnss.extractFileBufferData(chunk, min(available, (uint16_t)sizeof(chunk)));
+        if (n == 0) break;
+        file.write(chunk, n);
+        available -= n;
+    }
+    file.close();
+}
@@ -9,14 +9,46 @@
 
 
 #include "../src/obd.cpp"
+#include "../src/journey.cpp"
+#include "../src/overview.cpp"
+#include "../src/record_reader.cpp"
+#include "../src/record_query.cpp"
+#include "../src/segment.cpp"
+#include "../src/sd_mutex.cpp"
+#include "../src/delete_job.cpp"
+#include "../src/time_index.cpp"
+#include "../src/block_codec.cpp"
+#include "../src/block_log.cpp"
+#include "../src/catalog.cpp"
+#include "../src/journal.cpp"
+#include "../src/storage.cpp"
+#include "../src/retention.cpp"
+#include "../src/record_codec.cpp"
+#include "../src/sd_spi_esp32.cpp"
+#include "../src/trace.cpp"
+#include "../src/metrics.cpp"
+#include "../src/cycle_monitor.cpp"
+#include "../src/task_stats.cpp"
+#ifdef NATIVE
+#include "sim_block_device.hpp"
+#include "sim_ublox.hpp"
+#include "sim_vehicle.hpp"
+#endif
 
 #define SD_CS_PIN A0
+// Card config matching the firmware's SPI driver selection (platformio.ini)
+#if SPI_DRIVER_SELECT == 3
+#define SD_TEST_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(10), &sdSpi)
+#else
+#define SD_TEST_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SD_SCK_MHZ(10))
+#endif
 #define BUTTON_PIN  A1
 #define LED_PIN     A2
 
 SFE_UBLOX_GNSS myGNSS;
 OBD obd;
 SdFat SD;
+SemaphoreHandle_t sdMutex;
 
 // ------------------ setUp and tearDown ------------------
 void setUp() {
@@ -29,7 +61,7 @@ void setUp() {
   digitalWrite(LED_PIN, LOW);        
   
   // Initialize SD card (for SD tests)
-  bool sdInit = SD.begin(SD_CS_PIN, SD_SCK_MHZ(10));
+  bool sdInit = SD.begin(SD_TEST_CONFIG);
   Serial.printf("SD init: %s\n", sdInit ? "SUCCESS" : "FAILED");
 }
 
@@ -89,6 +121,40 @@ void test_gnss_dead_reckoning_data(void) {
   }
 }
 
+#ifdef NATIVE
+// Replays a captured NAV-PVT frame into the library: the position must be
+// the capture's, not the drive model's
+void test_gnss_ubx_replay(void) {
+  uint8_t frame[100] = { 0xB5, 0x62, 0x01, 0x07, 92, 0 };
+  uint8_t* pvt = &frame[6];
+  int32_t lat = 100000000, lon = 200000000;   // 10.0, 20.0
+  pvt[11] = 0x07;
+  pvt[20] = 3;
+  pvt[23] = 12;
+  memcpy(&pvt[24], &lon, 4);
+  memcpy(&pvt[28], &lat, 4);
+  uint8_t a = 0, b = 0;
+  for (int i = 2; i < 98; i++) {
+    a += frame[i];
+    b += a;
+  }
+  frame[98] = a;
+  frame[99] = b;
+  FILE* f = fopen("test_replay.ubx", "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  fwrite(frame, 1, sizeof(frame), f);
+  fclose(f);
+
+  TEST_ASSERT_TRUE(simUblox.replay("test_replay.ubx", false));
+  TEST_ASSERT_TRUE(myGNSS.getPVT());
+  simUblox.stopReplay();
+  remove("test_replay.ubx");
+  TEST_ASSERT_EQUAL_INT32(lat, myGNSS.getLatitude());
+  TEST_ASSERT_EQUAL_INT32(lon, myGNSS.getLongitude());
+  TEST_ASSERT_EQUAL_UINT8(12, myGNSS.getSIV());
+}
+#endif
+
 // ------------------ OBD Functionality Tests ------------------
 void test_obd_initialise(void) {
   bool initResult = obd.initialise();
@@ -179,10 +245,16 @@ void test_calculateAverageMPG_zeroMAF(void) {
 }
 
 void test_obd_timeout(void) {
+#ifdef NATIVE
+  simVehicleSetIgnition(false);  // The fake ECU stops answering
+#endif
   int dummy = 0;
   unsigned long start = millis();
   bool ok = obd.readSpeed(dummy);  
   unsigned long elapsed = millis() - start;
+#ifdef NATIVE
+  simVehicleSetIgnition(true);
+#endif
 
   TEST_ASSERT_TRUE_MESSAGE(elapsed < OBD_TIMEOUT_LONG,
     "OBD readSpeed hung longer than 500ms"
@@ -192,10 +264,297 @@ void test_obd_timeout(void) {
     "OBD readSpeed should return false on timeout"
   );
 }
+// ------------------ Journey Summary Tests ------------------
+void test_haversine_known_distance(void) {
+  // One degree of latitude is ~111.19 km
+  double km = haversineKm(51.0, -2.0, 52.0, -2.0);
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 111.19, km);
+}
+
+void test_journey_stats_aggregates(void) {
+  JourneyStats stats;
+  journeyStatsBegin(stats, "2025-03-04/12-00-00.json");
+  TelemetrySample a = { "12:00:00", 51.4545, -2.5879, 800, 0, 2.0, 0, 10, 0, 0, 0 };
+  TelemetrySample b = { "12:00:01", 51.4546, -2.5879, 2000, 36, 8.0, 30.0, 40, 30.0, 350, 0 };
+  TelemetrySample c = { "12:00:02", 51.4547, -2.5879, 2100, 40, 9.0, 28.0, 45, 29.0, 360, -450 };
+  journeyStatsUpdate(stats, a, 1.0);
+  journeyStatsUpdate(stats, b, 1.0);
+  journeyStatsUpdate(stats, c, 1.0);
+
+  TEST_ASSERT_EQUAL_UINT32(3, stats.samples);
+  TEST_ASSERT_EQUAL_FLOAT(2.0, stats.durationSec);   // First sample has no interval
+  TEST_ASSERT_EQUAL_FLOAT(2.0, stats.movingSec);
+  TEST_ASSERT_FLOAT_WITHIN(0.002, 0.0222, stats.distanceKm);
+  TEST_ASSERT_EQUAL_FLOAT(800, stats.rpm.min);
+  TEST_ASSERT_EQUAL_FLOAT(2100, stats.rpm.max);
+  TEST_ASSERT_EQUAL(1, stats.harshAccel);             // One excursion, two samples
+  TEST_ASSERT_EQUAL(1, stats.harshCorner);
+  TEST_ASSERT_EQUAL_STRING("12:00:00", stats.startTime);
+  TEST_ASSERT_EQUAL_STRING("12:00:02", stats.endTime);
+}
+
+void test_journey_sidecar_path(void) {
+  char path[48];
+  TEST_ASSERT_TRUE(journeySidecarPath("2025-03-04/12-00-00.json", SUMMARY_EXT, path, sizeof(path)));
+  TEST_ASSERT_EQUAL_STRING("2025-03-04/12-00-00.sum", path);
+}
+
+void test_journey_parse_record(void) {
+  const char* line =
+    "{\"gps\":{\"time\":\"16:09:35\",\"latitude\":40.7590,\"longitude\":-73.9850},"
+    "\"obd\":{\"rpm\":217,\"speed\":12,\"maf\":2.97,\"instant_mpg\":0,"
+    "\"throttle\":14,\"avg_mpg\":0},\"imu\":{\"accel_x\":3,\"accel_y\":-4}}";
+  TelemetrySample sample;
+  char time[10];
+  TEST_ASSERT_TRUE(journeyParseRecord(line, strlen(line), sample, time, sizeof(time)));
+  TEST_ASSERT_EQUAL_STRING("16:09:35", sample.time);
+  TEST_ASSERT_EQUAL(217, sample.rpm);
+  TEST_ASSERT_EQUAL(12, sample.speed);
+  TEST_ASSERT_EQUAL(-4, sample.accelY);
+  // A torn record is rejected
+  TEST_ASSERT_FALSE(journeyParseRecord(line, 40, sample, time, sizeof(time)));
+}
+
+void test_journey_time_delta_midnight(void) {
+  TEST_ASSERT_EQUAL_FLOAT(3.0, journeyTimeDelta("16:09:32", "16:09:35"));
+  TEST_ASSERT_EQUAL_FLOAT(2.0, journeyTimeDelta("23:59:59", "00:00:01"));
+}
+
+void test_record_field_filter(void) {
+  JsonDocument filter;
+  TEST_ASSERT_TRUE(recordFieldFilter("obd.speed, gps , obd.rpm", filter));
+  // gps.time is implied, and a whole group wins over its channels
+  TEST_ASSERT_TRUE(filter["gps"].as<bool>());
+  TEST_ASSERT_TRUE(filter["obd"]["speed"].as<bool>());
+  TEST_ASSERT_TRUE(filter["obd"]["rpm"].as<bool>());
+  TEST_ASSERT_FALSE(filter["obd"]["maf"].as<bool>());
+
+  JsonDocument keep;
+  TEST_ASSERT_TRUE(recordFieldFilter("", keep));
+  TEST_ASSERT_TRUE(keep.as<bool>());
+
+  JsonDocument bad;
+  TEST_ASSERT_FALSE(recordFieldFilter("obd.speed.max", bad));
+  TEST_ASSERT_FALSE(recordFieldFilter(".speed", bad));
+}
+
+void test_record_window_midnight(void) {
+  // A drive from 23:59:58 to 00:00:03, one record a second
+  const char* times[] = {"23:59:58", "23:59:59", "00:00:00", "00:00:01", "00:00:02", "00:00:03"};
+  RecordWindow window;
+
+  // A window across midnight
+  TEST_ASSERT_TRUE(window.begin("23:59:59", "00:00:01"));
+  const int across[] = {-1, 0, 0, 0, 1, 1};
+  for (int i = 0; i < 6; i++) TEST_ASSERT_EQUAL(across[i], window.check(times[i]));
+
+  // Open ends; a bound before the first record
+  TEST_ASSERT_TRUE(window.begin("23:00:00", ""));
+  for (int i = 0; i < 6; i++) TEST_ASSERT_EQUAL(0, window.check(times[i]));
+  TEST_ASSERT_TRUE(window.begin("", "00:00:00"));
+  const int upTo[] = {0, 0, 0, 1, 1, 1};
+  for (int i = 0; i < 6; i++) TEST_ASSERT_EQUAL(upTo[i], window.check(times[i]));
+
+  // A record without a time keeps the previous one's place
+  TEST_ASSERT_TRUE(window.begin("00:00:00", ""));
+  TEST_ASSERT_EQUAL(-1, window.check("23:59:58"));
+  TEST_ASSERT_EQUAL(-1, window.check(""));
+  TEST_ASSERT_EQUAL(0, window.check("00:00:00"));
+
+  TEST_ASSERT_FALSE(window.begin("0:00", ""));
+  TEST_ASSERT_FALSE(window.begin("", "12-00-00"));
+}
+
+void test_record_encodings_round_trip(void) {
+  const char* line =
+    "{\"gps\":{\"time\":\"16:09:35\",\"latitude\":40.759,\"longitude\":-73.985},"
+    "\"obd\":{\"rpm\":217,\"speed\":12,\"maf\":2.97,\"instant_mpg\":0,"
+    "\"throttle\":14,\"avg_mpg\":0},\"imu\":{\"accel_x\":3,\"accel_y\":-2}}";
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, line));
+
+  for (uint8_t e = ENCODING_MSGPACK; e < ENCODING_COUNT; e++) {
+    RecordEncoding encoding = (RecordEncoding)e;
+    uint8_t buf[RECORD_MAX_LEN];
+    size_t n = recordSerialize(doc, encoding, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(n > 0 && n < strlen(line));
+    TEST_ASSERT_EQUAL(n, recordItemLength(buf, n, encoding));
+    TEST_ASSERT_EQUAL(0, recordItemLength(buf, n - 1, encoding));
+
+    TelemetrySample sample;
+    char time[10];
+    TEST_ASSERT_TRUE(journeyParseRecord((const char*)buf, n, sample, time, sizeof(time), encoding));
+    TEST_ASSERT_EQUAL_STRING("16:09:35", sample.time);
+    TEST_ASSERT_EQUAL(217, sample.rpm);
+    TEST_ASSERT_EQUAL(-2, sample.accelY);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 2.97, sample.maf);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, -73.985, sample.longitude);
+  }
+
+  // CBOR negative integers wider than 32 bits; past int64_t is rejected
+  const uint8_t wide[] = { 0xA1, 0x61, 'n', 0x3B, 0, 0, 0, 1, 0, 0, 0, 0 };
+  TEST_ASSERT_FALSE(recordDeserialize(doc, (const char*)wide, sizeof(wide), ENCODING_CBOR));
+  TEST_ASSERT_TRUE(doc["n"].as<int64_t>() == -4294967297LL);
+  const uint8_t huge[] = { 0xA1, 0x61, 'n', 0x3B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  TEST_ASSERT_TRUE(recordDeserialize(doc, (const char*)huge, sizeof(huge), ENCODING_CBOR) ==
+                   DeserializationError::InvalidInput);
+}
+
+void test_block_codec_round_trip(void) {
+  static BlockEncoder encoder;
+  static uint8_t buf[BLOCK_MAX_BYTES];
+  BlockRecord in[3] = {
+    { 86399, 407590000, -739860000,   0,  0, 14, -19, -4, 0.94f, 0.0f,  0.0f },
+    {     0, 407590000, -739850000, 217,  0, 14,   3,  0, 2.97f, 0.0f,  0.0f },
+    {     3, 407580000, -739850000, 772, 12, 20,   1,  3, 8.33f, 31.5f, 28.2f },
+  };
+  for (const BlockRecord& r : in) TEST_ASSERT_TRUE(encoder.add(r));
+
+  size_t len = encoder.encode(buf, sizeof(buf));
+  TEST_ASSERT_TRUE(len > 0 && len < sizeof(in));
+
+  BlockRecord out[BLOCK_RECORDS];
+  size_t count = 0;
+  TEST_ASSERT_EQUAL(len, blockDecode(buf, len, out, count));
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL_MEMORY(in, out, sizeof(in));
+
+  // A truncated block is rejected
+  TEST_ASSERT_EQUAL(0, blockDecode(buf, len - 1, out, count));
+
+  // The header alone gives the same size and count
+  count = 0;
+  TEST_ASSERT_EQUAL(len, blockLength(buf, len, count));
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL(0, blockLength(buf, len - 1, count));
+}
+
+void test_trace_chrome_export(void) {
+  static struct { char text[2048]; size_t len; } out;
+  out.len = 0;
+  traceClear();
+  {
+    TRACE_SCOPE_ARG("test.scope", "010C");
+    delay(5);
+  }
+  TRACE_INSTANT("test.instant");
+
+  size_t events = traceWrite([](const char* data, size_t length, void* context) {
+    if (out.len + length < sizeof(out.text)) memcpy(out.text + out.len, data, length);
+    out.len += length;
+  }, nullptr);
+  TEST_ASSERT_TRUE(out.len < sizeof(out.text));
+  TEST_ASSERT_EQUAL(2, events);
+
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, out.text, out.len));
+  JsonObject slice = doc["traceEvents"][0];
+  TEST_ASSERT_EQUAL_STRING("test.scope", slice["name"]);
+  TEST_ASSERT_EQUAL_STRING("X", slice["ph"]);
+  TEST_ASSERT_EQUAL_STRING("010C", slice["args"]["detail"]);
+  TEST_ASSERT_TRUE(slice["dur"].as<double>() >= 5000);   // Microseconds
+  JsonObject instant = doc["traceEvents"][1];
+  TEST_ASSERT_EQUAL_STRING("i", instant["ph"]);
+  TEST_ASSERT_TRUE(instant["ts"].as<double>() >= slice["ts"].as<double>() + slice["dur"].as<double>());
+}
+
+void test_metrics_histogram(void) {
+  MetricHistogram* h = metricsHistogram("test_us", "case", "a");
+  TEST_ASSERT_EQUAL_PTR(h, metricsHistogram("test_us", "case", "a"));
+  TEST_ASSERT_NOT_EQUAL(h, metricsHistogram("test_us", "case", "b"));
+
+  for (uint32_t v = 1; v <= 1000; v++) h->record(v * 100);   // 100 us .. 100 ms
+  TEST_ASSERT_EQUAL(1000, h->count());
+  TEST_ASSERT_EQUAL(100000, h->max());
+  TEST_ASSERT_EQUAL(50050000ULL, h->sum());
+  // Within a bucket's width (19 %) of the exact percentile
+  TEST_ASSERT_UINT32_WITHIN(10000, 50000, h->percentile(50));
+  TEST_ASSERT_UINT32_WITHIN(19000, 99000, h->percentile(99));
+  TEST_ASSERT_EQUAL(100000, h->percentile(100));
+
+  metricsCounter("test_total")->add(3);
+  static char text[2048];
+  static size_t len;
+  len = 0;
+  metricsWrite([](const char* data, size_t length, void* context) {
+    if (len + length < sizeof(text)) memcpy(text + len, data, length);
+    len += length;
+  }, nullptr);
+  TEST_ASSERT_TRUE(len < sizeof(text));
+  text[len] = '\0';
+  TEST_ASSERT_NOT_NULL(strstr(text, "\ntest_us{case=\"a\"} count=1000 sum=50050000 "));
+  TEST_ASSERT_NOT_NULL(strstr(text, "\ntest_total 3\n"));
+}
+
+void test_cycle_monitor_overrun(void) {
+  CycleStats before = cycleStats();
+  cycleMonitorBegin();
+  TEST_ASSERT_EQUAL(0, cycleBegin());
+  {
+    CYCLE_PHASE(CYCLE_OBD);
+    delay(CYCLE_DEADLINE_MS / 2);
+    {
+      CYCLE_PHASE(CYCLE_SD_FLUSH);    // Nested: not charged to the OBD phase
+      delay(CYCLE_DEADLINE_MS * 3 / 4);
+    }
+  }
+  TEST_ASSERT_TRUE(cycleEnd());
+  TEST_ASSERT_EQUAL(before.overrunsBy[CYCLE_SD_FLUSH] + 1, cycleStats().overrunsBy[CYCLE_SD_FLUSH]);
+  TEST_ASSERT_EQUAL(before.overrunsBy[CYCLE_OBD], cycleStats().overrunsBy[CYCLE_OBD]);
+
+  // The next cycle starts at once, a quarter period into its slot
+  cycleWait();
+  uint32_t lateMs = cycleBegin();
+  TEST_ASSERT_UINT32_WITHIN(50, CYCLE_PERIOD_MS / 4, lateMs);
+  TEST_ASSERT_FALSE(cycleEnd());
+  TEST_ASSERT_EQUAL(before.late + 1, cycleStats().late);
+
+  // ... and the one after is back on the grid
+  unsigned long start = millis();
+  cycleWait();
+  TEST_ASSERT_EQUAL(0, cycleBegin());
+  TEST_ASSERT_UINT32_WITHIN(50, CYCLE_PERIOD_MS * 3 / 4, millis() - start);
+  cycleEnd();
+}
+
+void test_task_stats_run_time_wrap(void) {
+  // One task on core 0 whose 32-bit counter wraps between two snapshots
+  TaskStatus_t s = {};
+  s.xHandle = (TaskHandle_t)&s;
+  s.pcTaskName = "dataTask";
+  s.uxCurrentPriority = 2;
+  s.usStackHighWaterMark = 1234;
+  s.xCoreID = 0;
+  SystemSample sample = {};
+  s.ulRunTimeCounter = 0xFFFF0000;
+  taskStatsSample(&s, 1, 0x10000000, sample);
+  s.ulRunTimeCounter = 0x00010000;    // 0x20000 us later
+  taskStatsSample(&s, 1, 0x10000000 + 0x20000, sample);
+
+  JsonDocument doc;
+  taskStatsToJson(doc.to<JsonObject>());
+  JsonObject task = doc["tasks"][0];
+  TEST_ASSERT_EQUAL(1, doc["tasks"].size());
+  TEST_ASSERT_EQUAL_STRING("dataTask", task["name"]);
+  TEST_ASSERT_EQUAL(0, task["core"].as<int>());
+  TEST_ASSERT_EQUAL(2, task["priority"].as<int>());
+  TEST_ASSERT_EQUAL(1234, task["stack_free"].as<int>());
+  TEST_ASSERT_TRUE(task["runtime_ms"].as<uint64_t>() == (0xFFFF0000ULL + 0x20000) / 1000);
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, task["cpu_pct"].as<float>());
+
+  JsonDocument heap;
+  systemSampleToJson(sample, heap.to<JsonObject>());
+  TEST_ASSERT_TRUE(heap["heap_free"].is<uint32_t>());
+  TEST_ASSERT_TRUE(heap["heap_largest_block"].is<uint32_t>());
+  TEST_ASSERT_TRUE(heap["psram_largest_block"].is<uint32_t>());
+  TEST_ASSERT_EQUAL(100, heap["load_pct"][0].as<int>());
+  TEST_ASSERT_EQUAL(0, heap["load_pct"][1].as<int>());
+}
+
 // ------------------ SD Card Tests ------------------
 
 void test_sd_init(void) {
-  bool sdInit = SD.begin(SD_CS_PIN, SD_SCK_MHZ(10));
+  bool sdInit = SD.begin(SD_TEST_CONFIG);
   TEST_ASSERT_TRUE_MESSAGE(sdInit, "SD card failed to initialize");
 }
 
@@ -265,13 +624,13 @@ void test_sd_power_loss_during_write(void) {
   // 2) Write a partial JSON payload
   file.print("{\"partial\":");
   // 3) Simulate sudden power loss by re-initialising SD mid-write
-  SD.begin(SD_CS_PIN, SD_SCK_MHZ(10));
+  SD.begin(SD_TEST_CONFIG);
   // 4) Close the stale file handle
   file.close();
 
   // 5) Remount and verify FS is intact
   TEST_ASSERT_TRUE_MESSAGE(
-    SD.begin(SD_CS_PIN, SD_SCK_MHZ(10)),
+    SD.begin(SD_TEST_CONFIG),
     "SD re-init after simulated power-loss failed"
   );
   // 6) Check that the file still exists
@@ -326,6 +685,557 @@ void test_sd_concurrent_access(void) {
 }
 
 
+// ------------------ SD Record Reader Test ------------------
+
+void test_sd_record_reader(void) {
+  const char* fileName = "/reader.json";
+  FsFile file = SD.open(fileName, O_RDWR | O_CREAT | O_TRUNC);
+  TEST_ASSERT_TRUE_MESSAGE(file.isOpen(), "Reader test file open failed");
+  // Blank lines, a CRLF, an overlong line and a last record without a newline
+  file.print("{\"i\":0}\n\n{\"i\":1}\r\n");
+  for (int i = 0; i < RECORD_MAX_LEN + 10; i++) file.write('x');
+  file.print("\n{\"i\":2}");
+  file.close();
+
+  file = SD.open(fileName, O_RDONLY);
+  RecordReader reader(file);
+  size_t len;
+  const char* line = reader.next(len);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_EQUAL_STRING("{\"i\":0}", line);
+  TEST_ASSERT_EQUAL(0, (int)reader.recordOffset());
+  line = reader.next(len);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_EQUAL_STRING("{\"i\":1}", line);
+  TEST_ASSERT_EQUAL(9, (int)reader.recordOffset());
+  TEST_ASSERT_EQUAL(7, (int)len);
+  line = reader.next(len);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_EQUAL_STRING("{\"i\":2}", line);
+  TEST_ASSERT_EQUAL(18 + RECORD_MAX_LEN + 10 + 1, (int)reader.recordOffset());
+  TEST_ASSERT_NULL(reader.next(len));
+  file.close();
+  SD.remove(fileName);
+}
+
+// ------------------ SD Overview Test ------------------
+
+void test_sd_overview_buckets(void) {
+  const char* journey = "/ovtest.json";
+  SD.remove("/ovtest" OVERVIEW_FINE_EXT);
+  SD.remove("/ovtest" OVERVIEW_COARSE_EXT);
+
+  // 1) 25 one-second samples, speed rising by one each second
+  overviewBegin(journey);
+  char time[10];
+  for (int i = 0; i < 25; i++) {
+    snprintf(time, sizeof(time), "12:00:%02d", i);
+    TelemetrySample sample = { time, 51.0 + i * 0.001, -2.0, 1000, i, 2.0, 0, 10, 0, 0, 0 };
+    overviewUpdate(sample, i);
+  }
+
+  // 2) The closed fine buckets are on the card before the journey ends
+  FsFile file = SD.open("/ovtest" OVERVIEW_FINE_EXT, O_RDONLY);
+  TEST_ASSERT_TRUE_MESSAGE(file.isOpen(), "Overview sidecar missing");
+  RecordReader live(file);
+  size_t len;
+  int closed = 0;
+  while (live.next(len)) closed++;
+  TEST_ASSERT_EQUAL(2, closed);
+  file.close();
+  overviewFinish();
+
+  // 3) 10 + 10 + 5 samples at 10 s, all 25 in one 60 s bucket
+  JsonDocument doc;
+  file = SD.open("/ovtest" OVERVIEW_FINE_EXT, O_RDONLY);
+  RecordReader reader(file);
+  const int counts[] = {10, 10, 5};
+  for (int i = 0; i < 3; i++) {
+    const char* line = reader.next(len);
+    TEST_ASSERT_NOT_NULL(line);
+    TEST_ASSERT_FALSE(deserializeJson(doc, line, len));
+    TEST_ASSERT_EQUAL(counts[i], doc["n"].as<int>());
+    TEST_ASSERT_EQUAL_FLOAT(i * 10, doc["speed"][0].as<float>());
+    TEST_ASSERT_EQUAL_FLOAT(i * 10 + counts[i] - 1, doc["speed"][1].as<float>());
+    TEST_ASSERT_EQUAL_FLOAT(i * 10 + (counts[i] - 1) / 2.0, doc["speed"][2].as<float>());
+  }
+  TEST_ASSERT_NULL(reader.next(len));
+  file.close();
+
+  file = SD.open("/ovtest" OVERVIEW_COARSE_EXT, O_RDONLY);
+  RecordReader coarse(file);
+  const char* line = coarse.next(len);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_FALSE(deserializeJson(doc, line, len));
+  TEST_ASSERT_EQUAL(25, doc["n"].as<int>());
+  TEST_ASSERT_EQUAL_STRING("12:00:00", doc["t"]);
+  TEST_ASSERT_EQUAL_FLOAT(51.0, doc["first"][0].as<float>());
+  TEST_ASSERT_EQUAL_FLOAT(51.024, doc["last"][0].as<float>());
+  TEST_ASSERT_NULL(coarse.next(len));
+  file.close();
+
+  // Cleanup
+  SD.remove("/ovtest" OVERVIEW_FINE_EXT);
+  SD.remove("/ovtest" OVERVIEW_COARSE_EXT);
+}
+
+// ------------------ SD Delete Job Test ------------------
+
+static void runDeleteJob(void) {
+  for (int i = 0; i < 1000 && deleteJobStatus().running; i++) {
+    delay(DELETE_INTERVAL);
+    deleteJobService();
+  }
+}
+
+void test_sd_delete_job_keeps_live_journey(void) {
+  if (!sdMutex) sdMutex = xSemaphoreCreateMutex();
+  deleteJobBegin();
+
+  // 1) A day folder with 40 files, a subfolder, and the journey being logged
+  SD.mkdir("/deltest/sub", true);
+  char path[DELETE_PATH_MAX];
+  for (int i = 0; i < 40; i++) {
+    snprintf(path, sizeof(path), "/deltest/f%02d.json", i);
+    SD.open(path, O_WRONLY | O_CREAT).close();
+  }
+  SD.open("/deltest/sub/a.json", O_WRONLY | O_CREAT).close();
+  SD.open("/deltest/12-00-00.json", O_WRONLY | O_CREAT).close();
+  SD.open("/deltest/12-00-00.sum", O_WRONLY | O_CREAT).close();
+  journeyStatsBegin(journeyStats, "deltest/12-00-00.json");
+
+  // 2) The job clears everything else and completes
+  TEST_ASSERT_TRUE(deleteJobQueue("/deltest"));
+  runDeleteJob();
+  const DeleteJobStatus& status = deleteJobStatus();
+  TEST_ASSERT_FALSE(status.running);
+  TEST_ASSERT_EQUAL_STRING("", status.lastError);
+  TEST_ASSERT_EQUAL(40 + 2, (int)status.removed);
+  TEST_ASSERT_FALSE(SD.exists("/deltest/f39.json"));
+  TEST_ASSERT_FALSE(SD.exists("/deltest/sub"));
+  TEST_ASSERT_TRUE(SD.exists("/deltest/12-00-00.json"));
+  TEST_ASSERT_TRUE(SD.exists("/deltest/12-00-00.sum"));
+
+  // 3) Once the journey has closed, the folder goes
+  journeyStats.active = false;
+  TEST_ASSERT_TRUE(deleteJobQueue("/deltest"));
+  runDeleteJob();
+  TEST_ASSERT_EQUAL(3, (int)status.removed);
+  TEST_ASSERT_FALSE(SD.exists("/deltest"));
+}
+
+// ------------------ SD Block Log Recovery Test ------------------
+
+void test_sd_block_log_rebuild(void) {
+  const char* journey = "/blktest.json";
+  const char* blk = "/blktest" BLOCK_LOG_EXT;
+  SD.remove(journey);
+  SD.remove(blk);
+
+  // 1) 100 records logged; one block of 64 reached the card, 36 were in RAM
+  FsFile file = SD.open(journey, O_WRONLY | O_CREAT | O_TRUNC);
+  blockLogBegin(journey);
+  char time[10], line[160];
+  for (int i = 0; i < 100; i++) {
+    snprintf(time, sizeof(time), "12:%02d:%02d", i / 60, i % 60);
+    snprintf(line, sizeof(line),
+             "{\"gps\":{\"time\":\"%s\",\"latitude\":51.0,\"longitude\":-2.0},"
+             "\"obd\":{\"rpm\":%d,\"speed\":%d},\"imu\":{}}\n", time, 1000 + i, i);
+    file.print(line);
+    TelemetrySample sample = { time, 51.0, -2.0, 1000 + i, i, 0, 0, 0, 0, 0, 0 };
+    blockLogAdd(sample);
+  }
+  file.close();
+
+  // ... and a second block was torn part way through
+  file = SD.open(blk, O_WRONLY | O_AT_END);
+  const uint8_t torn[] = { BLOCK_MARKER, 0x7F, 0x24, 0x01 };
+  file.write(torn, sizeof(torn));
+  file.close();
+
+  // 2) Recovery brings the block log back to all 100 records
+  TEST_ASSERT_TRUE(blockLogRebuild(journey));
+  static uint8_t buf[4096];
+  file = SD.open(blk, O_RDONLY);
+  int size = file.read(buf, sizeof(buf));
+  file.close();
+  static BlockRecord out[BLOCK_RECORDS];
+  size_t count, total = 0, pos = 0;
+  size_t len;
+  while ((len = blockDecode(buf + pos, size - pos, out, count)) > 0) {
+    for (size_t i = 0; i < count; i++) TEST_ASSERT_EQUAL(total + i, out[i].speed);
+    total += count;
+    pos += len;
+  }
+  TEST_ASSERT_EQUAL(size, (int)pos);
+  TEST_ASSERT_EQUAL(100, (int)total);
+
+  // Cleanup
+  SD.remove(journey);
+  SD.remove(blk);
+}
+
+// ------------------ SD Segmented Journey Test ------------------
+
+// Logs `count` records to `file` as dataTask does, from second `first`
+static void writeJourneyRecords(FsFile& file, int first, int count) {
+  char line[160];
+  for (int i = first; i < first + count; i++) {
+    snprintf(line, sizeof(line),
+             "{\"gps\":{\"time\":\"12:%02d:%02d\",\"latitude\":51.0,\"longitude\":-2.0},"
+             "\"obd\":{\"rpm\":%d,\"speed\":%d},\"imu\":{}}\n", i / 60, i % 60, 1000 + i, i);
+    file.print(line);
+  }
+}
+
+// Last line of /.recovered
+static void lastRecoveredLine(char* line, size_t size) {
+  FsFile log = SD.open(RECOVERED_PATH, O_RDONLY);
+  line[0] = '\0';
+  if (!log) return;
+  char buf[128];
+  int n;
+  while ((n = log.fgets(buf, sizeof(buf))) > 0) {
+    if (buf[n - 1] == '\n') strncpy(line, buf, size - 1);
+  }
+  line[size - 1] = '\0';
+  log.close();
+}
+
+static void removeJourneyDay(const char* day) {
+  journeyStats.active = false;
+  TEST_ASSERT_TRUE(deleteJobQueue(day));
+  runDeleteJob();
+  TEST_ASSERT_FALSE(SD.exists(day));
+}
+
+void test_sd_journal_recover_truncates(void) {
+  if (!sdMutex) sdMutex = xSemaphoreCreateMutex();
+  const char* journey = "/jrntest/08-00-00.json";
+  SD.remove(RECOVERED_PATH);
+  SD.mkdir("/jrntest");
+  catalogBegin();
+  uint32_t gen = catalogGeneration();
+
+  // 1) Ten records committed, then a torn one when the power went
+  FsFile seg;
+  TEST_ASSERT_TRUE(segmentOpen(journey, 0, ENCODING_NDJSON, seg));
+  journalOpen(journey + 1);
+  writeJourneyRecords(seg, 0, 10);
+  uint32_t committed = seg.curPosition();
+  journalCommit(0, committed);
+  const char* torn = "{\"gps\":{\"time\":\"12:00:1";
+  seg.print(torn);
+  seg.close();
+
+  // 2) Recovery cuts the segment back to the committed length ...
+  journalRecover();
+  TEST_ASSERT_TRUE(journalRecovery().repaired);
+  TEST_ASSERT_EQUAL(strlen(torn), journalRecovery().truncatedBytes);
+  FsFile file = SD.open("/jrntest/08-00-00/000.json", O_RDONLY);
+  TEST_ASSERT_EQUAL(committed, (uint32_t)file.fileSize());
+  file.close();
+  char line[128];
+  lastRecoveredLine(line, sizeof(line));
+  TEST_ASSERT_NOT_NULL(strstr(line, "\"path\":\"jrntest/08-00-00.json\""));
+  TEST_ASSERT_NOT_NULL(strstr(line, "\"action\":\"truncated\""));
+
+  // ... writes the summary under a new catalog generation ...
+  TEST_ASSERT_EQUAL(gen + 1, catalogGeneration());
+  JsonDocument summary;
+  file = SD.open("/jrntest/08-00-00" SUMMARY_EXT, O_RDONLY);
+  TEST_ASSERT_FALSE(deserializeJson(summary, file));
+  file.close();
+  TEST_ASSERT_EQUAL(gen + 1, summary["gen"].as<uint32_t>());
+
+  // ... and clears the journal
+  JournalRecord saved;
+  file = SD.open(JOURNAL_PATH, O_RDONLY);
+  TEST_ASSERT_EQUAL((int)sizeof(saved), file.read((uint8_t*)&saved, sizeof(saved)));
+  file.close();
+  TEST_ASSERT_EQUAL_STRING("", saved.path);
+
+  removeJourneyDay("/jrntest");
+}
+
+void test_sd_journal_recover_removes(void) {
+  if (!sdMutex) sdMutex = xSemaphoreCreateMutex();
+  const char* journey = "/jrntest/09-00-00.json";
+  SD.remove(RECOVERED_PATH);
+  SD.mkdir("/jrntest");
+  char line[128];
+
+  // 1) A segment opened just before the power loss, nothing committed in it
+  FsFile seg;
+  TEST_ASSERT_TRUE(segmentOpen(journey, 0, ENCODING_NDJSON, seg));
+  journalOpen(journey + 1);
+  writeJourneyRecords(seg, 0, 10);
+  journalCommit(0, seg.curPosition());
+  TEST_ASSERT_TRUE(segmentClose(journey, 0, seg));
+  TEST_ASSERT_TRUE(segmentOpen(journey, 1, ENCODING_NDJSON, seg));
+  journalCommit(1, 0);
+  seg.print("{\"gps\":");
+  seg.close();
+
+  journalRecover();
+  TEST_ASSERT_FALSE(SD.exists("/jrntest/09-00-00/001.json"));
+  TEST_ASSERT_TRUE(SD.exists("/jrntest/09-00-00/000.json"));
+  lastRecoveredLine(line, sizeof(line));
+  TEST_ASSERT_NOT_NULL(strstr(line, "\"action\":\"truncated\""));
+
+  // 2) A journey with nothing committed at all goes entirely
+  journey = "/jrntest/10-00-00.json";
+  TEST_ASSERT_TRUE(segmentOpen(journey, 0, ENCODING_NDJSON, seg));
+  journalOpen(journey + 1);
+  seg.print("{\"gps\":");
+  seg.close();
+
+  journalRecover();
+  TEST_ASSERT_TRUE(journalRecovery().repaired);
+  runDeleteJob();
+  TEST_ASSERT_FALSE(segmentJourneyExists(journey));
+  TEST_ASSERT_TRUE(segmentJourneyExists("/jrntest/09-00-00.json"));
+  lastRecoveredLine(line, sizeof(line));
+  TEST_ASSERT_NOT_NULL(strstr(line, "\"path\":\"jrntest/10-00-00.json\""));
+  TEST_ASSERT_NOT_NULL(strstr(line, "\"action\":\"removed\""));
+
+  removeJourneyDay("/jrntest");
+}
+
+// A closed journey "/day/drive.json" with its summary, as a single file or
+// as segments; returns its catalog generation
+static uint32_t makeClosedJourney(const char* journey, bool segmented, bool starred) {
+  FsFile file;
+  if (segmented) {
+    TEST_ASSERT_TRUE(segmentOpen(journey, 0, ENCODING_NDJSON, file));
+  } else {
+    file = SD.open(journey, O_WRONLY | O_CREAT | O_TRUNC);
+  }
+  writeJourneyRecords(file, 0, 5);
+  file.close();
+
+  char path[48];
+  uint32_t gen = catalogAdd(journey + 1);
+  journeySidecarPath(journey, SUMMARY_EXT, path, sizeof(path));
+  file = SD.open(path, O_WRONLY | O_CREAT | O_TRUNC);
+  file.printf("{\"gen\":%lu}\n", (unsigned long)gen);
+  file.close();
+  if (starred) {
+    journeySidecarPath(journey, STAR_EXT, path, sizeof(path));
+    SD.open(path, O_WRONLY | O_CREAT).close();
+  }
+  return gen;
+}
+
+void test_sd_retention_evicts_oldest_synced(void) {
+  if (!sdMutex) sdMutex = xSemaphoreCreateMutex();
+  catalogBegin();
+  uint32_t syncedBefore = catalogSyncedGeneration();
+  SD.mkdir("/2020-01-01");
+  SD.mkdir("/2020-01-02");
+
+  // 1) The oldest journey is starred and the next oldest not yet synced
+  makeClosedJourney("/2020-01-01/07-00-00.json", true, true);
+  makeClosedJourney("/2020-01-01/08-00-00.json", true, false);
+  makeClosedJourney("/2020-01-01/09-00-00.json", false, false);
+  uint32_t acked = makeClosedJourney("/2020-01-02/07-00-00.json", false, false);
+  makeClosedJourney("/2020-01-01/06-00-00.json", false, false);
+  TEST_ASSERT_TRUE(catalogAck(acked));
+
+  // 2) Synced journeys go oldest first, skipping the starred and the unsynced
+  dayCursor[0] = '\0';
+  TEST_ASSERT_TRUE(evictStep(true));
+  TEST_ASSERT_EQUAL_STRING("2020-01-01/08-00-00.json", retentionStatus().lastEvicted);
+  runDeleteJob();
+  TEST_ASSERT_FALSE(segmentJourneyExists("/2020-01-01/08-00-00.json"));
+  TEST_ASSERT_TRUE(evictStep(true));
+  TEST_ASSERT_EQUAL_STRING("2020-01-01/09-00-00.json", retentionStatus().lastEvicted);
+
+  // 3) Nothing more in the first day; the next day's journey goes, and
+  // its folder with it
+  TEST_ASSERT_TRUE(evictStep(true));
+  TEST_ASSERT_TRUE(evictStep(true));
+  TEST_ASSERT_EQUAL_STRING("2020-01-02/07-00-00.json", retentionStatus().lastEvicted);
+  TEST_ASSERT_FALSE(SD.exists("/2020-01-02"));
+  TEST_ASSERT_FALSE(evictStep(true));
+
+  TEST_ASSERT_TRUE(segmentJourneyExists("/2020-01-01/07-00-00.json"));
+  TEST_ASSERT_TRUE(SD.exists("/2020-01-01/06-00-00.json"));
+
+  // Cleanup
+  catalogAck(syncedBefore);
+  removeJourneyDay("/2020-01-01");
+}
+
+void test_sd_segmented_journey_read(void) {
+  const char* journey = "/segtest.json";
+  FsFile seg;
+
+  // 1) Two segments, the record boundary falling on the segment boundary
+  TEST_ASSERT_TRUE_MESSAGE(segmentOpen(journey, 0, ENCODING_NDJSON, seg), "Segment 0 open failed");
+  seg.print("{\"i\":0}\n");
+  TEST_ASSERT_TRUE(segmentClose(journey, 0, seg));
+  TEST_ASSERT_TRUE_MESSAGE(segmentOpen(journey, 1, ENCODING_NDJSON, seg), "Segment 1 open failed");
+  seg.print("{\"i\":1}\n");
+  seg.close();
+  TEST_ASSERT_TRUE(segmentIsSegmented(journey));
+  // Only the segment directory exists, yet the journey does (/star, retention)
+  TEST_ASSERT_FALSE(SD.exists(journey));
+  TEST_ASSERT_TRUE(segmentJourneyExists(journey));
+  TEST_ASSERT_FALSE(segmentJourneyExists("/segmissing.json"));
+
+  // 2) Read back as one continuous journey
+  JourneyFile file;
+  TEST_ASSERT_TRUE_MESSAGE(file.open(journey), "JourneyFile open failed");
+  TEST_ASSERT_EQUAL(2, file.segmentCount());
+  TEST_ASSERT_EQUAL(16, (int)file.size());
+  char buf[17] = {0};
+  TEST_ASSERT_EQUAL(16, file.read(buf, 8) + file.read(buf + 8, 8));
+  TEST_ASSERT_EQUAL_STRING("{\"i\":0}\n{\"i\":1}\n", buf);
+
+  // 3) Seek into the second segment
+  TEST_ASSERT_TRUE(file.seekSet(13));
+  TEST_ASSERT_EQUAL(13, (int)file.curPosition());
+  TEST_ASSERT_EQUAL(1, file.read(buf, 1));
+  TEST_ASSERT_EQUAL('1', buf[0]);
+  file.close();
+
+  // Cleanup
+  SD.remove("/segtest/000.json");
+  SD.remove("/segtest/001.json");
+  SD.rmdir("/segtest");
+  SD.remove("/segtest" SEGMENT_MANIFEST_EXT);
+}
+
+// ------------------ SD Time Index Test ------------------
+
+void test_sd_time_index_seek(void) {
+  const char* journey = "/idxtest.json";
+  SD.remove("/idxtest" TIME_INDEX_EXT);
+
+  // 1) 120 one-second records of 100 bytes starting just before midnight
+  timeIndexBegin(journey);
+  char time[10];
+  for (int i = 0; i < 120; i++) {
+    long t = (86400 - 60 + i) % 86400;
+    snprintf(time, sizeof(time), "%02ld:%02ld:%02ld", t / 3600, (t / 60) % 60, t % 60);
+    timeIndexUpdate(time, i * 100);
+  }
+
+  // 2) Seeks land on the indexed record at or before the time
+  uint64_t offset;
+  TEST_ASSERT_TRUE(timeIndexSeek(journey, "23:59:00", 12000, offset));
+  TEST_ASSERT_EQUAL(0, (int)offset);
+  TEST_ASSERT_TRUE(timeIndexSeek(journey, "00:00:15", 12000, offset));
+  TEST_ASSERT_EQUAL(60 * 100, (int)offset);
+  TEST_ASSERT_TRUE(timeIndexSeek(journey, "00:00:45", 12000, offset));
+  TEST_ASSERT_EQUAL(90 * 100, (int)offset);
+
+  // 3) Entries past a truncated end are ignored
+  TEST_ASSERT_TRUE(timeIndexSeek(journey, "00:00:45", 9000, offset));
+  TEST_ASSERT_EQUAL(60 * 100, (int)offset);
+
+  // 4) Before the start
+  TEST_ASSERT_TRUE(timeIndexSeek(journey, "23:50:00", 12000, offset));
+  TEST_ASSERT_EQUAL(0, (int)offset);
+
+  // Cleanup
+  SD.remove("/idxtest" TIME_INDEX_EXT);
+}
+
+#ifdef NATIVE
+// ------------------ Host Block Device Test ------------------
+
+// Writes `clusters` whole clusters of filler to an open file
+static void writeClusters(FsVolume& volume, FsFile& file, uint32_t clusters) {
+  uint8_t sector[512];
+  memset(sector, 0x5A, sizeof(sector));
+  for (uint32_t i = 0; i < clusters * volume.bytesPerCluster() / sizeof(sector); i++) {
+    TEST_ASSERT_EQUAL(512, (int)file.write(sector, sizeof(sector)));
+  }
+}
+
+void test_sd_free_cluster_count_step(void) {
+  // A fresh FAT16 volume, so files are laid out from cluster 2 up
+  SimBlockDevice device;
+  TEST_ASSERT_TRUE(device.beginRam(64 * 2048));
+  uint8_t sector[512];
+  FsFormatter formatter;
+  TEST_ASSERT_TRUE(formatter.format(&device, sector));
+  FsVolume volume;
+  TEST_ASSERT_TRUE(volume.begin(&device, false));
+  TEST_ASSERT_EQUAL(16, volume.fatType());
+  // 1) A file over clusters 2..301, then a remount: the count is unknown
+  FsFile old = volume.open("/old.bin", O_WRONLY | O_CREAT | O_TRUNC);
+  writeClusters(volume, old, 300);
+  old.close();
+  TEST_ASSERT_TRUE(volume.begin(&device, false));
+  TEST_ASSERT_FALSE(volume.freeClusterCountKnown());
+
+  // 2) Two steps: the scan has passed clusters 0..511
+  TEST_ASSERT_EQUAL(0, volume.freeClusterCountStep(1));
+  TEST_ASSERT_EQUAL(0, volume.freeClusterCountStep(1));
+
+  // 3) Meanwhile files are created behind the scan position (402..), one
+  // preallocated across it (..561) and one extended past it; then the
+  // first is removed, all behind it
+  FsFile grown = volume.open("/grown.bin", O_WRONLY | O_CREAT | O_TRUNC);
+  writeClusters(volume, grown, 100);
+  grown.close();
+  FsFile pre = volume.open("/pre.bin", O_WRONLY | O_CREAT | O_TRUNC);
+  TEST_ASSERT_TRUE(pre.preAllocate(160 * volume.bytesPerCluster()));
+  pre.close();
+  grown = volume.open("/grown.bin", O_WRONLY | O_AT_END);
+  writeClusters(volume, grown, 100);
+  grown.close();
+  TEST_ASSERT_TRUE(volume.remove("/old.bin"));
+  TEST_ASSERT_FALSE(volume.freeClusterCountKnown());
+
+  // 4) The finished scan agrees with a full count of the FAT
+  int8_t rc;
+  while ((rc = volume.freeClusterCountStep(8)) == 0) {}
+  TEST_ASSERT_EQUAL(1, rc);
+  TEST_ASSERT_TRUE(volume.freeClusterCountKnown());
+  int32_t stepped = volume.freeClusterCount();
+  TEST_ASSERT_TRUE(volume.begin(&device, false));    // Drops the cached count
+  TEST_ASSERT_FALSE(volume.freeClusterCountKnown());
+  TEST_ASSERT_EQUAL(volume.freeClusterCount(), stepped);
+}
+
+void test_sd_block_device_volume(void) {
+  // 1) SdFat formats and mounts the host device directly (not the current volume)
+  SimBlockDevice device;
+  TEST_ASSERT_TRUE(device.beginRam(64 * 2048));
+  uint8_t sector[512];
+  FsFormatter formatter;
+  TEST_ASSERT_TRUE(formatter.format(&device, sector));
+  FsVolume volume;
+  TEST_ASSERT_TRUE(volume.begin(&device, false));
+
+  // 2) Writes pay the latency model: programming time for every sector
+  SimBlockLatency latency;
+  TEST_ASSERT_TRUE(SimBlockDevice::latencyProfile("class10", latency));
+  device.setLatency(latency);
+  SimBlockStats before = device.stats();
+  FsFile file = volume.open("/bench.bin", O_WRONLY | O_CREAT | O_TRUNC);
+  TEST_ASSERT_TRUE(file);
+  memset(sector, 0xA5, sizeof(sector));
+  for (int i = 0; i < 16; i++) TEST_ASSERT_EQUAL(512, (int)file.write(sector, sizeof(sector)));
+  file.close();
+  SimBlockStats after = device.stats();
+  uint64_t written = after.sectorsWritten - before.sectorsWritten;
+  TEST_ASSERT_TRUE(written >= 16);
+  TEST_ASSERT_TRUE(after.latencyUs - before.latencyUs >= written * latency.writeUs);
+
+  // 3) Data reads back
+  file = volume.open("/bench.bin", O_RDONLY);
+  TEST_ASSERT_EQUAL(16 * 512, (int)file.fileSize());
+  TEST_ASSERT_EQUAL(512, (int)file.read(sector, sizeof(sector)));
+  TEST_ASSERT_EQUAL_HEX8(0xA5, sector[511]);
+  file.close();
+}
+#endif
+
 
 // ------------------ Main: Run All Tests ------------------
 void setup() {
@@ -341,6 +1251,9 @@ void setup() {
   RUN_TEST(test_gnss_data);
   RUN_TEST(test_imu_data);
   RUN_TEST(test_gnss_dead_reckoning_data);
+#ifdef NATIVE
+  RUN_TEST(test_gnss_ubx_replay);
+#endif
 
   
   // OBD tests
@@ -355,6 +1268,21 @@ void setup() {
   RUN_TEST(test_calculateInstantMPG_zeroSpeed);
   RUN_TEST(test_calculateAverageMPG_zeroDistance);
   RUN_TEST(test_obd_timeout);
+
+  // Journey summary tests
+  RUN_TEST(test_haversine_known_distance);
+  RUN_TEST(test_journey_stats_aggregates);
+  RUN_TEST(test_journey_sidecar_path);
+  RUN_TEST(test_journey_parse_record);
+  RUN_TEST(test_journey_time_delta_midnight);
+  RUN_TEST(test_record_field_filter);
+  RUN_TEST(test_record_window_midnight);
+  RUN_TEST(test_record_encodings_round_trip);
+  RUN_TEST(test_block_codec_round_trip);
+  RUN_TEST(test_trace_chrome_export);
+  RUN_TEST(test_metrics_histogram);
+  RUN_TEST(test_cycle_monitor_overrun);
+  RUN_TEST(test_task_stats_run_time_wrap);
   
   // SD card tests
   RUN_TEST(test_sd_init);
@@ -368,8 +1296,25 @@ void setup() {
   RUN_TEST(test_sd_rmdir_nonexistent_folder);
   RUN_TEST(test_sd_power_loss_during_write);
   RUN_TEST(test_sd_concurrent_access);
+  RUN_TEST(test_sd_record_reader);
+  RUN_TEST(test_sd_overview_buckets);
+  RUN_TEST(test_sd_delete_job_keeps_live_journey);
+  RUN_TEST(test_sd_block_log_rebuild);
+  RUN_TEST(test_sd_journal_recover_truncates);
+  RUN_TEST(test_sd_journal_recover_removes);
+  RUN_TEST(test_sd_retention_evicts_oldest_synced);
+  RUN_TEST(test_sd_segmented_journey_read);
+  RUN_TEST(test_sd_time_index_seek);
+#ifdef NATIVE
+  RUN_TEST(test_sd_free_cluster_count_step);
+  RUN_TEST(test_sd_block_device_volume);
+#endif
   
+#ifdef NATIVE
+  exit(UNITY_END());  // The host build has no loop() worth returning to
+#else
   UNITY_END();
+#endif
 }
 
 void loop() {
@@ -0,0 +1,496 @@
+//-------------------------------------------------------------------------------
+// hotpath_bench: microbenchmarks of the per-record work in dataTask (OBD
+// reply decoding, the record document and its JSON, time formatting, the
+// journey math and the UBX checksum), compared with a checked-in baseline
+//
+//   hotpath_bench                          run and print ns per operation
+//   hotpath_bench --baseline FILE [PCT]    also compare; exit 1 if any
+//                                          benchmark is PCT % slower (25)
+//   hotpath_bench --save FILE              write a new baseline
+//   hotpath_bench --filter TEXT            only benchmarks whose name has TEXT
+//
+// Each figure is the fastest of 30 runs of at least 5 ms. A fixed integer
+// loop ("calibration") runs alongside, and the baseline is scaled by its
+// speed now against when the baseline was saved, so a host clocked
+// differently does not fail the gate. To count as slower a benchmark must
+// also lose BENCH_SLACK_NS, as the few-ns ones move by a cycle from run to
+// run, and still be slower after BENCH_RETRIES more rounds: other work on a
+// shared host can slow a whole round, a real regression slows every one.
+//
+// Baselines only compare on the host and compiler they were made with
+// (their header says which): refresh tools/hotpath_bench.baseline with
+// --save in the same commit as a change that moves a figure on purpose.
+//
+// Build from embedded-system/ against the firmware and the native fakes,
+// with the flags of the native env:
+//   g++ -std=gnu++17 -O2 -DNATIVE -DARDUINO=10819 -DUSE_SD_CRC=2 -DSPI_DRIVER_SELECT=3 \
+//       -DMAINTAIN_FREE_CLUSTER_COUNT=1 -DUSE_BLOCK_DEVICE_INTERFACE=1 -Inative/include -Iinclude \
+//       -Ilib/SdFat/src -Ilib/ArduinoJson-7.x/src -Ilib/SparkFun_u-blox_GNSS_Arduino_Library/src \
+//       -Ilib/SparkfunOBD2UART tools/hotpath_bench.cpp $(ls src/*.cpp native/src/*.cpp | grep -v sim_main) \
+//       $(find lib/SdFat/src -name '*.cpp') lib/SparkFun_u-blox_GNSS_Arduino_Library/src/*.cpp \
+//       lib/SparkfunOBD2UART/*.cpp -pthread -o hotpath_bench
+//-------------------------------------------------------------------------------
+#include "obd.hpp"
+#include "journey.hpp"
+#include "record_codec.hpp"
+#include "record_reader.hpp"
+#include <SparkFun_u-blox_GNSS_Arduino_Library.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+
+#define BENCH_RUNS     30
+#define BENCH_MIN_NS   5e6
+#define BENCH_VARIANTS 8        // Inputs cycled through, so nothing folds to a constant
+#define BENCH_SLACK_NS 1.0      // Below this a change is noise, whatever its %
+#define BENCH_RETRIES  2        // Rounds of BENCH_RUNS more for a benchmark that looks slower
+
+extern SFE_UBLOX_GNSS myGNSS;
+
+struct ObdBench {
+    static int parseHexValue(const char* response, int startIndex, int length) {
+        return obd.parseHexValue(response, startIndex, length);
+    }
+};
+
+// Results go here so the compiler cannot drop the work
+static volatile uint32_t sink;
+
+// Adapter replies as COBD::receive() leaves them (echo off, prompt stripped)
+static const char* const rpmReplies[BENCH_VARIANTS] = {
+    "41 0C 0B B8 \r", "41 0C 1A F8 \r", "41 0C 0C 4E \r", "41 0C 2E E0 \r",
+    "SEARCHING...\r41 0C 0F A0 \r", "41 0C 00 00 \r", "41 0C 13 88 \r", "41 0C 3A 98 \r",
+};
+static const char* const throttleReplies[BENCH_VARIANTS] = {
+    "41 4A 1F \r", "41 4A 33 \r", "41 4A 80 \r", "41 4A FF \r",
+    "41 4A 00 \r", "41 4A 2A \r", "41 4A 66 \r", "41 4A 9C \r",
+};
+
+struct Input {
+    uint8_t hour, minute, second;
+    uint16_t year, month, day;
+    double latitude, longitude;
+    int rpm, speed, throttle, accelX, accelY;
+    float maf, mpg, avgMPG;
+};
+static Input inputs[BENCH_VARIANTS];
+
+
+static void makeInputs() {
+    for (int i = 0; i < BENCH_VARIANTS; i++) {
+        Input& in = inputs[i];
+        in.hour = 8 + i;
+        in.minute = 7 * i;
+        in.second = 59 - 3 * i;
+        in.year = 2025;
+        in.month = 1 + i;
+        in.day = 3 * i + 1;
+        in.latitude = 52.9548 + i * 0.00013;
+        in.longitude = -1.1581 - i * 0.00021;
+        in.rpm = 800 + 350 * i;
+        in.speed = 12 * i;
+        in.throttle = 5 * i;
+        in.accelX = 40 * i - 150;
+        in.accelY = 90 - 25 * i;
+        in.maf = 2.5f + 3.1f * i;
+        in.mpg = 20.0f + i;
+        in.avgMPG = 31.5f;
+    }
+}
+
+
+//-------------------------------------------------------------------------------
+// Benchmarks: each runs its operation n times
+//-------------------------------------------------------------------------------
+
+// The reference: an xorshift chain, one dependent step after another, which
+// only the host's clock can speed up or slow down
+static void benchCalibration(uint32_t n) {
+    uint32_t x = sink | 1;
+    for (uint32_t i = 0; i < n; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    sink = x;
+}
+
+
+static void benchHex2uint8(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) acc += hex2uint8(rpmReplies[i % BENCH_VARIANTS] + 6);
+    sink = acc;
+}
+
+
+static void benchHex2uint16(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) acc += hex2uint16(rpmReplies[i % BENCH_VARIANTS] + 6);
+    sink = acc;
+}
+
+
+static void benchParseHexValue(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) acc += ObdBench::parseHexValue(rpmReplies[i % BENCH_VARIANTS], 6, 2);
+    sink = acc;
+}
+
+
+static void benchHeaderSearch(uint32_t n) {
+    uintptr_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) acc += (uintptr_t)strstr(rpmReplies[i % BENCH_VARIANTS], "41 0C");
+    sink = acc;
+}
+
+
+// Header search and both bytes, as OBD::readRPM()
+static void benchDecodeRpm(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const char* ptr = strstr(rpmReplies[i % BENCH_VARIANTS], "41 0C");
+        if (ptr) {
+            int A = ObdBench::parseHexValue(ptr, 6, 2);
+            int B = ObdBench::parseHexValue(ptr, 9, 2);
+            acc += ((A * 256) + B) / 4;
+        }
+    }
+    sink = acc;
+}
+
+
+// As OBD::readThrottle()
+static void benchDecodeThrottle(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const char* ptr = strstr(throttleReplies[i % BENCH_VARIANTS], "41 4A");
+        if (ptr && strlen(ptr) >= 8) {
+            char hexVal[3] = { ptr[6], ptr[7], '\0' };
+            acc += (strtol(hexVal, NULL, 16) * 100) / 255;
+        }
+    }
+    sink = acc;
+}
+
+
+static void benchTimeFormat(uint32_t n) {
+    char timeStr[10];
+    char dateStr[12];
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const Input& in = inputs[i % BENCH_VARIANTS];
+        sprintf(timeStr, "%02d:%02d:%02d", in.hour, in.minute, in.second);
+        sprintf(dateStr, "%04d-%02d-%02d", in.year, in.month, in.day);
+        acc += timeStr[7] + dateStr[9];
+    }
+    sink = acc;
+}
+
+
+// Same shape as the record dataTask logs
+static void buildRecord(JsonDocument& jsonDoc, const Input& in, const char* timeStr) {
+    jsonDoc["gps"]["time"] = timeStr;
+    jsonDoc["gps"]["latitude"] = in.latitude;
+    jsonDoc["gps"]["longitude"] = in.longitude;
+    jsonDoc["obd"]["rpm"] = in.rpm;
+    jsonDoc["obd"]["speed"] = in.speed;
+    jsonDoc["obd"]["maf"] = in.maf;
+    jsonDoc["obd"]["instant_mpg"] = in.mpg;
+    jsonDoc["obd"]["throttle"] = in.throttle;
+    jsonDoc["obd"]["avg_mpg"] = in.avgMPG;
+    jsonDoc["imu"]["accel_x"] = in.accelX;
+    jsonDoc["imu"]["accel_y"] = in.accelY;
+}
+
+
+static void benchRecordBuild(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        StaticJsonDocument<256> jsonDoc;
+        buildRecord(jsonDoc, inputs[i % BENCH_VARIANTS], "12:34:56");
+        acc += jsonDoc.size();
+    }
+    sink = acc;
+}
+
+
+static void benchRecordSerialize(uint32_t n) {
+    StaticJsonDocument<256> docs[BENCH_VARIANTS];
+    for (int i = 0; i < BENCH_VARIANTS; i++) buildRecord(docs[i], inputs[i], "12:34:56");
+    char out[RECORD_MAX_LEN];
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) acc += serializeJson(docs[i % BENCH_VARIANTS], out, sizeof(out));
+    sink = acc;
+}
+
+
+// Build and encode, as one logged record costs
+static void benchRecordEncode(uint32_t n) {
+    uint8_t out[RECORD_MAX_LEN];
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        StaticJsonDocument<256> jsonDoc;
+        buildRecord(jsonDoc, inputs[i % BENCH_VARIANTS], "12:34:56");
+        acc += recordSerialize(jsonDoc, ENCODING_NDJSON, out, sizeof(out));
+    }
+    sink = acc;
+}
+
+
+static void benchHaversine(uint32_t n) {
+    double acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const Input& a = inputs[i % BENCH_VARIANTS];
+        const Input& b = inputs[(i + 1) % BENCH_VARIANTS];
+        acc += haversineKm(a.latitude, a.longitude, b.latitude, b.longitude);
+    }
+    sink = (uint32_t)acc;
+}
+
+
+// Instant and running average MPG, as dataTask computes them
+static void benchMpg(uint32_t n) {
+    float totalSpeedTimeProduct = 0, totalFuelTimeProduct = 0;
+    float acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const Input& in = inputs[i % BENCH_VARIANTS];
+        acc += obd.calculateInstantMPG(in.speed, in.maf);
+        totalSpeedTimeProduct += (in.speed * 0.621371) * 1.0;
+        totalFuelTimeProduct += (in.maf * 0.0805) * 1.0;
+        acc += obd.calculateAverageMPG(totalSpeedTimeProduct, totalFuelTimeProduct);
+    }
+    sink = (uint32_t)acc;
+}
+
+
+static void benchJourneyUpdate(uint32_t n) {
+    static JourneyStats stats;
+    journeyStatsBegin(stats, "2025-01-01/08-00-00.json");
+    for (uint32_t i = 0; i < n; i++) {
+        const Input& in = inputs[i % BENCH_VARIANTS];
+        TelemetrySample sample = { "08:00:00", in.latitude, in.longitude, in.rpm, in.speed, in.maf,
+                                   in.mpg, in.throttle, in.avgMPG, in.accelX, in.accelY };
+        journeyStatsUpdate(stats, sample, 1.0);
+    }
+    sink = stats.samples;
+}
+
+
+// UBX checksums over the payloads dataTask polls: NAV-PVT and ESF-INS
+static void benchUbxChecksum(uint32_t n, uint8_t id, uint16_t len) {
+    static uint8_t payload[BENCH_VARIANTS][UBX_NAV_PVT_LEN];
+    for (int v = 0; v < BENCH_VARIANTS; v++) {
+        for (uint16_t b = 0; b < len; b++) payload[v][b] = (uint8_t)(v * 31 + b * 7);
+    }
+    ubxPacket packet = {};
+    packet.len = len;
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        packet.cls = id == UBX_NAV_PVT ? UBX_CLASS_NAV : UBX_CLASS_ESF;
+        packet.id = id;
+        packet.payload = payload[i % BENCH_VARIANTS];
+        myGNSS.calcChecksum(&packet);
+        acc += packet.checksumA + packet.checksumB;
+    }
+    sink = acc;
+}
+
+
+static void benchUbxPvt(uint32_t n) {
+    benchUbxChecksum(n, UBX_NAV_PVT, UBX_NAV_PVT_LEN);
+}
+
+
+static void benchUbxEsfIns(uint32_t n) {
+    benchUbxChecksum(n, UBX_ESF_INS, UBX_ESF_INS_LEN);
+}
+
+
+struct Benchmark {
+    const char* name;
+    void (*run)(uint32_t n);
+};
+
+static const Benchmark benchmarks[] = {
+    { "calibration",            benchCalibration },     // First: always run
+    { "obd.hex2uint8",          benchHex2uint8 },
+    { "obd.hex2uint16",         benchHex2uint16 },
+    { "obd.parse_hex_value",    benchParseHexValue },
+    { "obd.header_search",      benchHeaderSearch },
+    { "obd.decode_rpm",         benchDecodeRpm },
+    { "obd.decode_throttle",    benchDecodeThrottle },
+    { "record.time_format",     benchTimeFormat },
+    { "record.build",           benchRecordBuild },
+    { "record.serialize",       benchRecordSerialize },
+    { "record.encode",          benchRecordEncode },
+    { "journey.haversine",      benchHaversine },
+    { "journey.mpg",            benchMpg },
+    { "journey.stats_update",   benchJourneyUpdate },
+    { "ubx.checksum_nav_pvt",   benchUbxPvt },
+    { "ubx.checksum_esf_ins",   benchUbxEsfIns },
+};
+
+
+//-------------------------------------------------------------------------------
+// Operations per run, so that one run takes at least BENCH_MIN_NS
+//-------------------------------------------------------------------------------
+static double timeRun(const Benchmark& b, uint32_t n) {
+    auto start = std::chrono::steady_clock::now();
+    b.run(n);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static uint32_t calibrate(const Benchmark& b) {
+    uint32_t n = 16;
+    while (timeRun(b, n) < BENCH_MIN_NS && n < (1u << 30)) n *= 2;
+    return n;
+}
+
+
+//-------------------------------------------------------------------------------
+// BENCH_RUNS rounds of the benchmarks with ops[i] set, keeping the fastest.
+// The runs are interleaved so that a busy spell on the host slows one run of
+// every benchmark rather than every run of one.
+//-------------------------------------------------------------------------------
+static void measure(size_t count, const uint32_t* ops, double* best) {
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        for (size_t i = 0; i < count; i++) {
+            if (ops[i]) best[i] = std::min(best[i], timeRun(benchmarks[i], ops[i]) / ops[i]);
+        }
+    }
+}
+
+
+static bool readBaseline(const char* path, std::map<std::string, double>& baseline) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        char name[64];
+        double ns;
+        if (sscanf(line.c_str(), "%63s %lf", name, &ns) == 2) baseline[name] = ns;
+    }
+    return true;
+}
+
+
+static std::string cpuName() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) return line.substr(colon + 2);
+        }
+    }
+    return "unknown";
+}
+
+
+static void usage() {
+    fprintf(stderr, "usage: hotpath_bench [--baseline FILE [PCT]] [--save FILE] [--filter TEXT]\n");
+}
+
+
+int main(int argc, char** argv) {
+    const char* baselinePath = nullptr;
+    const char* savePath = nullptr;
+    const char* filter = nullptr;
+    double tolerance = 25;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+            baselinePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') tolerance = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--save") && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath && !readBaseline(baselinePath, baseline)) return 2;
+    FILE* save = nullptr;
+    if (savePath) {
+        save = fopen(savePath, "w");
+        if (!save) {
+            fprintf(stderr, "Cannot create %s\n", savePath);
+            return 2;
+        }
+        fprintf(save, "# hotpath_bench baseline: ns per operation, fastest of %d runs\n", BENCH_RUNS);
+        fprintf(save, "# cpu: %s\n# compiler: g++ %s\n", cpuName().c_str(), __VERSION__);
+    }
+
+    makeInputs();
+    const size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    uint32_t ops[count];
+    double best[count];
+    for (size_t i = 0; i < count; i++) {
+        bool selected = i == 0 || !filter || strstr(benchmarks[i].name, filter);
+        ops[i] = selected ? calibrate(benchmarks[i]) : 0;
+        best[i] = 1e300;
+    }
+    measure(count, ops, best);
+
+    // Baseline figures as they would run on this host now
+    double scale = 1;
+    auto reference = baseline.find(benchmarks[0].name);
+    if (reference != baseline.end()) scale = best[0] / reference->second;
+    double expected[count];
+    for (size_t i = 0; i < count; i++) {
+        auto it = baseline.find(benchmarks[i].name);
+        expected[i] = it != baseline.end() ? it->second * scale : 0;
+    }
+    auto slower = [&](size_t i) {
+        return i > 0 && ops[i] && expected[i] > 0 && best[i] > expected[i] * (1 + tolerance / 100) &&
+               best[i] - expected[i] > BENCH_SLACK_NS;
+    };
+
+    for (int retry = 0; retry < BENCH_RETRIES; retry++) {
+        uint32_t again[count];
+        bool any = false;
+        for (size_t i = 0; i < count; i++) {
+            again[i] = slower(i) ? ops[i] : 0;
+            any |= again[i] != 0;
+        }
+        if (!any) break;
+        measure(count, again, best);
+    }
+
+    int regressions = 0;
+    printf("%-24s %10s %10s %8s\n", "benchmark", "ns/op", "baseline", "change");
+    for (size_t i = 0; i < count; i++) {
+        if (!ops[i]) continue;
+        const Benchmark& b = benchmarks[i];
+        double ns = best[i];
+        if (save) fprintf(save, "%-24s %.2f\n", b.name, ns);
+
+        if (expected[i] == 0) {
+            printf("%-24s %10.2f %10s %8s\n", b.name, ns, "-", "-");
+            continue;
+        }
+        double change = (ns / expected[i] - 1) * 100;
+        if (slower(i)) regressions++;
+        printf("%-24s %10.2f %10.2f %+7.1f%%%s\n", b.name, ns, expected[i], change, slower(i) ? "  SLOWER" : "");
+    }
+    if (save) fclose(save);
+
+    if (regressions) {
+        printf("%d benchmark(s) more than %.0f%% slower than the baseline\n", regressions, tolerance);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+//-------------------------------------------------------------------------------
+// jblock: host tool for the journey column-block format (see block_codec.hpp)
+//
+//   jblock encode DRIVE.json OUT.blk     NDJSON journey -> blocks
+//   jblock decode DRIVE.blk              blocks -> NDJSON on stdout
+//   jblock bench DRIVE.json...           size and encode time vs NDJSON and deflate
+//
+// Build from embedded-system/:
+//   g++ -std=c++17 -O2 -Iinclude -Ilib/ArduinoJson-7.x/src tools/jblock.cpp src/block_codec.cpp -lz -o jblock
+//-------------------------------------------------------------------------------
+#include "block_codec.hpp"
+#include <ArduinoJson.h>
+#include <zlib.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool readFile(const char* path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+
+// Same mapping as blockRecordFromSample() on the device
+static bool parseRecord(const std::string& line, BlockRecord& r) {
+    JsonDocument doc;
+    if (deserializeJson(doc, line)) return false;
+    int h = 0, m = 0, s = 0;
+    sscanf(doc["gps"]["time"] | "", "%d:%d:%d", &h, &m, &s);
+    r.time       = h * 3600 + m * 60 + s;
+    r.latitude   = lround((doc["gps"]["latitude"] | 0.0) * BLOCK_DEGREE_SCALE);
+    r.longitude  = lround((doc["gps"]["longitude"] | 0.0) * BLOCK_DEGREE_SCALE);
+    r.rpm        = doc["obd"]["rpm"] | 0;
+    r.speed      = doc["obd"]["speed"] | 0;
+    r.throttle   = doc["obd"]["throttle"] | 0;
+    r.accelX     = doc["imu"]["accel_x"] | 0;
+    r.accelY     = doc["imu"]["accel_y"] | 0;
+    r.maf        = doc["obd"]["maf"] | 0.0f;
+    r.instantMPG = doc["obd"]["instant_mpg"] | 0.0f;
+    r.avgMPG     = doc["obd"]["avg_mpg"] | 0.0f;
+    return true;
+}
+
+
+// Builds the record the way dataTask logs it
+static void toJson(const BlockRecord& r, JsonDocument& doc) {
+    char time[16];
+    snprintf(time, sizeof(time), "%02d:%02d:%02d", r.time / 3600, (r.time / 60) % 60, r.time % 60);
+    doc.clear();
+    doc["gps"]["time"] = time;
+    doc["gps"]["latitude"] = r.latitude / BLOCK_DEGREE_SCALE;
+    doc["gps"]["longitude"] = r.longitude / BLOCK_DEGREE_SCALE;
+    doc["obd"]["rpm"] = r.rpm;
+    doc["obd"]["speed"] = r.speed;
+    doc["obd"]["maf"] = r.maf;
+    doc["obd"]["instant_mpg"] = r.instantMPG;
+    doc["obd"]["throttle"] = r.throttle;
+    doc["obd"]["avg_mpg"] = r.avgMPG;
+    doc["imu"]["accel_x"] = r.accelX;
+    doc["imu"]["accel_y"] = r.accelY;
+}
+
+
+static bool loadRecords(const char* path, std::vector<BlockRecord>& records, size_t& ndjsonBytes) {
+    std::string text;
+    if (!readFile(path, text)) return false;
+    ndjsonBytes = text.size();
+    std::istringstream lines(text);
+    std::string line;
+    BlockRecord r;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && parseRecord(line, r)) records.push_back(r);
+    }
+    return true;
+}
+
+
+static std::vector<uint8_t> encodeAll(const std::vector<BlockRecord>& records) {
+    std::vector<uint8_t> out;
+    static uint8_t buf[BLOCK_MAX_BYTES];
+    BlockEncoder encoder;
+    for (size_t i = 0; i < records.size(); i++) {
+        encoder.add(records[i]);
+        if (encoder.full() || i + 1 == records.size()) {
+            size_t len = encoder.encode(buf, sizeof(buf));
+            out.insert(out.end(), buf, buf + len);
+            encoder.reset();
+        }
+    }
+    return out;
+}
+
+
+static int encodeCmd(const char* in, const char* outPath) {
+    std::vector<BlockRecord> records;
+    size_t ndjsonBytes;
+    if (!loadRecords(in, records, ndjsonBytes)) return 1;
+    std::vector<uint8_t> out = encodeAll(records);
+    std::ofstream file(outPath, std::ios::binary);
+    file.write((const char*)out.data(), out.size());
+    fprintf(stderr, "%zu records, %zu -> %zu bytes\n", records.size(), ndjsonBytes, out.size());
+    return file ? 0 : 1;
+}
+
+
+static int decodeCmd(const char* in) {
+    std::string data;
+    if (!readFile(in, data)) return 1;
+    const uint8_t* p = (const uint8_t*)data.data();
+    size_t left = data.size();
+    BlockRecord block[BLOCK_RECORDS];
+    JsonDocument doc;
+    while (left > 0) {
+        size_t count;
+        size_t used = blockDecode(p, left, block, count);
+        if (used == 0) {
+            fprintf(stderr, "Malformed block at byte %zu\n", data.size() - left);
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            toJson(block[i], doc);
+            serializeJson(doc, std::cout);
+            std::cout << '\n';
+        }
+        p += used;
+        left -= used;
+    }
+    return 0;
+}
+
+
+template <typename F>
+static double nsPerRecord(size_t records, F fn) {
+    // Repeat until at least 200 ms have passed for a stable figure
+    auto start = std::chrono::steady_clock::now();
+    size_t runs = 0;
+    double elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 2e8);
+    return elapsed / runs / (records ? records : 1);
+}
+
+
+static int benchCmd(int count, char** paths) {
+    printf("%-32s %8s %10s %10s %6s %10s %6s %9s %9s %9s\n", "drive", "records", "ndjson_B",
+           "blocks_B", "ratio", "deflate_B", "ratio", "json_ns", "block_ns", "defl_ns");
+    for (int i = 0; i < count; i++) {
+        std::vector<BlockRecord> records;
+        size_t ndjsonBytes;
+        if (!loadRecords(paths[i], records, ndjsonBytes)) return 1;
+
+        // Round trip check
+        std::vector<uint8_t> blocks = encodeAll(records);
+        size_t at = 0, n = 0;
+        BlockRecord block[BLOCK_RECORDS];
+        while (at < blocks.size()) {
+            size_t got;
+            size_t used = blockDecode(blocks.data() + at, blocks.size() - at, block, got);
+            if (used == 0) break;
+            for (size_t j = 0; j < got; j++, n++) {
+                if (memcmp(&block[j], &records[n], sizeof(BlockRecord)) != 0) {
+                    fprintf(stderr, "%s: round trip mismatch at record %zu\n", paths[i], n);
+                    return 1;
+                }
+            }
+            at += used;
+        }
+
+        // Baselines: what the logger does today, and deflate over its output
+        std::string ndjson, line;
+        JsonDocument doc;
+        for (const BlockRecord& r : records) {
+            toJson(r, doc);
+            serializeJson(doc, line);
+            ndjson += line;
+            ndjson += '\n';
+        }
+        std::vector<uint8_t> deflated(compressBound(ndjson.size()));
+        uLongf deflatedLen = deflated.size();
+
+        double jsonNs = nsPerRecord(records.size(), [&] {
+            std::string out;
+            for (const BlockRecord& r : records) {
+                toJson(r, doc);
+                serializeJson(doc, line);
+                out += line;
+                out += '\n';
+            }
+        });
+        double blockNs = nsPerRecord(records.size(), [&] { encodeAll(records); });
+        double deflNs = nsPerRecord(records.size(), [&] {
+            deflatedLen = deflated.size();
+            compress2(deflated.data(), &deflatedLen, (const Bytef*)ndjson.data(), ndjson.size(), 6);
+        });
+
+        printf("%-32s %8zu %10zu %10zu %6.1f %10lu %6.1f %9.0f %9.0f %9.0f\n", paths[i],
+               records.size(), ndjsonBytes, blocks.size(), (double)ndjsonBytes / blocks.size(),
+               (unsigned long)deflatedLen, (double)ndjsonBytes / deflatedLen, jsonNs, blockNs, deflNs);
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc == 4 && !strcmp(argv[1], "encode")) return encodeCmd(argv[2], argv[3]);
+    if (argc == 3 && !strcmp(argv[1], "decode")) return decodeCmd(argv[2]);
+    if (argc >= 3 && !strcmp(argv[1], "bench")) return benchCmd(argc - 2, argv + 2);
+    fprintf(stderr, "usage: jblock encode DRIVE.json OUT.blk | decode DRIVE.blk | bench DRIVE.json...\n");
+    return 2;
+}
@@ -0,0 +1,111 @@
+//-------------------------------------------------------------------------------
+// record_bench: serialize/parse cost and size of each record encoding
+// (see record_codec.hpp) over recorded NDJSON drives
+//
+//   record_bench DRIVE.json...
+//
+// Build from embedded-system/:
+//   g++ -std=c++17 -O2 -Iinclude -Ilib/ArduinoJson-7.x/src tools/record_bench.cpp src/record_codec.cpp -o record_bench
+//-------------------------------------------------------------------------------
+#include "record_codec.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+template <typename F>
+static double nsPerRecord(size_t records, F fn) {
+    // Repeat until at least 200 ms have passed for a stable figure
+    auto start = std::chrono::steady_clock::now();
+    size_t runs = 0;
+    double elapsed;
+    do {
+        fn();
+        runs++;
+        elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 2e8);
+    return elapsed / runs / (records ? records : 1);
+}
+
+
+static int bench(const char* path) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    std::vector<JsonDocument> records;
+    std::string line;
+    while (std::getline(in, line)) {
+        JsonDocument doc;
+        if (!line.empty() && !deserializeJson(doc, line)) records.push_back(doc);
+    }
+    if (records.empty()) {
+        fprintf(stderr, "%s: no records\n", path);
+        return 1;
+    }
+
+    printf("%s: %zu records\n", path, records.size());
+    printf("  %-8s %10s %12s %10s %10s\n", "encoding", "bytes/rec", "total_B", "ser_ns", "parse_ns");
+    static uint8_t buf[RECORD_MAX_LEN];
+    for (uint8_t e = 0; e < ENCODING_COUNT; e++) {
+        RecordEncoding encoding = (RecordEncoding)e;
+
+        // Encoded stream, as the logger would write it
+        std::string stream;
+        for (const JsonDocument& doc : records) {
+            size_t n = recordSerialize(doc, encoding, buf, sizeof(buf));
+            stream.append((const char*)buf, n);
+        }
+
+        double serNs = nsPerRecord(records.size(), [&] {
+            for (const JsonDocument& doc : records) recordSerialize(doc, encoding, buf, sizeof(buf));
+        });
+
+        // Parse back, splitting records the way RecordReader does
+        JsonDocument out;
+        size_t parsed = 0;
+        double parseNs = nsPerRecord(records.size(), [&] {
+            const uint8_t* p = (const uint8_t*)stream.data();
+            const uint8_t* end = p + stream.size();
+            parsed = 0;
+            while (p < end) {
+                size_t n;
+                if (encoding == ENCODING_NDJSON) {
+                    const uint8_t* nl = (const uint8_t*)memchr(p, '\n', end - p);
+                    n = nl ? nl - p : end - p;
+                    if (!recordDeserialize(out, (const char*)p, n, encoding)) parsed++;
+                    n += 1;
+                } else {
+                    n = recordItemLength(p, end - p, encoding);
+                    if (n == 0) break;
+                    if (!recordDeserialize(out, (const char*)p, n, encoding)) parsed++;
+                }
+                p += n;
+            }
+        });
+        if (parsed != records.size()) {
+            fprintf(stderr, "%s: %s parsed %zu of %zu records\n", path, recordEncodingName(encoding),
+                    parsed, records.size());
+            return 1;
+        }
+
+        printf("  %-8s %10.1f %12zu %10.0f %10.0f\n", recordEncodingName(encoding),
+               (double)stream.size() / records.size(), stream.size(), serNs, parseNs);
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: record_bench DRIVE.json...\n");
+        return 2;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (bench(argv[i])) return 1;
+    }
+    return 0;
+}
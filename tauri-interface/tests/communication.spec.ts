@@ -10,6 +10,21 @@ test('Days endpoint returns valid response', async () => {
   expect(json).toContain('test');
 });
 
+test('Days endpoint pages with after/limit', async () => {
+  const apiContext = await request.newContext();
+  const all = await (await apiContext.get('http://192.168.4.1/days')).json();
+  const sorted = [...all].sort();
+
+  const first = await apiContext.get('http://192.168.4.1/days?limit=1');
+  expect(first.status()).toBe(200);
+  expect(await first.json()).toEqual(sorted.slice(0, 1));
+  expect(first.headers()['x-next-after']).toBe(sorted[0]);
+
+  const rest = await apiContext.get(`http://192.168.4.1/days?after=${sorted[0]}&limit=50`);
+  expect(rest.status()).toBe(200);
+  expect(await rest.json()).toEqual(sorted.slice(1, 51));
+});
+
 test('Drives endpoint returns valid response for day "test"', async () => {
   const apiContext = await request.newContext();
   const response = await apiContext.get('http://192.168.4.1/drives?day=test');
@@ -46,6 +61,77 @@ test('Drive endpoint returns valid drive data for day "test" and drive "dummy.js
   }
 });
 
+test('Drive endpoint filters fields and decimates on the device', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get(
+    'http://192.168.4.1/drive?day=test&drive=dummy.json&fields=obd.speed,gps.latitude&every=2'
+  );
+  expect(response.status()).toBe(200);
+  const text = await response.text();
+  const lines = text.split('\n').filter(line => line.trim() !== '');
+  expect(lines.length).toBe(2);
+  for (const line of lines) {
+    const data = JSON.parse(line);
+    expect(data.gps).toHaveProperty('time');
+    expect(data.gps).toHaveProperty('latitude');
+    expect(data.gps).not.toHaveProperty('longitude');
+    expect(data.obd).toHaveProperty('speed');
+    expect(data.obd).not.toHaveProperty('rpm');
+    expect(data).not.toHaveProperty('imu');
+  }
+});
+
+test('Drive endpoint applies a time window', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get(
+    'http://192.168.4.1/drive?day=test&drive=dummy.json&from=16:09:35&to=16:09:38'
+  );
+  expect(response.status()).toBe(200);
+  const text = await response.text();
+  const times = text.split('\n').filter(line => line.trim() !== '').map(line => JSON.parse(line).gps.time);
+  expect(times).toEqual(['16:09:35', '16:09:38']);
+});
+
+test('Overview endpoint rejects an unknown level', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/overview?day=test&drive=dummy.json&level=7');
+  expect(response.status()).toBe(400);
+});
+
+test('Overview endpoint returns 404 for a drive without buckets', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/overview?day=test&drive=dummy.json&level=60');
+  expect(response.status()).toBe(404);
+});
+
+test('Sync endpoint starts with a manifest and frames every journey', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/sync?since=0');
+  expect(response.status()).toBe(200);
+  const body = await response.body();
+  let offset = body.indexOf(10);
+  const manifest = JSON.parse(body.subarray(0, offset).toString());
+  expect(manifest).toHaveProperty('gen');
+  expect(manifest).toHaveProperty('more');
+  expect(Array.isArray(manifest.journeys)).toBe(true);
+  offset += 1;
+  for (const journey of manifest.journeys) {
+    const end = body.indexOf(10, offset);
+    const frame = JSON.parse(body.subarray(offset, end).toString());
+    expect(frame.day).toBe(journey.day);
+    expect(frame.drive).toBe(journey.drive);
+    expect(frame.size).toBe(journey.size);
+    offset = end + 1 + frame.size;
+  }
+  expect(offset).toBe(body.length);
+});
+
+test('Sync acknowledgement rejects a future generation', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.post('http://192.168.4.1/sync/ack?gen=4294967295');
+  expect(response.status()).toBe(400);
+});
+
 test('SD Info endpoint returns valid diagnostics', async () => {
   const apiContext = await request.newContext();
   const response = await apiContext.get('http://192.168.4.1/sdinfo');
@@ -56,6 +142,113 @@ test('SD Info endpoint returns valid diagnostics', async () => {
   expect(json).toHaveProperty('used_size');
   expect(json).toHaveProperty('free_size');
   expect(json).toHaveProperty('esp32_uptime_sec');
+  expect(json).toHaveProperty('spi_clock_mhz');
+  expect(json.spi_clock_mhz).toBeGreaterThanOrEqual(1);
+  expect(json).toHaveProperty('read_mbps');
+  expect(json).toHaveProperty('write_mbps');
+  expect(typeof json.free_pending).toBe('boolean');
+  expect(json).toHaveProperty('retention');
+  expect(typeof json.retention.evicting).toBe('boolean');
+});
+
+test('Starring a missing drive returns 404', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.post('http://192.168.4.1/star?day=test&drive=missing.json');
+  expect(response.status()).toBe(404);
+});
+
+test('A recorded drive can be starred and unstarred', async () => {
+  const apiContext = await request.newContext();
+  const sync = await apiContext.get('http://192.168.4.1/sync?since=0');
+  expect(sync.status()).toBe(200);
+  const body = await sync.body();
+  const manifest = JSON.parse(body.subarray(0, body.indexOf(10)).toString());
+  test.skip(manifest.journeys.length === 0, 'No recorded drive on the card');
+
+  // Journeys recorded as segments have no flat .json file, only a directory
+  const { day, drive } = manifest.journeys[0];
+  const star = await apiContext.post(`http://192.168.4.1/star?day=${day}&drive=${drive}`);
+  expect(star.status()).toBe(200);
+  const unstar = await apiContext.post(`http://192.168.4.1/star?day=${day}&drive=${drive}&on=0`);
+  expect(unstar.status()).toBe(200);
+});
+
+test('Summary endpoint returns a JSON array for day "test"', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/summary?day=test');
+  expect(response.status()).toBe(200);
+  const json = await response.json();
+  expect(Array.isArray(json)).toBe(true);
+  for (const summary of json) {
+    expect(summary).toHaveProperty('drive');
+    expect(summary).toHaveProperty('duration_sec');
+    expect(summary).toHaveProperty('distance_km');
+    expect(summary).toHaveProperty('avg_mpg');
+    expect(summary).toHaveProperty('harsh');
+    expect(summary).toHaveProperty('channels');
+  }
+});
+
+test('Summary endpoint rejects a missing day', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/summary');
+  expect(response.status()).toBe(400);
+});
+
+test('Delete status reports the background queue', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/delete/status');
+  expect(response.status()).toBe(200);
+  const json = await response.json();
+  expect(typeof json.running).toBe('boolean');
+  expect(json).toHaveProperty('queued');
+  expect(json).toHaveProperty('max_hold_ms');
+});
+
+test('Drive endpoint seeks to a time with at=', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/drive?day=test&drive=dummy.json&at=00:00:00&seek=scan');
+  expect(response.status()).toBe(200);
+  expect(response.headers()['x-seek-method']).toBe('scan');
+  expect(Number(response.headers()['x-seek-us'])).toBeGreaterThanOrEqual(0);
+});
+
+test('Drive endpoint rejects a malformed at=', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/drive?day=test&drive=dummy.json&at=45');
+  expect(response.status()).toBe(400);
+});
+
+test('Config endpoint reports the record encoding', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/config');
+  expect(response.status()).toBe(200);
+  const json = await response.json();
+  expect(json.encodings).toEqual(['ndjson', 'msgpack', 'cbor']);
+  expect(json.encodings).toContain(json.encoding);
+});
+
+test('Config endpoint rejects an unknown encoding', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.post('http://192.168.4.1/config?encoding=xml');
+  expect(response.status()).toBe(400);
+});
+
+test('Segments endpoint lists a legacy drive as one closed segment', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/segments?day=test&drive=dummy.json');
+  expect(response.status()).toBe(200);
+  const json = await response.json();
+  expect(json).toHaveLength(1);
+  expect(json[0].seg).toBe(0);
+  expect(json[0].bytes).toBeGreaterThan(0);
+  expect(json[0].closed).toBe(true);
+});
+
+test('Segment endpoint returns 404 for a missing segment', async () => {
+  const apiContext = await request.newContext();
+  const response = await apiContext.get('http://192.168.4.1/segment?day=test&drive=dummy.json&seg=1');
+  expect(response.status()).toBe(404);
 });
 
 test.describe.serial('Delete drive file tests', () => {